@@ -194,4 +194,202 @@ static inline void bs_align_1( bs_t *s )
     }
 }
 
+/**
+ * Cached bitstream reader
+ *
+ * Unlike bs_t, up to 64 bits are loaded at once into a cache, so that most
+ * reads, peeks and skips are a shift. Exp-Golomb codes are decoded by
+ * counting the leading zeroes of the cache. With bs64_init_nal(), the
+ * emulation prevention bytes of H.264, VC-1 or HEVC NAL units (00 00 03)
+ * are skipped while reading, so the NAL does not need to be copied first.
+ * Reading past the end returns zeroes, as bs_read() does.
+ */
+typedef struct bs64_s
+{
+    const uint8_t *p_start;
+    const uint8_t *p;       /* next byte to load into the cache */
+    const uint8_t *p_end;
+
+    uint64_t i_cache;       /* next bits, most significant first */
+    int      i_cached;      /* number of valid bits, negative past the end */
+    bool     b_ep;          /* skip emulation prevention bytes */
+    unsigned i_zeros;       /* zero bytes loaded in a row */
+    unsigned i_ep;          /* emulation prevention bytes skipped */
+} bs64_t;
+
+static inline void bs64_init( bs64_t *s, const void *p_data, size_t i_data )
+{
+    s->p_start  = p_data;
+    s->p        = s->p_start;
+    s->p_end    = s->p_start + i_data;
+    s->i_cache  = 0;
+    s->i_cached = 0;
+    s->b_ep     = false;
+    s->i_zeros  = 0;
+    s->i_ep     = 0;
+}
+
+static inline void bs64_init_nal( bs64_t *s, const void *p_data,
+                                  size_t i_data )
+{
+    bs64_init( s, p_data, i_data );
+    s->b_ep = true;
+}
+
+static inline unsigned bs64_clz( uint64_t x )
+{
+#ifdef __GNUC__
+    return x ? __builtin_clzll( x ) : 64;
+#else
+    unsigned i = 64;
+
+    while( x )
+    {
+        x >>= 1;
+        i--;
+    }
+    return i;
+#endif
+}
+
+/* Loads at least 57 bits into the cache, unless the end is reached. Bits
+ * below i_cached are either zeroes or the next bits of the stream, so that
+ * they can be ORed again. */
+static inline void bs64_refill( bs64_t *s )
+{
+    if( s->p_end - s->p >= 8 )
+    {
+        const uint64_t i_word = GetQWBE( s->p );
+        const unsigned i_bytes = ( 64 - s->i_cached ) >> 3;
+
+        if( s->b_ep )
+        {
+            /* 0x80 in each zero byte */
+            const uint64_t i_low = UINT64_C(0x7f7f7f7f7f7f7f7f);
+            const uint64_t i_nul = ~( ( ( i_word & i_low ) + i_low )
+                                      | i_word | i_low );
+            const uint8_t i_first = i_word >> 56;
+
+            /* Without two zero bytes in a row, including the ones already
+             * read, there is no emulation prevention byte in the word */
+            if( ( i_nul & ( i_nul << 8 ) )
+             || ( s->i_zeros >= 1 && i_first == 0x00 )
+             || ( s->i_zeros >= 2 && i_first == 0x03 ) )
+                goto bytes;
+            s->i_zeros = ( i_nul >> ( 71 - 8 * i_bytes ) ) & 1;
+        }
+        s->i_cache |= i_word >> s->i_cached;
+        s->p += i_bytes;
+        s->i_cached += 8 * i_bytes;
+        return;
+    }
+
+bytes:
+
+    while( s->i_cached <= 56 && s->p < s->p_end )
+    {
+        const uint8_t i_byte = *s->p++;
+
+        if( s->b_ep )
+        {
+            /* A 03 ending the buffer is kept, as startcode_RemoveEP3B() */
+            if( i_byte == 0x03 && s->i_zeros >= 2 && s->p < s->p_end )
+            {
+                s->i_zeros = 0;
+                s->i_ep++;
+                continue;
+            }
+            s->i_zeros = i_byte ? 0 : s->i_zeros + 1;
+        }
+        s->i_cache |= (uint64_t)i_byte << ( 56 - s->i_cached );
+        s->i_cached += 8;
+    }
+}
+
+static inline int bs64_pos( const bs64_t *s )
+{
+    return 8 * ( s->p - s->p_start - s->i_ep ) - s->i_cached;
+}
+
+static inline int bs64_eof( const bs64_t *s )
+{
+    return s->p >= s->p_end && s->i_cached <= 0;
+}
+
+/* Returns the next i_count bits (0 to 32) without consuming them */
+static inline uint32_t bs64_show( bs64_t *s, unsigned i_count )
+{
+    if( s->i_cached < (int)i_count )
+        bs64_refill( s );
+    return ( s->i_cache >> 1 ) >> ( 63 - i_count );
+}
+
+static inline uint32_t bs64_read( bs64_t *s, unsigned i_count )
+{
+    const uint32_t i_result = bs64_show( s, i_count );
+
+    s->i_cache <<= i_count;
+    s->i_cached -= i_count;
+    return i_result;
+}
+
+static inline uint32_t bs64_read1( bs64_t *s )
+{
+    return bs64_read( s, 1 );
+}
+
+static inline void bs64_skip( bs64_t *s, size_t i_count )
+{
+    for( ; i_count > 32; i_count -= 32 )
+        bs64_read( s, 32 );
+    bs64_read( s, i_count );
+}
+
+static inline void bs64_align( bs64_t *s )
+{
+    bs64_skip( s, s->i_cached & 7 );
+}
+
+/**
+ * Reads an unsigned Exp-Golomb code. A code with more than 31 leading
+ * zeroes is invalid: 32 bits are skipped and UINT32_MAX is returned.
+ */
+static inline uint32_t bs64_read_ue( bs64_t *s )
+{
+    if( s->i_cached < 32 )
+        bs64_refill( s );
+
+    const unsigned i_zeros = bs64_clz( s->i_cache );
+
+    if( unlikely( i_zeros >= 32 || (int)i_zeros >= s->i_cached ) )
+    {
+        if( s->i_cached > 32 )
+        {
+            bs64_read( s, 32 );
+            return UINT32_MAX;
+        }
+
+        /* Only zeroes are left: consume them, as the former
+         * h264 packetizer bs_read_ue() did */
+        const int i_left = s->i_cached;
+
+        s->i_cache = 0;
+        s->i_cached = __MIN( i_left, 0 );
+        return i_left > 1 ? ( 1u << ( i_left - 1 ) ) - 1 : 0;
+    }
+
+    s->i_cache <<= i_zeros + 1;
+    s->i_cached -= i_zeros + 1;
+    return ( 1u << i_zeros ) - 1 + bs64_read( s, i_zeros );
+}
+
+/* Reads a signed Exp-Golomb code */
+static inline int32_t bs64_read_se( bs64_t *s )
+{
+    const uint32_t i_val = bs64_read_ue( s );
+
+    return ( i_val & 1 ) ? (int32_t)( ( i_val >> 1 ) + 1 )
+                         : -(int32_t)( i_val >> 1 );
+}
+
 #endif
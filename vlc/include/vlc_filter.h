@@ -36,6 +36,7 @@
  */
 
 typedef struct filter_owner_sys_t filter_owner_sys_t;
+typedef struct filter_slices_t filter_slices_t;
 
 /** Structure describing a filter
  * @warning BIG FAT WARNING : the code relies on the first 4 members of
@@ -134,6 +135,10 @@ struct filter_t
 
     /* Private structure for the owner of the decoder */
     filter_owner_sys_t *p_owner;
+
+    /* Worker threads for filter_ProcessSlices(), set by the owner
+     * (NULL if the filter must run on the calling thread only) */
+    filter_slices_t *p_slices;
 };
 
 /**
@@ -262,6 +267,41 @@ VLC_EXPORT( int, filter_Blend, ( filter_t *, picture_t *p_dst, int i_dst_x, int
  */
 VLC_EXPORT( void, filter_DeleteBlend, ( filter_t * ) );
 
+/**
+ * Processes the lines [i_first, i_last) of a picture band.
+ *
+ * It may be called from any thread, and concurrently for different bands of
+ * the same picture, so it must only write to the lines of its band.
+ */
+typedef void (*filter_slice_cb)( filter_t *, void *p_data,
+                                 unsigned i_first, unsigned i_last );
+
+/**
+ * It splits the lines [0, i_lines) of a picture into horizontal bands, and
+ * runs pf_slice on them, in parallel on the slice threads of the filter owner
+ * if any. The calling thread takes part in the work.
+ * It returns once all the bands have been processed.
+ *
+ * The bands boundaries are multiples of i_align (for instance 2 so that the
+ * 4:2:0 chroma lines are split the same way as the luma lines).
+ */
+VLC_EXPORT( void, filter_ProcessSlices, ( filter_t *, filter_slice_cb pf_slice, void *p_data, unsigned i_lines, unsigned i_align ) );
+
+/**
+ * It converts a band of lines of the first plane of a picture, as given to
+ * a filter_slice_cb, to the matching band of lines of another plane.
+ */
+static inline void filter_SlicePlane( const picture_t *p_picture, int i_plane,
+                                      unsigned i_first, unsigned i_last,
+                                      int *pi_first, int *pi_last )
+{
+    const int64_t i_lines = p_picture->p[0].i_visible_lines;
+    const int64_t i_plane_lines = p_picture->p[i_plane].i_visible_lines;
+
+    *pi_first = i_first * i_plane_lines / i_lines;
+    *pi_last  = i_last  * i_plane_lines / i_lines;
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -325,6 +325,7 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    int64_t i_decoder_fifo; /* Bytes waiting to be decoded */
 
     /* Vout */
     int64_t i_displayed_pictures;
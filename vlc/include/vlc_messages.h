@@ -164,6 +164,12 @@ struct counter_t
 
     mtime_t             update_interval;
     mtime_t             last_update;
+
+    /* STATS_COUNTER total and STATS_DERIVATIVE last value. Integers are
+     * updated with 64-bits atomic operations where available, floats under
+     * the lock. The derivative samples are only taken by the readers. */
+    vlc_mutex_t         value_lock;
+    vlc_value_t         value;
 };
 
 enum
@@ -287,6 +287,12 @@ VLC_EXPORT( void,  playlist_Clear, ( playlist_t *, bool ) );
 /** Enqueue an input item for preparsing */
 VLC_EXPORT( int, playlist_PreparseEnqueue, (playlist_t *, input_item_t * ) );
 
+/** Preparse an enqueued input item before the ones not visible to the user */
+VLC_EXPORT( int, playlist_PreparsePrioritize, (playlist_t *, input_item_t * ) );
+
+/** Withdraw one request to preparse an input item */
+VLC_EXPORT( void, playlist_PreparseCancel, (playlist_t *, input_item_t * ) );
+
 /** Request the art for an input item to be fetched */
 VLC_EXPORT( int, playlist_AskForArtEnqueue, (playlist_t *, input_item_t * ) );
 
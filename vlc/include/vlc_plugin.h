@@ -53,6 +53,11 @@ enum vlc_module_properties
     VLC_MODULE_DESCRIPTION,
     VLC_MODULE_HELP,
     VLC_MODULE_TEXTDOMAIN,
+    VLC_MODULE_MAGIC,
+    /* signature (args=unsigned offset, const char *bytes, size_t length) */
+
+    VLC_MODULE_EXTENSION,
+    /* file name extensions (args=unsigned count, const char *const *) */
     /* Insert new VLC_MODULE_* here */
 
     /* DO NOT EVER REMOVE, INSERT OR REPLACE ANY ITEM! It would break the ABI!
@@ -229,6 +234,24 @@ enum vlc_module_properties
      || vlc_module_set (p_submodule, VLC_MODULE_CB_CLOSE, deactivate)) \
         goto error;
 
+/* Magic bytes identifying the handled format at a given offset, for probing.
+ * The magic must be a string literal of at most 13 bytes, and end within the
+ * first 2048 bytes of the stream. */
+#define add_magic( offset, magic ) \
+    if (vlc_module_set (p_submodule, VLC_MODULE_MAGIC, (unsigned)(offset), \
+                        (const char *)(magic), sizeof(magic) - 1)) \
+        goto error;
+
+/* File name extensions of the handled format, for probing */
+#define add_extension( ... ) \
+{ \
+    const char *extensions[] = { __VA_ARGS__ }; \
+    if (vlc_module_set (p_submodule, VLC_MODULE_EXTENSION, \
+                        (unsigned)(sizeof(extensions)/sizeof(extensions[0])), \
+                        extensions)) \
+        goto error; \
+}
+
 #define cannot_unload_broken_library( ) \
     if (vlc_module_set (p_submodule, VLC_MODULE_NO_UNLOAD)) \
         goto error;
@@ -364,7 +364,8 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->still.b_enabled = false;
     vlc_mutex_init( &p_sys->still.lock );
-    if( !vlc_timer_create( &p_sys->still.timer, StillTimer, p_sys ) )
+    if( !vlc_timer_create_blocking( &p_sys->still.timer, StillTimer,
+                                    p_sys ) )
         p_sys->still.b_created = true;
 
     return VLC_SUCCESS;
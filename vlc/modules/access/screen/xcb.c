@@ -202,7 +202,7 @@ static int Open (vlc_object_t *obj)
     p_sys->es = NULL;
     p_sys->pts = VLC_TS_INVALID;
     vlc_mutex_init (&p_sys->lock);
-    if (vlc_timer_create (&p_sys->timer, Demux, demux))
+    if (vlc_timer_create_blocking (&p_sys->timer, Demux, demux))
         goto error;
     vlc_timer_schedule (p_sys->timer, false, 1, p_sys->interval);
 
@@ -41,6 +41,11 @@
 #include <vlc_access.h>
 #include <vlc_network.h>
 
+#include <errno.h>
+#ifdef HAVE_RECVMMSG
+# include <sys/socket.h>
+#endif
+
 #define MTU 65535
 
 /*****************************************************************************
@@ -51,6 +56,11 @@
     "Caching value for UDP streams. This " \
     "value should be set in milliseconds." )
 
+#define BATCH_TEXT N_("Receive batch")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams read from the socket at once. " \
+    "Larger values reduce the system call overhead at high packet rates." )
+
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
@@ -63,6 +73,8 @@ vlc_module_begin ()
     add_integer( "udp-caching", DEFAULT_PTS_DELAY / 1000, NULL, CACHING_TEXT,
                  CACHING_LONGTEXT, true )
         change_safe()
+    add_integer( "udp-batch", 32, NULL, BATCH_TEXT, BATCH_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
     add_obsolete_integer( "rtp-late" )
     add_obsolete_bool( "udp-auto-mtu" )
 
@@ -83,12 +95,26 @@ vlc_module_end ()
 static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
 
+struct access_sys_t
+{
+    int       fd;
+    unsigned  i_batch;
+    unsigned  i_next;  /* next pending datagram */
+    unsigned  i_count; /* received datagrams */
+    uint8_t  *p_ring;  /* i_batch buffers of MTU bytes */
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr *p_msgs;
+    struct iovec   *p_iov;
+#endif
+};
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
 static int Open( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys;
 
     char *psz_name = strdup( p_access->psz_location );
     char *psz_parser;
@@ -167,7 +193,49 @@ static int Open( vlc_object_t *p_this )
         msg_Err( p_access, "cannot open socket" );
         return VLC_EGENERIC;
     }
-    p_access->p_sys = (void *)(intptr_t)fd;
+
+    p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        net_Close( fd );
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+    p_sys->i_next = p_sys->i_count = 0;
+#ifdef HAVE_RECVMMSG
+    p_sys->i_batch = var_InheritInteger( p_access, "udp-batch" );
+    if( p_sys->i_batch < 1 )
+        p_sys->i_batch = 1;
+#else
+    p_sys->i_batch = 1;
+#endif
+    p_sys->p_ring = malloc( p_sys->i_batch * MTU );
+#ifdef HAVE_RECVMMSG
+    p_sys->p_msgs = calloc( p_sys->i_batch, sizeof( *p_sys->p_msgs ) );
+    p_sys->p_iov = calloc( p_sys->i_batch, sizeof( *p_sys->p_iov ) );
+    if( p_sys->p_msgs == NULL || p_sys->p_iov == NULL )
+    {
+        free( p_sys->p_msgs );
+        free( p_sys->p_iov );
+        free( p_sys->p_ring );
+        p_sys->p_ring = NULL;
+    }
+    else
+        for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        {
+            p_sys->p_iov[i].iov_base = p_sys->p_ring + i * MTU;
+            p_sys->p_iov[i].iov_len = MTU;
+            p_sys->p_msgs[i].msg_hdr.msg_iov = &p_sys->p_iov[i];
+            p_sys->p_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    if( unlikely(p_sys->p_ring == NULL) )
+    {
+        net_Close( fd );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_access->p_sys = p_sys;
 
     /* Update default_pts to a suitable value for udp access */
     var_Create( p_access, "udp-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
@@ -180,8 +248,15 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
 
-    net_Close( (intptr_t)p_access->p_sys );
+    net_Close( p_sys->fd );
+#ifdef HAVE_RECVMMSG
+    free( p_sys->p_msgs );
+    free( p_sys->p_iov );
+#endif
+    free( p_sys->p_ring );
+    free( p_sys );
 }
 
 /*****************************************************************************
@@ -227,25 +302,55 @@ static int Control( access_t *p_access, int i_query, va_list args )
 
 /*****************************************************************************
  * BlockUDP:
+ *****************************************************************************
+ * Datagrams are received up to udp-batch at a time into a preallocated ring,
+ * then handed out one per call in a block of their own size.
  *****************************************************************************/
 static block_t *BlockUDP( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
     block_t      *p_block;
+    const uint8_t *p_data;
     ssize_t len;
 
     if( p_access->info.b_eof )
         return NULL;
 
-    /* Read data */
-    p_block = block_New( p_access, MTU );
-    len = net_Read( p_access, (intptr_t)p_sys, NULL,
-                    p_block->p_buffer, MTU, false );
-    if( len < 0 )
+#ifdef HAVE_RECVMMSG
+    if( p_sys->i_next >= p_sys->i_count && p_sys->i_batch > 1 )
     {
-        block_Release( p_block );
-        return NULL;
+        /* Drain whatever is already queued on the socket */
+        int n = recvmmsg( p_sys->fd, p_sys->p_msgs, p_sys->i_batch,
+                          MSG_DONTWAIT, NULL );
+
+        p_sys->i_next = 0;
+        p_sys->i_count = (n > 0) ? n : 0;
+        if( n == -1 && errno == ENOSYS )
+        {
+            msg_Warn( p_access, "batched receive not supported" );
+            p_sys->i_batch = 1;
+        }
+    }
+
+    if( p_sys->i_next < p_sys->i_count )
+    {
+        const struct mmsghdr *p_msg = &p_sys->p_msgs[p_sys->i_next++];
+
+        p_data = p_msg->msg_hdr.msg_iov->iov_base;
+        len = p_msg->msg_len;
+    }
+    else
+#endif
+    {
+        /* Nothing pending: wait for the next datagram */
+        p_data = p_sys->p_ring;
+        len = net_Read( p_access, p_sys->fd, NULL, p_sys->p_ring, MTU, false );
+        if( len < 0 )
+            return NULL;
     }
 
-    return block_Realloc( p_block, 0, len );
+    p_block = block_Alloc( len );
+    if( likely(p_block != NULL) )
+        memcpy( p_block->p_buffer, p_data, len );
+    return p_block;
 }
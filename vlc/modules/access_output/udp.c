@@ -51,6 +51,8 @@
 
 #include <vlc_network.h>
 
+#include <errno.h>
+
 #define MAX_EMPTY_BLOCKS 200
 
 /*****************************************************************************
@@ -73,6 +75,10 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Send batch")
+#define BATCH_LONGTEXT N_("Maximum number of packets which are due at the " \
+                          "same time and sent with a single system call." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -81,6 +87,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, NULL, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, NULL, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "batch", 32, NULL, BATCH_TEXT, BATCH_LONGTEXT,
+                                 true )
+        change_integer_range( 1, 1024 )
     add_obsolete_integer( SOUT_CFG_PREFIX "late" )
     add_obsolete_bool( SOUT_CFG_PREFIX "raw" )
 
@@ -96,6 +105,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
     NULL
 };
 
@@ -126,6 +136,15 @@ struct sout_access_out_sys_t
     block_fifo_t *p_empty_blocks;
     block_t      *p_buffer;
 
+    /* Packets being sent by the thread */
+    unsigned      i_batch;
+    unsigned      i_batched;
+    block_t     **pp_batch;
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr *p_msgs;
+    struct iovec   *p_iov;
+#endif
+
     vlc_thread_t  thread;
 };
 
@@ -219,12 +238,37 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
 
+#ifdef HAVE_SENDMMSG
+    p_sys->i_batch = var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+    if( p_sys->i_batch < 1 )
+        p_sys->i_batch = 1;
+    p_sys->p_msgs = calloc( p_sys->i_batch, sizeof( *p_sys->p_msgs ) );
+    p_sys->p_iov = calloc( p_sys->i_batch, sizeof( *p_sys->p_iov ) );
+    if( p_sys->p_msgs == NULL || p_sys->p_iov == NULL )
+    {
+        free( p_sys->p_msgs );
+        free( p_sys->p_iov );
+        p_sys->p_msgs = NULL;
+        p_sys->p_iov = NULL;
+        p_sys->i_batch = 1;
+    }
+#else
+    p_sys->i_batch = 1;
+#endif
+    p_sys->i_batched = 0;
+    p_sys->pp_batch = xmalloc( p_sys->i_batch * sizeof( *p_sys->pp_batch ) );
+
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
         block_FifoRelease( p_sys->p_fifo );
         block_FifoRelease( p_sys->p_empty_blocks );
+#ifdef HAVE_SENDMMSG
+        free( p_sys->p_msgs );
+        free( p_sys->p_iov );
+#endif
+        free( p_sys->pp_batch );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
@@ -253,6 +297,11 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
 
     net_Close( p_sys->i_handle );
+#ifdef HAVE_SENDMMSG
+    free( p_sys->p_msgs );
+    free( p_sys->p_iov );
+#endif
+    free( p_sys->pp_batch );
     free( p_sys );
 }
 
@@ -397,6 +446,68 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * BatchRelease: drop the packets of a cancelled batch
+ *****************************************************************************/
+static void BatchRelease( void *data )
+{
+    sout_access_out_sys_t *p_sys = data;
+
+    for( unsigned i = 0; i < p_sys->i_batched; i++ )
+        block_Release( p_sys->pp_batch[i] );
+    p_sys->i_batched = 0;
+}
+
+/*****************************************************************************
+ * BatchSend: send the packets of the batch, with one system call if possible
+ *****************************************************************************/
+static void BatchSend( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i = 0;
+
+#ifdef HAVE_SENDMMSG
+    if( p_sys->i_batched > 1 )
+    {
+        for( unsigned j = 0; j < p_sys->i_batched; j++ )
+        {
+            p_sys->p_iov[j].iov_base = p_sys->pp_batch[j]->p_buffer;
+            p_sys->p_iov[j].iov_len = p_sys->pp_batch[j]->i_buffer;
+            memset( &p_sys->p_msgs[j], 0, sizeof( p_sys->p_msgs[j] ) );
+            p_sys->p_msgs[j].msg_hdr.msg_iov = &p_sys->p_iov[j];
+            p_sys->p_msgs[j].msg_hdr.msg_iovlen = 1;
+        }
+
+        while( i < p_sys->i_batched )
+        {
+            int val = sendmmsg( p_sys->i_handle, p_sys->p_msgs + i,
+                                p_sys->i_batched - i, 0 );
+            if( val == -1 )
+            {
+                if( errno == ENOSYS )
+                {
+                    msg_Warn( p_access, "batched send not supported" );
+                    p_sys->i_batch = 1;
+                    break;
+                }
+                /* Skip the failed packet, like a single send() would */
+                msg_Warn( p_access, "send error: %m" );
+                val = 1;
+            }
+            i += val;
+        }
+    }
+#endif
+
+    for( ; i < p_sys->i_batched; i++ )
+    {
+        block_t *p_pk = p_sys->pp_batch[i];
+
+        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %m" );
+    }
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -438,15 +549,45 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
+        p_sys->pp_batch[0] = p_pk;
+        p_sys->i_batched = 1;
+        vlc_cleanup_push( BatchRelease, p_sys );
+        /* Date of the last packet of the batch (not i_date itself, which
+         * would be live across the cancellation cleanup setjmp()) */
+        mtime_t i_batch_date = i_date;
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %m" );
+
+        /* Take along the next packets which would not wait either */
+        if( p_sys->i_batch > 1 )
+        {
+            mtime_t now = mdate();
+
+            while( p_sys->i_batched < p_sys->i_batch
+                && block_FifoCount( p_sys->p_fifo ) > 0 )
+            {
+                block_t *p_next = block_FifoShow( p_sys->p_fifo );
+                mtime_t i_next = p_sys->i_caching + p_next->i_dts;
+                bool b_wait = i_to_send == 1
+                           || (p_next->i_flags & BLOCK_FLAG_CLOCK);
+
+                if( i_next - i_batch_date > 2000000
+                 || (b_wait && i_next > now) )
+                    break;
+
+                p_sys->pp_batch[p_sys->i_batched++] =
+                    block_FifoGet( p_sys->p_fifo );
+                i_to_send = b_wait ? i_group : i_to_send - 1;
+                i_batch_date = i_next;
+            }
+        }
+
+        BatchSend( p_access );
+        i_date = i_batch_date;
         vlc_cleanup_pop();
 
         if( i_dropped_packets )
@@ -464,7 +605,9 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+        for( unsigned i = 0; i < p_sys->i_batched; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, p_sys->pp_batch[i] );
+        p_sys->i_batched = 0;
 
         i_date_last = i_date;
     }
@@ -38,6 +38,7 @@
 #include <vlc_aout.h>
 #include <vlc_block.h>
 #include <vlc_filter.h>
+#include "pcm_helper.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -320,28 +321,8 @@ static block_t *S32toS16(filter_t *filter, block_t *b)
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = *src * 32768.0;
-        src++; dst++;
-#else
-        /* This is walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.0;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
-
+    pcm_Fl32toS16((int16_t *)b->p_buffer, (float *)b->p_buffer,
+                  b->i_buffer / 4);
     b->i_buffer /= 2;
     return b;
 }
@@ -367,10 +348,8 @@ static block_t *Fl64toS16(filter_t *filter, block_t *b)
 static block_t *S32toFl32(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / 2147483648.0;
+    pcm_S32toFl32((float *)b->p_buffer, (int32_t *)b->p_buffer,
+                  b->i_buffer / 4);
     return b;
 }
 static block_t *Fi32toFl32(filter_t *filter, block_t *b)
@@ -449,35 +428,13 @@ static void S16toS32(block_t *bdst, const block_t *bsrc)
 }
 static void S16toFl32(block_t *bdst, const block_t *bsrc)
 {
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float *dst = (float *)bdst->p_buffer;
-    for (int i = bsrc->i_buffer / 2; i--;) {
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.0;
-#else
-        /* This is walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.0;
-#endif
-    }
+    pcm_S16toFl32((float *)bdst->p_buffer, (int16_t *)bsrc->p_buffer,
+                  bsrc->i_buffer / 2);
 }
 static void S24toFl32(block_t *bdst, const block_t *bsrc)
 {
-    uint8_t *src = bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (int i = bsrc->i_buffer / 3; i--;) {
-#ifdef WORDS_BIGENDIAN
-        int32_t v = (src[0] << 24) | (src[1] << 16) | (src[2] <<  8);
-#else
-        int32_t v = (src[0] <<  8) | (src[1] << 16) | (src[2] << 24);
-#endif
-        src += 3;
-        *dst++ = v / 2147483648.0;
-    }
+    pcm_S24toFl32((float *)bdst->p_buffer, bsrc->p_buffer,
+                  bsrc->i_buffer / 3);
 }
 
 /* */
@@ -496,12 +453,7 @@ static void Swap64(block_t *b)
 }
 static void Swap32(block_t *b)
 {
-    uint8_t *data = (uint8_t *)b->p_buffer;
-    for (size_t i = 0; i < b->i_buffer / 4; i++) {
-        XCHG(uint8_t, data[0], data[3]);
-        XCHG(uint8_t, data[1], data[2]);
-        data += 4;
-    }
+    pcm_Swap32(b->p_buffer, b->i_buffer / 4);
 }
 static void Swap24(block_t *b)
 {
@@ -513,11 +465,7 @@ static void Swap24(block_t *b)
 }
 static void Swap16(block_t *b)
 {
-    uint8_t *data = (uint8_t *)b->p_buffer;
-    for (size_t i = 0; i < b->i_buffer / 2; i++) {
-        XCHG(uint8_t, data[0], data[1]);
-        data += 2;
-    }
+    pcm_Swap16(b->p_buffer, b->i_buffer / 2);
 }
 
 /* */
@@ -0,0 +1,517 @@
+/*****************************************************************************
+ * pcm_helper.h: PCM mixing and conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2002-2005 the VideoLAN team
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PCM_HELPER_H
+#define _PCM_HELPER_H 1
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* Every kernel has a plain C version, which defines the exact results, and
+ * vector versions that must produce the very same bits (but for denormals,
+ * which NEON flushes to zero). The vector loops leave the remaining samples
+ * to the C version.
+ * Unless noted, the destination may be the source (in place conversion). */
+
+/*****************************************************************************
+ * C versions
+ *****************************************************************************/
+static inline void pcm_ScaleFl32_C( float *dst, const float *src, size_t n,
+                                    float f )
+{
+    while( n-- )
+        *dst++ = *src++ * f;
+}
+
+static inline void pcm_MixFl32_C( float *dst, const float *src, size_t n,
+                                  float f )
+{
+    while( n-- )
+        *dst++ += *src++ * f;
+}
+
+static inline void pcm_Fl32toS16_C( int16_t *dst, const float *src, size_t n )
+{
+    while( n-- )
+    {
+        /* This is walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.f = *src++ + 384.0;
+        if( u.i > 0x43c07fff )
+            *dst++ = 32767;
+        else if( u.i < 0x43bf8000 )
+            *dst++ = -32768;
+        else
+            *dst++ = u.i - 0x43c00000;
+    }
+}
+
+/* dst and src must not overlap */
+static inline void pcm_S16toFl32_C( float *dst, const int16_t *src, size_t n )
+{
+    while( n-- )
+    {
+        /* This is walken's trick based on IEEE float format. On my PIII
+         * this takes 16 seconds to perform one billion conversions, instead
+         * of 19 seconds for a division. */
+        union { float f; int32_t i; } u;
+        u.i = *src++ + 0x43c00000;
+        *dst++ = u.f - 384.0;
+    }
+}
+
+static inline void pcm_S32toFl32_C( float *dst, const int32_t *src, size_t n )
+{
+    while( n-- )
+        *dst++ = (float)(*src++) / 2147483648.0;
+}
+
+/* dst and src must not overlap */
+static inline void pcm_S24toFl32_C( float *dst, const uint8_t *src, size_t n )
+{
+    while( n-- )
+    {
+#ifdef WORDS_BIGENDIAN
+        int32_t v = (src[0] << 24) | (src[1] << 16) | (src[2] <<  8);
+#else
+        int32_t v = (src[0] <<  8) | (src[1] << 16) | (src[2] << 24);
+#endif
+        src += 3;
+        *dst++ = v / 2147483648.0;
+    }
+}
+
+static inline void pcm_Swap16_C( uint8_t *data, size_t n )
+{
+    for( ; n > 0; n--, data += 2 )
+    {
+        uint8_t tmp = data[0];
+        data[0] = data[1];
+        data[1] = tmp;
+    }
+}
+
+static inline void pcm_Swap32_C( uint8_t *data, size_t n )
+{
+    for( ; n > 0; n--, data += 4 )
+    {
+        uint8_t tmp = data[0];
+        data[0] = data[3];
+        data[3] = tmp;
+        tmp = data[1];
+        data[1] = data[2];
+        data[2] = tmp;
+    }
+}
+
+/*****************************************************************************
+ * x86 versions
+ *****************************************************************************/
+#ifdef CAN_COMPILE_SSE
+static inline void pcm_ScaleFl32_SSE( float *dst, const float *src, size_t n,
+                                      float f )
+{
+    const float k[4] = { f, f, f, f };
+
+    for( ; n >= 8; n -= 8, src += 8, dst += 8 )
+        asm volatile( "movups   %[k],      %%xmm2\n"
+                      "movups   (%[src]),  %%xmm0\n"
+                      "movups   16(%[src]),%%xmm1\n"
+                      "mulps    %%xmm2,    %%xmm0\n"
+                      "mulps    %%xmm2,    %%xmm1\n"
+                      "movups   %%xmm0,    (%[dst])\n"
+                      "movups   %%xmm1,    16(%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [k]"m"(k)
+                      : "xmm0", "xmm1", "xmm2", "memory" );
+    pcm_ScaleFl32_C( dst, src, n, f );
+}
+
+static inline void pcm_MixFl32_SSE( float *dst, const float *src, size_t n,
+                                    float f )
+{
+    const float k[4] = { f, f, f, f };
+
+    for( ; n >= 8; n -= 8, src += 8, dst += 8 )
+        asm volatile( "movups   %[k],      %%xmm2\n"
+                      "movups   (%[src]),  %%xmm0\n"
+                      "movups   16(%[src]),%%xmm1\n"
+                      "movups   (%[dst]),  %%xmm3\n"
+                      "movups   16(%[dst]),%%xmm4\n"
+                      "mulps    %%xmm2,    %%xmm0\n"
+                      "mulps    %%xmm2,    %%xmm1\n"
+                      "addps    %%xmm3,    %%xmm0\n"
+                      "addps    %%xmm4,    %%xmm1\n"
+                      "movups   %%xmm0,    (%[dst])\n"
+                      "movups   %%xmm1,    16(%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [k]"m"(k)
+                      : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory" );
+    pcm_MixFl32_C( dst, src, n, f );
+}
+#endif
+
+#ifdef CAN_COMPILE_SSE2
+static inline void pcm_Fl32toS16_SSE2( int16_t *dst, const float *src,
+                                       size_t n )
+{
+    static const float k384[4] = { 384.f, 384.f, 384.f, 384.f };
+    static const int32_t khi[4] = { 0x43c07fff, 0x43c07fff,
+                                    0x43c07fff, 0x43c07fff };
+    static const int32_t klo[4] = { 0x43bf8000, 0x43bf8000,
+                                    0x43bf8000, 0x43bf8000 };
+    static const int32_t kbias[4] = { 0x43c00000, 0x43c00000,
+                                      0x43c00000, 0x43c00000 };
+
+    /* Same trick as the C version, the comparisons giving the saturated
+     * values: all ones >> 17 is 32767, all ones << 15 is -32768 */
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+        asm volatile( "movups   (%[src]),  %%xmm0\n"
+                      "movups   %[k384],   %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "movdqu   %[khi],    %%xmm1\n"
+                      "movdqa   %%xmm0,    %%xmm2\n"
+                      "pcmpgtd  %%xmm1,    %%xmm2\n"
+                      "movdqu   %[klo],    %%xmm3\n"
+                      "pcmpgtd  %%xmm0,    %%xmm3\n"
+                      "movdqu   %[kbias],  %%xmm1\n"
+                      "psubd    %%xmm1,    %%xmm0\n"
+                      "movdqa   %%xmm2,    %%xmm1\n"
+                      "por      %%xmm3,    %%xmm1\n"
+                      "pandn    %%xmm0,    %%xmm1\n"
+                      "psrld    $17,       %%xmm2\n"
+                      "pslld    $15,       %%xmm3\n"
+                      "por      %%xmm2,    %%xmm1\n"
+                      "por      %%xmm3,    %%xmm1\n"
+                      "packssdw %%xmm1,    %%xmm1\n"
+                      "movq     %%xmm1,    (%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [k384]"m"(k384),
+                        [khi]"m"(khi), [klo]"m"(klo), [kbias]"m"(kbias)
+                      : "xmm0", "xmm1", "xmm2", "xmm3", "memory" );
+    pcm_Fl32toS16_C( dst, src, n );
+}
+
+static inline void pcm_S16toFl32_SSE2( float *dst, const int16_t *src,
+                                       size_t n )
+{
+    static const float k[4] = { 1.f / 32768, 1.f / 32768,
+                                1.f / 32768, 1.f / 32768 };
+
+    for( ; n >= 8; n -= 8, src += 8, dst += 8 )
+        asm volatile( "movdqu    (%[src]),  %%xmm0\n"
+                      "movups    %[k],      %%xmm2\n"
+                      "movdqa    %%xmm0,    %%xmm1\n"
+                      "punpcklwd %%xmm0,    %%xmm0\n"
+                      "punpckhwd %%xmm1,    %%xmm1\n"
+                      "psrad     $16,       %%xmm0\n"
+                      "psrad     $16,       %%xmm1\n"
+                      "cvtdq2ps  %%xmm0,    %%xmm0\n"
+                      "cvtdq2ps  %%xmm1,    %%xmm1\n"
+                      "mulps     %%xmm2,    %%xmm0\n"
+                      "mulps     %%xmm2,    %%xmm1\n"
+                      "movups    %%xmm0,    (%[dst])\n"
+                      "movups    %%xmm1,    16(%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [k]"m"(k)
+                      : "xmm0", "xmm1", "xmm2", "memory" );
+    pcm_S16toFl32_C( dst, src, n );
+}
+
+static inline void pcm_S32toFl32_SSE2( float *dst, const int32_t *src,
+                                       size_t n )
+{
+    static const float k[4] = { 1.f / 2147483648.f, 1.f / 2147483648.f,
+                                1.f / 2147483648.f, 1.f / 2147483648.f };
+
+    for( ; n >= 8; n -= 8, src += 8, dst += 8 )
+        asm volatile( "movdqu    (%[src]),  %%xmm0\n"
+                      "movdqu    16(%[src]),%%xmm1\n"
+                      "movups    %[k],      %%xmm2\n"
+                      "cvtdq2ps  %%xmm0,    %%xmm0\n"
+                      "cvtdq2ps  %%xmm1,    %%xmm1\n"
+                      "mulps     %%xmm2,    %%xmm0\n"
+                      "mulps     %%xmm2,    %%xmm1\n"
+                      "movups    %%xmm0,    (%[dst])\n"
+                      "movups    %%xmm1,    16(%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [k]"m"(k)
+                      : "xmm0", "xmm1", "xmm2", "memory" );
+    pcm_S32toFl32_C( dst, src, n );
+}
+
+static inline void pcm_Swap16_SSE2( uint8_t *data, size_t n )
+{
+    for( ; n >= 8; n -= 8, data += 16 )
+        asm volatile( "movdqu    (%[data]), %%xmm0\n"
+                      "movdqa    %%xmm0,    %%xmm1\n"
+                      "psllw     $8,        %%xmm0\n"
+                      "psrlw     $8,        %%xmm1\n"
+                      "por       %%xmm1,    %%xmm0\n"
+                      "movdqu    %%xmm0,    (%[data])\n"
+                      :
+                      : [data]"r"(data)
+                      : "xmm0", "xmm1", "memory" );
+    pcm_Swap16_C( data, n );
+}
+
+static inline void pcm_Swap32_SSE2( uint8_t *data, size_t n )
+{
+    for( ; n >= 4; n -= 4, data += 16 )
+        asm volatile( "movdqu    (%[data]), %%xmm0\n"
+                      "pshuflw   $0xb1,     %%xmm0, %%xmm0\n"
+                      "pshufhw   $0xb1,     %%xmm0, %%xmm0\n"
+                      "movdqa    %%xmm0,    %%xmm1\n"
+                      "psllw     $8,        %%xmm0\n"
+                      "psrlw     $8,        %%xmm1\n"
+                      "por       %%xmm1,    %%xmm0\n"
+                      "movdqu    %%xmm0,    (%[data])\n"
+                      :
+                      : [data]"r"(data)
+                      : "xmm0", "xmm1", "memory" );
+    pcm_Swap32_C( data, n );
+}
+#endif
+
+#if defined(CAN_COMPILE_SSSE3) && !defined(WORDS_BIGENDIAN)
+static inline void pcm_S24toFl32_SSSE3( float *dst, const uint8_t *src,
+                                        size_t n )
+{
+    /* Each 24-bits sample goes to the upper bytes of a 32-bits lane */
+    static const uint8_t shuf[16] = {
+        0x80, 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11 };
+    static const float k[4] = { 1.f / 2147483648.f, 1.f / 2147483648.f,
+                                1.f / 2147483648.f, 1.f / 2147483648.f };
+
+    /* 16 bytes are loaded for 12 bytes used */
+    for( ; n >= 6; n -= 4, src += 12, dst += 4 )
+        asm volatile( "movdqu    (%[src]),  %%xmm0\n"
+                      "movdqu    %[shuf],   %%xmm1\n"
+                      "movups    %[k],      %%xmm2\n"
+                      "pshufb    %%xmm1,    %%xmm0\n"
+                      "cvtdq2ps  %%xmm0,    %%xmm0\n"
+                      "mulps     %%xmm2,    %%xmm0\n"
+                      "movups    %%xmm0,    (%[dst])\n"
+                      :
+                      : [src]"r"(src), [dst]"r"(dst), [shuf]"m"(shuf),
+                        [k]"m"(k)
+                      : "xmm0", "xmm1", "xmm2", "memory" );
+    pcm_S24toFl32_C( dst, src, n );
+}
+#endif
+
+/*****************************************************************************
+ * ARM versions
+ *****************************************************************************/
+#if defined(__ARM_NEON__)
+static inline void pcm_ScaleFl32_NEON( float *dst, const float *src,
+                                       size_t n, float f )
+{
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+        vst1q_f32( dst, vmulq_n_f32( vld1q_f32( src ), f ) );
+    pcm_ScaleFl32_C( dst, src, n, f );
+}
+
+static inline void pcm_MixFl32_NEON( float *dst, const float *src, size_t n,
+                                     float f )
+{
+    /* No multiply-accumulate: the C version rounds the product */
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+        vst1q_f32( dst, vaddq_f32( vld1q_f32( dst ),
+                                   vmulq_n_f32( vld1q_f32( src ), f ) ) );
+    pcm_MixFl32_C( dst, src, n, f );
+}
+
+static inline void pcm_Fl32toS16_NEON( int16_t *dst, const float *src,
+                                       size_t n )
+{
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+    {
+        const int32x4_t u = vreinterpretq_s32_f32(
+            vaddq_f32( vld1q_f32( src ), vdupq_n_f32( 384.f ) ) );
+        int32x4_t v = vsubq_s32( u, vdupq_n_s32( 0x43c00000 ) );
+
+        v = vbslq_s32( vcgtq_s32( u, vdupq_n_s32( 0x43c07fff ) ),
+                       vdupq_n_s32( 32767 ), v );
+        v = vbslq_s32( vcltq_s32( u, vdupq_n_s32( 0x43bf8000 ) ),
+                       vdupq_n_s32( -32768 ), v );
+        vst1_s16( dst, vmovn_s32( v ) );
+    }
+    pcm_Fl32toS16_C( dst, src, n );
+}
+
+static inline void pcm_S16toFl32_NEON( float *dst, const int16_t *src,
+                                       size_t n )
+{
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+        vst1q_f32( dst, vmulq_n_f32( vcvtq_f32_s32(
+                   vmovl_s16( vld1_s16( src ) ) ), 1.f / 32768 ) );
+    pcm_S16toFl32_C( dst, src, n );
+}
+
+static inline void pcm_S32toFl32_NEON( float *dst, const int32_t *src,
+                                       size_t n )
+{
+    for( ; n >= 4; n -= 4, src += 4, dst += 4 )
+        vst1q_f32( dst, vmulq_n_f32( vcvtq_f32_s32( vld1q_s32( src ) ),
+                                     1.f / 2147483648.f ) );
+    pcm_S32toFl32_C( dst, src, n );
+}
+
+static inline void pcm_S24toFl32_NEON( float *dst, const uint8_t *src,
+                                       size_t n )
+{
+    for( ; n >= 8; n -= 8, src += 24, dst += 8 )
+    {
+        const uint8x8x3_t b = vld3_u8( src );
+#ifdef WORDS_BIGENDIAN
+        const uint16x8_t hi = vorrq_u16( vshll_n_u8( b.val[0], 8 ),
+                                         vmovl_u8( b.val[1] ) );
+        const uint16x8_t lo = vshll_n_u8( b.val[2], 8 );
+#else
+        const uint16x8_t hi = vorrq_u16( vshll_n_u8( b.val[2], 8 ),
+                                         vmovl_u8( b.val[1] ) );
+        const uint16x8_t lo = vshll_n_u8( b.val[0], 8 );
+#endif
+        const uint16x8x2_t w = vzipq_u16( lo, hi );
+
+        vst1q_f32( dst, vmulq_n_f32( vcvtq_f32_s32(
+                   vreinterpretq_s32_u16( w.val[0] ) ), 1.f / 2147483648.f ) );
+        vst1q_f32( dst + 4, vmulq_n_f32( vcvtq_f32_s32(
+                   vreinterpretq_s32_u16( w.val[1] ) ), 1.f / 2147483648.f ) );
+    }
+    pcm_S24toFl32_C( dst, src, n );
+}
+
+static inline void pcm_Swap16_NEON( uint8_t *data, size_t n )
+{
+    for( ; n >= 8; n -= 8, data += 16 )
+        vst1q_u8( data, vrev16q_u8( vld1q_u8( data ) ) );
+    pcm_Swap16_C( data, n );
+}
+
+static inline void pcm_Swap32_NEON( uint8_t *data, size_t n )
+{
+    for( ; n >= 4; n -= 4, data += 16 )
+        vst1q_u8( data, vrev32q_u8( vld1q_u8( data ) ) );
+    pcm_Swap32_C( data, n );
+}
+#endif
+
+/*****************************************************************************
+ * Run-time selection
+ *****************************************************************************/
+#ifdef CAN_COMPILE_SSE
+# define PCM_SSE(f, ...) \
+    if( vlc_CPU() & CPU_CAPABILITY_SSE ) { f##_SSE( __VA_ARGS__ ); return; }
+#else
+# define PCM_SSE(f, ...)
+#endif
+#ifdef CAN_COMPILE_SSE2
+# define PCM_SSE2(f, ...) \
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 ) { f##_SSE2( __VA_ARGS__ ); return; }
+#else
+# define PCM_SSE2(f, ...)
+#endif
+#if defined(__ARM_NEON__)
+# define PCM_NEON(f, ...) \
+    if( vlc_CPU() & CPU_CAPABILITY_NEON ) { f##_NEON( __VA_ARGS__ ); return; }
+#else
+# define PCM_NEON(f, ...)
+#endif
+
+/** dst[i] = src[i] * f */
+static inline void pcm_ScaleFl32( float *dst, const float *src, size_t n,
+                                  float f )
+{
+    PCM_SSE( pcm_ScaleFl32, dst, src, n, f )
+    PCM_NEON( pcm_ScaleFl32, dst, src, n, f )
+    pcm_ScaleFl32_C( dst, src, n, f );
+}
+
+/** dst[i] += src[i] * f */
+static inline void pcm_MixFl32( float *dst, const float *src, size_t n,
+                                float f )
+{
+    PCM_SSE( pcm_MixFl32, dst, src, n, f )
+    PCM_NEON( pcm_MixFl32, dst, src, n, f )
+    pcm_MixFl32_C( dst, src, n, f );
+}
+
+/** Saturating conversion from float to signed 16-bits */
+static inline void pcm_Fl32toS16( int16_t *dst, const float *src, size_t n )
+{
+    PCM_SSE2( pcm_Fl32toS16, dst, src, n )
+    PCM_NEON( pcm_Fl32toS16, dst, src, n )
+    pcm_Fl32toS16_C( dst, src, n );
+}
+
+static inline void pcm_S16toFl32( float *dst, const int16_t *src, size_t n )
+{
+    PCM_SSE2( pcm_S16toFl32, dst, src, n )
+    PCM_NEON( pcm_S16toFl32, dst, src, n )
+    pcm_S16toFl32_C( dst, src, n );
+}
+
+static inline void pcm_S32toFl32( float *dst, const int32_t *src, size_t n )
+{
+    PCM_SSE2( pcm_S32toFl32, dst, src, n )
+    PCM_NEON( pcm_S32toFl32, dst, src, n )
+    pcm_S32toFl32_C( dst, src, n );
+}
+
+static inline void pcm_S24toFl32( float *dst, const uint8_t *src, size_t n )
+{
+#if defined(CAN_COMPILE_SSSE3) && !defined(WORDS_BIGENDIAN)
+    if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
+    {
+        pcm_S24toFl32_SSSE3( dst, src, n );
+        return;
+    }
+#endif
+    PCM_NEON( pcm_S24toFl32, dst, src, n )
+    pcm_S24toFl32_C( dst, src, n );
+}
+
+/** Swaps the bytes of n 16-bits words */
+static inline void pcm_Swap16( uint8_t *data, size_t n )
+{
+    PCM_SSE2( pcm_Swap16, data, n )
+    PCM_NEON( pcm_Swap16, data, n )
+    pcm_Swap16_C( data, n );
+}
+
+/** Swaps the bytes of n 32-bits words */
+static inline void pcm_Swap32( uint8_t *data, size_t n )
+{
+    PCM_SSE2( pcm_Swap32, data, n )
+    PCM_NEON( pcm_Swap32, data, n )
+    pcm_Swap32_C( data, n );
+}
+
+#undef PCM_NEON
+#undef PCM_SSE2
+#undef PCM_SSE
+
+#endif
@@ -0,0 +1,664 @@
+/*****************************************************************************
+ * polyphase.c : polyphase filter bank resampler
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * The output rate over the input rate is reduced to a fraction up/down. Each
+ * output frame lies at one of up possible positions (phases) between two
+ * input frames. The Kaiser-windowed sinc low-pass filter is computed once
+ * for each phase when the ratio changes, so that every output frame is a
+ * plain dot product of the filter with the input frames around it, for all
+ * the channels at once.
+ *
+ * When up is too large (odd ratios, or while the audio output corrects the
+ * drift by a few Hz), the filter bank has a fixed number of phases, and the
+ * coefficients are linearly interpolated between the two nearest ones.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#include <math.h>
+#include <assert.h>
+
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
+static block_t *Resample( filter_t *, block_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_( \
+    "Length of the interpolation filter. Higher qualities keep more of the " \
+    "high frequencies and reject more aliasing, but use more CPU.")
+
+static const int pi_quality_values[] = { 0, 1, 2 };
+static const char *const ppsz_quality_texts[] =
+    { N_("Low"), N_("Medium"), N_("High") };
+
+vlc_module_begin ()
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_MISC )
+    set_shortname( N_("Polyphase") )
+    set_description( N_("Audio filter for polyphase resampling") )
+    /* Above bandlimited (20): faster and cleaner at every quality */
+    set_capability( "audio filter", 25 )
+    add_integer( "polyphase-quality", 1, NULL, QUALITY_TEXT,
+                 QUALITY_LONGTEXT, true )
+        change_integer_list( pi_quality_values, ppsz_quality_texts, NULL )
+    set_callbacks( OpenFilter, CloseFilter )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+/* Filter length at unity ratio and Kaiser window shape, for the quality
+ * presets (about 55, 70 and 90 dB of stop band attenuation). */
+static const struct
+{
+    unsigned i_taps;
+    double   d_beta;
+} p_qualities[] = { { 16, 5. }, { 32, 7. }, { 64, 9. } };
+
+#define MAX_EXACT_PHASES 1024 /* largest up for an exact filter bank */
+#define INTERP_PHASES    256  /* otherwise */
+#define MAX_TAPS         1024
+
+typedef void (*dot_t)( float *, const float *, const float *, unsigned,
+                       unsigned );
+
+struct filter_sys_t
+{
+    unsigned i_quality;
+    unsigned i_channels;
+    dot_t    pf_dot;
+
+    /* Current ratio */
+    unsigned i_in_rate;
+    unsigned i_out_rate;
+    unsigned i_up;
+    unsigned i_down;
+    unsigned i_frac;        /* position of the next output frame, in 1/up */
+
+    /* Filter bank: i_phases + 1 rows of i_taps coefficients */
+    float   *p_bank;
+    float   *p_coeffs;      /* interpolated row */
+    unsigned i_phases;
+    unsigned i_taps;
+    double   d_cutoff;
+
+    /* Input frames not consumed yet; the next output frame lies
+     * i_taps / 2 - 1 frames after the first one */
+    float   *p_hist;
+    size_t   i_hist;
+    size_t   i_hist_max;
+
+    bool     b_first;
+    date_t   end_date;
+};
+
+/*****************************************************************************
+ * Dot products of the filter with interleaved frames:
+ *   out[c] = sum( h[j] * x[j * ch + c], j < taps )
+ * taps is a non-zero multiple of 4.
+ *****************************************************************************/
+static float DotChannel_C( const float *x, const float *h, unsigned taps,
+                           unsigned ch )
+{
+    float f = 0.f;
+
+    for( unsigned j = 0; j < taps; j++ )
+        f += h[j] * x[j * ch];
+    return f;
+}
+
+static void Dot_C( float *out, const float *x, const float *h,
+                   unsigned taps, unsigned ch )
+{
+    for( unsigned c = 0; c < ch; c++ )
+        out[c] = DotChannel_C( &x[c], h, taps, ch );
+}
+
+#ifdef CAN_COMPILE_SSE
+static void Dot_SSE( float *out, const float *x, const float *h,
+                     unsigned taps, unsigned ch )
+{
+    size_t n = taps;
+    unsigned c = 0;
+
+    if( ch == 1 )
+    {
+        asm volatile( "xorps    %%xmm0,    %%xmm0\n"
+                      "1:\n"
+                      "movups   (%[x]),    %%xmm1\n"
+                      "movups   (%[h]),    %%xmm2\n"
+                      "mulps    %%xmm2,    %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "add      $16,       %[x]\n"
+                      "add      $16,       %[h]\n"
+                      "sub      $4,        %[n]\n"
+                      "jnz      1b\n"
+                      "movhlps  %%xmm0,    %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "movaps   %%xmm0,    %%xmm1\n"
+                      "shufps   $0x55,     %%xmm1, %%xmm1\n"
+                      "addss    %%xmm1,    %%xmm0\n"
+                      "movss    %%xmm0,    %[out]\n"
+                      : [x]"+r"(x), [h]"+r"(h), [n]"+r"(n), [out]"=m"(*out)
+                      :
+                      : "xmm0", "xmm1", "xmm2", "memory", "cc" );
+        return;
+    }
+
+    if( ch == 2 )
+    {   /* Four frames at a time, with each coefficient twice */
+        asm volatile( "xorps    %%xmm0,    %%xmm0\n"
+                      "xorps    %%xmm5,    %%xmm5\n"
+                      "1:\n"
+                      "movups   (%[h]),    %%xmm1\n"
+                      "movaps   %%xmm1,    %%xmm2\n"
+                      "unpcklps %%xmm1,    %%xmm1\n"
+                      "unpckhps %%xmm2,    %%xmm2\n"
+                      "movups   (%[x]),    %%xmm3\n"
+                      "movups   16(%[x]),  %%xmm4\n"
+                      "mulps    %%xmm1,    %%xmm3\n"
+                      "mulps    %%xmm2,    %%xmm4\n"
+                      "addps    %%xmm3,    %%xmm0\n"
+                      "addps    %%xmm4,    %%xmm5\n"
+                      "add      $32,       %[x]\n"
+                      "add      $16,       %[h]\n"
+                      "sub      $4,        %[n]\n"
+                      "jnz      1b\n"
+                      "addps    %%xmm5,    %%xmm0\n"
+                      "movhlps  %%xmm0,    %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "movlps   %%xmm0,    %[out]\n"
+                      : [x]"+r"(x), [h]"+r"(h), [n]"+r"(n),
+                        [out]"=m"(*(float (*)[2])out)
+                      :
+                      : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+                        "memory", "cc" );
+        return;
+    }
+
+    /* Four channels at a time, one frame per iteration */
+    for( ; c + 4 <= ch; c += 4 )
+    {
+        const float *xc = &x[c], *hc = h;
+
+        n = taps;
+        asm volatile( "xorps    %%xmm0,    %%xmm0\n"
+                      "1:\n"
+                      "movss    (%[h]),    %%xmm1\n"
+                      "shufps   $0,        %%xmm1, %%xmm1\n"
+                      "movups   (%[x]),    %%xmm2\n"
+                      "mulps    %%xmm1,    %%xmm2\n"
+                      "addps    %%xmm2,    %%xmm0\n"
+                      "add      %[stride], %[x]\n"
+                      "add      $4,        %[h]\n"
+                      "dec      %[n]\n"
+                      "jnz      1b\n"
+                      "movups   %%xmm0,    %[out]\n"
+                      : [x]"+r"(xc), [h]"+r"(hc), [n]"+r"(n),
+                        [out]"=m"(*(float (*)[4])&out[c])
+                      : [stride]"r"(ch * sizeof(float))
+                      : "xmm0", "xmm1", "xmm2", "memory", "cc" );
+    }
+    for( ; c < ch; c++ )
+        out[c] = DotChannel_C( &x[c], h, taps, ch );
+}
+#endif
+
+#if defined(__ARM_NEON__)
+static void Dot_NEON( float *out, const float *x, const float *h,
+                      unsigned taps, unsigned ch )
+{
+    unsigned c = 0;
+
+    if( ch == 1 )
+    {
+        float32x4_t acc = vdupq_n_f32( 0.f );
+
+        for( unsigned j = 0; j < taps; j += 4 )
+            acc = vmlaq_f32( acc, vld1q_f32( &x[j] ), vld1q_f32( &h[j] ) );
+
+        float32x2_t s = vadd_f32( vget_low_f32( acc ), vget_high_f32( acc ) );
+        *out = vget_lane_f32( vpadd_f32( s, s ), 0 );
+        return;
+    }
+
+    if( ch == 2 )
+    {   /* Four frames at a time, with each coefficient twice */
+        float32x4_t acc0 = vdupq_n_f32( 0.f ), acc1 = acc0;
+
+        for( unsigned j = 0; j < taps; j += 4, x += 8 )
+        {
+            const float32x4_t hj = vld1q_f32( &h[j] );
+            const float32x4x2_t hh = vzipq_f32( hj, hj );
+
+            acc0 = vmlaq_f32( acc0, vld1q_f32( x ), hh.val[0] );
+            acc1 = vmlaq_f32( acc1, vld1q_f32( x + 4 ), hh.val[1] );
+        }
+        acc0 = vaddq_f32( acc0, acc1 );
+        vst1_f32( out, vadd_f32( vget_low_f32( acc0 ),
+                                 vget_high_f32( acc0 ) ) );
+        return;
+    }
+
+    /* Four channels at a time, one frame per iteration */
+    for( ; c + 4 <= ch; c += 4 )
+    {
+        float32x4_t acc = vdupq_n_f32( 0.f );
+
+        for( unsigned j = 0; j < taps; j++ )
+            acc = vmlaq_n_f32( acc, vld1q_f32( &x[j * ch + c] ), h[j] );
+        vst1q_f32( &out[c], acc );
+    }
+    for( ; c < ch; c++ )
+        out[c] = DotChannel_C( &x[c], h, taps, ch );
+}
+#endif
+
+/*****************************************************************************
+ * Filter bank
+ *****************************************************************************/
+static double BesselI0( double x )
+{
+    double d_sum = 1., d_term = 1.;
+
+    for( unsigned k = 1; d_term > 1e-12 * d_sum; k++ )
+    {
+        d_term *= (x / (2 * k)) * (x / (2 * k));
+        d_sum += d_term;
+    }
+    return d_sum;
+}
+
+/* Row p holds the filter for an output frame p / i_phases after the frame
+ * i_taps / 2 - 1, with a cut-off frequency d_cutoff (in input cycles per
+ * sample). Each row has unity gain. */
+static void BuildBank( filter_sys_t *p_sys, double d_beta )
+{
+    const unsigned i_taps = p_sys->i_taps;
+    const double d_half = i_taps / 2;
+    const double d_i0_beta = BesselI0( d_beta );
+
+    for( unsigned p = 0; p <= p_sys->i_phases; p++ )
+    {
+        float *row = &p_sys->p_bank[p * i_taps];
+        double d_sum = 0.;
+
+        for( unsigned j = 0; j < i_taps; j++ )
+        {
+            const double d = j - (d_half - 1.) - (double)p / p_sys->i_phases;
+            const double w = d / d_half;
+            double f;
+
+            if( d == 0. )
+                f = 2. * p_sys->d_cutoff;
+            else
+                f = sin( 2. * M_PI * p_sys->d_cutoff * d ) / (M_PI * d);
+            if( w * w < 1. )
+                f *= BesselI0( d_beta * sqrt( 1. - w * w ) ) / d_i0_beta;
+            else
+                f = 0.;
+            row[j] = f;
+            d_sum += f;
+        }
+        for( unsigned j = 0; j < i_taps; j++ )
+            row[j] /= d_sum;
+    }
+}
+
+static int ReserveHistory( filter_sys_t *p_sys, size_t i_frames )
+{
+    if( i_frames <= p_sys->i_hist_max )
+        return VLC_SUCCESS;
+
+    float *p_hist = realloc( p_sys->p_hist,
+                             i_frames * p_sys->i_channels * sizeof(float) );
+    if( unlikely(p_hist == NULL) )
+        return VLC_ENOMEM;
+    p_sys->p_hist = p_hist;
+    p_sys->i_hist_max = i_frames;
+    return VLC_SUCCESS;
+}
+
+/* Number of silent frames added at the start of the history when the
+ * filter gets longer */
+static size_t AlignAdd( unsigned i_old_taps, unsigned i_taps )
+{
+    return i_taps > i_old_taps ? (i_taps - i_old_taps) / 2 : 0;
+}
+
+/* Keeps the next output frame at the same place when the filter length
+ * changes, by adding silence or dropping frames at the start.
+ * The history must have room for the added frames. */
+static void AlignHistory( filter_sys_t *p_sys, unsigned i_old_taps )
+{
+    const size_t i_frame = p_sys->i_channels * sizeof(float);
+
+    if( p_sys->i_taps > i_old_taps )
+    {
+        const size_t i_add = AlignAdd( i_old_taps, p_sys->i_taps );
+
+        assert( p_sys->i_hist + i_add <= p_sys->i_hist_max );
+        memmove( (uint8_t *)p_sys->p_hist + i_add * i_frame, p_sys->p_hist,
+                 p_sys->i_hist * i_frame );
+        memset( p_sys->p_hist, 0, i_add * i_frame );
+        p_sys->i_hist += i_add;
+    }
+    else
+    {
+        const size_t i_drop = __MIN( (i_old_taps - p_sys->i_taps) / 2,
+                                     p_sys->i_hist );
+
+        p_sys->i_hist -= i_drop;
+        memmove( p_sys->p_hist, (uint8_t *)p_sys->p_hist + i_drop * i_frame,
+                 p_sys->i_hist * i_frame );
+    }
+}
+
+/* Updates the fraction and, if needed, the filter bank for new rates */
+static int SetRatio( filter_t *p_filter, unsigned i_in_rate,
+                     unsigned i_out_rate )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( i_in_rate == p_sys->i_in_rate && i_out_rate == p_sys->i_out_rate )
+        return VLC_SUCCESS;
+
+    const unsigned i_gcd = GCD( i_in_rate, i_out_rate );
+    const unsigned i_up = i_out_rate / i_gcd;
+    const unsigned i_down = i_in_rate / i_gcd;
+
+    /* When downsampling, the cut-off frequency is lowered and the filter
+     * made longer by the same factor, to keep the same transition band */
+    const double d_ratio = __MIN( 1., (double)i_out_rate / i_in_rate );
+    const unsigned i_base = p_qualities[p_sys->i_quality].i_taps;
+    const double d_beta = p_qualities[p_sys->i_quality].d_beta;
+    const double d_atten = d_beta / 0.1102 + 8.7;
+    const double d_transition = (d_atten - 7.95) / (14.36 * i_base);
+    const double d_cutoff = d_ratio * (.5 - d_transition / 2.);
+
+    const double d_taps = ceil( i_base / d_ratio / 4. ) * 4.;
+    const unsigned i_taps = (d_taps < MAX_TAPS) ? d_taps : MAX_TAPS;
+    const unsigned i_phases = (i_up <= MAX_EXACT_PHASES) ? i_up
+                                                         : INTERP_PHASES;
+
+    /* Small rate corrections do not need a new bank */
+    if( i_phases != p_sys->i_phases
+     || fabs( d_cutoff - p_sys->d_cutoff ) > 1e-3 * d_cutoff )
+    {
+        const unsigned i_old_taps = p_sys->i_taps;
+        float *p_bank = malloc( (i_phases + 1) * i_taps * sizeof(float) );
+        float *p_coeffs = malloc( i_taps * sizeof(float) );
+
+        /* Nothing is changed until nothing can fail anymore */
+        if( unlikely(p_bank == NULL || p_coeffs == NULL)
+         || ( i_old_taps != 0
+           && ReserveHistory( p_sys, p_sys->i_hist
+                                   + AlignAdd( i_old_taps, i_taps ) ) ) )
+        {
+            free( p_bank );
+            free( p_coeffs );
+            return VLC_ENOMEM;
+        }
+        free( p_sys->p_bank );
+        free( p_sys->p_coeffs );
+        p_sys->p_bank = p_bank;
+        p_sys->p_coeffs = p_coeffs;
+        p_sys->i_phases = i_phases;
+        p_sys->i_taps = i_taps;
+        p_sys->d_cutoff = d_cutoff;
+        BuildBank( p_sys, d_beta );
+
+        if( i_old_taps != 0 && i_old_taps != i_taps )
+            AlignHistory( p_sys, i_old_taps );
+
+        msg_Dbg( p_filter, "%u->%u Hz: %u phases of %u taps, cut-off %.0f Hz",
+                 i_in_rate, i_out_rate, i_phases, i_taps,
+                 d_cutoff * i_in_rate );
+    }
+
+    if( p_sys->i_up != 0 )
+        p_sys->i_frac = (uint64_t)p_sys->i_frac * i_up / p_sys->i_up;
+    p_sys->i_in_rate = i_in_rate;
+    p_sys->i_out_rate = i_out_rate;
+    p_sys->i_up = i_up;
+    p_sys->i_down = i_down;
+    return VLC_SUCCESS;
+}
+
+static const float *GetCoeffs( filter_sys_t *p_sys )
+{
+    const unsigned i_taps = p_sys->i_taps;
+
+    if( p_sys->i_phases == p_sys->i_up )
+        return &p_sys->p_bank[p_sys->i_frac * i_taps];
+
+    /* Linear interpolation between the two nearest phases */
+    const uint64_t i_phase = (uint64_t)p_sys->i_frac * p_sys->i_phases;
+    const float *h0 = &p_sys->p_bank[(i_phase / p_sys->i_up) * i_taps];
+    const float *h1 = &h0[i_taps];
+    const float f = (float)(i_phase % p_sys->i_up) / p_sys->i_up;
+
+    for( unsigned j = 0; j < i_taps; j++ )
+        p_sys->p_coeffs[j] = h0[j] + f * (h1[j] - h0[j]);
+    return p_sys->p_coeffs;
+}
+
+/*****************************************************************************
+ * Resample: convert a buffer
+ *****************************************************************************/
+static block_t *Resample( filter_t *p_filter, block_t *p_in_buf )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_channels = p_sys->i_channels;
+    const size_t i_frame = i_channels * sizeof(float);
+
+    if( !p_in_buf || !p_in_buf->i_nb_samples )
+    {
+        if( p_in_buf )
+            block_Release( p_in_buf );
+        return NULL;
+    }
+
+    if( SetRatio( p_filter, p_filter->fmt_in.audio.i_rate,
+                  p_filter->fmt_out.audio.i_rate ) )
+    {
+        block_Release( p_in_buf );
+        return NULL;
+    }
+
+    const bool b_discontinuity =
+        (p_in_buf->i_flags & BLOCK_FLAG_DISCONTINUITY) || p_sys->b_first;
+    if( b_discontinuity )
+    {
+        /* Start with silence before the first frame */
+        if( ReserveHistory( p_sys, p_sys->i_taps ) )
+        {
+            block_Release( p_in_buf );
+            return NULL;
+        }
+        p_sys->i_hist = p_sys->i_taps / 2 - 1;
+        memset( p_sys->p_hist, 0, p_sys->i_hist * i_frame );
+        p_sys->i_frac = 0;
+        date_Init( &p_sys->end_date, p_sys->i_out_rate, 1 );
+        date_Set( &p_sys->end_date, p_in_buf->i_pts );
+        p_sys->b_first = false;
+    }
+
+    /* Append the input frames to the history */
+    if( ReserveHistory( p_sys, p_sys->i_hist + p_in_buf->i_nb_samples ) )
+    {
+        block_Release( p_in_buf );
+        return NULL;
+    }
+    memcpy( (uint8_t *)p_sys->p_hist + p_sys->i_hist * i_frame,
+            p_in_buf->p_buffer, p_in_buf->i_nb_samples * i_frame );
+    p_sys->i_hist += p_in_buf->i_nb_samples;
+    block_Release( p_in_buf );
+
+    const size_t i_out_max =
+        (uint64_t)p_sys->i_hist * p_sys->i_up / p_sys->i_down + 1;
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter,
+                                                i_out_max * i_frame );
+    if( !p_out_buf )
+        return NULL;
+
+    const unsigned i_taps = p_sys->i_taps;
+    float *p_out = (float *)p_out_buf->p_buffer;
+    size_t i_pos = 0, i_out = 0;
+
+    while( i_pos + i_taps <= p_sys->i_hist )
+    {
+        const float *p_in = &p_sys->p_hist[i_pos * i_channels];
+
+        if( p_sys->i_up == p_sys->i_down )
+            memcpy( p_out, &p_in[(i_taps / 2 - 1) * i_channels], i_frame );
+        else
+            p_sys->pf_dot( p_out, p_in, GetCoeffs( p_sys ), i_taps,
+                           i_channels );
+        p_out += i_channels;
+        i_out++;
+
+        p_sys->i_frac += p_sys->i_down;
+        i_pos += p_sys->i_frac / p_sys->i_up;
+        p_sys->i_frac %= p_sys->i_up;
+    }
+    assert( i_out <= i_out_max );
+
+    /* Keep the frames needed for the next output frames */
+    i_pos = __MIN( i_pos, p_sys->i_hist );
+    p_sys->i_hist -= i_pos;
+    memmove( p_sys->p_hist, &p_sys->p_hist[i_pos * i_channels],
+             p_sys->i_hist * i_frame );
+
+    if( b_discontinuity )
+        p_out_buf->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+    p_out_buf->i_nb_samples = i_out;
+    p_out_buf->i_buffer = i_out * i_frame;
+    p_out_buf->i_pts = date_Get( &p_sys->end_date );
+    p_out_buf->i_length = date_Increment( &p_sys->end_date, i_out )
+                        - p_out_buf->i_pts;
+    return p_out_buf;
+}
+
+/*****************************************************************************
+ * OpenFilter:
+ *****************************************************************************/
+static int OpenFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    unsigned int i_out_rate = p_filter->fmt_out.audio.i_rate;
+
+    if ( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate
+      || p_filter->fmt_in.audio.i_format != p_filter->fmt_out.audio.i_format
+      || p_filter->fmt_in.audio.i_physical_channels
+              != p_filter->fmt_out.audio.i_physical_channels
+      || p_filter->fmt_in.audio.i_original_channels
+              != p_filter->fmt_out.audio.i_original_channels
+      || p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32 )
+    {
+        return VLC_EGENERIC;
+    }
+
+#if !defined( SYS_DARWIN )
+    if( !var_InheritBool( p_this, "hq-resampling" ) )
+    {
+        return VLC_EGENERIC;
+    }
+#endif
+
+    p_filter->p_sys = p_sys = calloc( 1, sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    int i_quality = var_InheritInteger( p_this, "polyphase-quality" );
+    if( i_quality < 0 )
+        i_quality = 0;
+    if( i_quality > 2 )
+        i_quality = 2;
+    p_sys->i_quality = i_quality;
+    p_sys->i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    p_sys->pf_dot = Dot_C;
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU() & CPU_CAPABILITY_SSE )
+        p_sys->pf_dot = Dot_SSE;
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        p_sys->pf_dot = Dot_NEON;
+#endif
+    p_sys->b_first = true;
+
+    if( SetRatio( p_filter, p_filter->fmt_in.audio.i_rate, i_out_rate ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_filter->pf_audio_filter = Resample;
+
+    msg_Dbg( p_this, "%4.4s/%iKHz/%i->%4.4s/%iKHz/%i, quality %u",
+             (char *)&p_filter->fmt_in.i_codec,
+             p_filter->fmt_in.audio.i_rate,
+             p_filter->fmt_in.audio.i_channels,
+             (char *)&p_filter->fmt_out.i_codec,
+             p_filter->fmt_out.audio.i_rate,
+             p_filter->fmt_out.audio.i_channels, p_sys->i_quality );
+
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->fmt_out.audio.i_rate = i_out_rate;
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * CloseFilter : deallocate data structures
+ *****************************************************************************/
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->p_hist );
+    free( p_sys->p_coeffs );
+    free( p_sys->p_bank );
+    free( p_sys );
+}
@@ -32,10 +32,16 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
+#include <math.h>
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -70,6 +76,8 @@ vlc_module_end ()
  * Scaletempo smooths the overlap further by searching within the input buffer
  * for the best overlap position.  Scaletempo uses a statistical cross correlation
  * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here.
+ * For long searches, the correlations for all the positions are computed at
+ * once through a FFT; otherwise, each one is a (vectorized) dot-product.
  *
  * NOTE:
  * sample: a single audio sample for one channel
@@ -111,8 +119,69 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    float   (*dot)( const float *, const float *, unsigned );
+    /* FFT cross correlation */
+    unsigned  fft_bits;
+    float    *fft_buf;            /* real parts, then imaginary parts */
+    float    *fft_corr;           /* idem */
+    float    *fft_twiddle;        /* cosines, then minus sines */
+    unsigned *fft_bitrev;
 };
 
+/*****************************************************************************
+ * dot: sum of the products of two vectors of floats
+ *****************************************************************************/
+static float dot_float( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    while( n-- )
+        corr += *a++ * *b++;
+    return corr;
+}
+
+#ifdef CAN_COMPILE_SSE
+static float dot_float_sse( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    size_t n4 = n & ~3;
+
+    if( n4 > 0 )
+        asm volatile( "xorps    %%xmm0,    %%xmm0\n"
+                      "1:\n"
+                      "movups   (%[a]),    %%xmm1\n"
+                      "movups   (%[b]),    %%xmm2\n"
+                      "mulps    %%xmm2,    %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "add      $16,       %[a]\n"
+                      "add      $16,       %[b]\n"
+                      "sub      $4,        %[n]\n"
+                      "jnz      1b\n"
+                      "movhlps  %%xmm0,    %%xmm1\n"
+                      "addps    %%xmm1,    %%xmm0\n"
+                      "movaps   %%xmm0,    %%xmm1\n"
+                      "shufps   $0x55,     %%xmm1, %%xmm1\n"
+                      "addss    %%xmm1,    %%xmm0\n"
+                      "movss    %%xmm0,    %[corr]\n"
+                      : [a]"+r"(a), [b]"+r"(b), [n]"+r"(n4), [corr]"=m"(corr)
+                      :
+                      : "xmm0", "xmm1", "xmm2", "memory", "cc" );
+    return corr + dot_float( a, b, n & 3 );
+}
+#endif
+
+#if defined(__ARM_NEON__)
+static float dot_float_neon( const float *a, const float *b, unsigned n )
+{
+    float32x4_t acc = vdupq_n_f32( 0.f );
+
+    for( ; n >= 4; n -= 4, a += 4, b += 4 )
+        acc = vmlaq_f32( acc, vld1q_f32( a ), vld1q_f32( b ) );
+
+    float32x2_t sum = vadd_f32( vget_low_f32( acc ), vget_high_f32( acc ) );
+    return vget_lane_f32( vpadd_f32( sum, sum ), 0 ) + dot_float( a, b, n );
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -134,12 +203,8 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->dot( p->buf_pre_corr, search_start,
+                           p->samples_overlap - p->samples_per_frame );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -150,6 +215,102 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+/*****************************************************************************
+ * fft: in place radix-2 complex FFT of 2^fft_bits points
+ *****************************************************************************/
+static void fft( const filter_sys_t *p, float *re, float *im )
+{
+    const unsigned n = 1 << p->fft_bits;
+    const float *tw_cos = p->fft_twiddle, *tw_sin = tw_cos + n / 2;
+
+    for( unsigned i = 0; i < n; i++ ) {
+        unsigned j = p->fft_bitrev[i];
+        if( i < j ) {
+            float t;
+            t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for( unsigned half = 1, step = n / 2; half < n; half *= 2, step /= 2 ) {
+        for( unsigned k = 0; k < half; k++ ) {
+            const float wr = tw_cos[k * step], wi = tw_sin[k * step];
+            for( unsigned a = k; a < n; a += 2 * half ) {
+                const unsigned b = a + half;
+                const float tr = wr * re[b] - wi * im[b];
+                const float ti = wr * im[b] + wi * re[b];
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+ * best_overlap_offset_fft: same as best_overlap_offset_float, through the
+ * cross spectrum of the windowed overlap and the search area
+ *****************************************************************************/
+static unsigned best_overlap_offset_fft( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const unsigned n = 1 << p->fft_bits;
+    const unsigned nch = p->samples_per_frame;
+    const unsigned frames_corr = p->samples_overlap / nch - 1;
+    const unsigned frames_in = p->frames_search + frames_corr - 1;
+    const float *pw = p->table_window;
+    const float *po = (float *)p->buf_overlap + nch;
+    const float *pq = (float *)p->buf_queue + nch;
+    float *ppc = p->buf_pre_corr;
+    float *re = p->fft_buf, *im = re + n;
+    float *corr_re = p->fft_corr, *corr_im = corr_re + n;
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+
+    for( unsigned i = nch; i < p->samples_overlap; i++ )
+      *ppc++ = *pw++ * *po++;
+    ppc = p->buf_pre_corr;
+
+    memset( p->fft_corr, 0, 2 * n * sizeof(float) );
+    for( unsigned c = 0; c < nch; c++ ) {
+        /* Search area in the real part, pre-correlation in the imaginary
+         * part: both spectra come out of a single FFT */
+        for( unsigned k = 0; k < frames_in; k++ )
+            re[k] = pq[k * nch + c];
+        memset( &re[frames_in], 0, (n - frames_in) * sizeof(float) );
+        for( unsigned k = 0; k < frames_corr; k++ )
+            im[k] = ppc[k * nch + c];
+        memset( &im[frames_corr], 0, (n - frames_corr) * sizeof(float) );
+
+        fft( p, re, im );
+
+        /* Accumulate conj(P) * Q, with Q = (Z[k] + conj(Z[n-k])) / 2 and
+         * P = (Z[k] - conj(Z[n-k])) / 2i, leaving out the factor 1/4 */
+        for( unsigned k = 0; k < n; k++ ) {
+            const unsigned m = (n - k) & (n - 1);
+            const float qr = re[k] + re[m], qi = im[k] - im[m];
+            const float pr = im[k] + im[m], pi = re[m] - re[k];
+            corr_re[k] += pr * qr + pi * qi;
+            corr_im[k] += pr * qi - pi * qr;
+        }
+    }
+
+    /* Inverse transform: the correlations are real */
+    for( unsigned k = 0; k < n; k++ )
+        corr_im[k] = -corr_im[k];
+    fft( p, corr_re, corr_im );
+
+    for( unsigned off = 0; off < p->frames_search; off++ ) {
+      if( corr_re[off] > best_corr ) {
+        best_corr = corr_re[off];
+        best_off  = off;
+      }
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -338,6 +499,41 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+
+        /* Use the FFT when it is faster than the dot-products: one transform
+         * of n points takes about as long as 6 n log2(n) vectorized
+         * multiply-adds (measured with SSE) */
+        unsigned frames_in = p->frames_search + frames_overlap - 2;
+        unsigned bits = 1;
+        while( (1u << bits) < frames_in )
+            bits++;
+        double cost_fft = 6. * (p->samples_per_frame + 1) * (1 << bits) * bits;
+        double cost_dot = (double)p->frames_search
+                        * ( p->samples_overlap - p->samples_per_frame );
+        if( cost_fft < cost_dot )
+        {
+            unsigned n = 1 << bits;
+            p->fft_bits    = bits;
+            p->fft_buf     = malloc( 2 * n * sizeof(float) );
+            p->fft_corr    = malloc( 2 * n * sizeof(float) );
+            p->fft_twiddle = malloc( n * sizeof(float) );
+            p->fft_bitrev  = malloc( n * sizeof(unsigned) );
+            if( !p->fft_buf || !p->fft_corr || !p->fft_twiddle || !p->fft_bitrev )
+                return VLC_ENOMEM;
+            for( i = 0; i < n / 2; i++ )
+            {
+                p->fft_twiddle[i]         = cos( 2. * M_PI * i / n );
+                p->fft_twiddle[n / 2 + i] = -sin( 2. * M_PI * i / n );
+            }
+            for( i = 0; i < n; i++ )
+            {
+                unsigned r = 0;
+                for( j = 0; j < bits; j++ )
+                    r |= ( ( i >> j ) & 1 ) << ( bits - 1 - j );
+                p->fft_bitrev[i] = r;
+            }
+            p->best_overlap_offset = best_overlap_offset_fft;
+        }
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -367,13 +563,14 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search (%s), %i queue, %s mode",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
              (int)( p->bytes_standing / p->bytes_per_frame ),
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
+             p->best_overlap_offset == best_overlap_offset_fft ? "fft" : "dot",
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
              "fl32");
 
@@ -437,6 +634,20 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->fft_bits       = 0;
+    p_sys->fft_buf        = NULL;
+    p_sys->fft_corr       = NULL;
+    p_sys->fft_twiddle    = NULL;
+    p_sys->fft_bitrev     = NULL;
+    p_sys->dot            = dot_float;
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU() & CPU_CAPABILITY_SSE )
+        p_sys->dot = dot_float_sse;
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        p_sys->dot = dot_float_neon;
+#endif
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -459,6 +670,10 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->fft_buf );
+    free( p_sys->fft_corr );
+    free( p_sys->fft_twiddle );
+    free( p_sys->fft_bitrev );
     free( p_sys );
 }
 
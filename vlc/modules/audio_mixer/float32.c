@@ -33,6 +33,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
+#include "../audio_filter/converter/pcm_helper.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -85,13 +86,7 @@ static int Create( vlc_object_t *p_this )
 static void ScaleWords( float * p_out, const float * p_in, size_t i_nb_words,
                         int i_nb_inputs, float f_multiplier )
 {
-    int i;
-    f_multiplier /= i_nb_inputs;
-
-    for ( i = i_nb_words; i--; )
-    {
-        *p_out++ = *p_in++ * f_multiplier;
-    }
+    pcm_ScaleFl32( p_out, p_in, i_nb_words, f_multiplier / i_nb_inputs );
 }
 
 /*****************************************************************************
@@ -100,13 +95,7 @@ static void ScaleWords( float * p_out, const float * p_in, size_t i_nb_words,
 static void MeanWords( float * p_out, const float * p_in, size_t i_nb_words,
                        int i_nb_inputs, float f_multiplier )
 {
-    int i;
-    f_multiplier /= i_nb_inputs;
-
-    for ( i = i_nb_words; i--; )
-    {
-        *p_out++ += *p_in++ * f_multiplier;
-    }
+    pcm_MixFl32( p_out, p_in, i_nb_words, f_multiplier / i_nb_inputs );
 }
 
 /*****************************************************************************
@@ -54,6 +54,10 @@ static void Close( vlc_object_t * );
 #define ART_LONGTEXT N_( \
         "Allow exporting album art for current playlist items at the " \
         "/art and /art?id=<id> URLs." )
+#define STATS_TEXT N_( "Export statistics as /stats" )
+#define STATS_LONGTEXT N_( \
+        "Allow exporting the statistics of the current input at the " \
+        "/stats URL, as plain text with one value per line." )
 #define CERT_TEXT N_( "Certificate file" )
 #define CERT_LONGTEXT N_( "HTTP interface x509 PEM certificate file " \
                           "(enables SSL)." )
@@ -77,6 +81,7 @@ vlc_module_begin ()
         add_string ( "http-handlers", NULL, NULL, HANDLERS_TEXT, HANDLERS_LONGTEXT, true )
 #endif
         add_bool   ( "http-album-art", false, NULL, ART_TEXT, ART_LONGTEXT, true )
+        add_bool   ( "http-stats", false, NULL, STATS_TEXT, STATS_LONGTEXT, true )
         set_section( N_("HTTP SSL" ), 0 )
         add_string ( "http-intf-cert", NULL, NULL, CERT_TEXT, CERT_LONGTEXT, true )
         add_string ( "http-intf-key",  NULL, NULL, KEY_TEXT,  KEY_LONGTEXT,  true )
@@ -97,6 +102,12 @@ int  ArtCallback( httpd_handler_sys_t *p_args,
                           uint8_t *_p_in, int i_in,
                           char *psz_remote_addr, char *psz_remote_host,
                           uint8_t **pp_data, int *pi_data );
+static int StatsCallback( httpd_handler_sys_t *p_args,
+                          httpd_handler_t *p_handler, char *_p_url,
+                          uint8_t *_p_request, int i_type,
+                          uint8_t *_p_in, int i_in,
+                          char *psz_remote_addr, char *psz_remote_host,
+                          uint8_t **pp_data, int *pi_data );
 
 /*****************************************************************************
  * Activate: initialize and create stuff
@@ -137,6 +148,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->psz_address = psz_address;
     p_sys->i_port     = i_port;
     p_sys->p_art_handler = NULL;
+    p_sys->p_stats = NULL;
 
     /* determine file handler associations */
     p_sys->i_handlers = 0;
@@ -277,6 +289,20 @@ static int Open( vlc_object_t *p_this )
         p_sys->p_art_handler = h->p_handler;
     }
 
+    if( var_InheritBool( p_intf, "http-stats" ) )
+    {
+        httpd_handler_sys_t *h = malloc( sizeof( httpd_handler_sys_t ) );
+        if( !h )
+            goto failed;
+        h->file.p_intf = p_intf;
+        h->file.file = NULL;
+        h->file.name = NULL;
+        h->p_handler = httpd_HandlerNew( p_sys->p_httpd_host,
+                                         "/stats", NULL, NULL, NULL,
+                                         StatsCallback, h );
+        p_sys->p_stats = h;
+    }
+
     return VLC_SUCCESS;
 
 failed:
@@ -332,6 +358,12 @@ static void Close ( vlc_object_t *p_this )
         free( p_sys->pp_handlers );
     if( p_sys->p_art_handler )
         httpd_HandlerDelete( p_sys->p_art_handler );
+    if( p_sys->p_stats )
+    {
+        if( p_sys->p_stats->p_handler )
+            httpd_HandlerDelete( p_sys->p_stats->p_handler );
+        free( p_sys->p_stats );
+    }
     httpd_HostDelete( p_sys->p_httpd_host );
     free( p_sys->psz_address );
     free( p_sys );
@@ -841,3 +873,103 @@ int  ArtCallback( httpd_handler_sys_t *p_args,
 
     return VLC_SUCCESS;
 }
+
+/****************************************************************************
+ * StatsCallback:
+ ****************************************************************************
+ * Exports the statistics of the current input for monitoring tools: one
+ * "name value" pair per line, byte rates in bytes per second.
+ ****************************************************************************/
+static int StatsCallback( httpd_handler_sys_t *p_args,
+                          httpd_handler_t *p_handler, char *_p_url,
+                          uint8_t *p_request, int i_type,
+                          uint8_t *p_in, int i_in,
+                          char *psz_remote_addr, char *psz_remote_host,
+                          uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(p_handler); VLC_UNUSED(_p_url); VLC_UNUSED(p_request);
+    VLC_UNUSED(i_type); VLC_UNUSED(p_in); VLC_UNUSED(i_in);
+    VLC_UNUSED(psz_remote_addr); VLC_UNUSED(psz_remote_host);
+
+    intf_thread_t *p_intf = p_args->file.p_intf;
+    input_thread_t *p_input = playlist_CurrentInput( p_intf->p_sys->p_playlist );
+    input_stats_t stats; /* numeric fields only, the lock is not copied */
+    char *psz_body = NULL;
+    int i_body = -1;
+
+    memset( &stats, 0, sizeof( stats ) );
+    if( p_input )
+    {
+        /* The input thread refreshes this snapshot every second */
+        input_stats_t *p_stats = input_GetItem( p_input )->p_stats;
+        if( p_stats )
+        {
+            vlc_mutex_lock( &p_stats->lock );
+            stats.i_read_packets = p_stats->i_read_packets;
+            stats.i_read_bytes = p_stats->i_read_bytes;
+            stats.f_input_bitrate = p_stats->f_input_bitrate;
+            stats.i_demux_read_bytes = p_stats->i_demux_read_bytes;
+            stats.f_demux_bitrate = p_stats->f_demux_bitrate;
+            stats.i_demux_corrupted = p_stats->i_demux_corrupted;
+            stats.i_demux_discontinuity = p_stats->i_demux_discontinuity;
+            stats.i_decoded_audio = p_stats->i_decoded_audio;
+            stats.i_decoded_video = p_stats->i_decoded_video;
+            stats.i_decoder_fifo = p_stats->i_decoder_fifo;
+            stats.i_displayed_pictures = p_stats->i_displayed_pictures;
+            stats.i_lost_pictures = p_stats->i_lost_pictures;
+            stats.i_played_abuffers = p_stats->i_played_abuffers;
+            stats.i_lost_abuffers = p_stats->i_lost_abuffers;
+            stats.i_sent_packets = p_stats->i_sent_packets;
+            stats.i_sent_bytes = p_stats->i_sent_bytes;
+            stats.f_send_bitrate = p_stats->f_send_bitrate;
+            vlc_mutex_unlock( &p_stats->lock );
+        }
+        vlc_object_release( p_input );
+    }
+
+    i_body = asprintf( &psz_body,
+        "playing %d\n"
+        "input_read_packets %"PRId64"\n"
+        "input_read_bytes %"PRId64"\n"
+        "input_bitrate %.0f\n"
+        "demux_read_bytes %"PRId64"\n"
+        "demux_bitrate %.0f\n"
+        "demux_corrupted %"PRId64"\n"
+        "demux_discontinuity %"PRId64"\n"
+        "decoded_audio %"PRId64"\n"
+        "decoded_video %"PRId64"\n"
+        "decoder_fifo_bytes %"PRId64"\n"
+        "displayed_pictures %"PRId64"\n"
+        "lost_pictures %"PRId64"\n"
+        "played_abuffers %"PRId64"\n"
+        "lost_abuffers %"PRId64"\n"
+        "sent_packets %"PRId64"\n"
+        "sent_bytes %"PRId64"\n"
+        "send_bitrate %.0f\n",
+        p_input != NULL,
+        stats.i_read_packets, stats.i_read_bytes,
+        stats.f_input_bitrate * 1000000.,
+        stats.i_demux_read_bytes, stats.f_demux_bitrate * 1000000.,
+        stats.i_demux_corrupted, stats.i_demux_discontinuity,
+        stats.i_decoded_audio, stats.i_decoded_video, stats.i_decoder_fifo,
+        stats.i_displayed_pictures, stats.i_lost_pictures,
+        stats.i_played_abuffers, stats.i_lost_abuffers,
+        stats.i_sent_packets, stats.i_sent_bytes,
+        stats.f_send_bitrate * 1000000. );
+    if( i_body == -1 )
+        return VLC_ENOMEM;
+
+#define HEADER  "Content-Type: text/plain\n" \
+                "Content-Length: %d\n" \
+                "\n"
+    int i_data = asprintf( (char **)pp_data, HEADER"%s", i_body, psz_body );
+#undef HEADER
+    free( psz_body );
+    if( i_data == -1 )
+    {
+        *pp_data = NULL;
+        return VLC_ENOMEM;
+    }
+    *pi_data = i_data;
+    return VLC_SUCCESS;
+}
@@ -48,6 +48,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("AIFF demuxer" ) )
     set_capability( "demux", 10 )
+    add_magic( 8, "AIFF" )
+    add_extension( "aiff", "aif" )
     set_callbacks( Open, Close )
     add_shortcut( "aiff" )
 vlc_module_end ()
@@ -55,6 +55,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("ASF v1.0 demuxer") )
     set_capability( "demux", 200 )
+    add_magic( 0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11\xa6\xd9\x00\xaa\x00" )
+    add_extension( "asf", "wmv", "wma" )
     set_callbacks( Open, Close )
     add_shortcut( "asf" )
 vlc_module_end ()
@@ -49,6 +49,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("AU demuxer") )
     set_capability( "demux", 10 )
+    add_magic( 0, ".snd" )
+    add_extension( "au", "snd" )
     set_callbacks( Open, Close )
     add_shortcut( "au" )
 vlc_module_end ()
@@ -53,6 +53,8 @@ vlc_module_begin();
     set_subcategory( SUBCAT_INPUT_DEMUX );
     set_description( N_("Dirac video demuxer" ) );
     set_capability( "demux", 50 );
+    add_magic( 0, "BBCD" )
+    add_extension( "drc" )
     add_integer( DEMUX_CFG_PREFIX DEMUX_DTSOFFSET, 0, NULL,
                  DEMUX_DTSOFFSET_TEXT, DEMUX_DTSOFFSET_LONGTEXT, false )
     set_callbacks( Open, Close );
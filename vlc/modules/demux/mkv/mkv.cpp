@@ -45,6 +45,8 @@ vlc_module_begin ()
     set_shortname( "Matroska" )
     set_description( N_("Matroska stream demuxer" ) )
     set_capability( "demux", 50 )
+    add_magic( 0, "\x1a\x45\xdf\xa3" )
+    add_extension( "mkv", "mka", "mks", "webm" )
     set_callbacks( Open, Close )
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -55,6 +55,11 @@ vlc_module_begin ()
     set_description( N_("MP4 stream demuxer") )
     set_shortname( N_("MP4") )
     set_capability( "demux", 242 )
+    add_magic( 4, "ftyp" )
+    add_magic( 4, "moov" )
+    add_magic( 4, "moof" )
+    add_magic( 4, "mdat" )
+    add_extension( "mp4", "m4a", "m4b", "mov", "qt", "3gp", "3g2" )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
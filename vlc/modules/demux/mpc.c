@@ -61,6 +61,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("MusePack demuxer") )
     set_capability( "demux", 145 )
+    add_magic( 0, "MP+" )
+    add_magic( 0, "MPCK" )
+    add_extension( "mpc", "mpp", "mp+" )
 
     set_callbacks( Open, Close )
     add_shortcut( "mpc" )
@@ -55,6 +55,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("MPEG-I/II/4 / A52 / DTS / MLP audio" ) )
     set_capability( "demux", 155 )
+    add_extension( "mp3", "mp2", "mpga", "aac", "ac3", "a52", "eac3", "dts",
+                   "mlp", "thd" )
     set_callbacks( OpenAudio, Close )
 
     add_shortcut( "mpga", "mp3",
@@ -48,6 +48,9 @@ static void Close  ( vlc_object_t * );
 vlc_module_begin ()
     set_description( N_("NullSoft demuxer" ) )
     set_capability( "demux", 10 )
+    add_magic( 0, "NSVf" )
+    add_magic( 0, "NSVs" )
+    add_extension( "nsv" )
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_callbacks( Open, Close )
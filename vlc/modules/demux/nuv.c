@@ -48,6 +48,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_description( N_("Nuv demuxer") )
     set_capability( "demux", 145 )
+    add_magic( 0, "NuppelVideo" )
+    add_magic( 0, "MythTVVideo" )
+    add_extension( "nuv" )
     set_callbacks( Open, Close )
     add_shortcut( "nuv" )
 vlc_module_end ()
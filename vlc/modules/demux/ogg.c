@@ -55,6 +55,8 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 50 )
+    add_magic( 0, "OggS" )
+    add_extension( "ogg", "ogm", "oga", "ogv", "ogx", "spx" )
     set_callbacks( Open, Close )
     add_shortcut( "ogg" )
 vlc_module_end ()
@@ -63,6 +65,16 @@ vlc_module_end ()
 /*****************************************************************************
  * Definitions of structures and functions used by this plugins
  *****************************************************************************/
+
+/* A page of a logical stream, found while seeking */
+typedef struct
+{
+    int64_t     i_pos;                                /* offset of the page */
+    int64_t     i_granule;
+    mtime_t     i_time;                 /* time at the end of the page */
+    bool        b_continued;  /* the dated packet started on an earlier page */
+} ogg_index_point_t;
+
 typedef struct logical_stream_s
 {
     ogg_stream_state os;                        /* logical stream of packets */
@@ -98,6 +110,11 @@ typedef struct logical_stream_s
     /* for Annodex logical bitstreams */
     int i_secondary_header_packets;
 
+    /* pages found while seeking, sorted by offset (and time) */
+    int               i_index;
+    int               i_index_max;
+    ogg_index_point_t *p_index;
+
 } logical_stream_t;
 
 struct demux_sys_t
@@ -123,6 +140,11 @@ struct demux_sys_t
     /* after reading all headers, the first data page is stuffed into the relevant stream, ready to use */
     bool    b_page_waiting;
 
+    /* seeking */
+    bool    b_can_seek;
+    bool    b_length_probed;
+    mtime_t i_length;                    /* from the last page, -1 if unknown */
+
     /* */
     vlc_meta_t *p_meta;
 };
@@ -168,6 +190,12 @@ typedef struct
 
 #define OGG_BLOCK_SIZE 4096
 
+/* Time seeking stops once a page ending this close to the target is found */
+#define OGG_SEEK_PRECISION  (CLOCK_FREQ / 10)
+#define OGG_SEEK_ITERATIONS 32
+/* How far to look for a page of a given logical stream */
+#define OGG_SCAN_MAX        (1024 * 1024)
+
 /* Some defines from OggDS */
 #define PACKET_TYPE_HEADER   0x01
 #define PACKET_TYPE_BITS     0x07
@@ -186,6 +214,11 @@ static int  Ogg_ReadPage     ( demux_t *, ogg_page * );
 static void Ogg_UpdatePCR    ( logical_stream_t *, ogg_packet * );
 static void Ogg_DecodePacket ( demux_t *, logical_stream_t *, ogg_packet * );
 
+/* Seeking */
+static int  Ogg_ProbeLength( demux_t * );
+static int  Ogg_SeekTime( demux_t *, mtime_t );
+static void Ogg_ResetStreams( demux_t * );
+
 static int Ogg_BeginningOfStream( demux_t *p_demux );
 static int Ogg_FindLogicalStreams( demux_t *p_demux );
 static void Ogg_EndOfStream( demux_t *p_demux );
@@ -243,6 +276,10 @@ static int Open( vlc_object_t * p_this )
     ogg_sync_init( &p_sys->oy );
     p_sys->b_page_waiting = false;
 
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_can_seek );
+    p_sys->b_length_probed = false;
+    p_sys->i_length = -1;
+
     /* */
     p_sys->p_meta = NULL;
 
@@ -451,9 +488,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 {
     demux_sys_t *p_sys  = p_demux->p_sys;
     vlc_meta_t *p_meta;
-    int64_t *pi64;
+    int64_t *pi64, i64;
     bool *pb_bool;
-    int i;
 
     switch( i_query )
     {
@@ -473,8 +509,21 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             *pi64 = p_sys->i_pcr;
             return VLC_SUCCESS;
 
+        case DEMUX_GET_LENGTH:
+            if( Ogg_ProbeLength( p_demux ) )
+                return demux_vaControlHelper( p_demux->s, 0, -1,
+                                              p_sys->i_bitrate, 1, i_query,
+                                              args );
+            pi64 = (int64_t*)va_arg( args, int64_t * );
+            *pi64 = p_sys->i_length;
+            return VLC_SUCCESS;
+
         case DEMUX_SET_TIME:
-            return VLC_EGENERIC;
+            i64 = (int64_t)va_arg( args, int64_t );
+            /* see DEMUX_SET_POSITION */
+            if( p_sys->i_bos > 0 || Ogg_ProbeLength( p_demux ) )
+                return VLC_EGENERIC;
+            return Ogg_SeekTime( p_demux, i64 );
 
         case DEMUX_SET_POSITION:
             /* forbid seeking if we haven't initialized all logical bitstreams yet;
@@ -485,17 +534,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 return VLC_EGENERIC;
             }
 
-            for( i = 0; i < p_sys->i_streams; i++ )
-            {
-                logical_stream_t *p_stream = p_sys->pp_stream[i];
-
-                /* we'll trash all the data until we find the next pcr */
-                p_stream->b_reinit = true;
-                p_stream->i_pcr = -1;
-                p_stream->i_interpolated_pcr = -1;
-                ogg_stream_reset( &p_stream->os );
-            }
-            ogg_sync_reset( &p_sys->oy );
+            Ogg_ResetStreams( p_demux );
             /* XXX The break/return is missing on purpose as
              * demux_vaControlHelper will do the last part of the job */
 
@@ -531,6 +570,41 @@ static int Ogg_ReadPage( demux_t *p_demux, ogg_page *p_oggpage )
     return VLC_SUCCESS;
 }
 
+/****************************************************************************
+ * Ogg_GranuleToTime: convert a granulepos into a time, or into the time of
+ *                    the key frame it depends on.
+ ****************************************************************************/
+static mtime_t Ogg_GranuleToTime( const logical_stream_t *p_stream,
+                                  int64_t i_granule, bool b_keyframe )
+{
+    int64_t i_frame;
+
+    if( p_stream->fmt.i_codec == VLC_CODEC_THEORA ||
+        p_stream->fmt.i_codec == VLC_CODEC_KATE )
+    {
+        ogg_int64_t iframe = i_granule >> p_stream->i_granule_shift;
+        ogg_int64_t pframe = i_granule - ( iframe << p_stream->i_granule_shift );
+
+        i_frame = b_keyframe ? iframe : iframe + pframe;
+    }
+    else if( p_stream->fmt.i_codec == VLC_CODEC_DIRAC )
+    {
+        /* NB, OggDirac granulepos values are in units of 2*picturerate */
+        i_frame = ( i_granule >> 31 ) / 2;
+        if( b_keyframe )
+        {
+            /* pictures since the last sync point */
+            i_frame -= ( ( i_granule >> 14 ) & 0xff00 ) | ( i_granule & 0xff );
+            if( i_frame < 0 )
+                i_frame = 0;
+        }
+    }
+    else
+        i_frame = i_granule;
+
+    return i_frame * INT64_C(1000000) / p_stream->f_rate;
+}
+
 /****************************************************************************
  * Ogg_UpdatePCR: update the PCR (90kHz program clock reference) for the
  *                current stream.
@@ -541,29 +615,8 @@ static void Ogg_UpdatePCR( logical_stream_t *p_stream,
     /* Convert the granulepos into a pcr */
     if( p_oggpacket->granulepos >= 0 )
     {
-        if( p_stream->fmt.i_codec == VLC_CODEC_THEORA ||
-            p_stream->fmt.i_codec == VLC_CODEC_KATE )
-        {
-            ogg_int64_t iframe = p_oggpacket->granulepos >>
-              p_stream->i_granule_shift;
-            ogg_int64_t pframe = p_oggpacket->granulepos -
-              ( iframe << p_stream->i_granule_shift );
-
-            p_stream->i_pcr = ( iframe + pframe ) * INT64_C(1000000)
-                              / p_stream->f_rate;
-        }
-        else if( p_stream->fmt.i_codec == VLC_CODEC_DIRAC )
-        {
-            ogg_int64_t i_dts = p_oggpacket->granulepos >> 31;
-            /* NB, OggDirac granulepos values are in units of 2*picturerate */
-            p_stream->i_pcr = (i_dts/2) * INT64_C(1000000) / p_stream->f_rate;
-        }
-        else
-        {
-            p_stream->i_pcr = p_oggpacket->granulepos * INT64_C(1000000)
-                              / p_stream->f_rate;
-        }
-
+        p_stream->i_pcr = Ogg_GranuleToTime( p_stream,
+                                             p_oggpacket->granulepos, false );
         p_stream->i_pcr += 1;
         p_stream->i_interpolated_pcr = p_stream->i_pcr;
     }
@@ -583,6 +636,297 @@ static void Ogg_UpdatePCR( logical_stream_t *p_stream,
     }
 }
 
+/****************************************************************************
+ * Ogg_IndexAdd: remember a page found while seeking, unless it is out of
+ *               order with its neighbours (e.g. in a chained stream).
+ ****************************************************************************/
+static void Ogg_IndexAdd( logical_stream_t *p_stream,
+                          const ogg_index_point_t *p_point )
+{
+    int i_low = 0, i_high = p_stream->i_index;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_stream->p_index[i_mid].i_pos <= p_point->i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    if( i_low > 0 &&
+        ( p_stream->p_index[i_low - 1].i_pos == p_point->i_pos ||
+          p_stream->p_index[i_low - 1].i_time > p_point->i_time ) )
+        return;
+    if( i_low < p_stream->i_index &&
+        p_stream->p_index[i_low].i_time < p_point->i_time )
+        return;
+
+    if( p_stream->i_index >= p_stream->i_index_max )
+    {
+        const int i_max = p_stream->i_index_max ? 2 * p_stream->i_index_max
+                                                : 64;
+        ogg_index_point_t *p_index = realloc( p_stream->p_index,
+                                              i_max * sizeof(*p_index) );
+        if( !p_index )
+            return;
+        p_stream->p_index = p_index;
+        p_stream->i_index_max = i_max;
+    }
+    memmove( &p_stream->p_index[i_low + 1], &p_stream->p_index[i_low],
+             ( p_stream->i_index - i_low ) * sizeof(*p_stream->p_index) );
+    p_stream->p_index[i_low] = *p_point;
+    p_stream->i_index++;
+}
+
+/****************************************************************************
+ * Ogg_ScanPage: look for the first (or the last) page of a logical stream
+ *               with a granulepos, starting between two offsets.
+ ****************************************************************************
+ * The stream position is left undefined.
+ ****************************************************************************/
+static int Ogg_ScanPage( demux_t *p_demux, logical_stream_t *p_stream,
+                         int64_t i_start, int64_t i_end, bool b_last,
+                         ogg_index_point_t *p_point )
+{
+    ogg_sync_state oy;
+    ogg_page oggpage;
+    bool b_found = false;
+
+    if( stream_Seek( p_demux->s, i_start ) )
+        return VLC_EGENERIC;
+    ogg_sync_init( &oy );
+
+    while( i_start < i_end && ( b_last || !b_found ) )
+    {
+        long i_page = ogg_sync_pageseek( &oy, &oggpage );
+
+        if( i_page == 0 )
+        {
+            char *p_buffer = ogg_sync_buffer( &oy, OGG_BLOCK_SIZE );
+            int i_read = stream_Read( p_demux->s, p_buffer, OGG_BLOCK_SIZE );
+            if( i_read <= 0 )
+                break;
+            ogg_sync_wrote( &oy, i_read );
+            continue;
+        }
+
+        /* A negative size is garbage skipped before the next page */
+        if( i_page > 0 &&
+            ogg_page_serialno( &oggpage ) == p_stream->i_serial_no &&
+            ogg_page_granulepos( &oggpage ) >= 0 )
+        {
+            p_point->i_pos = i_start;
+            p_point->i_granule = ogg_page_granulepos( &oggpage );
+            p_point->i_time = Ogg_GranuleToTime( p_stream, p_point->i_granule,
+                                                 false );
+            p_point->b_continued = ogg_page_continued( &oggpage ) &&
+                                   ogg_page_packets( &oggpage ) == 1;
+            b_found = true;
+        }
+        i_start += labs( i_page );
+    }
+
+    ogg_sync_clear( &oy );
+    return b_found ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/****************************************************************************
+ * Ogg_GetSeekStream: the logical stream time seeking is based on, video if
+ *                    any for its key frames.
+ ****************************************************************************/
+static logical_stream_t *Ogg_GetSeekStream( demux_sys_t *p_ogg )
+{
+    logical_stream_t *p_audio = NULL;
+
+    for( int i_stream = 0; i_stream < p_ogg->i_streams; i_stream++ )
+    {
+        logical_stream_t *p_stream = p_ogg->pp_stream[i_stream];
+
+        if( p_stream->f_rate <= 0 )
+            continue;
+        if( p_stream->fmt.i_cat == VIDEO_ES )
+            return p_stream;
+        if( p_stream->fmt.i_cat == AUDIO_ES && !p_audio )
+            p_audio = p_stream;
+    }
+    return p_audio;
+}
+
+/****************************************************************************
+ * Ogg_ProbeLength: get the length from the granulepos of the last page of
+ *                  a seekable stream.
+ ****************************************************************************/
+static int Ogg_ProbeLength( demux_t *p_demux )
+{
+    demux_sys_t *p_ogg = p_demux->p_sys;
+
+    if( !p_ogg->b_length_probed )
+    {
+        logical_stream_t *p_stream = Ogg_GetSeekStream( p_ogg );
+        ogg_index_point_t last;
+
+        if( !p_ogg->b_can_seek || !p_stream )
+            return VLC_EGENERIC;
+        p_ogg->b_length_probed = true;
+
+        const int64_t i_size = stream_Size( p_demux->s );
+        const int64_t i_tell = stream_Tell( p_demux->s );
+
+        /* Look back from the end, further and further */
+        for( int64_t i_window = 16 * OGG_BLOCK_SIZE; i_window <= OGG_SCAN_MAX;
+             i_window *= 2 )
+        {
+            const int64_t i_start = __MAX( i_size - i_window, 0 );
+
+            if( !Ogg_ScanPage( p_demux, p_stream, i_start, i_size, true,
+                               &last ) )
+            {
+                p_ogg->i_length = last.i_time;
+                Ogg_IndexAdd( p_stream, &last );
+                msg_Dbg( p_demux, "length %"PRId64" ms", last.i_time / 1000 );
+                break;
+            }
+            if( i_start == 0 )
+                break;
+        }
+        stream_Seek( p_demux->s, i_tell );
+    }
+    return p_ogg->i_length >= 0 ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/****************************************************************************
+ * Ogg_SeekFind: find the last page of a logical stream ending at or before
+ *               a time, by bisection between the nearest known pages.
+ ****************************************************************************
+ * The pages found on the way are added to the index of the stream. If there
+ * is no such page, the start of the physical stream is returned.
+ ****************************************************************************/
+static void Ogg_SeekFind( demux_t *p_demux, logical_stream_t *p_stream,
+                          mtime_t i_time, ogg_index_point_t *p_found )
+{
+    ogg_index_point_t low = { 0, -1, -1, false };
+    ogg_index_point_t high = { stream_Size( p_demux->s ), -1, INT64_MAX,
+                               false };
+    int i_low = 0, i_high = p_stream->i_index;
+    int i_step;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_stream->p_index[i_mid].i_time <= i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    if( i_low > 0 )
+        low = p_stream->p_index[i_low - 1];
+    if( i_low < p_stream->i_index )
+        high = p_stream->p_index[i_low];
+
+    for( i_step = 0; i_step < OGG_SEEK_ITERATIONS &&
+                     i_time - low.i_time > OGG_SEEK_PRECISION &&
+                     high.i_pos - low.i_pos > 1; i_step++ )
+    {
+        ogg_index_point_t point;
+        int64_t i_pos;
+
+        /* Interpolate, aiming slightly early so that the next page ends
+         * before the target, but halve the interval every other step so
+         * that variable bit rates converge as well */
+        if( ( i_step & 1 ) == 0 && low.i_time >= 0 &&
+            high.i_time != INT64_MAX && high.i_time > low.i_time )
+            i_pos = low.i_pos + (double)( high.i_pos - low.i_pos )
+                  * ( i_time - OGG_SEEK_PRECISION / 2 - low.i_time )
+                  / ( high.i_time - low.i_time );
+        else
+            i_pos = low.i_pos + ( high.i_pos - low.i_pos ) / 2;
+        if( i_pos <= low.i_pos )
+            i_pos = low.i_pos + 1;
+        if( i_pos >= high.i_pos )
+            i_pos = high.i_pos - 1;
+
+        if( Ogg_ScanPage( p_demux, p_stream, i_pos,
+                          __MIN( high.i_pos, i_pos + OGG_SCAN_MAX ), false,
+                          &point ) )
+        {
+            /* No page of this stream between there and the upper bound */
+            high.i_pos = i_pos;
+            continue;
+        }
+
+        Ogg_IndexAdd( p_stream, &point );
+        if( point.i_time <= i_time )
+            low = point;
+        else
+            high = point;
+    }
+
+    msg_Dbg( p_demux, "seek to %"PRId64" ms found page at %"PRId64" ending "
+             "at %"PRId64" ms in %d steps", i_time / 1000, low.i_pos,
+             low.i_time / 1000, i_step );
+    *p_found = low;
+}
+
+/****************************************************************************
+ * Ogg_SeekTime: seek to the page to start decoding from to present a time.
+ ****************************************************************************/
+static int Ogg_SeekTime( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_ogg = p_demux->p_sys;
+    logical_stream_t *p_stream = Ogg_GetSeekStream( p_ogg );
+    ogg_index_point_t page;
+
+    if( !p_stream )
+        return VLC_EGENERIC;
+    if( i_time > p_ogg->i_length )
+        i_time = p_ogg->i_length;
+
+    Ogg_SeekFind( p_demux, p_stream, i_time, &page );
+
+    /* After a seek, the packets are dropped up to the first one with a
+     * granulepos, the last of the page: back off to a page ending before the
+     * key frame that one depends on. */
+    if( ( p_stream->fmt.i_codec == VLC_CODEC_THEORA ||
+          p_stream->fmt.i_codec == VLC_CODEC_DIRAC ) && page.i_granule >= 0 )
+    {
+        const mtime_t i_keyframe = Ogg_GranuleToTime( p_stream,
+                                                      page.i_granule, true );
+        Ogg_SeekFind( p_demux, p_stream, i_keyframe - 1, &page );
+    }
+
+    /* That packet is dropped as well if it started on an earlier page */
+    if( page.b_continued )
+        Ogg_SeekFind( p_demux, p_stream, page.i_time - 1, &page );
+
+    Ogg_ResetStreams( p_demux );
+    return stream_Seek( p_demux->s, page.i_pos );
+}
+
+/****************************************************************************
+ * Ogg_ResetStreams: drop the buffered data before seeking.
+ ****************************************************************************/
+static void Ogg_ResetStreams( demux_t *p_demux )
+{
+    demux_sys_t *p_ogg = p_demux->p_sys;
+
+    for( int i_stream = 0; i_stream < p_ogg->i_streams; i_stream++ )
+    {
+        logical_stream_t *p_stream = p_ogg->pp_stream[i_stream];
+
+        /* we'll trash all the data until we find the next pcr */
+        p_stream->b_reinit = true;
+        p_stream->i_pcr = -1;
+        p_stream->i_interpolated_pcr = -1;
+        ogg_stream_reset( &p_stream->os );
+    }
+    ogg_sync_reset( &p_ogg->oy );
+    p_ogg->b_page_waiting = false;
+    p_ogg->i_eos = 0;
+}
+
 /****************************************************************************
  * Ogg_DecodePacket: Decode an Ogg packet.
  ****************************************************************************/
@@ -1436,6 +1780,8 @@ static void Ogg_EndOfStream( demux_t *p_demux )
     p_ogg->i_bitrate = 0;
     p_ogg->i_streams = 0;
     p_ogg->pp_stream = NULL;
+    p_ogg->b_length_probed = false;
+    p_ogg->i_length = -1;
 
     /* */
     if( p_ogg->p_meta )
@@ -1453,6 +1799,7 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
 
     ogg_stream_clear( &p_stream->os );
     free( p_stream->p_headers );
+    free( p_stream->p_index );
 
     es_format_Clean( &p_stream->fmt_old );
     es_format_Clean( &p_stream->fmt );
@@ -73,6 +73,8 @@ vlc_module_begin ()
         set_description( N_("M3U playlist import") )
         add_shortcut( "playlist", "m3u", "m3u8", "m3u-open" )
         set_capability( "demux", 10 )
+        add_magic( 0, "#EXTM3U" )
+        add_extension( "m3u", "m3u8" )
         set_callbacks( Import_M3U, Close_M3U )
     add_submodule ()
         set_description( N_("RAM playlist import") )
@@ -83,6 +85,8 @@ vlc_module_begin ()
         set_description( N_("PLS playlist import") )
         add_shortcut( "playlist", "pls-open" )
         set_capability( "demux", 10 )
+        add_magic( 0, "[playlist]" )
+        add_extension( "pls" )
         set_callbacks( Import_PLS, Close_PLS )
     add_submodule ()
         set_description( N_("B4S playlist import") )
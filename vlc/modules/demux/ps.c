@@ -68,6 +68,8 @@ vlc_module_begin ()
     add_submodule ()
     set_description( N_("MPEG-PS demuxer") )
     set_capability( "demux", 8 )
+    add_magic( 0, "\x00\x00\x01\xba" )
+    add_extension( "mpg", "mpeg", "vob", "vro" )
     set_callbacks( Open, Close )
     add_shortcut( "ps" )
 vlc_module_end ()
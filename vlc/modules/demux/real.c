@@ -69,6 +69,9 @@ static void Close  ( vlc_object_t * );
 vlc_module_begin ()
     set_description( N_("Real demuxer" ) )
     set_capability( "demux", 50 )
+    add_magic( 0, ".RMF" )
+    add_magic( 0, ".ra" )
+    add_extension( "rm", "rmvb", "ra" )
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_callbacks( Open, Close )
@@ -155,6 +155,13 @@ static void Close ( vlc_object_t * );
     "Tweak the buffer size for reading and writing an integer number of packets." \
     "Specify the size of the buffer here and not the number of packets." )
 
+#define BULK_TEXT N_("Packets per read")
+#define BULK_LONGTEXT N_( \
+    "Number of TS packets read from the stream at once. The packets are " \
+    "then demultiplexed straight from that buffer, without being copied. " \
+    "Use 1 to read packets one at a time, which lowers the latency of very " \
+    "low bitrate live streams." )
+
 #define SPLIT_ES_TEXT N_("Separate sub-streams")
 #define SPLIT_ES_LONGTEXT N_( \
     "Separate teletex/dvbs pages into independent ES. " \
@@ -181,8 +188,11 @@ vlc_module_begin ()
     add_integer( "ts-dump-size", 16384, NULL, DUMPSIZE_TEXT,
                  DUMPSIZE_LONGTEXT, true )
     add_bool( "ts-split-es", true, NULL, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
+    add_integer( "ts-bulk-packets", 64, NULL, BULK_TEXT, BULK_LONGTEXT, true )
+        change_integer_range( 1, 1024 )
 
     set_capability( "demux", 10 )
+    add_extension( "ts", "m2t", "m2ts", "mts", "tp", "trp" )
     set_callbacks( Open, Close )
     add_shortcut( "ts" )
 vlc_module_end ()
@@ -342,6 +352,34 @@ typedef struct
 
 } ts_pid_t;
 
+typedef struct ts_chunk_t ts_chunk_t;
+
+/* A TS packet referencing a bulk read buffer */
+typedef struct
+{
+    block_t     self;
+    ts_chunk_t *p_chunk;
+} ts_view_t;
+
+/* Bulk read buffer, shared by the packet views handed out from it */
+struct ts_chunk_t
+{
+    demux_sys_t *p_sys;
+    unsigned    i_refs;   /* demuxer reference + live views */
+    size_t      i_data;   /* valid bytes in p_data */
+    size_t      i_offset; /* offset of the next packet in p_data */
+    unsigned    i_views;  /* views handed out */
+    ts_view_t   *p_views;
+    uint8_t     *p_data;
+};
+
+/* A point of the time index: a packet carrying a PCR and its unwrapped PCR */
+typedef struct
+{
+    int64_t     i_pos;
+    mtime_t     i_pcr; /* 90kHz */
+} ts_pcr_point_t;
+
 struct demux_sys_t
 {
     vlc_mutex_t     csa_lock;
@@ -352,6 +390,11 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     int         i_ts_read;
 
+    /* Bulk reading (packets per read, current and recycled buffers) */
+    int         i_bulk_packets;
+    ts_chunk_t  *p_chunk;
+    ts_chunk_t  *p_chunk_spare;
+
     /* All pid */
     ts_pid_t    pid[8192];
 
@@ -394,6 +437,19 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* Time index of seekable streams, on the PCR of the first program seen.
+     * PCR are unwrapped forward from the first PCR of the file. */
+    bool        b_can_seek;
+    bool        b_pcr_probed;     /* first and last PCR looked up */
+    int         i_pcr_pid;        /* indexed PID, -1 until a PCR is seen */
+    mtime_t     i_pcr_first;      /* -1 if unknown */
+    mtime_t     i_pcr_last;
+    int64_t     i_pcr_first_pos;
+    mtime_t     i_pcr_current;    /* last PCR demuxed, -1 after a seek */
+    int         i_index;
+    int         i_index_max;
+    ts_pcr_point_t *p_index;      /* sorted by position and by PCR */
 };
 
 static int Demux    ( demux_t *p_demux );
@@ -417,9 +473,15 @@ static inline int PIDGet( block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 
+static block_t *ReadTSPacket( demux_t *p_demux );
+static void TsChunkRelease( ts_chunk_t * );
+static void TsChunkFlush( demux_sys_t * );
+
 static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
+static int  PCRProbeBounds( demux_t * );
+static int  PCRSeekTime( demux_t *, mtime_t );
 
 static iod_descriptor_t *IODNew( int , uint8_t * );
 static void              IODFree( iod_descriptor_t * );
@@ -436,6 +498,17 @@ static void SetPrgFilter( demux_t *, int i_prg, bool b_selected );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_TOPFIELD_HEADER 1320
 
+/* PCR are 33 bits at 90kHz, and wrap around every 26.5 hours */
+#define TS_PCR_MASK         ((INT64_C(1) << 33) - 1)
+/* Minimum PCR distance between two points of the time index (1s) */
+#define TS_INDEX_SPACING    90000
+/* Time seeking stops once the target is bracketed this closely (100ms) */
+#define TS_SEEK_PRECISION   9000
+#define TS_SEEK_ITERATIONS  32
+/* How far to look for a PCR, and packets read at once while looking */
+#define TS_PCR_SCAN_MAX     (4 * 1024 * 1024)
+#define TS_PCR_SCAN_PACKETS 64
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -668,9 +741,25 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_udp_out = false;
     p_sys->fd = -1;
     p_sys->i_ts_read = 50;
+    p_sys->i_bulk_packets = var_InheritInteger( p_demux, "ts-bulk-packets" );
+    if( p_sys->i_bulk_packets < 1 )
+        p_sys->i_bulk_packets = 1;
+    p_sys->p_chunk = NULL;
+    p_sys->p_chunk_spare = NULL;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
+    stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_can_seek );
+    p_sys->b_pcr_probed = false;
+    p_sys->i_pcr_pid = -1;
+    p_sys->i_pcr_first = -1;
+    p_sys->i_pcr_last = -1;
+    p_sys->i_pcr_first_pos = 0;
+    p_sys->i_pcr_current = -1;
+    p_sys->i_index = 0;
+    p_sys->i_index_max = 0;
+    p_sys->p_index = NULL;
+
     /* Init PAT handler */
     pat = &p_sys->pid[0];
     PIDInit( pat, true, NULL );
@@ -883,7 +972,14 @@ static void Close( vlc_object_t *p_this )
 
     TAB_CLEAN( p_sys->i_pmt, p_sys->pmt );
 
+    /* All the packet views have been released with the PES above */
+    if( p_sys->p_chunk )
+        TsChunkRelease( p_sys->p_chunk );
+    assert( p_sys->p_chunk_spare == NULL || p_sys->p_chunk_spare->i_refs == 0 );
+    free( p_sys->p_chunk_spare );
+
     free( p_sys->programs_list.p_values );
+    free( p_sys->p_index );
 
     /* If in dump mode, then close the file */
     if( p_sys->b_file_out )
@@ -1034,71 +1130,235 @@ static int DemuxFile( demux_t *p_demux )
 }
 
 /*****************************************************************************
- * Demux:
+ * Packet reading
  *****************************************************************************/
-static int Demux( demux_t *p_demux )
+static void TsViewRelease( block_t *p_block )
+{
+    TsChunkRelease( ((ts_view_t *)p_block)->p_chunk );
+}
+
+static void TsChunkRelease( ts_chunk_t *p_chunk )
+{
+    demux_sys_t *p_sys = p_chunk->p_sys;
+
+    assert( p_chunk->i_refs > 0 );
+    if( --p_chunk->i_refs > 0 )
+        return;
+
+    /* Keep one buffer around, so that reading does not allocate */
+    if( p_sys->p_chunk_spare == NULL )
+        p_sys->p_chunk_spare = p_chunk;
+    else
+        free( p_chunk );
+}
+
+/* Discards the packets that were read ahead (e.g. when seeking) */
+static void TsChunkFlush( demux_sys_t *p_sys )
+{
+    if( p_sys->p_chunk )
+        p_sys->p_chunk->i_offset = p_sys->p_chunk->i_data;
+}
+
+/* Bytes read from the stream but not yet handed to the demuxer */
+static size_t TsChunkPending( demux_sys_t *p_sys )
+{
+    if( p_sys->p_chunk == NULL )
+        return 0;
+    return p_sys->p_chunk->i_data - p_sys->p_chunk->i_offset;
+}
+
+/**
+ * Reads a new bulk buffer. The unused bytes of the previous buffer, if any,
+ * are carried over in front of it.
+ */
+static int TsChunkFill( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_wait_es = p_sys->i_pmt_es <= 0;
+    const size_t i_packets = p_sys->i_bulk_packets;
+    const size_t i_size = i_packets * p_sys->i_packet_size;
+    ts_chunk_t *p_old = p_sys->p_chunk;
+    ts_chunk_t *p_chunk = p_sys->p_chunk_spare;
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( int i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    if( p_chunk != NULL )
+        p_sys->p_chunk_spare = NULL;
+    else
     {
-        bool         b_frame = false;
-        block_t     *p_pkt;
+        p_chunk = malloc( sizeof(*p_chunk)
+                        + i_packets * sizeof(ts_view_t) + i_size );
+        if( p_chunk == NULL )
+            return VLC_ENOMEM;
+        p_chunk->p_sys = p_sys;
+        p_chunk->p_views = (ts_view_t *)(p_chunk + 1);
+        p_chunk->p_data = (uint8_t *)(p_chunk->p_views + i_packets);
+    }
+    p_chunk->i_refs = 1;
+    p_chunk->i_views = 0;
+    p_chunk->i_offset = 0;
+    p_chunk->i_data = 0;
 
-        /* Get a new TS packet */
-        if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
-        {
-            msg_Dbg( p_demux, "eof ?" );
-            return 0;
-        }
+    if( p_old != NULL )
+    {
+        size_t i_tail = p_old->i_data - p_old->i_offset;
+
+        assert( i_tail < i_size );
+        memcpy( p_chunk->p_data, p_old->p_data + p_old->i_offset, i_tail );
+        p_chunk->i_data = i_tail;
+        TsChunkRelease( p_old );
+    }
+    p_sys->p_chunk = p_chunk;
+
+    int i_read = stream_Read( p_demux->s, p_chunk->p_data + p_chunk->i_data,
+                              i_size - p_chunk->i_data );
+    if( i_read > 0 )
+        p_chunk->i_data += i_read;
+    if( p_chunk->i_data < (size_t)p_sys->i_packet_size )
+    {
+        msg_Dbg( p_demux, "eof ?" );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
 
-        /* Check sync byte and re-sync if needed */
-        if( p_pkt->p_buffer[0] != 0x47 )
+/**
+ * Returns the next TS packet, synchronized on the sync byte, or NULL at the
+ * end of the stream. In bulk mode, the packet is a view of the bulk buffer.
+ */
+static block_t *ReadTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_packet_size = p_sys->i_packet_size;
+    block_t     *p_pkt;
+
+    if( p_sys->i_bulk_packets > 1 )
+    {
+        for( ;; )
         {
+            ts_chunk_t *p_chunk = p_sys->p_chunk;
+
+            if( TsChunkPending( p_sys ) < i_packet_size )
+            {
+                if( TsChunkFill( p_demux ) )
+                    return NULL;
+                continue;
+            }
+
+            uint8_t *p_data = p_chunk->p_data + p_chunk->i_offset;
+            if( likely(p_data[0] == 0x47) )
+            {
+                ts_view_t *p_view = &p_chunk->p_views[p_chunk->i_views++];
+
+                assert( p_chunk->i_views <= (unsigned)p_sys->i_bulk_packets );
+                block_Init( &p_view->self, p_data, i_packet_size );
+                p_view->self.pf_release = TsViewRelease;
+                p_view->p_chunk = p_chunk;
+                p_chunk->i_refs++;
+                p_chunk->i_offset += i_packet_size;
+                return &p_view->self;
+            }
+
+            /* Check sync byte and re-sync if needed, over the whole buffer */
             msg_Warn( p_demux, "lost synchro" );
-            block_Release( p_pkt );
+            if( !vlc_object_alive( p_demux ) )
+                return NULL;
 
-            while( vlc_object_alive (p_demux) )
+            size_t i_skip = p_chunk->i_offset;
+            while( i_skip + i_packet_size < p_chunk->i_data )
             {
-                const uint8_t *p_peek;
-                int i_peek, i_skip = 0;
+                if( p_chunk->p_data[i_skip] == 0x47 &&
+                    p_chunk->p_data[i_skip + i_packet_size] == 0x47 )
+                    break;
+                i_skip++;
+            }
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage",
+                     i_skip - p_chunk->i_offset );
 
-                i_peek = stream_Peek( p_demux->s, &p_peek,
-                                      p_sys->i_packet_size * 10 );
-                if( i_peek < p_sys->i_packet_size + 1 )
-                {
-                    msg_Dbg( p_demux, "eof ?" );
-                    return 0;
-                }
+            if( i_skip + i_packet_size < p_chunk->i_data )
+                p_chunk->i_offset = i_skip;
+            else
+            {   /* Not found: keep the last packet worth of data, and read
+                 * some more before looking again */
+                if( p_chunk->i_data - p_chunk->i_offset > i_packet_size )
+                    p_chunk->i_offset = p_chunk->i_data - i_packet_size;
+                else
+                    p_chunk->i_offset++;
+                if( TsChunkFill( p_demux ) )
+                    return NULL;
+            }
+        }
+    }
 
-                while( i_skip < i_peek - p_sys->i_packet_size )
-                {
-                    if( p_peek[i_skip] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_size] == 0x47 )
-                    {
-                        break;
-                    }
-                    i_skip++;
-                }
+    /* Get a new TS packet */
+    if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
+    {
+        msg_Dbg( p_demux, "eof ?" );
+        return NULL;
+    }
 
-                msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-                stream_Read( p_demux->s, NULL, i_skip );
+    /* Check sync byte and re-sync if needed */
+    if( p_pkt->p_buffer[0] != 0x47 )
+    {
+        msg_Warn( p_demux, "lost synchro" );
+        block_Release( p_pkt );
+
+        while( vlc_object_alive (p_demux) )
+        {
+            const uint8_t *p_peek;
+            int i_peek, i_skip = 0;
 
-                if( i_skip < i_peek - p_sys->i_packet_size )
+            i_peek = stream_Peek( p_demux->s, &p_peek,
+                                  p_sys->i_packet_size * 10 );
+            if( i_peek < p_sys->i_packet_size + 1 )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+
+            while( i_skip < i_peek - p_sys->i_packet_size )
+            {
+                if( p_peek[i_skip] == 0x47 &&
+                    p_peek[i_skip + p_sys->i_packet_size] == 0x47 )
                 {
                     break;
                 }
+                i_skip++;
             }
 
-            if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
+            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
+            stream_Read( p_demux->s, NULL, i_skip );
+
+            if( i_skip < i_peek - p_sys->i_packet_size )
             {
-                msg_Dbg( p_demux, "eof ?" );
-                return 0;
+                break;
             }
         }
 
+        if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return NULL;
+        }
+    }
+    return p_pkt;
+}
+
+/*****************************************************************************
+ * Demux:
+ *****************************************************************************/
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_wait_es = p_sys->i_pmt_es <= 0;
+
+    /* We read at most 100 TS packet or until a frame is completed */
+    for( int i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    {
+        bool         b_frame = false;
+        block_t     *p_pkt;
+
+        /* Get a new TS packet */
+        if( !( p_pkt = ReadTSPacket( p_demux ) ) )
+            return 0;
+
         if( p_sys->b_start_record )
         {
             /* Enable recording once synchronized */
@@ -1219,7 +1479,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         i64 = stream_Size( p_demux->s );
         if( i64 > 0 )
         {
-            double f_current = stream_Tell( p_demux->s );
+            double f_current = stream_Tell( p_demux->s )
+                             - TsChunkPending( p_sys );
             *pf = f_current / (double)i64;
         }
         else
@@ -1237,43 +1498,46 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( stream_Seek( p_demux->s, (int64_t)(i64 * f) ) )
             return VLC_EGENERIC;
+        TsChunkFlush( p_sys );
+        p_sys->i_pcr_current = -1;
 
         return VLC_SUCCESS;
-#if 0
 
     case DEMUX_GET_TIME:
         pi64 = (int64_t*)va_arg( args, int64_t * );
-        if( p_sys->i_time < 0 )
+        if( !PCRProbeBounds( p_demux ) )
         {
-            *pi64 = 0;
-            return VLC_EGENERIC;
-        }
-        *pi64 = p_sys->i_time;
-        return VLC_SUCCESS;
+            const mtime_t i_length = p_sys->i_pcr_last - p_sys->i_pcr_first;
 
-    case DEMUX_GET_LENGTH:
-        pi64 = (int64_t*)va_arg( args, int64_t * );
-        if( p_sys->i_mux_rate > 0 )
-        {
-            *pi64 = INT64_C(1000000) * ( stream_Size( p_demux->s ) / 50 ) /
-                    p_sys->i_mux_rate;
-            return VLC_SUCCESS;
+            if( p_sys->i_pcr_current >= 0 )
+                *pi64 = ( p_sys->i_pcr_current - p_sys->i_pcr_first ) * 100 / 9;
+            else
+            {
+                /* Seeked by position, interpolate until the next PCR */
+                i64 = stream_Size( p_demux->s );
+                f = i64 > 0 ? ( stream_Tell( p_demux->s )
+                                - TsChunkPending( p_sys ) ) / (double)i64 : 0.;
+                *pi64 = f * i_length * 100 / 9;
+            }
         }
-        *pi64 = 0;
-        return VLC_EGENERIC;
-#else
-    case DEMUX_GET_TIME:
-        pi64 = (int64_t*)va_arg( args, int64_t * );
-        if( DVBEventInformation( p_demux, pi64, NULL ) )
+        else if( DVBEventInformation( p_demux, pi64, NULL ) )
             *pi64 = 0;
         return VLC_SUCCESS;
 
     case DEMUX_GET_LENGTH:
         pi64 = (int64_t*)va_arg( args, int64_t * );
-        if( DVBEventInformation( p_demux, NULL, pi64 ) )
+        if( !PCRProbeBounds( p_demux ) )
+            *pi64 = ( p_sys->i_pcr_last - p_sys->i_pcr_first ) * 100 / 9;
+        else if( DVBEventInformation( p_demux, NULL, pi64 ) )
             *pi64 = 0;
         return VLC_SUCCESS;
-#endif
+
+    case DEMUX_SET_TIME:
+        i64 = (int64_t)va_arg( args, int64_t );
+        if( PCRProbeBounds( p_demux ) )
+            return VLC_EGENERIC;
+        return PCRSeekTime( p_demux, p_sys->i_pcr_first + i64 * 9 / 100 );
+
     case DEMUX_SET_GROUP:
     {
         vlc_list_t *p_list;
@@ -1340,7 +1604,6 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         return VLC_SUCCESS;
 
     case DEMUX_GET_FPS:
-    case DEMUX_SET_TIME:
     default:
         return VLC_EGENERIC;
     }
@@ -1843,6 +2106,16 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
         p_pes->i_length = i_length * 100 / 9;
 
         p_block = block_ChainGather( p_pes );
+        if( p_block->pf_release == TsViewRelease )
+        {
+            /* The PES fits in a single TS packet: copy it, so that the bulk
+             * buffer is never referenced outside of the demuxer */
+            block_t *p_dup = block_Duplicate( p_block );
+            block_Release( p_block );
+            if( p_dup == NULL )
+                return;
+            p_block = p_dup;
+        }
         if( pid->es->fmt.i_codec == VLC_CODEC_SUBT )
         {
             if( i_pes_size > 0 && p_block->i_buffer > i_pes_size )
@@ -1868,25 +2141,328 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
     }
 }
 
+/* Returns the PCR base of a TS packet, if it carries one */
+static inline bool GetPCR( const uint8_t *p, mtime_t *pi_pcr )
+{
+    if( ( p[3]&0x20 ) && /* adaptation */
+        ( p[5]&0x10 ) &&
+        ( p[4] >= 7 ) )
+    {
+        /* PCR is 33 bits */
+        *pi_pcr = ( (mtime_t)p[6] << 25 ) |
+                  ( (mtime_t)p[7] << 17 ) |
+                  ( (mtime_t)p[8] << 9 ) |
+                  ( (mtime_t)p[9] << 1 ) |
+                  ( (mtime_t)p[10] >> 7 );
+        return true;
+    }
+    return false;
+}
+
+/* Unwraps a PCR forward from the first PCR of the stream */
+static inline mtime_t PCRUnwrap( const demux_sys_t *p_sys, mtime_t i_pcr )
+{
+    return p_sys->i_pcr_first + ( ( i_pcr - p_sys->i_pcr_first ) & TS_PCR_MASK );
+}
+
+/* Number of points of the time index at or before a byte offset */
+static int IndexFindPos( const demux_sys_t *p_sys, int64_t i_pos )
+{
+    int i_low = 0, i_high = p_sys->i_index;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_sys->p_index[i_mid].i_pos <= i_pos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/* Number of points of the time index at or before a PCR */
+static int IndexFindPCR( const demux_sys_t *p_sys, mtime_t i_pcr )
+{
+    int i_low = 0, i_high = p_sys->i_index;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_sys->p_index[i_mid].i_pcr <= i_pcr )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+/**
+ * Inserts a point in the time index, unless it is too close to one of its
+ * neighbours, or out of order with them (e.g. after a PCR discontinuity).
+ */
+static void IndexAdd( demux_sys_t *p_sys, int64_t i_pos, mtime_t i_pcr )
+{
+    const int i = IndexFindPos( p_sys, i_pos );
+
+    if( i > 0 && i_pcr < p_sys->p_index[i - 1].i_pcr + TS_INDEX_SPACING )
+        return;
+    if( i < p_sys->i_index &&
+        i_pcr + TS_INDEX_SPACING > p_sys->p_index[i].i_pcr )
+        return;
+
+    if( p_sys->i_index >= p_sys->i_index_max )
+    {
+        const int i_max = p_sys->i_index_max ? 2 * p_sys->i_index_max : 256;
+        ts_pcr_point_t *p_index = realloc( p_sys->p_index,
+                                           i_max * sizeof(*p_index) );
+        if( p_index == NULL )
+            return;
+        p_sys->p_index = p_index;
+        p_sys->i_index_max = i_max;
+    }
+    memmove( &p_sys->p_index[i + 1], &p_sys->p_index[i],
+             ( p_sys->i_index - i ) * sizeof(*p_sys->p_index) );
+    p_sys->p_index[i].i_pos = i_pos;
+    p_sys->p_index[i].i_pcr = i_pcr;
+    p_sys->i_index++;
+}
+
+/**
+ * Looks for the first (or the last) PCR of the indexed PID between two byte
+ * offsets. The stream position is left undefined.
+ */
+static int ScanPCR( demux_t *p_demux, int64_t i_start, int64_t i_end,
+                    bool b_last, int64_t *pi_pos, mtime_t *pi_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int i_packet_size = p_sys->i_packet_size;
+    const int i_buffer = TS_PCR_SCAN_PACKETS * i_packet_size;
+    bool b_found = false;
+
+    uint8_t *p_buffer = malloc( i_buffer );
+    if( p_buffer == NULL )
+        return VLC_ENOMEM;
+
+    while( i_end - i_start >= i_packet_size && ( b_last || !b_found ) )
+    {
+        if( stream_Seek( p_demux->s, i_start ) )
+            break;
+
+        const int i_read = stream_Read( p_demux->s, p_buffer,
+                                        __MIN( i_buffer, i_end - i_start ) );
+        if( i_read < i_packet_size )
+            break;
+
+        int i_skip = 0;
+        while( i_skip + i_packet_size <= i_read )
+        {
+            const uint8_t *p = &p_buffer[i_skip];
+            mtime_t i_pcr;
+
+            /* Resynchronize on two consecutive sync bytes */
+            if( p[0] != 0x47 || ( i_skip + 2 * i_packet_size <= i_read &&
+                                  p[i_packet_size] != 0x47 ) )
+            {
+                i_skip++;
+                continue;
+            }
+
+            if( ( ( (p[1]&0x1f)<<8 )|p[2] ) == p_sys->i_pcr_pid &&
+                GetPCR( p, &i_pcr ) )
+            {
+                *pi_pos = i_start + i_skip;
+                *pi_pcr = i_pcr;
+                b_found = true;
+                if( !b_last )
+                    break;
+            }
+            i_skip += i_packet_size;
+        }
+        i_start += i_skip;
+    }
+
+    free( p_buffer );
+    return b_found ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/**
+ * Looks up the first and the last PCR of a seekable stream, once the PCR
+ * PID to index is known. The stream position is preserved.
+ */
+static int PCRProbeBounds( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_pcr_probed )
+    {
+        if( !p_sys->b_can_seek || p_sys->i_pcr_pid < 0 )
+            return VLC_EGENERIC;
+        p_sys->b_pcr_probed = true;
+
+        const int64_t i_size = stream_Size( p_demux->s );
+        const int64_t i_tell = stream_Tell( p_demux->s );
+        int64_t i_first_pos, i_last_pos = 0;
+        mtime_t i_pcr;
+
+        if( i_size > 0 && !ScanPCR( p_demux, 0, __MIN( i_size, TS_PCR_SCAN_MAX ),
+                                    false, &i_first_pos, &i_pcr ) )
+        {
+            p_sys->i_pcr_first = i_pcr;
+            p_sys->i_pcr_first_pos = i_first_pos;
+
+            /* Look back from the end, further and further */
+            for( int64_t i_window = TS_PCR_SCAN_PACKETS * p_sys->i_packet_size;
+                 i_window <= TS_PCR_SCAN_MAX; i_window *= 2 )
+            {
+                const int64_t i_start = __MAX( i_size - i_window, i_first_pos );
+
+                if( !ScanPCR( p_demux, i_start, i_size, true,
+                              &i_last_pos, &i_pcr ) )
+                {
+                    p_sys->i_pcr_last = PCRUnwrap( p_sys, i_pcr );
+                    break;
+                }
+                if( i_start == i_first_pos )
+                    break;
+            }
+        }
+        stream_Seek( p_demux->s, i_tell );
+
+        if( p_sys->i_pcr_first >= 0 && p_sys->i_pcr_last > p_sys->i_pcr_first )
+        {
+            msg_Dbg( p_demux, "PCR pid %d, length %"PRId64" ms",
+                     p_sys->i_pcr_pid,
+                     ( p_sys->i_pcr_last - p_sys->i_pcr_first ) / 90 );
+            IndexAdd( p_sys, p_sys->i_pcr_first_pos, p_sys->i_pcr_first );
+            IndexAdd( p_sys, i_last_pos, p_sys->i_pcr_last );
+        }
+        else
+        {
+            msg_Dbg( p_demux, "no usable PCR, cannot seek by time" );
+            p_sys->i_pcr_first = -1;
+        }
+    }
+    return p_sys->i_pcr_first >= 0 ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/**
+ * Seeks to the last PCR of the indexed PID at or before a target (unwrapped)
+ * PCR, by bisection between the nearest points of the time index. The points
+ * found on the way are added to the index.
+ */
+static int PCRSeekTime( demux_t *p_demux, mtime_t i_target )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int i_packet_size = p_sys->i_packet_size;
+    const int64_t i_tell = stream_Tell( p_demux->s );
+    ts_pcr_point_t low, high;
+    int i_step;
+
+    if( i_target > p_sys->i_pcr_last )
+        i_target = p_sys->i_pcr_last;
+
+    const int i = IndexFindPCR( p_sys, i_target );
+    if( i == 0 )
+    {
+        /* Before the first PCR: restart from the beginning */
+        low.i_pos = 0;
+        low.i_pcr = p_sys->i_pcr_first;
+        high = low;
+    }
+    else
+    {
+        low = p_sys->p_index[i - 1];
+        high = ( i < p_sys->i_index ) ? p_sys->p_index[i] : low;
+    }
+
+    for( i_step = 0; i_step < TS_SEEK_ITERATIONS &&
+                     i_target - low.i_pcr > TS_SEEK_PRECISION &&
+                     high.i_pos - low.i_pos > 2 * i_packet_size; i_step++ )
+    {
+        int64_t i_pos, i_found;
+        mtime_t i_pcr;
+
+        /* Interpolate, aiming slightly early so that the next PCR lands
+         * before the target: on constant bit rate streams, this is the last
+         * step. Variable bit rates can make interpolation converge slowly,
+         * so every other step halves the interval instead. */
+        if( ( i_step & 1 ) == 0 && high.i_pcr > low.i_pcr )
+            i_pos = low.i_pos + (double)( high.i_pos - low.i_pos )
+                  * ( i_target - TS_SEEK_PRECISION / 2 - low.i_pcr )
+                  / ( high.i_pcr - low.i_pcr );
+        else
+            i_pos = low.i_pos + ( high.i_pos - low.i_pos ) / 2;
+        if( i_pos < low.i_pos + i_packet_size )
+            i_pos = low.i_pos + i_packet_size;
+        if( i_pos > high.i_pos - i_packet_size )
+            i_pos = high.i_pos - i_packet_size;
+
+        if( ScanPCR( p_demux, i_pos, __MIN( high.i_pos, i_pos + TS_PCR_SCAN_MAX ),
+                     false, &i_found, &i_pcr ) )
+        {
+            /* No PCR between there and the upper bound */
+            high.i_pos = i_pos;
+            continue;
+        }
+
+        i_pcr = PCRUnwrap( p_sys, i_pcr );
+        IndexAdd( p_sys, i_found, i_pcr );
+        if( i_pcr <= i_target )
+        {
+            low.i_pos = i_found;
+            low.i_pcr = i_pcr;
+        }
+        else
+        {
+            high.i_pos = i_found;
+            high.i_pcr = i_pcr;
+        }
+    }
+
+    if( stream_Seek( p_demux->s, low.i_pos ) )
+    {
+        stream_Seek( p_demux->s, i_tell );
+        return VLC_EGENERIC;
+    }
+    TsChunkFlush( p_sys );
+    p_sys->i_pcr_current = low.i_pcr;
+
+    msg_Dbg( p_demux, "seek to %"PRId64" ms found %"PRId64" ms at %"PRId64
+             " in %d steps (%d index points)",
+             ( i_target - p_sys->i_pcr_first ) / 90,
+             ( low.i_pcr - p_sys->i_pcr_first ) / 90, low.i_pos, i_step,
+             p_sys->i_index );
+    return VLC_SUCCESS;
+}
+
+/* Tracks the playback time, and indexes the PCR of the last packet read */
+static void PCRUpdate( demux_t *p_demux, mtime_t i_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_pcr_first < 0 )
+        return;
+
+    p_sys->i_pcr_current = PCRUnwrap( p_sys, i_pcr );
+
+    const int64_t i_pos = stream_Tell( p_demux->s ) - TsChunkPending( p_sys )
+                        - p_sys->i_packet_size;
+    IndexAdd( p_sys, i_pos, p_sys->i_pcr_current );
+}
+
 static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
-    const uint8_t *p = p_bk->p_buffer;
+    mtime_t       i_pcr;
 
     if( p_sys->i_pmt_es <= 0 )
         return;
 
-    if( ( p[3]&0x20 ) && /* adaptation */
-        ( p[5]&0x10 ) &&
-        ( p[4] >= 7 ) )
+    if( GetPCR( p_bk->p_buffer, &i_pcr ) )
     {
-        /* PCR is 33 bits */
-        const mtime_t i_pcr = ( (mtime_t)p[6] << 25 ) |
-                              ( (mtime_t)p[7] << 17 ) |
-                              ( (mtime_t)p[8] << 9 ) |
-                              ( (mtime_t)p[9] << 1 ) |
-                              ( (mtime_t)p[10] >> 7 );
-
         /* Search program and set the PCR */
         for( int i = 0; i < p_sys->i_pmt; i++ )
         {
@@ -1894,12 +2470,17 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             {
                 if( pid->i_pid == p_sys->pmt[i]->psi->prg[i_prg]->i_pid_pcr )
                 {
+                    if( p_sys->i_pcr_pid < 0 )
+                        p_sys->i_pcr_pid = pid->i_pid;
                     es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
                                     (int)p_sys->pmt[i]->psi->prg[i_prg]->i_number,
                                     (int64_t)(VLC_TS_0 + i_pcr * 100 / 9) );
                 }
             }
         }
+
+        if( pid->i_pid == p_sys->i_pcr_pid )
+            PCRUpdate( p_demux, i_pcr );
     }
 }
 
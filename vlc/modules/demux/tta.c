@@ -46,6 +46,8 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 145 )
+    add_magic( 0, "TTA1" )
+    add_extension( "tta" )
 
     set_callbacks( Open, Close )
     add_shortcut( "tta" )
@@ -45,6 +45,8 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 10 )
+    add_magic( 0, "Creative Voic" )
+    add_extension( "voc" )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
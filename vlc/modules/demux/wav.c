@@ -46,6 +46,8 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
     set_capability( "demux", 142 )
+    add_magic( 8, "WAVE" )
+    add_extension( "wav" )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -125,6 +125,14 @@ static const char *const ppsz_sizes_text[] = {
 #define EFFECT_LONGTEXT N_("It is possible to apply effects to the rendered " \
 "text to improve its readability." )
 
+#define CACHE_TEXT N_("Glyph cache size")
+#define CACHE_LONGTEXT N_("Maximum amount of memory (in KiB) used to keep " \
+    "the rendered glyphs for reuse. 0 disables the cache." )
+#define REGION_CACHE_TEXT N_("Rendered text cache")
+#define REGION_CACHE_LONGTEXT N_("Number of rendered texts kept for reuse " \
+    "when the same text is rendered again with the same style. " \
+    "0 disables the cache." )
+
 #define EFFECT_BACKGROUND  1
 #define EFFECT_OUTLINE     2
 #define EFFECT_OUTLINE_FAT 3
@@ -172,6 +180,10 @@ vlc_module_begin ()
 
     add_bool( "freetype-yuvp", false, NULL, YUVP_TEXT,
               YUVP_LONGTEXT, true )
+    add_integer_with_range( "freetype-cache", 1024, 0, 65536, NULL,
+                            CACHE_TEXT, CACHE_LONGTEXT, true )
+    add_integer_with_range( "freetype-region-cache", 8, 0, 256, NULL,
+                            REGION_CACHE_TEXT, REGION_CACHE_LONGTEXT, true )
     set_capability( "text renderer", 100 )
     add_shortcut( "text" )
     set_callbacks( Create, Destroy )
@@ -245,6 +257,59 @@ static int Render( filter_t *, subpicture_region_t *, line_desc_t *, int, int);
 static void FreeLines( line_desc_t * );
 static void FreeLine( line_desc_t * );
 
+/* Rendered glyph, in a LRU cache keyed by font, size, style and glyph index */
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    uint64_t        i_font;     /* Font identifier, see FontId() */
+    uint32_t        i_size;     /* Horizontal and vertical pixel sizes */
+    int             i_style;    /* Synthetic styles */
+    FT_UInt         i_index;    /* Glyph index */
+
+    FT_BitmapGlyph  p_glyph;
+    FT_BBox         bbox;       /* Glyph box before rasterization */
+    FT_Pos          i_advance;
+    size_t          i_bytes;
+
+    glyph_cache_entry_t *p_hash_next;
+    glyph_cache_entry_t *p_prev;    /* LRU list, most recently used first */
+    glyph_cache_entry_t *p_next;
+};
+
+#define GLYPH_CACHE_BUCKETS 1024
+#define GLYPH_STYLE_BOLD    0x1
+#define GLYPH_STYLE_ITALIC  0x2
+
+typedef struct
+{
+    glyph_cache_entry_t *pp_buckets[GLYPH_CACHE_BUCKETS];
+    glyph_cache_entry_t *p_first;
+    glyph_cache_entry_t *p_last;
+    size_t              i_bytes;
+    size_t              i_max;
+    unsigned            i_hits;
+    unsigned            i_misses;
+} glyph_cache_t;
+
+/* Rendered region, in a LRU cache keyed by text, style and output format */
+typedef struct region_cache_entry_t region_cache_entry_t;
+struct region_cache_entry_t
+{
+    char           *psz_key;
+    video_format_t fmt;
+    picture_t      *p_picture;
+    region_cache_entry_t *p_next;   /* Most recently used first */
+};
+
+typedef struct
+{
+    region_cache_entry_t *p_first;
+    unsigned             i_count;
+    unsigned             i_max;
+    unsigned             i_hits;
+    unsigned             i_misses;
+} region_cache_t;
+
 /*****************************************************************************
  * filter_sys_t: freetype local data
  *****************************************************************************
@@ -271,8 +336,15 @@ struct filter_sys_t
     input_attachment_t **pp_font_attachments;
     int                  i_font_attachments;
 
+    glyph_cache_t  glyph_cache;
+    region_cache_t region_cache;
 };
 
+static void GlyphCacheInit( glyph_cache_t *, size_t );
+static void GlyphCacheClean( glyph_cache_t * );
+static void RegionCacheInit( region_cache_t *, unsigned );
+static void RegionCacheClean( region_cache_t * );
+
 #define UCHAR uint32_t
 #define TR_DEFAULT_FONT p_sys->psz_fontfamily
 #define TR_FONT_STYLE_PTR ft_style_t *
@@ -323,6 +395,10 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_font_opacity = __MAX( __MIN( p_sys->i_font_opacity, 255 ), 0 );
     p_sys->i_font_color = var_CreateGetInteger( p_filter, "freetype-color" );
     p_sys->i_font_color = __MAX( __MIN( p_sys->i_font_color , 0xFFFFFF ), 0 );
+    GlyphCacheInit( &p_sys->glyph_cache,
+                    var_InheritInteger( p_filter, "freetype-cache" ) * 1024 );
+    RegionCacheInit( &p_sys->region_cache,
+                     var_InheritInteger( p_filter, "freetype-region-cache" ) );
 
     fontindex=0;
     if( !psz_fontfamily || !*psz_fontfamily )
@@ -522,6 +598,14 @@ static void Destroy( vlc_object_t *p_this )
      * even if no other library functions have been made since FcInit(),
      * so don't call it. */
 
+    msg_Dbg( p_filter, "glyph cache: %u hits, %u misses, %zu KiB; "
+             "region cache: %u hits, %u misses",
+             p_sys->glyph_cache.i_hits, p_sys->glyph_cache.i_misses,
+             p_sys->glyph_cache.i_bytes / 1024,
+             p_sys->region_cache.i_hits, p_sys->region_cache.i_misses );
+    GlyphCacheClean( &p_sys->glyph_cache );
+    RegionCacheClean( &p_sys->region_cache );
+
     FT_Done_Face( p_sys->p_face );
     FT_Done_FreeType( p_sys->p_library );
     free( p_sys );
@@ -565,6 +649,410 @@ static int LoadFontsFromAttachments( filter_t *p_filter )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Glyph and region caches
+ *****************************************************************************
+ * Re-rendered subtitles are made of the same few glyphs: the rasterized
+ * glyphs are kept in a LRU cache bounded in memory, and the last rendered
+ * regions are kept to be copied when the same text is rendered again.
+ *****************************************************************************/
+static uint64_t FontId( FT_Face p_face )
+{
+    /* Faces are opened again for each styled text run, so they are told
+     * apart by their names rather than by their addresses (FNV-1a) */
+    const char *ppsz_names[2] = { p_face->family_name, p_face->style_name };
+    uint64_t i_hash = UINT64_C(14695981039346656037);
+
+    for( int i = 0; i < 2; i++ )
+    {
+        for( const char *psz = ppsz_names[i]; psz && *psz; psz++ )
+            i_hash = ( i_hash ^ (uint8_t)*psz ) * UINT64_C(1099511628211);
+        i_hash = i_hash * UINT64_C(1099511628211);
+    }
+    i_hash = ( i_hash ^ p_face->face_index ) * UINT64_C(1099511628211);
+    i_hash = ( i_hash ^ p_face->num_glyphs ) * UINT64_C(1099511628211);
+    return i_hash;
+}
+
+static unsigned GlyphCacheHash( uint64_t i_font, uint32_t i_size,
+                                int i_style, FT_UInt i_index )
+{
+    uint64_t i_hash = i_font ^ ( (uint64_t)i_size << 32 ) ^ i_style
+                    ^ ( (uint64_t)i_index * UINT64_C(0x9E3779B97F4A7C15) );
+    return ( i_hash ^ ( i_hash >> 29 ) ^ ( i_hash >> 47 ) )
+           % GLYPH_CACHE_BUCKETS;
+}
+
+static void GlyphCacheInit( glyph_cache_t *p_cache, size_t i_max )
+{
+    memset( p_cache, 0, sizeof(*p_cache) );
+    p_cache->i_max = i_max;
+}
+
+static void GlyphCacheRemove( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp = &p_cache->pp_buckets[
+        GlyphCacheHash( p_entry->i_font, p_entry->i_size,
+                        p_entry->i_style, p_entry->i_index ) ];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+
+    p_cache->i_bytes -= p_entry->i_bytes;
+    FT_Done_Glyph( (FT_Glyph)p_entry->p_glyph );
+    free( p_entry );
+}
+
+static void GlyphCacheTrim( glyph_cache_t *p_cache )
+{
+    while( p_cache->p_last && p_cache->i_bytes > p_cache->i_max )
+        GlyphCacheRemove( p_cache, p_cache->p_last );
+}
+
+static void GlyphCacheClean( glyph_cache_t *p_cache )
+{
+    p_cache->i_max = 0;
+    GlyphCacheTrim( p_cache );
+}
+
+static void GlyphCachePromote( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( !p_entry->p_prev )
+        return;
+
+    p_entry->p_prev->p_next = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    p_cache->p_first->p_prev = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static glyph_cache_entry_t *GlyphCacheFind( glyph_cache_t *p_cache,
+                                            uint64_t i_font, uint32_t i_size,
+                                            int i_style, FT_UInt i_index )
+{
+    glyph_cache_entry_t *p_entry =
+        p_cache->pp_buckets[GlyphCacheHash( i_font, i_size, i_style, i_index )];
+
+    for( ; p_entry; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_font == i_font && p_entry->i_size == i_size &&
+            p_entry->i_style == i_style && p_entry->i_index == i_index )
+        {
+            GlyphCachePromote( p_cache, p_entry );
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
+static void GlyphCacheInsert( glyph_cache_t *p_cache,
+                              uint64_t i_font, uint32_t i_size,
+                              int i_style, FT_UInt i_index,
+                              FT_BitmapGlyph p_glyph, const FT_BBox *p_bbox,
+                              FT_Pos i_advance )
+{
+    glyph_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( !p_entry )
+    {
+        FT_Done_Glyph( (FT_Glyph)p_glyph );
+        return;
+    }
+
+    p_entry->i_font = i_font;
+    p_entry->i_size = i_size;
+    p_entry->i_style = i_style;
+    p_entry->i_index = i_index;
+    p_entry->p_glyph = p_glyph;
+    p_entry->bbox = *p_bbox;
+    p_entry->i_advance = i_advance;
+    p_entry->i_bytes = sizeof(*p_entry) + sizeof(*p_glyph) +
+                       p_glyph->bitmap.rows * abs( p_glyph->bitmap.pitch );
+
+    const unsigned i_bucket = GlyphCacheHash( i_font, i_size, i_style, i_index );
+    p_entry->p_hash_next = p_cache->pp_buckets[i_bucket];
+    p_cache->pp_buckets[i_bucket] = p_entry;
+
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+
+    p_cache->i_bytes += p_entry->i_bytes;
+    GlyphCacheTrim( p_cache );
+}
+
+/**
+ * Returns a rasterized glyph of the face at its current size, its box before
+ * rasterization and its advance, from the cache if possible.
+ *
+ * The caller owns *pp_glyph, which is NULL if the glyph cannot be
+ * rasterized.
+ */
+static int GetGlyph( filter_t *p_filter, FT_Face p_face, uint64_t i_font,
+                     FT_UInt i_glyph_index, bool b_bold, bool b_italic,
+                     FT_BitmapGlyph *pp_glyph, FT_BBox *p_bbox,
+                     FT_Pos *pi_advance )
+{
+    glyph_cache_t *p_cache = &p_filter->p_sys->glyph_cache;
+    const uint32_t i_size = ( p_face->size->metrics.x_ppem << 16 ) |
+                            p_face->size->metrics.y_ppem;
+    int i_style = 0;
+    FT_Glyph tmp_glyph;
+    int i_error;
+
+    /* Synthetic styling is only needed if the face lacks the style */
+    if( b_bold && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+        i_style |= GLYPH_STYLE_BOLD;
+    if( b_italic && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+        i_style |= GLYPH_STYLE_ITALIC;
+
+    *pp_glyph = NULL;
+
+    glyph_cache_entry_t *p_entry =
+        GlyphCacheFind( p_cache, i_font, i_size, i_style, i_glyph_index );
+    if( p_entry )
+    {
+        p_cache->i_hits++;
+        if( FT_Glyph_Copy( (FT_Glyph)p_entry->p_glyph, &tmp_glyph ) )
+            return VLC_ENOMEM;
+        *pp_glyph = (FT_BitmapGlyph)tmp_glyph;
+        *p_bbox = p_entry->bbox;
+        *pi_advance = p_entry->i_advance;
+        return VLC_SUCCESS;
+    }
+    p_cache->i_misses++;
+
+    i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT );
+    if( i_error )
+    {
+        i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT );
+        if( i_error )
+        {
+            msg_Err( p_filter, "unable to render text FT_Load_Glyph returned"
+                               " %d", i_error );
+            return VLC_EGENERIC;
+        }
+    }
+
+    /* Do synthetic styling now that Freetype supports it;
+     * ie. if the font we have loaded is NOT already in the
+     * style that the tags want, then switch it on; if they
+     * are then don't. */
+    if( i_style & GLYPH_STYLE_BOLD )
+        FT_GlyphSlot_Embolden( p_face->glyph );
+    if( i_style & GLYPH_STYLE_ITALIC )
+        FT_GlyphSlot_Oblique( p_face->glyph );
+
+    i_error = FT_Get_Glyph( p_face->glyph, &tmp_glyph );
+    if( i_error )
+    {
+        msg_Err( p_filter, "unable to render text FT_Get_Glyph returned "
+                           "%d", i_error );
+        return VLC_EGENERIC;
+    }
+    FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, p_bbox );
+    i_error = FT_Glyph_To_Bitmap( &tmp_glyph, FT_RENDER_MODE_NORMAL, 0, 1 );
+    if( i_error )
+    {
+        FT_Done_Glyph( tmp_glyph );
+        return VLC_SUCCESS;
+    }
+    *pp_glyph = (FT_BitmapGlyph)tmp_glyph;
+    *pi_advance = p_face->glyph->advance.x;
+
+    if( p_cache->i_max > 0 &&
+        !FT_Glyph_Copy( tmp_glyph, &tmp_glyph ) )
+        GlyphCacheInsert( p_cache, i_font, i_size, i_style, i_glyph_index,
+                          (FT_BitmapGlyph)tmp_glyph, p_bbox, *pi_advance );
+    return VLC_SUCCESS;
+}
+
+static void RegionCacheInit( region_cache_t *p_cache, unsigned i_max )
+{
+    memset( p_cache, 0, sizeof(*p_cache) );
+    p_cache->i_max = i_max;
+}
+
+static void RegionCacheDeleteEntry( region_cache_entry_t *p_entry )
+{
+    free( p_entry->psz_key );
+    free( p_entry->fmt.p_palette );
+    picture_Release( p_entry->p_picture );
+    free( p_entry );
+}
+
+static void RegionCacheClean( region_cache_t *p_cache )
+{
+    while( p_cache->p_first )
+    {
+        region_cache_entry_t *p_entry = p_cache->p_first;
+
+        p_cache->p_first = p_entry->p_next;
+        RegionCacheDeleteEntry( p_entry );
+    }
+    p_cache->i_count = 0;
+}
+
+/**
+ * Returns the key identifying what a region renders to, or NULL if the
+ * cache is disabled.
+ */
+static char *RegionCacheKey( filter_t *p_filter,
+                             const subpicture_region_t *p_region, bool b_html )
+{
+    const text_style_t *p_style = p_region->p_style;
+    const video_format_t *p_fmt = &p_filter->fmt_out.video;
+    char *psz_key;
+
+    if( p_filter->p_sys->region_cache.i_max == 0 )
+        return NULL;
+
+    if( asprintf( &psz_key, "%d %d %"PRId64" %u %u %u %d %u %u %s %d %d %d %d %d %d %d\n%s",
+                  b_html, var_InheritBool( p_filter, "freetype-yuvp" ),
+                  var_GetInteger( p_filter, "scale" ),
+                  p_fmt->i_width, p_fmt->i_height, p_fmt->i_visible_width,
+                  p_region->i_align, p_region->fmt.i_visible_width,
+                  p_region->fmt.i_visible_height,
+                  p_style && p_style->psz_fontname ? p_style->psz_fontname : "",
+                  p_style ? p_style->i_font_size : -1,
+                  p_style ? p_style->i_font_color : -1,
+                  p_style ? p_style->i_font_alpha : -1,
+                  p_style ? p_style->i_style_flags : -1,
+                  p_style ? p_style->i_outline_color : -1,
+                  p_style ? p_style->i_karaoke_background_color : -1,
+                  p_style ? p_style->i_karaoke_background_alpha : -1,
+                  b_html ? p_region->psz_html : p_region->psz_text ) == -1 )
+        return NULL;
+    return psz_key;
+}
+
+/**
+ * Renders the region from the cache if it holds the key.
+ */
+static bool RegionCacheGet( filter_t *p_filter, subpicture_region_t *p_region,
+                            const char *psz_key )
+{
+    region_cache_t *p_cache = &p_filter->p_sys->region_cache;
+    region_cache_entry_t **pp_entry = &p_cache->p_first;
+
+    if( !psz_key )
+        return false;
+
+    for( ; *pp_entry; pp_entry = &(*pp_entry)->p_next )
+    {
+        region_cache_entry_t *p_entry = *pp_entry;
+
+        if( strcmp( p_entry->psz_key, psz_key ) )
+            continue;
+
+        video_format_t fmt = p_entry->fmt;
+        if( fmt.p_palette )
+        {
+            fmt.p_palette = p_region->fmt.p_palette ? p_region->fmt.p_palette
+                                : malloc( sizeof(*fmt.p_palette) );
+            if( !fmt.p_palette )
+                return false;
+            *fmt.p_palette = *p_entry->fmt.p_palette;
+        }
+        p_region->p_picture = picture_NewFromFormat( &fmt );
+        if( !p_region->p_picture )
+        {
+            if( fmt.p_palette != p_region->fmt.p_palette )
+                free( fmt.p_palette );
+            return false;
+        }
+        picture_Copy( p_region->p_picture, p_entry->p_picture );
+        p_region->fmt = fmt;
+
+        /* Move it first */
+        *pp_entry = p_entry->p_next;
+        p_entry->p_next = p_cache->p_first;
+        p_cache->p_first = p_entry;
+
+        p_cache->i_hits++;
+        return true;
+    }
+    p_cache->i_misses++;
+    return false;
+}
+
+/**
+ * Stores a copy of the rendered region, releases the key.
+ */
+static void RegionCachePut( filter_t *p_filter,
+                            const subpicture_region_t *p_region, char *psz_key )
+{
+    region_cache_t *p_cache = &p_filter->p_sys->region_cache;
+
+    /* Time dependent texts (karaoke) must be rendered again */
+    if( !psz_key || !p_region->p_picture ||
+        var_GetBool( p_filter, "text-rerender" ) )
+    {
+        free( psz_key );
+        return;
+    }
+
+    region_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( !p_entry )
+    {
+        free( psz_key );
+        return;
+    }
+    p_entry->psz_key = psz_key;
+    p_entry->fmt = p_region->fmt;
+    p_entry->fmt.p_palette = NULL;
+    p_entry->p_picture = picture_NewFromFormat( &p_region->fmt );
+    if( p_region->fmt.p_palette )
+    {
+        p_entry->fmt.p_palette = malloc( sizeof(*p_entry->fmt.p_palette) );
+        if( p_entry->fmt.p_palette )
+            *p_entry->fmt.p_palette = *p_region->fmt.p_palette;
+    }
+    if( !p_entry->p_picture ||
+        ( p_region->fmt.p_palette && !p_entry->fmt.p_palette ) )
+    {
+        if( p_entry->p_picture )
+            picture_Release( p_entry->p_picture );
+        free( p_entry->fmt.p_palette );
+        free( psz_key );
+        free( p_entry );
+        return;
+    }
+    picture_Copy( p_entry->p_picture, p_region->p_picture );
+
+    p_entry->p_next = p_cache->p_first;
+    p_cache->p_first = p_entry;
+
+    /* Drop the least recently used one */
+    if( ++p_cache->i_count > p_cache->i_max )
+    {
+        region_cache_entry_t **pp_last = &p_cache->p_first;
+        while( (*pp_last)->p_next )
+            pp_last = &(*pp_last)->p_next;
+        RegionCacheDeleteEntry( *pp_last );
+        *pp_last = NULL;
+        p_cache->i_count--;
+    }
+}
+
 /*****************************************************************************
  * Render: place string in picture
  *****************************************************************************
@@ -1032,7 +1520,7 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     line_desc_t  *p_lines = NULL, *p_line = NULL, *p_next = NULL, *p_prev = NULL;
-    int i, i_pen_y, i_pen_x, i_error, i_glyph_index, i_previous;
+    int i, i_pen_y, i_pen_x, i_glyph_index, i_previous;
     uint32_t *psz_unicode, *psz_unicode_orig = NULL, i_char, *psz_line_start;
     int i_string_length;
     char *psz_string;
@@ -1040,17 +1528,27 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     int i_font_color, i_font_alpha, i_font_size, i_red, i_green, i_blue;
     vlc_value_t val;
     int i_scale = 1000;
+    uint64_t i_font;
+    char *psz_key;
 
     FT_BBox line;
     FT_BBox glyph_size;
     FT_Vector result;
-    FT_Glyph tmp_glyph;
 
     /* Sanity check */
     if( !p_region_in || !p_region_out ) return VLC_EGENERIC;
     psz_string = p_region_in->psz_text;
     if( !psz_string || !*psz_string ) return VLC_EGENERIC;
 
+    psz_key = RegionCacheKey( p_filter, p_region_in, false );
+    if( RegionCacheGet( p_filter, p_region_out, psz_key ) )
+    {
+        free( psz_key );
+        p_region_out->i_x = p_region_in->i_x;
+        p_region_out->i_y = p_region_in->i_y;
+        return VLC_SUCCESS;
+    }
+
     if( VLC_SUCCESS == var_Get( p_filter, "scale", &val ))
         i_scale = val.i_int;
 
@@ -1172,7 +1670,8 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     psz_line_start = psz_unicode;
 
 #define face p_sys->p_face
-#define glyph face->glyph
+
+    i_font = FontId( face );
 
     while( *psz_unicode )
     {
@@ -1221,36 +1720,16 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
         }
         p_line->p_glyph_pos[ i ].x = i_pen_x;
         p_line->p_glyph_pos[ i ].y = i_pen_y;
-        i_error = FT_Load_Glyph( face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT );
-        if( i_error )
-        {
-	        i_error = FT_Load_Glyph( face, i_glyph_index, FT_LOAD_DEFAULT );
-	        if( i_error )
-	        {
-	            msg_Err( p_filter, "unable to render text FT_Load_Glyph returned"
-	                               " %d", i_error );
-	            goto error;
-	        }
-        }
-        i_error = FT_Get_Glyph( glyph, &tmp_glyph );
-        if( i_error )
-        {
-            msg_Err( p_filter, "unable to render text FT_Get_Glyph returned "
-                               "%d", i_error );
+        FT_Pos i_advance;
+        if( GetGlyph( p_filter, face, i_font, i_glyph_index, false, false,
+                      &p_line->pp_glyphs[ i ], &glyph_size, &i_advance ) )
             goto error;
-        }
-        FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, &glyph_size );
-        i_error = FT_Glyph_To_Bitmap( &tmp_glyph, ft_render_mode_normal, 0, 1);
-        if( i_error )
-        {
-            FT_Done_Glyph( tmp_glyph );
+        if( !p_line->pp_glyphs[ i ] )
             continue;
-        }
-        p_line->pp_glyphs[ i ] = (FT_BitmapGlyph)tmp_glyph;
 
         /* Do rest */
         line.xMax = p_line->p_glyph_pos[i].x + glyph_size.xMax -
-            glyph_size.xMin + ((FT_BitmapGlyph)tmp_glyph)->left;
+            glyph_size.xMin + p_line->pp_glyphs[ i ]->left;
         if( line.xMax > (int)p_filter->fmt_out.video.i_visible_width - 20 )
         {
             FT_Done_Glyph( (FT_Glyph)p_line->pp_glyphs[ i ] );
@@ -1294,7 +1773,7 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
         line.yMin = __MIN( line.yMin, glyph_size.yMin );
 
         i_previous = i_glyph_index;
-        i_pen_x += glyph->advance.x >> 6;
+        i_pen_x += i_advance >> 6;
         i++;
     }
 
@@ -1309,7 +1788,6 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     result.y += line.yMax - line.yMin;
 
 #undef face
-#undef glyph
 
     p_region_out->i_x = p_region_in->i_x;
     p_region_out->i_y = p_region_in->i_y;
@@ -1319,11 +1797,13 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     else
         RenderYUVA( p_filter, p_region_out, p_lines, result.x, result.y );
 
+    RegionCachePut( p_filter, p_region_out, psz_key );
     free( psz_unicode_orig );
     FreeLines( p_lines );
     return VLC_SUCCESS;
 
  error:
+    free( psz_key );
     free( psz_unicode_orig );
     FreeLines( p_lines );
     return VLC_EGENERIC;
@@ -1469,6 +1949,7 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
 
     int          i_previous = 0;
     int          i_pen_x_start = *pi_pen_x;
+    uint64_t     i_font = FontId( p_face );
 
     uint32_t *psz_unicode_start = psz_unicode;
 
@@ -1496,8 +1977,8 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
     while( *psz_unicode && ( *psz_unicode != '\n' ) )
     {
         FT_BBox glyph_size;
-        FT_Glyph tmp_glyph;
-        int i_error;
+        FT_BitmapGlyph p_glyph;
+        FT_Pos i_advance;
 
         int i_glyph_index = FT_Get_Char_Index( p_face, *psz_unicode++ );
         if( FT_HAS_KERNING( p_face ) && i_glyph_index
@@ -1511,43 +1992,14 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
         p_line->p_glyph_pos[ i ].x = *pi_pen_x;
         p_line->p_glyph_pos[ i ].y = i_pen_y;
 
-        i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT );
-        if( i_error )
+        if( GetGlyph( p_filter, p_face, i_font, i_glyph_index,
+                      b_bold, b_italic, &p_glyph, &glyph_size, &i_advance ) )
         {
-	        i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT );
-	        if( i_error )
-	        {
-	            msg_Err( p_filter,
-	                   "unable to render text FT_Load_Glyph returned %d", i_error );
-	            p_line->pp_glyphs[ i ] = NULL;
-	            return VLC_EGENERIC;
-	        }
-        }
-
-        /* Do synthetic styling now that Freetype supports it;
-         * ie. if the font we have loaded is NOT already in the
-         * style that the tags want, then switch it on; if they
-         * are then don't. */
-        if (b_bold && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ))
-            FT_GlyphSlot_Embolden( p_face->glyph );
-        if (b_italic && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ))
-            FT_GlyphSlot_Oblique( p_face->glyph );
-
-        i_error = FT_Get_Glyph( p_face->glyph, &tmp_glyph );
-        if( i_error )
-        {
-            msg_Err( p_filter,
-                    "unable to render text FT_Get_Glyph returned %d", i_error );
             p_line->pp_glyphs[ i ] = NULL;
             return VLC_EGENERIC;
         }
-        FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, &glyph_size );
-        i_error = FT_Glyph_To_Bitmap( &tmp_glyph, FT_RENDER_MODE_NORMAL, 0, 1);
-        if( i_error )
-        {
-            FT_Done_Glyph( tmp_glyph );
+        if( !p_glyph )
             continue;
-        }
         if( b_uline || b_through )
         {
             float aOffset = FT_FLOOR(FT_MulFix(p_face->underline_position,
@@ -1572,13 +2024,13 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
             }
         }
 
-        p_line->pp_glyphs[ i ] = (FT_BitmapGlyph)tmp_glyph;
+        p_line->pp_glyphs[ i ] = p_glyph;
         p_line->p_fg_rgb[ i ] = i_font_color & 0x00ffffff;
         p_line->p_bg_rgb[ i ] = i_karaoke_bgcolor & 0x00ffffff;
         p_line->p_fg_bg_ratio[ i ] = 0x00;
 
         line.xMax = p_line->p_glyph_pos[i].x + glyph_size.xMax -
-                    glyph_size.xMin + ((FT_BitmapGlyph)tmp_glyph)->left;
+                    glyph_size.xMin + p_glyph->left;
         if( line.xMax > (int)p_filter->fmt_out.video.i_visible_width - 20 )
         {
             for( ; i >= *pi_start; i-- )
@@ -1626,7 +2078,7 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
         line.yMin = __MIN( line.yMin, glyph_size.yMin );
 
         i_previous = i_glyph_index;
-        *pi_pen_x += p_face->glyph->advance.x >> 6;
+        *pi_pen_x += i_advance >> 6;
         i++;
     }
     p_line->i_width = line.xMax;
@@ -2195,6 +2647,15 @@ static int RenderHtml( filter_t *p_filter, subpicture_region_t *p_region_out,
     if( !p_region_in || !p_region_in->psz_html )
         return VLC_EGENERIC;
 
+    char *psz_key = RegionCacheKey( p_filter, p_region_in, true );
+    if( RegionCacheGet( p_filter, p_region_out, psz_key ) )
+    {
+        free( psz_key );
+        p_region_out->i_x = p_region_in->i_x;
+        p_region_out->i_y = p_region_in->i_y;
+        return VLC_SUCCESS;
+    }
+
     /* Reset the default fontsize in case screen metrics have changed */
     p_filter->p_sys->i_font_size = GetFontSize( p_filter );
 
@@ -2310,6 +2771,10 @@ static int RenderHtml( filter_t *p_filter, subpicture_region_t *p_region_out,
         stream_Delete( p_sub );
     }
 
+    if( rv == VLC_SUCCESS )
+        RegionCachePut( p_filter, p_region_out, psz_key );
+    else
+        free( psz_key );
     return rv;
 }
 
@@ -81,7 +81,7 @@ static int Activate( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
-    if( vlc_timer_create( &p_sys->timer, Timer, p_ih ) )
+    if( vlc_timer_create_blocking( &p_sys->timer, Timer, p_ih ) )
     {
         free( p_sys );
         return VLC_ENOMEM;
@@ -555,46 +555,10 @@ static block_t *CreateAnnexbNAL( decoder_t *p_dec, const uint8_t *p, int i_size
 static void CreateDecodedNAL( uint8_t **pp_ret, int *pi_ret,
                               const uint8_t *src, int i_src )
 {
-    const uint8_t *end = &src[i_src];
     uint8_t *dst = malloc( i_src );
 
     *pp_ret = dst;
-
-    if( dst )
-    {
-        while( src < end )
-        {
-            if( src < end - 3 && src[0] == 0x00 && src[1] == 0x00 &&
-                src[2] == 0x03 )
-            {
-                *dst++ = 0x00;
-                *dst++ = 0x00;
-
-                src += 3;
-                continue;
-            }
-            *dst++ = *src++;
-        }
-    }
-    *pi_ret = dst - *pp_ret;
-}
-
-static inline int bs_read_ue( bs_t *s )
-{
-    int i = 0;
-
-    while( bs_read1( s ) == 0 && s->p < s->p_end && i < 32 )
-    {
-        i++;
-    }
-    return( ( 1 << i) - 1 + bs_read( s, i ) );
-}
-
-static inline int bs_read_se( bs_t *s )
-{
-    int val = bs_read_ue( s );
-
-    return val&0x01 ? (val+1)/2 : -(val/2);
+    *pi_ret = dst ? startcode_RemoveEP3B( dst, i_src, src, i_src ) : 0;
 }
 
 /*****************************************************************************
@@ -788,27 +752,21 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
 
-    uint8_t *pb_dec = NULL;
-    int     i_dec = 0;
-    bs_t s;
+    bs64_t s;
     int i_tmp;
-    int i_sps_id;
+    unsigned i_sps_id;
 
-    CreateDecodedNAL( &pb_dec, &i_dec, &p_frag->p_buffer[5],
-                     p_frag->i_buffer - 5 );
-
-    bs_init( &s, pb_dec, i_dec );
-    int i_profile_idc = bs_read( &s, 8 );
+    bs64_init_nal( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
+    int i_profile_idc = bs64_read( &s, 8 );
     p_dec->fmt_out.i_profile = i_profile_idc;
     /* Skip constraint_set0123, reserved(4) */
-    bs_skip( &s, 1+1+1+1 + 4 );
-    p_dec->fmt_out.i_level = bs_read( &s, 8 );
+    bs64_skip( &s, 1+1+1+1 + 4 );
+    p_dec->fmt_out.i_level = bs64_read( &s, 8 );
     /* sps id */
-    i_sps_id = bs_read_ue( &s );
+    i_sps_id = bs64_read_ue( &s );
     if( i_sps_id >= SPS_MAX )
     {
-        msg_Warn( p_dec, "invalid SPS (sps_id=%d)", i_sps_id );
-        free( pb_dec );
+        msg_Warn( p_dec, "invalid SPS (sps_id=%u)", i_sps_id );
         block_Release( p_frag );
         return;
     }
@@ -819,23 +777,23 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
         i_profile_idc ==  86 )
     {
         /* chroma_format_idc */
-        const int i_chroma_format_idc = bs_read_ue( &s );
+        const int i_chroma_format_idc = bs64_read_ue( &s );
         if( i_chroma_format_idc == 3 )
-            bs_skip( &s, 1 ); /* separate_colour_plane_flag */
+            bs64_skip( &s, 1 ); /* separate_colour_plane_flag */
         /* bit_depth_luma_minus8 */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
         /* bit_depth_chroma_minus8 */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
         /* qpprime_y_zero_transform_bypass_flag */
-        bs_skip( &s, 1 );
+        bs64_skip( &s, 1 );
         /* seq_scaling_matrix_present_flag */
-        i_tmp = bs_read( &s, 1 );
+        i_tmp = bs64_read( &s, 1 );
         if( i_tmp )
         {
             for( int i = 0; i < ((3 != i_chroma_format_idc) ? 8 : 12); i++ )
             {
                 /* seq_scaling_list_present_flag[i] */
-                i_tmp = bs_read( &s, 1 );
+                i_tmp = bs64_read( &s, 1 );
                 if( !i_tmp )
                     continue;
                 const int i_size_of_scaling_list = (i < 6 ) ? 16 : 64;
@@ -847,7 +805,7 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
                     if( i_nextscale != 0 )
                     {
                         /* delta_scale */
-                        i_tmp = bs_read_se( &s );
+                        i_tmp = bs64_read_se( &s );
                         i_nextscale = ( i_lastscale + i_tmp + 256 ) % 256;
                         /* useDefaultScalingMatrixFlag = ... */
                     }
@@ -859,15 +817,15 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     }
 
     /* Skip i_log2_max_frame_num */
-    p_sys->i_log2_max_frame_num = bs_read_ue( &s );
+    p_sys->i_log2_max_frame_num = bs64_read_ue( &s );
     if( p_sys->i_log2_max_frame_num > 12)
         p_sys->i_log2_max_frame_num = 12;
     /* Read poc_type */
-    p_sys->i_pic_order_cnt_type = bs_read_ue( &s );
+    p_sys->i_pic_order_cnt_type = bs64_read_ue( &s );
     if( p_sys->i_pic_order_cnt_type == 0 )
     {
         /* skip i_log2_max_poc_lsb */
-        p_sys->i_log2_max_pic_order_cnt_lsb = bs_read_ue( &s );
+        p_sys->i_log2_max_pic_order_cnt_lsb = bs64_read_ue( &s );
         if( p_sys->i_log2_max_pic_order_cnt_lsb > 12 )
             p_sys->i_log2_max_pic_order_cnt_lsb = 12;
     }
@@ -875,59 +833,59 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     {
         int i_cycle;
         /* skip b_delta_pic_order_always_zero */
-        p_sys->i_delta_pic_order_always_zero_flag = bs_read( &s, 1 );
+        p_sys->i_delta_pic_order_always_zero_flag = bs64_read( &s, 1 );
         /* skip i_offset_for_non_ref_pic */
-        bs_read_se( &s );
+        bs64_read_se( &s );
         /* skip i_offset_for_top_to_bottom_field */
-        bs_read_se( &s );
+        bs64_read_se( &s );
         /* read i_num_ref_frames_in_poc_cycle */
-        i_cycle = bs_read_ue( &s );
+        i_cycle = bs64_read_ue( &s );
         if( i_cycle > 256 ) i_cycle = 256;
         while( i_cycle > 0 )
         {
             /* skip i_offset_for_ref_frame */
-            bs_read_se(&s );
+            bs64_read_se(&s );
             i_cycle--;
         }
     }
     /* i_num_ref_frames */
-    bs_read_ue( &s );
+    bs64_read_ue( &s );
     /* b_gaps_in_frame_num_value_allowed */
-    bs_skip( &s, 1 );
+    bs64_skip( &s, 1 );
 
     /* Read size */
-    p_dec->fmt_out.video.i_width  = 16 * ( bs_read_ue( &s ) + 1 );
-    p_dec->fmt_out.video.i_height = 16 * ( bs_read_ue( &s ) + 1 );
+    p_dec->fmt_out.video.i_width  = 16 * ( bs64_read_ue( &s ) + 1 );
+    p_dec->fmt_out.video.i_height = 16 * ( bs64_read_ue( &s ) + 1 );
 
     /* b_frame_mbs_only */
-    p_sys->b_frame_mbs_only = bs_read( &s, 1 );
+    p_sys->b_frame_mbs_only = bs64_read( &s, 1 );
     if( p_sys->b_frame_mbs_only == 0 )
     {
-        bs_skip( &s, 1 );
+        bs64_skip( &s, 1 );
     }
     /* b_direct8x8_inference */
-    bs_skip( &s, 1 );
+    bs64_skip( &s, 1 );
 
     /* crop */
-    i_tmp = bs_read( &s, 1 );
+    i_tmp = bs64_read( &s, 1 );
     if( i_tmp )
     {
         /* left */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
         /* right */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
         /* top */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
         /* bottom */
-        bs_read_ue( &s );
+        bs64_read_ue( &s );
     }
 
     /* vui */
-    i_tmp = bs_read( &s, 1 );
+    i_tmp = bs64_read( &s, 1 );
     if( i_tmp )
     {
         /* read the aspect ratio part if any */
-        i_tmp = bs_read( &s, 1 );
+        i_tmp = bs64_read( &s, 1 );
         if( i_tmp )
         {
             static const struct { int w, h; } sar[17] =
@@ -938,7 +896,7 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
                 { 64, 33 }, { 160,99 }, {  4,  3 }, {  3,  2 },
                 {  2,  1 },
             };
-            int i_sar = bs_read( &s, 8 );
+            int i_sar = bs64_read( &s, 8 );
             int w, h;
 
             if( i_sar < 17 )
@@ -948,8 +906,8 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
             }
             else if( i_sar == 255 )
             {
-                w = bs_read( &s, 16 );
-                h = bs_read( &s, 16 );
+                w = bs64_read( &s, 16 );
+                h = bs64_read( &s, 16 );
             }
             else
             {
@@ -970,11 +928,9 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
         }
     }
 
-    free( pb_dec );
-
     /* We have a new SPS */
     if( !p_sys->b_sps )
-        msg_Dbg( p_dec, "found NAL_SPS (sps_id=%d)", i_sps_id );
+        msg_Dbg( p_dec, "found NAL_SPS (sps_id=%u)", i_sps_id );
     p_sys->b_sps = true;
 
     if( p_sys->pp_sps[i_sps_id] )
@@ -985,26 +941,26 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
 static void PutPPS( decoder_t *p_dec, block_t *p_frag )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
-    bs_t s;
-    int i_pps_id;
-    int i_sps_id;
+    bs64_t s;
+    unsigned i_pps_id;
+    unsigned i_sps_id;
 
-    bs_init( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
-    i_pps_id = bs_read_ue( &s ); // pps id
-    i_sps_id = bs_read_ue( &s ); // sps id
+    bs64_init_nal( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
+    i_pps_id = bs64_read_ue( &s ); // pps id
+    i_sps_id = bs64_read_ue( &s ); // sps id
     if( i_pps_id >= PPS_MAX || i_sps_id >= SPS_MAX )
     {
-        msg_Warn( p_dec, "invalid PPS (pps_id=%d sps_id=%d)", i_pps_id, i_sps_id );
+        msg_Warn( p_dec, "invalid PPS (pps_id=%u sps_id=%u)", i_pps_id, i_sps_id );
         block_Release( p_frag );
         return;
     }
-    bs_skip( &s, 1 ); // entropy coding mode flag
-    p_sys->i_pic_order_present_flag = bs_read( &s, 1 );
+    bs64_skip( &s, 1 ); // entropy coding mode flag
+    p_sys->i_pic_order_present_flag = bs64_read( &s, 1 );
     /* TODO */
 
     /* We have a new PPS */
     if( !p_sys->b_pps )
-        msg_Dbg( p_dec, "found NAL_PPS (pps_id=%d sps_id=%d)", i_pps_id, i_sps_id );
+        msg_Dbg( p_dec, "found NAL_PPS (pps_id=%u sps_id=%u)", i_pps_id, i_sps_id );
     p_sys->b_pps = true;
 
     if( p_sys->pp_pps[i_pps_id] )
@@ -1016,22 +972,19 @@ static void ParseSlice( decoder_t *p_dec, bool *pb_new_picture, slice_t *p_slice
                         int i_nal_ref_idc, int i_nal_type, const block_t *p_frag )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
-    uint8_t *pb_dec;
-    int i_dec;
     int i_first_mb, i_slice_type;
     slice_t slice;
-    bs_t s;
+    bs64_t s;
 
-    /* do not convert the whole frame */
-    CreateDecodedNAL( &pb_dec, &i_dec, &p_frag->p_buffer[5],
-                     __MIN( p_frag->i_buffer - 5, 60 ) );
-    bs_init( &s, pb_dec, i_dec );
+    /* do not read the whole frame */
+    bs64_init_nal( &s, &p_frag->p_buffer[5],
+                   __MIN( p_frag->i_buffer - 5, 60 ) );
 
     /* first_mb_in_slice */
-    i_first_mb = bs_read_ue( &s );
+    i_first_mb = bs64_read_ue( &s );
 
     /* slice_type */
-    switch( (i_slice_type = bs_read_ue( &s )) )
+    switch( (i_slice_type = bs64_read_ue( &s )) )
     {
     case 0: case 5:
         slice.i_frame_type = BLOCK_FLAG_TYPE_P;
@@ -1057,22 +1010,22 @@ static void ParseSlice( decoder_t *p_dec, bool *pb_new_picture, slice_t *p_slice
     slice.i_nal_type = i_nal_type;
     slice.i_nal_ref_idc = i_nal_ref_idc;
 
-    slice.i_pic_parameter_set_id = bs_read_ue( &s );
-    slice.i_frame_num = bs_read( &s, p_sys->i_log2_max_frame_num + 4 );
+    slice.i_pic_parameter_set_id = bs64_read_ue( &s );
+    slice.i_frame_num = bs64_read( &s, p_sys->i_log2_max_frame_num + 4 );
 
     slice.i_field_pic_flag = 0;
     slice.i_bottom_field_flag = -1;
     if( !p_sys->b_frame_mbs_only )
     {
         /* field_pic_flag */
-        slice.i_field_pic_flag = bs_read( &s, 1 );
+        slice.i_field_pic_flag = bs64_read( &s, 1 );
         if( slice.i_field_pic_flag )
-            slice.i_bottom_field_flag = bs_read( &s, 1 );
+            slice.i_bottom_field_flag = bs64_read( &s, 1 );
     }
 
     slice.i_idr_pic_id = p_sys->slice.i_idr_pic_id;
     if( slice.i_nal_type == NAL_SLICE_IDR )
-        slice.i_idr_pic_id = bs_read_ue( &s );
+        slice.i_idr_pic_id = bs64_read_ue( &s );
 
     slice.i_pic_order_cnt_lsb = -1;
     slice.i_delta_pic_order_cnt_bottom = -1;
@@ -1080,18 +1033,17 @@ static void ParseSlice( decoder_t *p_dec, bool *pb_new_picture, slice_t *p_slice
     slice.i_delta_pic_order_cnt1 = 0;
     if( p_sys->i_pic_order_cnt_type == 0 )
     {
-        slice.i_pic_order_cnt_lsb = bs_read( &s, p_sys->i_log2_max_pic_order_cnt_lsb + 4 );
+        slice.i_pic_order_cnt_lsb = bs64_read( &s, p_sys->i_log2_max_pic_order_cnt_lsb + 4 );
         if( p_sys->i_pic_order_present_flag && !slice.i_field_pic_flag )
-            slice.i_delta_pic_order_cnt_bottom = bs_read_se( &s );
+            slice.i_delta_pic_order_cnt_bottom = bs64_read_se( &s );
     }
     else if( (p_sys->i_pic_order_cnt_type == 1) &&
              (!p_sys->i_delta_pic_order_always_zero_flag) )
     {
-        slice.i_delta_pic_order_cnt0 = bs_read_se( &s );
+        slice.i_delta_pic_order_cnt0 = bs64_read_se( &s );
         if( p_sys->i_pic_order_present_flag && !slice.i_field_pic_flag )
-            slice.i_delta_pic_order_cnt1 = bs_read_se( &s );
+            slice.i_delta_pic_order_cnt1 = bs64_read_se( &s );
     }
-    free( pb_dec );
 
     /* Detection of the first VCL NAL unit of a primary coded picture
      * (cf. 7.4.1.2.4) */
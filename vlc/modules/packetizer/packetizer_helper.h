@@ -25,6 +25,7 @@
 #define _PACKETIZER_H 1
 
 #include <vlc_block.h>
+#include "startcode_helper.h"
 
 enum
 {
@@ -45,6 +46,7 @@ typedef struct
 
     int i_startcode;
     const uint8_t *p_startcode;
+    bool b_annexb;
 
     int i_au_prepend;
     const uint8_t *p_au_prepend;
@@ -78,6 +80,8 @@ static inline void packetizer_Init( packetizer_t *p_pack,
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
+    p_pack->b_annexb = i_startcode == 3 && p_startcode[0] == 0x00 &&
+                       p_startcode[1] == 0x00 && p_startcode[2] == 0x01;
     p_pack->pf_reset = pf_reset;
     p_pack->pf_parse = pf_parse;
     p_pack->pf_validate = pf_validate;
@@ -89,6 +93,71 @@ static inline void packetizer_Clean( packetizer_t *p_pack )
     block_BytestreamRelease( &p_pack->bytestream );
 }
 
+/* Same as block_FindStartcodeFromOffset() for a 00 00 01 start code, but
+ * scanning whole blocks with startcode_FindAnnexB() */
+static inline int packetizer_FindAnnexB( block_bytestream_t *p_bytestream,
+                                         size_t *pi_offset )
+{
+    block_t *p_block = p_bytestream->p_block;
+    const size_t i_start = p_bytestream->i_offset + *pi_offset;
+    size_t i_base = 0; /* position of p_block in the chain */
+    unsigned i_zero = 0; /* zero bytes ending the data scanned so far */
+
+    /* Find the right place */
+    while( p_block != NULL && i_start >= i_base + p_block->i_buffer )
+    {
+        i_base += p_block->i_buffer;
+        p_block = p_block->p_next;
+    }
+    if( p_block == NULL )
+        return VLC_EGENERIC; /* Not enough data */
+
+    for( size_t i_from = i_start - i_base; p_block != NULL;
+         p_block = p_block->p_next, i_from = 0 )
+    {
+        const uint8_t *p = &p_block->p_buffer[i_from];
+        const uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
+
+        /* Start code straddling the previous blocks */
+        for( const uint8_t *q = p; i_zero > 0 && q < end && q < &p[2]; q++ )
+        {
+            if( *q == 0x01 && i_zero >= 2 )
+            {
+                *pi_offset = i_base + (q - p_block->p_buffer) - 2
+                           - p_bytestream->i_offset;
+                return VLC_SUCCESS;
+            }
+            i_zero = *q == 0x00 ? __MIN( i_zero + 1, 2 ) : 0;
+        }
+
+        const uint8_t *p_sc = startcode_FindAnnexB( p, end );
+        if( p_sc != NULL )
+        {
+            *pi_offset = i_base + (p_sc - p_block->p_buffer)
+                       - p_bytestream->i_offset;
+            return VLC_SUCCESS;
+        }
+
+        if( end - p >= 2 )
+            i_zero = end[-1] != 0x00 ? 0 : end[-2] != 0x00 ? 1 : 2;
+        else if( end - p == 1 )
+            i_zero = end[-1] != 0x00 ? 0 : __MIN( i_zero + 1, 2 );
+        i_base += p_block->i_buffer;
+    }
+
+    /* Resume the next search on the partial start code, if any */
+    *pi_offset = i_base - i_zero - p_bytestream->i_offset;
+    return VLC_EGENERIC;
+}
+
+static inline int packetizer_FindStartcode( packetizer_t *p_pack )
+{
+    if( p_pack->b_annexb )
+        return packetizer_FindAnnexB( &p_pack->bytestream, &p_pack->i_offset );
+    return block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
+                                          p_pack->p_startcode, p_pack->i_startcode );
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     if( !pp_block || !*pp_block )
@@ -120,8 +189,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
         {
         case STATE_NOSYNC:
             /* Find a startcode */
-            if( !block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                                p_pack->p_startcode, p_pack->i_startcode ) )
+            if( !packetizer_FindStartcode( p_pack ) )
                 p_pack->i_state = STATE_NEXT_SYNC;
 
             if( p_pack->i_offset )
@@ -138,8 +206,7 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
 
         case STATE_NEXT_SYNC:
             /* Find the next startcode */
-            if( block_FindStartcodeFromOffset( &p_pack->bytestream, &p_pack->i_offset,
-                                               p_pack->p_startcode, p_pack->i_startcode ) )
+            if( packetizer_FindStartcode( p_pack ) )
             {
                 if( !p_pack->b_flushing || !p_pack->bytestream.p_chain )
                     return NULL; /* Need more data */
@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * startcode_helper.h: Start code and emulation prevention helpers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _STARTCODE_HELPER_H
+#define _STARTCODE_HELPER_H 1
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* All the searches below look for a 00 00 <code> sequence lying entirely
+ * within [p, end). Any such sequence begins with a zero byte, so the vector
+ * versions only look closer at the chunks that contain one, which are rare
+ * in compressed data. */
+
+static inline bool startcode_Match( const uint8_t *p, const uint8_t *end,
+                                    uint8_t i_code )
+{
+    return end - p >= 3 && p[0] == 0x00 && p[1] == 0x00 && p[2] == i_code;
+}
+
+static inline const uint8_t *startcode_FindC( const uint8_t *p,
+                                              const uint8_t *end,
+                                              uint8_t i_code )
+{
+    const unsigned long ones = ~0UL / 0xff, highs = ones << 7;
+
+    /* Align on a machine word */
+    for( ; p < end && ((uintptr_t)p & (sizeof(unsigned long) - 1)); p++ )
+        if( startcode_Match( p, end, i_code ) )
+            return p;
+
+    /* Skip the words without any zero byte */
+    for( ; end - p >= (ptrdiff_t)sizeof(unsigned long);
+         p += sizeof(unsigned long) )
+    {
+        unsigned long w;
+
+        memcpy( &w, p, sizeof(w) );
+        if( ((w - ones) & ~w & highs) == 0 )
+            continue;
+        for( unsigned i = 0; i < sizeof(unsigned long); i++ )
+            if( startcode_Match( &p[i], end, i_code ) )
+                return &p[i];
+    }
+
+    for( ; p < end; p++ )
+        if( startcode_Match( p, end, i_code ) )
+            return p;
+    return NULL;
+}
+
+#ifdef CAN_COMPILE_SSE2
+static inline const uint8_t *startcode_FindSSE2( const uint8_t *p,
+                                                 const uint8_t *end,
+                                                 uint8_t i_code )
+{
+    for( ; end - p >= 16; p += 16 )
+    {
+        unsigned i_zero;
+
+        asm( "pxor      %%xmm1, %%xmm1\n"
+             "movdqu    %[p],   %%xmm0\n"
+             "pcmpeqb   %%xmm1, %%xmm0\n"
+             "pmovmskb  %%xmm0, %[zero]\n"
+             : [zero]"=r"(i_zero)
+             : [p]"m"(*(const uint8_t (*)[16])p)
+             : "xmm0", "xmm1" );
+
+        for( unsigned i = 0; i_zero != 0; i++, i_zero >>= 1 )
+            if( (i_zero & 1) && startcode_Match( &p[i], end, i_code ) )
+                return &p[i];
+    }
+    return startcode_FindC( p, end, i_code );
+}
+#endif
+
+#if defined(__ARM_NEON__)
+static inline const uint8_t *startcode_FindNEON( const uint8_t *p,
+                                                 const uint8_t *end,
+                                                 uint8_t i_code )
+{
+    const uint8x16_t zero = vdupq_n_u8( 0 );
+
+    for( ; end - p >= 16; p += 16 )
+    {
+        const uint8x16_t z = vceqq_u8( vld1q_u8( p ), zero );
+        const uint8x8_t h = vorr_u8( vget_low_u8( z ), vget_high_u8( z ) );
+
+        if( vget_lane_u64( vreinterpret_u64_u8( h ), 0 ) == 0 )
+            continue;
+        for( unsigned i = 0; i < 16; i++ )
+            if( startcode_Match( &p[i], end, i_code ) )
+                return &p[i];
+    }
+    return startcode_FindC( p, end, i_code );
+}
+#endif
+
+/**
+ * Returns the first 00 00 <i_code> sequence within [p, end), or NULL.
+ */
+static inline const uint8_t *startcode_Find( const uint8_t *p,
+                                             const uint8_t *end,
+                                             uint8_t i_code )
+{
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+        return startcode_FindSSE2( p, end, i_code );
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        return startcode_FindNEON( p, end, i_code );
+#endif
+    return startcode_FindC( p, end, i_code );
+}
+
+/**
+ * Returns the first 00 00 01 start code within [p, end), or NULL.
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+    return startcode_Find( p, end, 0x01 );
+}
+
+/**
+ * Copies i_src bytes from src to dst, removing the emulation prevention
+ * bytes (00 00 03 becomes 00 00) as used by H.264 and VC-1.
+ * A 03 byte ending the buffer is kept.
+ * At most i_dst bytes are written; returns the number of bytes written.
+ */
+static inline size_t startcode_RemoveEP3B( uint8_t *dst, size_t i_dst,
+                                           const uint8_t *src, size_t i_src )
+{
+    const uint8_t *end = &src[i_src];
+    uint8_t *dst_start = dst;
+
+    while( src < end && i_dst > 0 )
+    {
+        const uint8_t *ep = startcode_Find( src, end - 1, 0x03 );
+        size_t i_copy = (ep != NULL ? &ep[2] : end) - src;
+
+        if( i_copy > i_dst )
+            i_copy = i_dst;
+        memcpy( dst, src, i_copy );
+        dst += i_copy;
+        i_dst -= i_copy;
+
+        if( ep == NULL )
+            break;
+        src = &ep[3];
+    }
+    return dst - dst_start;
+}
+
+#endif
@@ -302,18 +302,92 @@ static void Deactivate( vlc_object_t *p_this )
     free( p_filter->p_sys );
 }
 
+/*****************************************************************************
+ * Convert: run a conversion function by bands of lines
+ *****************************************************************************
+ * Without scaling, each output line only depends on the matching input lines
+ * and the conversion buffers are not used, so bands can be converted
+ * independently, as smaller pictures.
+ *****************************************************************************/
+typedef struct
+{
+    void (*pf_convert)( filter_t *, picture_t *, picture_t * );
+    picture_t *p_src;
+    picture_t *p_dst;
+} convert_t;
+
+static void ConvertSlice( filter_t *p_filter, void *p_data,
+                          unsigned i_first, unsigned i_last )
+{
+    const convert_t *p_convert = p_data;
+    picture_t src = *p_convert->p_src;
+    picture_t dst = *p_convert->p_dst;
+
+    /* The conversion functions only read the formats and the tables of
+     * the filter */
+    filter_t slice = *p_filter;
+    slice.fmt_in.video.i_height = i_last - i_first;
+    slice.fmt_out.video.i_height = i_last - i_first;
+
+    for( int i = 0; i < src.i_planes; i++ )
+    {
+        /* 4:2:0 chroma planes have one line for two luma lines */
+        const unsigned i_first_line = i ? i_first / 2 : i_first;
+        const unsigned i_lines = i ? (i_last - i_first) / 2 : i_last - i_first;
+
+        src.p[i].p_pixels += i_first_line * src.p[i].i_pitch;
+        src.p[i].i_lines = src.p[i].i_visible_lines = i_lines;
+    }
+    dst.p->p_pixels += i_first * dst.p->i_pitch;
+    dst.p->i_lines = dst.p->i_visible_lines = i_last - i_first;
+
+    p_convert->pf_convert( &slice, &src, &dst );
+}
+
+static void Convert( filter_t *p_filter,
+                     void (*pf_convert)( filter_t *, picture_t *, picture_t * ),
+                     picture_t *p_src, picture_t *p_dst )
+{
+    if( p_filter->fmt_in.video.i_width != p_filter->fmt_out.video.i_width
+     || p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height )
+    {
+        pf_convert( p_filter, p_src, p_dst );
+        return;
+    }
+
+    convert_t convert = { pf_convert, p_src, p_dst };
+
+    /* Bands of 4 lines keep the ordered dither pattern of 8 bpp */
+    filter_ProcessSlices( p_filter, ConvertSlice, &convert,
+                          p_filter->fmt_in.video.i_height, 4 );
+}
+
+#define CONVERT_WRAPPER( name )                                         \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( p_outpic )                                                  \
+        {                                                               \
+            Convert( p_filter, name, p_pic, p_outpic );                 \
+            picture_CopyProperties( p_outpic, p_pic );                  \
+        }                                                               \
+        picture_Release( p_pic );                                       \
+        return p_outpic;                                                \
+    }
+
 #if defined (MODULE_NAME_IS_i420_rgb)
-VIDEO_FILTER_WRAPPER( I420_RGB8 )
-VIDEO_FILTER_WRAPPER( I420_RGB16 )
-//VIDEO_FILTER_WRAPPER( I420_RGB16_dither )
-VIDEO_FILTER_WRAPPER( I420_RGB32 )
+CONVERT_WRAPPER( I420_RGB8 )
+CONVERT_WRAPPER( I420_RGB16 )
+//CONVERT_WRAPPER( I420_RGB16_dither )
+CONVERT_WRAPPER( I420_RGB32 )
 #else
-VIDEO_FILTER_WRAPPER( I420_R5G5B5 )
-VIDEO_FILTER_WRAPPER( I420_R5G6B5 )
-VIDEO_FILTER_WRAPPER( I420_A8R8G8B8 )
-VIDEO_FILTER_WRAPPER( I420_R8G8B8A8 )
-VIDEO_FILTER_WRAPPER( I420_B8G8R8A8 )
-VIDEO_FILTER_WRAPPER( I420_A8B8G8R8 )
+CONVERT_WRAPPER( I420_R5G5B5 )
+CONVERT_WRAPPER( I420_R5G6B5 )
+CONVERT_WRAPPER( I420_A8R8G8B8 )
+CONVERT_WRAPPER( I420_R8G8B8A8 )
+CONVERT_WRAPPER( I420_B8G8R8A8 )
+CONVERT_WRAPPER( I420_A8B8G8R8 )
 #endif
 
 #if defined (MODULE_NAME_IS_i420_rgb)
@@ -204,35 +204,37 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * adjust_t: per picture settings shared by the bands of a picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+typedef struct
 {
+    picture_t *p_in;
+    picture_t *p_out;
+
     int pi_luma[256];
-    int pi_gamma[256];
+    int i_sat, i_sin, i_cos, i_x, i_y;
 
-    picture_t *p_outpic;
-    uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
-    uint8_t *p_out, *p_out_v;
+    /* Packed YUV only */
+    int i_y_offset, i_u_offset, i_v_offset;
+} adjust_t;
+
+/*****************************************************************************
+ * GetSettings: compute the lookup table and coefficients of a picture
+ *****************************************************************************/
+static void GetSettings( filter_t *p_filter, adjust_t *p_adjust )
+{
+    int pi_gamma[256];
+    int *pi_luma = p_adjust->pi_luma;
 
     bool b_thres;
     double  f_hue;
     double  f_gamma;
     int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
+    int i_sat;
     int i;
 
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
     /* Get variables */
     vlc_mutex_lock( &p_sys->lock );
     i_cont = (int)( p_sys->f_contrast * 255 );
@@ -282,18 +284,43 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
         i_sat = 0;
     }
 
+    p_adjust->i_sat = i_sat;
+    p_adjust->i_sin = sin(f_hue) * 256;
+    p_adjust->i_cos = cos(f_hue) * 256;
+
+    p_adjust->i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
+    p_adjust->i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+}
+
+/*****************************************************************************
+ * Run the filter on a band of a Planar YUV picture
+ *****************************************************************************/
+static void FilterPlanarSlice( filter_t *p_filter, void *p_data,
+                               unsigned i_first, unsigned i_last )
+{
+    const adjust_t *p_adjust = p_data;
+    const picture_t *p_pic = p_adjust->p_in;
+    const picture_t *p_outpic = p_adjust->p_out;
+    const int *pi_luma = p_adjust->pi_luma;
+    const int i_sat = p_adjust->i_sat;
+    const int i_sin = p_adjust->i_sin, i_cos = p_adjust->i_cos;
+    const int i_x = p_adjust->i_x, i_y = p_adjust->i_y;
+
+    uint8_t *p_in, *p_in_v, *p_line_end;
+    uint8_t *p_out, *p_out_v;
+    int y, y_end;
+
+    VLC_UNUSED(p_filter);
+
     /*
      * Do the Y plane
      */
 
-    p_in = p_pic->p[Y_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                      * p_pic->p[Y_PLANE].i_pitch - 8;
-
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-    for( ; p_in < p_in_end ; )
+    filter_SlicePlane( p_outpic, Y_PLANE, i_first, i_last, &y, &y_end );
+    for( ; y < y_end ; y++ )
     {
+        p_in = &p_pic->p[Y_PLANE].p_pixels[y * p_pic->p[Y_PLANE].i_pitch];
+        p_out = &p_outpic->p[Y_PLANE].p_pixels[y * p_outpic->p[Y_PLANE].i_pitch];
         p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
 
         for( ; p_in < p_line_end ; )
@@ -311,30 +338,13 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
         {
             *p_out++ = pi_luma[ *p_in++ ];
         }
-
-        p_in += p_pic->p[Y_PLANE].i_pitch
-              - p_pic->p[Y_PLANE].i_visible_pitch;
-        p_out += p_outpic->p[Y_PLANE].i_pitch
-               - p_outpic->p[Y_PLANE].i_visible_pitch;
     }
 
     /*
      * Do the U and V planes
      */
 
-    p_in = p_pic->p[U_PLANE].p_pixels;
-    p_in_v = p_pic->p[V_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[U_PLANE].i_visible_lines
-                      * p_pic->p[U_PLANE].i_pitch - 8;
-
-    p_out = p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = p_outpic->p[V_PLANE].p_pixels;
-
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
-
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+    filter_SlicePlane( p_outpic, U_PLANE, i_first, i_last, &y, &y_end );
 
     if ( i_sat > 256 )
     {
@@ -347,8 +357,12 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 
         uint8_t i_u, i_v;
 
-        for( ; p_in < p_in_end ; )
+        for( ; y < y_end ; y++ )
         {
+            p_in = &p_pic->p[U_PLANE].p_pixels[y * p_pic->p[U_PLANE].i_pitch];
+            p_in_v = &p_pic->p[V_PLANE].p_pixels[y * p_pic->p[V_PLANE].i_pitch];
+            p_out = &p_outpic->p[U_PLANE].p_pixels[y * p_outpic->p[U_PLANE].i_pitch];
+            p_out_v = &p_outpic->p[V_PLANE].p_pixels[y * p_outpic->p[V_PLANE].i_pitch];
             p_line_end = p_in + p_pic->p[U_PLANE].i_visible_pitch - 8;
 
             for( ; p_in < p_line_end ; )
@@ -366,15 +380,6 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
             {
                 WRITE_UV_CLIP();
             }
-
-            p_in += p_pic->p[U_PLANE].i_pitch
-                  - p_pic->p[U_PLANE].i_visible_pitch;
-            p_in_v += p_pic->p[V_PLANE].i_pitch
-                    - p_pic->p[V_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[U_PLANE].i_pitch
-                   - p_outpic->p[U_PLANE].i_visible_pitch;
-            p_out_v += p_outpic->p[V_PLANE].i_pitch
-                     - p_outpic->p[V_PLANE].i_visible_pitch;
         }
 #undef WRITE_UV_CLIP
     }
@@ -389,8 +394,12 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 
         uint8_t i_u, i_v;
 
-        for( ; p_in < p_in_end ; )
+        for( ; y < y_end ; y++ )
         {
+            p_in = &p_pic->p[U_PLANE].p_pixels[y * p_pic->p[U_PLANE].i_pitch];
+            p_in_v = &p_pic->p[V_PLANE].p_pixels[y * p_pic->p[V_PLANE].i_pitch];
+            p_out = &p_outpic->p[U_PLANE].p_pixels[y * p_outpic->p[U_PLANE].i_pitch];
+            p_out_v = &p_outpic->p[V_PLANE].p_pixels[y * p_outpic->p[V_PLANE].i_pitch];
             p_line_end = p_in + p_pic->p[U_PLANE].i_visible_pitch - 8;
 
             for( ; p_in < p_line_end ; )
@@ -406,132 +415,67 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
             {
                 WRITE_UV();
             }
-
-            p_in += p_pic->p[U_PLANE].i_pitch
-                  - p_pic->p[U_PLANE].i_visible_pitch;
-            p_in_v += p_pic->p[V_PLANE].i_pitch
-                    - p_pic->p[V_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[U_PLANE].i_pitch
-                   - p_outpic->p[U_PLANE].i_visible_pitch;
-            p_out_v += p_outpic->p[V_PLANE].i_pitch
-                     - p_outpic->p[V_PLANE].i_visible_pitch;
         }
 #undef WRITE_UV
     }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
 /*****************************************************************************
- * Run the filter on a Packed YUV picture
+ * Run the filter on a Planar YUV picture
  *****************************************************************************/
-static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 {
-    int pi_luma[256];
-    int pi_gamma[256];
-
+    adjust_t adjust;
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
-    uint8_t *p_out, *p_out_v;
-    int i_y_offset, i_u_offset, i_v_offset;
-
-    int i_lines, i_visible_lines, i_pitch, i_visible_pitch;
-
-    bool b_thres;
-    double  f_hue;
-    double  f_gamma;
-    int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
-    int i;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
 
     if( !p_pic ) return NULL;
 
-    i_lines = p_pic->p->i_lines;
-    i_visible_lines = p_pic->p->i_visible_lines;
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
-    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
-                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
-    {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&(p_pic->format.i_chroma) );
-
-        picture_Release( p_pic );
-        return NULL;
-    }
-
     p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
     {
-        msg_Warn( p_filter, "can't get output picture" );
-
         picture_Release( p_pic );
         return NULL;
     }
 
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    i_cont = (int)( p_sys->f_contrast * 255 );
-    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
-    f_hue = (float)( p_sys->i_hue * M_PI / 180 );
-    i_sat = (int)( p_sys->f_saturation * 256 );
-    f_gamma = 1.0 / p_sys->f_gamma;
-    b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
-
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( b_thres != true )
-    {
+    adjust.p_in = p_pic;
+    adjust.p_out = p_outpic;
+    GetSettings( p_filter, &adjust );
 
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += 128 - i_cont / 2;
+    filter_ProcessSlices( p_filter, FilterPlanarSlice, &adjust,
+                          p_outpic->p[Y_PLANE].i_visible_lines, 2 );
 
-        /* Fill the gamma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
-        }
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
 
-        /* Fill the luma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
-        }
+/*****************************************************************************
+ * Run the filter on a band of a Packed YUV picture
+ *****************************************************************************/
+static void FilterPackedSlice( filter_t *p_filter, void *p_data,
+                               unsigned i_first, unsigned i_last )
+{
+    const adjust_t *p_adjust = p_data;
+    const plane_t *p_src = &p_adjust->p_in->p[0];
+    const plane_t *p_dst = &p_adjust->p_out->p[0];
+    const int *pi_luma = p_adjust->pi_luma;
+    const int i_sat = p_adjust->i_sat;
+    const int i_sin = p_adjust->i_sin, i_cos = p_adjust->i_cos;
+    const int i_x = p_adjust->i_x, i_y = p_adjust->i_y;
+    const int i_visible_pitch = p_src->i_visible_pitch;
+
+    uint8_t *p_in, *p_in_v, *p_line_end;
+    uint8_t *p_out, *p_out_v;
+    unsigned y;
 
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    VLC_UNUSED(p_filter);
 
     /*
      * Do the Y plane
      */
 
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
-
-    for( ; p_in < p_in_end ; )
+    for( y = i_first ; y < i_last ; y++ )
     {
+        p_in = &p_src->p_pixels[y * p_src->i_pitch + p_adjust->i_y_offset];
+        p_out = &p_dst->p_pixels[y * p_dst->i_pitch + p_adjust->i_y_offset];
         p_line_end = p_in + i_visible_pitch - 8 * 4;
 
         for( ; p_in < p_line_end ; )
@@ -553,28 +497,12 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
         {
             *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
         }
-
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
     }
 
     /*
      * Do the U and V planes
      */
 
-    p_in = p_pic->p->p_pixels + i_u_offset;
-    p_in_v = p_pic->p->p_pixels + i_v_offset;
-    p_in_end = p_in + i_visible_lines * i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_u_offset;
-    p_out_v = p_outpic->p->p_pixels + i_v_offset;
-
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
-
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
-
     if ( i_sat > 256 )
     {
 #define WRITE_UV_CLIP() \
@@ -588,8 +516,12 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
         uint8_t i_u, i_v;
 
-        for( ; p_in < p_in_end ; )
+        for( y = i_first ; y < i_last ; y++ )
         {
+            p_in = &p_src->p_pixels[y * p_src->i_pitch + p_adjust->i_u_offset];
+            p_in_v = &p_src->p_pixels[y * p_src->i_pitch + p_adjust->i_v_offset];
+            p_out = &p_dst->p_pixels[y * p_dst->i_pitch + p_adjust->i_u_offset];
+            p_out_v = &p_dst->p_pixels[y * p_dst->i_pitch + p_adjust->i_v_offset];
             p_line_end = p_in + i_visible_pitch - 8 * 4;
 
             for( ; p_in < p_line_end ; )
@@ -607,11 +539,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
             {
                 WRITE_UV_CLIP();
             }
-
-            p_in += i_pitch - i_visible_pitch;
-            p_in_v += i_pitch - i_visible_pitch;
-            p_out += i_pitch - i_visible_pitch;
-            p_out_v += i_pitch - i_visible_pitch;
         }
 #undef WRITE_UV_CLIP
     }
@@ -628,8 +555,12 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
         uint8_t i_u, i_v;
 
-        for( ; p_in < p_in_end ; )
+        for( y = i_first ; y < i_last ; y++ )
         {
+            p_in = &p_src->p_pixels[y * p_src->i_pitch + p_adjust->i_u_offset];
+            p_in_v = &p_src->p_pixels[y * p_src->i_pitch + p_adjust->i_v_offset];
+            p_out = &p_dst->p_pixels[y * p_dst->i_pitch + p_adjust->i_u_offset];
+            p_out_v = &p_dst->p_pixels[y * p_dst->i_pitch + p_adjust->i_v_offset];
             p_line_end = p_in + i_visible_pitch - 8 * 4;
 
             for( ; p_in < p_line_end ; )
@@ -645,14 +576,46 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
             {
                 WRITE_UV();
             }
-
-            p_in += i_pitch - i_visible_pitch;
-            p_in_v += i_pitch - i_visible_pitch;
-            p_out += i_pitch - i_visible_pitch;
-            p_out_v += i_pitch - i_visible_pitch;
         }
 #undef WRITE_UV
     }
+}
+
+/*****************************************************************************
+ * Run the filter on a Packed YUV picture
+ *****************************************************************************/
+static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+{
+    adjust_t adjust;
+    picture_t *p_outpic;
+
+    if( !p_pic ) return NULL;
+
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &adjust.i_y_offset,
+                             &adjust.i_u_offset, &adjust.i_v_offset ) != VLC_SUCCESS )
+    {
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        msg_Warn( p_filter, "can't get output picture" );
+
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    adjust.p_in = p_pic;
+    adjust.p_out = p_outpic;
+    GetSettings( p_filter, &adjust );
+
+    filter_ProcessSlices( p_filter, FilterPackedSlice, &adjust,
+                          p_pic->p->i_visible_lines, 1 );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -433,55 +433,80 @@ static void RenderBob( filter_t *p_filter,
 #define Merge p_filter->p_sys->pf_merge
 #define EndMerge if(p_filter->p_sys->pf_end_merge) p_filter->p_sys->pf_end_merge
 
+/* Pictures of the Linear, Mean and Blend methods, processed by bands */
+typedef struct
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+    int        i_field;
+    bool       b_422;   /**< 4:2:2 input */
+} render_slice_t;
+
 /*****************************************************************************
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
-static void RenderLinear( filter_t *p_filter,
-                          picture_t *p_outpic, picture_t *p_pic, int i_field )
+static void RenderLinearSlice( filter_t *p_filter, void *p_data,
+                               unsigned i_first, unsigned i_last )
 {
-    int i_plane;
+    const render_slice_t *p_job = p_data;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < p_job->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const plane_t *p_in = &p_job->p_pic->p[i_plane];
+        const plane_t *p_out = &p_job->p_outpic->p[i_plane];
+        int y, y_end;
 
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        filter_SlicePlane( p_job->p_outpic, i_plane, i_first, i_last,
+                           &y, &y_end );
 
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
+        for( ; y < y_end ; y++ )
         {
-            vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
+            uint8_t *p_dst = &p_out->p_pixels[y * p_out->i_pitch];
+            uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            /* Copy the lines of the field, and interpolate the other ones,
+             * except the first and last lines which are copied too */
+            if( (y % 2) != p_job->i_field
+             && y > 0 && y < p_out->i_visible_lines - 1 )
+                Merge( p_dst, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                       p_in->i_pitch );
+            else
+                vlc_memcpy( p_dst, p_src, p_in->i_pitch );
         }
+    }
+    EndMerge();
+}
 
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+static void RenderLinear( filter_t *p_filter,
+                          picture_t *p_outpic, picture_t *p_pic, int i_field )
+{
+    render_slice_t job = { p_outpic, p_pic, i_field, false };
 
-            p_out += p_outpic->p[i_plane].i_pitch;
+    filter_ProcessSlices( p_filter, RenderLinearSlice, &job,
+                          p_outpic->p[Y_PLANE].i_visible_lines, 2 );
+}
 
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+static void RenderMeanSlice( filter_t *p_filter, void *p_data,
+                             unsigned i_first, unsigned i_last )
+{
+    const render_slice_t *p_job = p_data;
 
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
+    for( int i_plane = 0 ; i_plane < p_job->p_pic->i_planes ; i_plane++ )
+    {
+        const plane_t *p_in = &p_job->p_pic->p[i_plane];
+        const plane_t *p_out = &p_job->p_outpic->p[i_plane];
+        int y, y_end;
 
-        vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+        filter_SlicePlane( p_job->p_outpic, i_plane, i_first, i_last,
+                           &y, &y_end );
 
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
+        /* All lines: mean value */
+        for( ; y < y_end ; y++ )
         {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
+
+            Merge( &p_out->p_pixels[y * p_out->i_pitch], p_src,
+                   p_src + p_in->i_pitch, p_in->i_pitch );
         }
     }
     EndMerge();
@@ -490,27 +515,42 @@ static void RenderLinear( filter_t *p_filter,
 static void RenderMean( filter_t *p_filter,
                         picture_t *p_outpic, picture_t *p_pic )
 {
-    int i_plane;
+    render_slice_t job = { p_outpic, p_pic, 0, false };
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    filter_ProcessSlices( p_filter, RenderMeanSlice, &job,
+                          p_outpic->p[Y_PLANE].i_visible_lines, 2 );
+}
+
+static void RenderBlendSlice( filter_t *p_filter, void *p_data,
+                              unsigned i_first, unsigned i_last )
+{
+    const render_slice_t *p_job = p_data;
+
+    for( int i_plane = 0 ; i_plane < p_job->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const plane_t *p_in = &p_job->p_pic->p[i_plane];
+        const plane_t *p_out = &p_job->p_outpic->p[i_plane];
+        int y, y_end;
 
-        p_in = p_pic->p[i_plane].p_pixels;
+        filter_SlicePlane( p_job->p_outpic, i_plane, i_first, i_last,
+                           &y, &y_end );
 
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        /* First line: simple copy */
+        if( y == 0 && y < y_end )
+        {
+            vlc_memcpy( p_out->p_pixels, p_in->p_pixels, p_in->i_pitch );
+            y++;
+        }
 
-        /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
+        /* Remaining lines: mean value (the 4:2:2 chroma is output as 4:2:0,
+         * with two input lines per output line) */
+        const int i_step = (p_job->b_422 && i_plane != Y_PLANE) ? 2 : 1;
+        for( ; y < y_end ; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            uint8_t *p_src = &p_in->p_pixels[(y - 1) * i_step * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
+            Merge( &p_out->p_pixels[y * p_out->i_pitch],
+                   p_src, p_src + p_in->i_pitch, p_in->i_pitch );
         }
     }
     EndMerge();
@@ -519,73 +559,13 @@ static void RenderMean( filter_t *p_filter,
 static void RenderBlend( filter_t *p_filter,
                          picture_t *p_outpic, picture_t *p_pic )
 {
-    int i_plane;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
+    const vlc_fourcc_t i_chroma = p_filter->fmt_in.video.i_chroma;
+    render_slice_t job = { p_outpic, p_pic, 0,
+                           i_chroma == VLC_CODEC_I422 ||
+                           i_chroma == VLC_CODEC_J422 };
 
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        switch( p_filter->fmt_in.video.i_chroma )
-        {
-            case VLC_CODEC_I420:
-            case VLC_CODEC_J420:
-            case VLC_CODEC_YV12:
-                /* First line: simple copy */
-                vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-                p_out += p_outpic->p[i_plane].i_pitch;
-
-                /* Remaining lines: mean value */
-                for( ; p_out < p_out_end ; )
-                {
-                    Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                           p_pic->p[i_plane].i_pitch );
-
-                    p_out += p_outpic->p[i_plane].i_pitch;
-                    p_in += p_pic->p[i_plane].i_pitch;
-                }
-                break;
-
-            case VLC_CODEC_I422:
-            case VLC_CODEC_J422:
-                /* First line: simple copy */
-                vlc_memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-                p_out += p_outpic->p[i_plane].i_pitch;
-
-                /* Remaining lines: mean value */
-                if( i_plane == Y_PLANE )
-                {
-                    for( ; p_out < p_out_end ; )
-                    {
-                        Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                               p_pic->p[i_plane].i_pitch );
-
-                        p_out += p_outpic->p[i_plane].i_pitch;
-                        p_in += p_pic->p[i_plane].i_pitch;
-                    }
-                }
-
-                else
-                {
-                    for( ; p_out < p_out_end ; )
-                    {
-                        Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                               p_pic->p[i_plane].i_pitch );
-
-                        p_out += p_outpic->p[i_plane].i_pitch;
-                        p_in += 2*p_pic->p[i_plane].i_pitch;
-                    }
-                }
-                break;
-        }
-    }
-    EndMerge();
+    filter_ProcessSlices( p_filter, RenderBlendSlice, &job,
+                          p_outpic->p[Y_PLANE].i_visible_lines, 2 );
 }
 
 #undef Merge
@@ -1434,6 +1414,78 @@ typedef intptr_t x86_reg;
 /* yadif.h comes from vf_yadif.c of mplayer project */
 #include "yadif.h"
 
+/* Pictures and line filter of Yadif, processed by bands */
+typedef struct
+{
+    picture_t *p_dst;
+    picture_t *p_prev, *p_cur, *p_next;
+    void (*pf_filter)( struct vf_priv_s *p, uint8_t *dst, uint8_t *prev,
+                       uint8_t *cur, uint8_t *next, int w, int refs,
+                       int parity );
+    int i_order;
+    int i_field;
+} yadif_slice_t;
+
+static void RenderYadifSlice( filter_t *p_filter, void *p_data,
+                              unsigned i_first, unsigned i_last )
+{
+    const yadif_slice_t *p_job = p_data;
+    const int i_field = p_job->i_field;
+    const int i_order = p_job->i_order;
+
+    VLC_UNUSED(p_filter);
+
+    for( int n = 0; n < p_job->p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &p_job->p_prev->p[n];
+        const plane_t *curp  = &p_job->p_cur->p[n];
+        const plane_t *nextp = &p_job->p_next->p[n];
+        plane_t *dstp        = &p_job->p_dst->p[n];
+        int y, y_end;
+
+        filter_SlicePlane( p_job->p_dst, n, i_first, i_last, &y, &y_end );
+        /* The first and last lines are duplicated from their neighbours */
+        y = __MAX( y, 1 );
+        y_end = __MIN( y_end, dstp->i_visible_lines - 1 );
+
+        for( ; y < y_end; y++ )
+        {
+            if( (y % 2) == i_field )
+            {
+                vlc_memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                struct vf_priv_s cfg;
+                /* Spatial checks only when enough data */
+                cfg.mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                p_job->pf_filter( &cfg,
+                                  &dstp->p_pixels[y * dstp->i_pitch],
+                                  &prevp->p_pixels[y * prevp->i_pitch],
+                                  &curp->p_pixels[y * curp->i_pitch],
+                                  &nextp->p_pixels[y * nextp->i_pitch],
+                                  dstp->i_visible_pitch,
+                                  curp->i_pitch,
+                                  (i_field ^ (i_order == i_field)) & 1 );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                vlc_memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch], &dstp->p_pixels[y * dstp->i_pitch], dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                vlc_memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch], &dstp->p_pixels[y * dstp->i_pitch], dstp->i_pitch);
+        }
+    }
+#if defined(HAVE_YADIF_SSE2)
+    /* The MMX state belongs to the thread which processed the band */
+    if( p_job->pf_filter == yadif_filter_line_mmx2 )
+        __asm__ __volatile__( "emms" :: );
+#endif
+}
+
 static int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src, int i_order, int i_field )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -1467,53 +1519,20 @@ static int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity);
+        yadif_slice_t job = {
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_order = i_order, .i_field = i_field,
+        };
+
 #if defined(HAVE_YADIF_SSE2)
         if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
-            filter = yadif_filter_line_mmx2;
+            job.pf_filter = yadif_filter_line_mmx2;
         else
 #endif
-            filter = yadif_filter_line_c;
+            job.pf_filter = yadif_filter_line_c;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field )
-                {
-                    vlc_memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    struct vf_priv_s cfg;
-                    /* Spatial checks only when enough data */
-                    cfg.mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &cfg,
-                            &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            curp->i_pitch,
-                            (i_field ^ (i_order == i_field)) & 1 );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    vlc_memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch], &dstp->p_pixels[y * dstp->i_pitch], dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    vlc_memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch], &dstp->p_pixels[y * dstp->i_pitch], dstp->i_pitch);
-            }
-        }
+        filter_ProcessSlices( p_filter, RenderYadifSlice, &job,
+                              p_dst->p[Y_PLANE].i_visible_lines, 2 );
 
         /* */
         p_dst->date = (p_next->date - p_cur->date) * i_order / 2 + p_cur->date;
@@ -0,0 +1,1002 @@
+/*****************************************************************************
+ * resize.c: separable video scaler
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * Each plane is scaled in two passes with a bilinear, bicubic or Lanczos
+ * filter. The horizontal pass turns a source line into a line of 16-bit
+ * intermediate samples at the output width, the vertical pass combines
+ * those lines into an output line. The position and the 2.14 fixed point
+ * coefficients of the filter for each output column and line are computed
+ * once, when the filter is opened.
+ *
+ * Only the intermediate lines under the vertical filter window are kept,
+ * in a ring, so that each source line is filtered once and the vertical
+ * pass reads from the cache. The vertical pass goes through the lines in
+ * blocks of VBLOCK samples, with the sums in a small aligned buffer.
+ *
+ * The kernels are bit exact with the C versions.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#include <math.h>
+
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  OpenFilter ( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define MODE_TEXT N_("Scaling mode")
+#define MODE_LONGTEXT N_( \
+    "Interpolation filter. Bilinear is the fastest, Lanczos the sharpest.")
+
+static const int pi_mode_values[] = { 0, 1, 2 };
+static const char *const ppsz_mode_texts[] =
+    { N_("Bilinear"), N_("Bicubic"), N_("Lanczos") };
+
+vlc_module_begin ()
+    set_description( N_("Separable video scaling filter") )
+    set_shortname( N_("Resize") )
+    set_capability( "video filter2", 100 )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    add_integer( "resize-mode", 1, NULL, MODE_TEXT, MODE_LONGTEXT, true )
+        change_integer_list( pi_mode_values, ppsz_mode_texts, NULL )
+    set_callbacks( OpenFilter, CloseFilter )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+#define COEF_BITS   14  /* coefficients precision */
+#define INTER_BITS  6   /* fractional bits of the intermediate samples */
+#define HSHIFT      (COEF_BITS - INTER_BITS)
+#define VSHIFT      (COEF_BITS + INTER_BITS)
+#define VBLOCK      512 /* samples per block of the vertical pass */
+
+/**
+ * Filter of one direction. Horizontal coefficients are stored by pairs of
+ * output samples and groups of 4 taps: x0 taps 0-3, x1 taps 0-3, x0 taps
+ * 4-7... Vertical coefficients are stored line after line.
+ */
+typedef struct
+{
+    unsigned  i_in;     /* source samples */
+    unsigned  i_out;    /* output samples */
+    unsigned  i_taps;   /* multiple of 4 horizontally, of 2 vertically */
+    unsigned *p_pos;    /* first source sample under each output sample */
+    int16_t  *p_coefs;
+} scale_table_t;
+
+typedef struct
+{
+    /* Components interleaved in the plane, all in the same ring line */
+    unsigned i_lanes;
+    struct
+    {
+        unsigned i_offset;
+        unsigned i_step;
+        unsigned i_table;
+    } lane[4];
+
+    unsigned i_src_width;   /* bytes */
+    unsigned i_src_lines;
+    unsigned i_dst_width;
+    unsigned i_dst_lines;
+
+    scale_table_t h[2];
+    scale_table_t v;
+
+    int16_t  *p_ring;       /* v.i_taps intermediate lines */
+    void     *p_ring_base;
+    size_t    i_ring_pitch; /* samples */
+    int16_t **pp_rows;
+    uint8_t  *p_line;       /* zero padded copy of lines shorter than the
+                               horizontal filter, or NULL */
+} scale_plane_t;
+
+typedef void (*hscale_t)( int16_t *, const uint8_t *, const scale_table_t * );
+typedef void (*hlane_t)( int16_t *, const uint8_t *, unsigned, unsigned,
+                         const scale_table_t * );
+typedef void (*vscale_t)( uint8_t *, int16_t *const *, const int16_t *,
+                          unsigned, unsigned, int32_t * );
+
+struct filter_sys_t
+{
+    unsigned      i_planes;
+    scale_plane_t planes[4];
+
+    hscale_t      pf_hscale8;   /* one component */
+    hscale_t      pf_hscale32;  /* four interleaved components */
+    hlane_t       pf_hlane;     /* one of several interleaved components */
+    vscale_t      pf_vscale;
+    int32_t      *p_acc;        /* VBLOCK sums */
+    void         *p_acc_base;
+};
+
+/*****************************************************************************
+ * Interpolation kernels
+ *****************************************************************************/
+static double Bilinear( double x )
+{
+    x = fabs( x );
+    return x < 1. ? 1. - x : 0.;
+}
+
+static double Bicubic( double x )
+{   /* Catmull-Rom spline */
+    x = fabs( x );
+    if( x < 1. )
+        return (1.5 * x - 2.5) * x * x + 1.;
+    if( x < 2. )
+        return ((-.5 * x + 2.5) * x - 4.) * x + 2.;
+    return 0.;
+}
+
+static double Sinc( double x )
+{
+    return x == 0. ? 1. : sin( M_PI * x ) / (M_PI * x);
+}
+
+static double Lanczos( double x )
+{
+    return fabs( x ) < 3. ? Sinc( x ) * Sinc( x / 3. ) : 0.;
+}
+
+static const struct
+{
+    double   d_support;
+    double (*pf_kernel)( double );
+} p_modes[] = { { 1., Bilinear }, { 2., Bicubic }, { 3., Lanczos } };
+
+/*****************************************************************************
+ * Filter tables
+ *****************************************************************************/
+static inline size_t CoefIndex( unsigned x, unsigned j, unsigned i_taps,
+                                bool b_pairs )
+{
+    if( !b_pairs )
+        return (size_t)x * i_taps + j;
+    return (size_t)(x >> 1) * 2 * i_taps + (j >> 2) * 8 + (x & 1) * 4
+         + (j & 3);
+}
+
+/* The kernel is stretched when downscaling, to filter out what the output
+ * cannot represent. The window of each output sample stays inside the
+ * source, the weights falling outside going to the edge samples, unless
+ * the source is shorter than the window. */
+static int BuildTable( scale_table_t *t, unsigned i_in, unsigned i_out,
+                       unsigned i_mode, unsigned i_align, bool b_pairs )
+{
+    const double d_scale = (double)i_in / i_out;
+    const double d_stretch = __MAX( d_scale, 1. );
+    const double d_support = p_modes[i_mode].d_support * d_stretch;
+    unsigned i_taps = ceil( 2. * d_support - 1e-9 );
+
+    i_taps = (i_taps + i_align - 1) / i_align * i_align;
+
+    /* The SIMD horizontal kernels compute two samples at once */
+    const unsigned i_count = b_pairs ? (i_out + 1) & ~1 : i_out;
+
+    t->i_in = i_in;
+    t->i_out = i_out;
+    t->i_taps = i_taps;
+    t->p_pos = calloc( i_count, sizeof(*t->p_pos) );
+    t->p_coefs = calloc( (size_t)i_count * i_taps, sizeof(*t->p_coefs) );
+    double *w = malloc( i_taps * sizeof(*w) );
+    if( !t->p_pos || !t->p_coefs || !w )
+    {
+        free( w );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned x = 0; x < i_out; x++ )
+    {
+        const double d_center = (x + .5) * d_scale - .5;
+        const int i_first = floor( d_center - d_support ) + 1;
+        const int i_pos = __MAX( 0, __MIN( i_first,
+                                           (int)i_in - (int)i_taps ) );
+        double d_sum = 0.;
+
+        for( unsigned j = 0; j < i_taps; j++ )
+            w[j] = 0.;
+        for( unsigned j = 0; j < i_taps; j++ )
+        {
+            const int i_src = i_first + (int)j;
+            const double d = p_modes[i_mode].pf_kernel(
+                                            (i_src - d_center) / d_stretch );
+
+            w[__MAX( 0, __MIN( i_src, (int)i_in - 1 ) ) - i_pos] += d;
+            d_sum += d;
+        }
+
+        /* Unity gain, the rounding error going to the largest weight */
+        int i_total = 0;
+        unsigned i_max = 0;
+        for( unsigned j = 0; j < i_taps; j++ )
+        {
+            const int c = lround( w[j] / d_sum * (1 << COEF_BITS) );
+
+            t->p_coefs[CoefIndex( x, j, i_taps, b_pairs )] = c;
+            i_total += c;
+            if( fabs( w[j] ) > fabs( w[i_max] ) )
+                i_max = j;
+        }
+        t->p_coefs[CoefIndex( x, i_max, i_taps, b_pairs )] +=
+            (1 << COEF_BITS) - i_total;
+        t->p_pos[x] = i_pos;
+    }
+    free( w );
+    return VLC_SUCCESS;
+}
+
+static void CleanTable( scale_table_t *t )
+{
+    free( t->p_coefs );
+    free( t->p_pos );
+}
+
+/*****************************************************************************
+ * Horizontal pass: dst[x] = sum( src[pos[x] + j] * c[x][j] ) >> HSHIFT
+ *****************************************************************************/
+static inline int16_t Clip16( int i )
+{
+    return i > INT16_MAX ? INT16_MAX : i < INT16_MIN ? INT16_MIN : i;
+}
+
+/* One component every i_step bytes, from byte i_offset, to the same
+ * place in the intermediate line */
+static void HLane_C( int16_t *dst, const uint8_t *src, unsigned i_step,
+                     unsigned i_offset, const scale_table_t *t )
+{
+    const unsigned i_taps = t->i_taps;
+
+    src += i_offset;
+    dst += i_offset;
+    for( unsigned x = 0; x < t->i_out; x++ )
+    {
+        const uint8_t *s = &src[t->p_pos[x] * i_step];
+        const int16_t *c = &t->p_coefs[CoefIndex( x, 0, i_taps, true )];
+        int i_sum = 0;
+
+        for( unsigned j = 0; j < i_taps; j += 4, c += 8 )
+            for( unsigned k = 0; k < 4; k++ )
+                i_sum += s[(j + k) * i_step] * c[k];
+        dst[x * i_step] = Clip16( (i_sum + (1 << (HSHIFT - 1))) >> HSHIFT );
+    }
+}
+
+static void HScale8_C( int16_t *dst, const uint8_t *src,
+                       const scale_table_t *t )
+{
+    HLane_C( dst, src, 1, 0, t );
+}
+
+static void HScale32_C( int16_t *dst, const uint8_t *src,
+                        const scale_table_t *t )
+{
+    for( unsigned i = 0; i < 4; i++ )
+        HLane_C( dst, src, 4, i, t );
+}
+
+/*****************************************************************************
+ * Vertical pass: dst[x] = sum( rows[j][x] * c[j] ) >> VSHIFT
+ *****************************************************************************/
+static inline uint8_t VScaleSample( int16_t *const *rows, const int16_t *c,
+                                    unsigned i_taps, unsigned x )
+{
+    int i_sum = 1 << (VSHIFT - 1);
+
+    for( unsigned j = 0; j < i_taps; j++ )
+        i_sum += rows[j][x] * c[j];
+    i_sum >>= VSHIFT;
+    return i_sum < 0 ? 0 : i_sum > 255 ? 255 : i_sum;
+}
+
+static void VScale_C( uint8_t *dst, int16_t *const *rows, const int16_t *c,
+                      unsigned i_taps, unsigned n, int32_t *acc )
+{
+    VLC_UNUSED(acc);
+    for( unsigned x = 0; x < n; x++ )
+        dst[x] = VScaleSample( rows, c, i_taps, x );
+}
+
+#ifdef CAN_COMPILE_SSE2
+/* Two output samples per iteration, four taps of each in a register */
+static void HScale8_SSE2( int16_t *dst, const uint8_t *src,
+                          const scale_table_t *t )
+{
+    static const int32_t k_round[4] = {
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1),
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1) };
+    const int16_t *c = t->p_coefs;
+
+    for( unsigned x = 0; x < t->i_out; x += 2, dst += 2 )
+    {
+        const uint8_t *s0 = &src[t->p_pos[x]], *s1 = &src[t->p_pos[x + 1]];
+        size_t n = t->i_taps;
+
+        asm volatile( "pxor      %%xmm7,    %%xmm7\n"
+                      "pxor      %%xmm6,    %%xmm6\n"
+                      "1:\n"
+                      "movd      (%[s0]),   %%xmm0\n"
+                      "movd      (%[s1]),   %%xmm1\n"
+                      "punpckldq %%xmm1,    %%xmm0\n"
+                      "punpcklbw %%xmm7,    %%xmm0\n"
+                      "movdqu    (%[c]),    %%xmm1\n"
+                      "pmaddwd   %%xmm1,    %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "add       $4,        %[s0]\n"
+                      "add       $4,        %[s1]\n"
+                      "add       $16,       %[c]\n"
+                      "sub       $4,        %[n]\n"
+                      "jnz       1b\n"
+                      "pshufd    $0xb1,     %%xmm6, %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "movdqu    %[round],  %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "psrad     %[shift],  %%xmm6\n"
+                      "pshufd    $0x08,     %%xmm6, %%xmm6\n"
+                      "packssdw  %%xmm6,    %%xmm6\n"
+                      "movd      %%xmm6,    %[out]\n"
+                      : [s0]"+r"(s0), [s1]"+r"(s1), [c]"+r"(c), [n]"+r"(n),
+                        [out]"=m"(*(int16_t (*)[2])dst)
+                      : [round]"m"(k_round), [shift]"i"(HSHIFT)
+                      : "xmm0", "xmm1", "xmm6", "xmm7", "memory", "cc" );
+    }
+}
+
+/* Four components per iteration, two taps of each in a register */
+static void HScale32_SSE2( int16_t *dst, const uint8_t *src,
+                           const scale_table_t *t )
+{
+    static const int32_t k_round[4] = {
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1),
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1) };
+
+    for( unsigned x = 0; x < t->i_out; x++, dst += 4 )
+    {
+        const uint8_t *s = &src[4 * t->p_pos[x]];
+        const int16_t *c = &t->p_coefs[CoefIndex( x, 0, t->i_taps, true )];
+        size_t n = t->i_taps;
+
+        asm volatile( "pxor      %%xmm7,    %%xmm7\n"
+                      "pxor      %%xmm6,    %%xmm6\n"
+                      "1:\n"
+                      "movd      (%[s]),    %%xmm0\n"
+                      "movd      4(%[s]),   %%xmm1\n"
+                      "punpcklbw %%xmm1,    %%xmm0\n"
+                      "punpcklbw %%xmm7,    %%xmm0\n"
+                      "movd      (%[c]),    %%xmm1\n"
+                      "pshufd    $0,        %%xmm1, %%xmm1\n"
+                      "pmaddwd   %%xmm1,    %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "movd      8(%[s]),   %%xmm0\n"
+                      "movd      12(%[s]),  %%xmm1\n"
+                      "punpcklbw %%xmm1,    %%xmm0\n"
+                      "punpcklbw %%xmm7,    %%xmm0\n"
+                      "movd      4(%[c]),   %%xmm1\n"
+                      "pshufd    $0,        %%xmm1, %%xmm1\n"
+                      "pmaddwd   %%xmm1,    %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "add       $16,       %[s]\n"
+                      "add       $16,       %[c]\n"
+                      "sub       $4,        %[n]\n"
+                      "jnz       1b\n"
+                      "movdqu    %[round],  %%xmm0\n"
+                      "paddd     %%xmm0,    %%xmm6\n"
+                      "psrad     %[shift],  %%xmm6\n"
+                      "packssdw  %%xmm6,    %%xmm6\n"
+                      "movq      %%xmm6,    %[out]\n"
+                      : [s]"+r"(s), [c]"+r"(c), [n]"+r"(n),
+                        [out]"=m"(*(int16_t (*)[4])dst)
+                      : [round]"m"(k_round), [shift]"i"(HSHIFT)
+                      : "xmm0", "xmm1", "xmm6", "xmm7", "memory", "cc" );
+    }
+}
+
+/* Two output samples per iteration like HScale8_SSE2, the component being
+ * shifted down and masked out of whole 2 or 4 bytes elements */
+static void HLane_SSE2( int16_t *dst, const uint8_t *src, unsigned i_step,
+                        unsigned i_offset, const scale_table_t *t )
+{
+    static const int32_t k_round[4] = {
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1),
+        1 << (HSHIFT - 1), 1 << (HSHIFT - 1) };
+    static const int16_t k_mask16[8] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    static const int32_t k_mask32[4] = { 0xff, 0xff, 0xff, 0xff };
+    const uint32_t i_shift = 8 * i_offset;
+    const int16_t *c = t->p_coefs;
+
+    if( i_step != 2 && i_step != 4 )
+    {
+        HLane_C( dst, src, i_step, i_offset, t );
+        return;
+    }
+
+    dst += i_offset;
+    for( unsigned x = 0; x < t->i_out; x += 2 )
+    {
+        const uint8_t *s0 = &src[t->p_pos[x] * i_step];
+        const uint8_t *s1 = &src[t->p_pos[x + 1] * i_step];
+        size_t n = t->i_taps;
+        uint32_t i_pair;
+
+        if( i_step == 2 )
+            asm volatile( "movd      %[shift],  %%xmm5\n"
+                          "movdqu    %[mask],   %%xmm4\n"
+                          "pxor      %%xmm6,    %%xmm6\n"
+                          "1:\n"
+                          "movq      (%[s0]),   %%xmm0\n"
+                          "movq      (%[s1]),   %%xmm1\n"
+                          "punpcklqdq %%xmm1,   %%xmm0\n"
+                          "psrlw     %%xmm5,    %%xmm0\n"
+                          "pand      %%xmm4,    %%xmm0\n"
+                          "movdqu    (%[c]),    %%xmm1\n"
+                          "pmaddwd   %%xmm1,    %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "add       $8,        %[s0]\n"
+                          "add       $8,        %[s1]\n"
+                          "add       $16,       %[c]\n"
+                          "sub       $4,        %[n]\n"
+                          "jnz       1b\n"
+                          "pshufd    $0xb1,     %%xmm6, %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "movdqu    %[round],  %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "psrad     %[hshift], %%xmm6\n"
+                          "pshufd    $0x08,     %%xmm6, %%xmm6\n"
+                          "packssdw  %%xmm6,    %%xmm6\n"
+                          "movd      %%xmm6,    %[pair]\n"
+                          : [s0]"+r"(s0), [s1]"+r"(s1), [c]"+r"(c),
+                            [n]"+r"(n), [pair]"=m"(i_pair)
+                          : [shift]"m"(i_shift), [mask]"m"(k_mask16),
+                            [round]"m"(k_round), [hshift]"i"(HSHIFT)
+                          : "xmm0", "xmm1", "xmm4", "xmm5", "xmm6",
+                            "memory", "cc" );
+        else
+            asm volatile( "movd      %[shift],  %%xmm5\n"
+                          "movdqu    %[mask],   %%xmm4\n"
+                          "pxor      %%xmm6,    %%xmm6\n"
+                          "1:\n"
+                          "movdqu    (%[s0]),   %%xmm0\n"
+                          "movdqu    (%[s1]),   %%xmm1\n"
+                          "psrld     %%xmm5,    %%xmm0\n"
+                          "psrld     %%xmm5,    %%xmm1\n"
+                          "pand      %%xmm4,    %%xmm0\n"
+                          "pand      %%xmm4,    %%xmm1\n"
+                          "packssdw  %%xmm1,    %%xmm0\n"
+                          "movdqu    (%[c]),    %%xmm1\n"
+                          "pmaddwd   %%xmm1,    %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "add       $16,       %[s0]\n"
+                          "add       $16,       %[s1]\n"
+                          "add       $16,       %[c]\n"
+                          "sub       $4,        %[n]\n"
+                          "jnz       1b\n"
+                          "pshufd    $0xb1,     %%xmm6, %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "movdqu    %[round],  %%xmm0\n"
+                          "paddd     %%xmm0,    %%xmm6\n"
+                          "psrad     %[hshift], %%xmm6\n"
+                          "pshufd    $0x08,     %%xmm6, %%xmm6\n"
+                          "packssdw  %%xmm6,    %%xmm6\n"
+                          "movd      %%xmm6,    %[pair]\n"
+                          : [s0]"+r"(s0), [s1]"+r"(s1), [c]"+r"(c),
+                            [n]"+r"(n), [pair]"=m"(i_pair)
+                          : [shift]"m"(i_shift), [mask]"m"(k_mask32),
+                            [round]"m"(k_round), [hshift]"i"(HSHIFT)
+                          : "xmm0", "xmm1", "xmm4", "xmm5", "xmm6",
+                            "memory", "cc" );
+
+        dst[x * i_step] = i_pair & 0xffff;
+        if( x + 1 < t->i_out )
+            dst[(x + 1) * i_step] = i_pair >> 16;
+    }
+}
+
+/* Blocks of VBLOCK samples, the lines added by pairs into acc */
+static void VScale_SSE2( uint8_t *dst, int16_t *const *rows,
+                         const int16_t *c, unsigned i_taps, unsigned n,
+                         int32_t *acc )
+{
+    static const int32_t k_round[4] = {
+        1 << (VSHIFT - 1), 1 << (VSHIFT - 1),
+        1 << (VSHIFT - 1), 1 << (VSHIFT - 1) };
+    const unsigned n8 = n & ~7;
+
+    for( unsigned x = 0; x < n8; x += VBLOCK )
+    {
+        const unsigned i_block = __MIN( VBLOCK, n8 - x );
+
+        memset( acc, 0, i_block * sizeof(*acc) );
+        for( unsigned j = 0; j < i_taps; j += 2 )
+        {
+            const int16_t *r0 = &rows[j][x], *r1 = &rows[j + 1][x];
+            const uint32_t i_pair = (uint16_t)c[j]
+                                  | ((uint32_t)(uint16_t)c[j + 1] << 16);
+            int32_t *a = acc;
+            size_t i = i_block;
+
+            asm volatile( "movd      %[pair],   %%xmm5\n"
+                          "pshufd    $0,        %%xmm5, %%xmm5\n"
+                          "1:\n"
+                          "movdqa    (%[r0]),   %%xmm0\n"
+                          "movdqa    (%[r1]),   %%xmm1\n"
+                          "movdqa    %%xmm0,    %%xmm2\n"
+                          "punpcklwd %%xmm1,    %%xmm0\n"
+                          "punpckhwd %%xmm1,    %%xmm2\n"
+                          "pmaddwd   %%xmm5,    %%xmm0\n"
+                          "pmaddwd   %%xmm5,    %%xmm2\n"
+                          "paddd     (%[a]),    %%xmm0\n"
+                          "paddd     16(%[a]),  %%xmm2\n"
+                          "movdqa    %%xmm0,    (%[a])\n"
+                          "movdqa    %%xmm2,    16(%[a])\n"
+                          "add       $16,       %[r0]\n"
+                          "add       $16,       %[r1]\n"
+                          "add       $32,       %[a]\n"
+                          "sub       $8,        %[i]\n"
+                          "jnz       1b\n"
+                          : [r0]"+r"(r0), [r1]"+r"(r1), [a]"+r"(a),
+                            [i]"+r"(i)
+                          : [pair]"r"(i_pair)
+                          : "xmm0", "xmm1", "xmm2", "xmm5", "memory", "cc" );
+        }
+
+        const int32_t *a = acc;
+        uint8_t *d = &dst[x];
+        size_t i = i_block;
+
+        asm volatile( "movdqu    %[round],  %%xmm3\n"
+                      "1:\n"
+                      "movdqa    (%[a]),    %%xmm0\n"
+                      "movdqa    16(%[a]),  %%xmm1\n"
+                      "paddd     %%xmm3,    %%xmm0\n"
+                      "paddd     %%xmm3,    %%xmm1\n"
+                      "psrad     %[shift],  %%xmm0\n"
+                      "psrad     %[shift],  %%xmm1\n"
+                      "packssdw  %%xmm1,    %%xmm0\n"
+                      "packuswb  %%xmm0,    %%xmm0\n"
+                      "movq      %%xmm0,    (%[d])\n"
+                      "add       $32,       %[a]\n"
+                      "add       $8,        %[d]\n"
+                      "sub       $8,        %[i]\n"
+                      "jnz       1b\n"
+                      : [a]"+r"(a), [d]"+r"(d), [i]"+r"(i)
+                      : [round]"m"(k_round), [shift]"i"(VSHIFT)
+                      : "xmm0", "xmm1", "xmm3", "memory", "cc" );
+    }
+    for( unsigned x = n8; x < n; x++ )
+        dst[x] = VScaleSample( rows, c, i_taps, x );
+}
+#endif
+
+#if defined(__ARM_NEON__)
+static inline uint32x2_t Load32x2( const uint8_t *p0, const uint8_t *p1 )
+{
+    uint32_t u0, u1;
+
+    memcpy( &u0, p0, 4 );
+    memcpy( &u1, p1, 4 );
+    return vset_lane_u32( u1, vdup_n_u32( u0 ), 1 );
+}
+
+static inline int16_t HSum16( int32x4_t v )
+{
+    int32x2_t s = vadd_s32( vget_low_s32( v ), vget_high_s32( v ) );
+    const int i = vget_lane_s32( vpadd_s32( s, s ), 0 );
+
+    return Clip16( (i + (1 << (HSHIFT - 1))) >> HSHIFT );
+}
+
+static void HScale8_NEON( int16_t *dst, const uint8_t *src,
+                          const scale_table_t *t )
+{
+    const int16_t *c = t->p_coefs;
+
+    for( unsigned x = 0; x < t->i_out; x += 2 )
+    {
+        const uint8_t *s0 = &src[t->p_pos[x]], *s1 = &src[t->p_pos[x + 1]];
+        int32x4_t acc0 = vdupq_n_s32( 0 ), acc1 = acc0;
+
+        for( unsigned j = 0; j < t->i_taps; j += 4, c += 8 )
+        {
+            const int16x8_t v = vreinterpretq_s16_u16( vmovl_u8(
+                vreinterpret_u8_u32( Load32x2( &s0[j], &s1[j] ) ) ) );
+            const int16x8_t k = vld1q_s16( c );
+
+            acc0 = vmlal_s16( acc0, vget_low_s16( v ), vget_low_s16( k ) );
+            acc1 = vmlal_s16( acc1, vget_high_s16( v ), vget_high_s16( k ) );
+        }
+        dst[x] = HSum16( acc0 );
+        dst[x + 1] = HSum16( acc1 );
+    }
+}
+
+static void HScale32_NEON( int16_t *dst, const uint8_t *src,
+                           const scale_table_t *t )
+{
+    const int32x4_t round = vdupq_n_s32( 1 << (HSHIFT - 1) );
+
+    for( unsigned x = 0; x < t->i_out; x++ )
+    {
+        const uint8_t *s = &src[4 * t->p_pos[x]];
+        const int16_t *c = &t->p_coefs[CoefIndex( x, 0, t->i_taps, true )];
+        int32x4_t acc = round;
+
+        for( unsigned j = 0; j < t->i_taps; j += 2 )
+        {
+            const int16x8_t v = vreinterpretq_s16_u16( vmovl_u8(
+                vreinterpret_u8_u32( Load32x2( &s[4 * j], &s[4 * j + 4] ) ) ) );
+
+            acc = vmlal_n_s16( acc, vget_low_s16( v ),
+                               c[(j >> 2) * 8 + (j & 3)] );
+            acc = vmlal_n_s16( acc, vget_high_s16( v ),
+                               c[(j >> 2) * 8 + (j & 3) + 1] );
+        }
+        vst1_s16( &dst[4 * x], vqmovn_s32( vshrq_n_s32( acc, HSHIFT ) ) );
+    }
+}
+
+static void VScale_NEON( uint8_t *dst, int16_t *const *rows,
+                         const int16_t *c, unsigned i_taps, unsigned n,
+                         int32_t *acc )
+{
+    const int32x4_t round = vdupq_n_s32( 1 << (VSHIFT - 1) );
+    const unsigned n8 = n & ~7;
+
+    VLC_UNUSED(acc);
+    for( unsigned x = 0; x < n8; x += 8 )
+    {
+        int32x4_t lo = round, hi = round;
+
+        for( unsigned j = 0; j < i_taps; j++ )
+        {
+            const int16x8_t v = vld1q_s16( &rows[j][x] );
+
+            lo = vmlal_n_s16( lo, vget_low_s16( v ), c[j] );
+            hi = vmlal_n_s16( hi, vget_high_s16( v ), c[j] );
+        }
+        vst1_u8( &dst[x], vqmovun_s16( vcombine_s16(
+                     vqmovn_s32( vshrq_n_s32( lo, VSHIFT ) ),
+                     vqmovn_s32( vshrq_n_s32( hi, VSHIFT ) ) ) ) );
+    }
+    for( unsigned x = n8; x < n; x++ )
+        dst[x] = VScaleSample( rows, c, i_taps, x );
+}
+#endif
+
+/*****************************************************************************
+ * Planes
+ *****************************************************************************/
+static void SetLane( scale_plane_t *p, unsigned i_offset, unsigned i_step,
+                     unsigned i_table )
+{
+    p->lane[p->i_lanes].i_offset = i_offset;
+    p->lane[p->i_lanes].i_step = i_step;
+    p->lane[p->i_lanes].i_table = i_table;
+    p->i_lanes++;
+}
+
+/* Layout of the components of a plane */
+static void SetLanes( scale_plane_t *p, vlc_fourcc_t i_chroma,
+                      unsigned i_plane )
+{
+    switch( i_chroma )
+    {
+        case VLC_CODEC_YUYV:
+        case VLC_CODEC_YVYU:
+            SetLane( p, 0, 2, 0 );
+            SetLane( p, 1, 4, 1 );
+            SetLane( p, 3, 4, 1 );
+            break;
+        case VLC_CODEC_UYVY:
+        case VLC_CODEC_VYUY:
+            SetLane( p, 1, 2, 0 );
+            SetLane( p, 0, 4, 1 );
+            SetLane( p, 2, 4, 1 );
+            break;
+        case VLC_CODEC_NV12:
+            if( i_plane == 1 )
+            {
+                SetLane( p, 0, 2, 0 );
+                SetLane( p, 1, 2, 0 );
+            }
+            else
+                SetLane( p, 0, 1, 0 );
+            break;
+        case VLC_CODEC_RGB32:
+        case VLC_CODEC_RGBA:
+            for( unsigned i = 0; i < 4; i++ )
+                SetLane( p, i, 4, 0 );
+            break;
+        default:
+            SetLane( p, 0, 1, 0 );
+            break;
+    }
+}
+
+static int InitPlane( scale_plane_t *p, unsigned i_mode )
+{
+    unsigned i_window = 0;
+
+    for( unsigned k = 0; k < 2; k++ )
+    {
+        unsigned i_step = 0;
+
+        for( unsigned i = 0; i < p->i_lanes; i++ )
+            if( p->lane[i].i_table == k )
+                i_step = p->lane[i].i_step;
+        if( i_step == 0 )
+            continue;
+        if( p->i_src_width < i_step || p->i_dst_width < i_step )
+            return VLC_EGENERIC;
+        if( BuildTable( &p->h[k], p->i_src_width / i_step,
+                        p->i_dst_width / i_step, i_mode, 4, true ) )
+            return VLC_ENOMEM;
+        if( p->h[k].i_taps > p->h[k].i_in )
+            i_window = __MAX( i_window, 4 * (p->h[k].i_taps + 1) );
+    }
+    if( BuildTable( &p->v, p->i_src_lines, p->i_dst_lines, i_mode, 2,
+                    false ) )
+        return VLC_ENOMEM;
+
+    /* Room for the extra sample of the two samples kernels, and whole
+     * blocks of 8 samples */
+    p->i_ring_pitch = (p->i_dst_width + 8) & ~7;
+    p->p_ring = vlc_memalign( &p->p_ring_base, 16,
+                              p->v.i_taps * p->i_ring_pitch * 2 );
+    p->pp_rows = calloc( p->v.i_taps, sizeof(*p->pp_rows) );
+    if( !p->p_ring || !p->pp_rows )
+        return VLC_ENOMEM;
+    memset( p->p_ring, 0, p->v.i_taps * p->i_ring_pitch * 2 );
+
+    if( i_window > 0 )
+    {
+        p->p_line = calloc( p->i_src_width + i_window, 1 );
+        if( !p->p_line )
+            return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+static void CleanPlane( scale_plane_t *p )
+{
+    CleanTable( &p->h[0] );
+    CleanTable( &p->h[1] );
+    CleanTable( &p->v );
+    free( p->p_ring_base );
+    free( p->pp_rows );
+    free( p->p_line );
+}
+
+static void HScaleLine( filter_sys_t *p_sys, scale_plane_t *p, int16_t *dst,
+                        const uint8_t *src )
+{
+    if( p->p_line )
+    {
+        memcpy( p->p_line, src, p->i_src_width );
+        src = p->p_line;
+    }
+
+    if( p->i_lanes == 1 && p->lane[0].i_step == 1 )
+        p_sys->pf_hscale8( dst, src, &p->h[0] );
+    else if( p->i_lanes == 4 )
+        p_sys->pf_hscale32( dst, src, &p->h[0] );
+    else
+        for( unsigned i = 0; i < p->i_lanes; i++ )
+            p_sys->pf_hlane( dst, src, p->lane[i].i_step,
+                             p->lane[i].i_offset, &p->h[p->lane[i].i_table] );
+}
+
+static void ScalePlane( filter_sys_t *p_sys, scale_plane_t *p,
+                        plane_t *p_dst, const plane_t *p_src )
+{
+    const scale_table_t *v = &p->v;
+    const unsigned i_taps = v->i_taps;
+    unsigned i_next = 0; /* first source line not filtered yet */
+
+    for( unsigned y = 0; y < p->i_dst_lines; y++ )
+    {
+        const unsigned i_pos = v->p_pos[y];
+
+        for( unsigned l = __MAX( i_next, i_pos );
+             l < i_pos + i_taps && l < p->i_src_lines; l++ )
+            HScaleLine( p_sys, p,
+                        &p->p_ring[(l % i_taps) * p->i_ring_pitch],
+                        &p_src->p_pixels[l * p_src->i_pitch] );
+        i_next = i_pos + i_taps;
+
+        for( unsigned j = 0; j < i_taps; j++ )
+            p->pp_rows[j] =
+                &p->p_ring[((i_pos + j) % i_taps) * p->i_ring_pitch];
+        p_sys->pf_vscale( &p_dst->p_pixels[y * p_dst->i_pitch], p->pp_rows,
+                          &v->p_coefs[y * i_taps], i_taps, p->i_dst_width,
+                          p_sys->p_acc );
+    }
+}
+
+/*****************************************************************************
+ * OpenFilter: probe the filter and return score
+ *****************************************************************************/
+static const vlc_fourcc_t p_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_YV12, VLC_CODEC_J420, VLC_CODEC_I422,
+    VLC_CODEC_J422, VLC_CODEC_I440, VLC_CODEC_J440, VLC_CODEC_I444,
+    VLC_CODEC_J444, VLC_CODEC_I411, VLC_CODEC_I410, VLC_CODEC_YV9,
+    VLC_CODEC_YUVA, VLC_CODEC_GREY, VLC_CODEC_NV12, VLC_CODEC_YUYV,
+    VLC_CODEC_YVYU, VLC_CODEC_UYVY, VLC_CODEC_VYUY, VLC_CODEC_RGB32,
+    VLC_CODEC_RGBA, 0
+};
+
+static int OpenFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+    filter_sys_t *p_sys;
+    unsigned i;
+
+    if( p_in->i_chroma != p_out->i_chroma )
+        return VLC_EGENERIC;
+    for( i = 0; p_chromas[i] != 0; i++ )
+        if( p_chromas[i] == p_in->i_chroma )
+            break;
+    if( p_chromas[i] == 0 )
+        return VLC_EGENERIC;
+    if( p_in->i_width == 0 || p_in->i_height == 0 ||
+        p_out->i_width == 0 || p_out->i_height == 0 )
+        return VLC_EGENERIC;
+
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_in->i_chroma );
+    if( !p_dsc )
+        return VLC_EGENERIC;
+
+    p_sys = p_filter->p_sys = calloc( 1, sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    unsigned i_mode = var_InheritInteger( p_filter, "resize-mode" );
+    if( i_mode >= sizeof(p_modes) / sizeof(p_modes[0]) )
+        i_mode = 1;
+
+    /* Same visible plane sizes as picture_Setup() */
+    p_sys->i_planes = p_dsc->plane_count;
+    for( i = 0; i < p_sys->i_planes; i++ )
+    {
+        scale_plane_t *p = &p_sys->planes[i];
+
+        p->i_src_width = p_in->i_width * p_dsc->p[i].w.num
+                       / p_dsc->p[i].w.den * p_dsc->pixel_size;
+        p->i_src_lines = p_in->i_height * p_dsc->p[i].h.num
+                       / p_dsc->p[i].h.den;
+        p->i_dst_width = p_out->i_width * p_dsc->p[i].w.num
+                       / p_dsc->p[i].w.den * p_dsc->pixel_size;
+        p->i_dst_lines = p_out->i_height * p_dsc->p[i].h.num
+                       / p_dsc->p[i].h.den;
+        SetLanes( p, p_in->i_chroma, i );
+
+        if( p->i_src_lines == 0 || p->i_dst_lines == 0 ||
+            InitPlane( p, i_mode ) )
+            goto error;
+    }
+
+    p_sys->p_acc = vlc_memalign( &p_sys->p_acc_base, 16,
+                                 VBLOCK * sizeof(*p_sys->p_acc) );
+    if( !p_sys->p_acc )
+        goto error;
+
+    p_sys->pf_hscale8 = HScale8_C;
+    p_sys->pf_hscale32 = HScale32_C;
+    p_sys->pf_hlane = HLane_C;
+    p_sys->pf_vscale = VScale_C;
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+    {
+        p_sys->pf_hscale8 = HScale8_SSE2;
+        p_sys->pf_hscale32 = HScale32_SSE2;
+        p_sys->pf_hlane = HLane_SSE2;
+        p_sys->pf_vscale = VScale_SSE2;
+    }
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+    {
+        p_sys->pf_hscale8 = HScale8_NEON;
+        p_sys->pf_hscale32 = HScale32_NEON;
+        p_sys->pf_vscale = VScale_NEON;
+    }
+#endif
+
+    p_filter->pf_video_filter = Filter;
+
+    msg_Dbg( p_filter, "%ix%i -> %ix%i %4.4s, %s, %u/%u taps",
+             p_in->i_width, p_in->i_height, p_out->i_width, p_out->i_height,
+             (const char *)&p_in->i_chroma, ppsz_mode_texts[i_mode],
+             p_sys->planes[0].h[0].i_taps, p_sys->planes[0].v.i_taps );
+
+    return VLC_SUCCESS;
+
+error:
+    for( i = 0; i < p_sys->i_planes; i++ )
+        CleanPlane( &p_sys->planes[i] );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * CloseFilter: clean up the filter
+ *****************************************************************************/
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+        CleanPlane( &p_sys->planes[i] );
+    free( p_sys->p_acc_base );
+    free( p_sys );
+}
+
+/****************************************************************************
+ * Filter: scale all the planes
+ ****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_pic_dst;
+
+    if( !p_pic ) return NULL;
+
+    /* Request output picture */
+    p_pic_dst = filter_NewPicture( p_filter );
+    if( !p_pic_dst )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+        ScalePlane( p_sys, &p_sys->planes[i], &p_pic_dst->p[i],
+                    &p_pic->p[i] );
+
+    picture_CopyProperties( p_pic_dst, p_pic );
+    picture_Release( p_pic );
+    return p_pic_dst;
+}
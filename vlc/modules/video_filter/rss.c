@@ -307,7 +307,7 @@ static int CreateFilter( vlc_object_t *p_this )
     p_sys->b_fetched = false;
 
     /* Create and arm the timer */
-    if( vlc_timer_create( &p_sys->timer, Fetch, p_filter ) )
+    if( vlc_timer_create_blocking( &p_sys->timer, Fetch, p_filter ) )
     {
         vlc_mutex_destroy( &p_sys->lock );
         goto error;
@@ -506,6 +506,23 @@ void config_Free( module_t *p_module )
 {
     int i;
 
+    if( p_module->b_mapped )
+    {
+        /* Only the current and saved values belong to cached items */
+        for (size_t j = 0; j < p_module->confsize; j++)
+        {
+            module_config_t *p_item = p_module->p_config + j;
+
+            if (IsConfigStringType (p_item->i_type))
+            {
+                free (p_item->value.psz);
+                free (p_item->saved.psz);
+            }
+        }
+        p_module->p_config = NULL;
+        return;
+    }
+
     for (size_t j = 0; j < p_module->confsize; j++)
     {
         module_config_t *p_item = p_module->p_config + j;
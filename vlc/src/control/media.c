@@ -406,6 +406,12 @@ void libvlc_media_release( libvlc_media_t *p_md )
         libvlc_media_list_release( p_md->p_subitems );
 
     uninstall_input_item_observer( p_md );
+
+    /* Nobody can wait for the preparsing anymore */
+    if( p_md->has_asked_preparse && !p_md->is_parsed )
+        playlist_PreparseCancel(
+                libvlc_priv (p_md->p_libvlc_instance->p_libvlc_int)->p_playlist,
+                p_md->p_input_item );
     vlc_gc_decref( p_md->p_input_item );
 
     vlc_cond_destroy( &p_md->parsed_cond );
@@ -625,6 +631,11 @@ libvlc_media_parse(libvlc_media_t *media)
     preparse_if_needed(media);
 
     vlc_mutex_lock(&media->parsed_lock);
+    /* The caller is waiting, do not wait for the whole queue */
+    if (!media->is_parsed)
+        playlist_PreparsePrioritize(
+                libvlc_priv (media->p_libvlc_instance->p_libvlc_int)->p_playlist,
+                media->p_input_item );
     while (!media->is_parsed)
         vlc_cond_wait(&media->parsed_cond, &media->parsed_lock);
     vlc_mutex_unlock(&media->parsed_lock);
@@ -754,8 +754,9 @@ static decoder_t * CreateDecoder( input_thread_t *p_input,
     p_dec->p_owner->p_packetizer = NULL;
     p_dec->p_owner->b_packetizer = b_packetizer;
 
-    /* decoder fifo */
-    if( ( p_dec->p_owner->p_fifo = block_FifoNew() ) == NULL )
+    /* decoder fifo: only fed by the input thread (under the ES output lock)
+     * and only read by the decoder thread */
+    if( ( p_dec->p_owner->p_fifo = block_FifoNewSPSC() ) == NULL )
     {
         free( p_dec->p_owner );
         vlc_object_release( p_dec );
@@ -1282,16 +1283,12 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
     /* Update ugly stat */
     if( i_decoded > 0 || i_lost > 0 || i_played > 0 )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock);
-
         stats_UpdateInteger( p_dec, p_input->p->counters.p_lost_abuffers,
                              i_lost, NULL );
         stats_UpdateInteger( p_dec, p_input->p->counters.p_played_abuffers,
                              i_played, NULL );
         stats_UpdateInteger( p_dec, p_input->p->counters.p_decoded_audio,
                              i_decoded, NULL );
-
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock);
     }
 }
 static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
@@ -1508,8 +1505,6 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     }
     if( i_decoded > 0 || i_lost > 0 || i_displayed > 0 )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
-
         stats_UpdateInteger( p_dec, p_input->p->counters.p_decoded_video,
                              i_decoded, NULL );
         stats_UpdateInteger( p_dec, p_input->p->counters.p_lost_pictures,
@@ -1517,8 +1512,6 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 
         stats_UpdateInteger( p_dec, p_input->p->counters.p_displayed_pictures,
                              i_displayed, NULL);
-
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 }
 
@@ -1903,9 +1896,7 @@ static void DecoderProcessSpu( decoder_t *p_dec, block_t *p_block, bool b_flush
 
     while( (p_spu = p_dec->pf_decode_sub( p_dec, p_block ? &p_block : NULL ) ) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_UpdateInteger( p_dec, p_input->p->counters.p_decoded_sub, 1, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
 
         p_vout = input_resource_HoldVout( p_input->p->p_resource );
         if( p_vout && p_owner->p_spu_vout == p_vout )
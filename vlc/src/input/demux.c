@@ -27,6 +27,7 @@
 
 #include "demux.h"
 #include <libvlc.h>
+#include "modules/modules.h"
 #include <vlc_codec.h>
 #include <vlc_meta.h>
 #include <vlc_url.h>
@@ -104,11 +105,18 @@ demux_t *__demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
     if( s ) psz_module = p_demux->psz_demux;
     else psz_module = p_demux->psz_access;
 
-    const char *psz_ext;
+    const char *psz_ext = NULL;
 
-    if( s && *psz_module == '\0'
-     && p_demux->psz_file != NULL
-     && (psz_ext = strrchr( p_demux->psz_file, '.' )) )
+    if( p_demux->psz_file != NULL )
+    {
+        psz_ext = strrchr( p_demux->psz_file, '.' );
+        if( psz_ext != NULL && strchr( psz_ext, DIR_SEP_CHAR ) != NULL )
+            psz_ext = NULL; /* dot in a directory name */
+        if( psz_ext != NULL )
+            psz_ext++; // skip '.'
+    }
+
+    if( s && *psz_module == '\0' && psz_ext != NULL )
     {
        /* XXX: add only file without any problem here and with strong detection.
         *  - no .mp3, .a52, ... (aac is added as it works only by file ext
@@ -150,8 +158,6 @@ demux_t *__demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
             { "", "" }
         };
 
-        psz_ext++; // skip '.'
-
         if( !b_quick )
         {
             for( unsigned i = 0; exttodemux[i].ext[0]; i++ )
@@ -188,9 +194,15 @@ demux_t *__demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
         if( !SkipID3Tag( p_demux ) )
             SkipAPETag( p_demux );
 
+        /* Try the demuxers whose signature matches first */
+        module_probe_t probe = { .psz_ext = psz_ext };
+        int i_peek = stream_Peek( s, &probe.p_peek, MODULE_PROBE_SIZE );
+        probe.i_peek = (i_peek > 0) ? i_peek : 0;
+
         p_demux->p_module =
-            module_need( p_demux, "demux", psz_module,
-                         !strcmp( psz_module, p_demux->psz_demux ) );
+            module_need_probe( p_demux, "demux", psz_module,
+                               !strcmp( psz_module, p_demux->psz_demux ),
+                               &probe );
     }
     else
     {
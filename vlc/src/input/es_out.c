@@ -726,7 +726,7 @@ static void EsOutDecodersChangePause( es_out_t *out, bool b_paused, mtime_t i_da
     }
 }
 
-static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
+static size_t EsOutGetFifoSize( es_out_t *out )
 {
     es_out_sys_t *p_sys = out->p_sys;
 
@@ -740,6 +740,12 @@ static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
         if( p_es->p_dec_record )
             i_size += input_DecoderGetFifoSize( p_es->p_dec_record );
     }
+    return i_size;
+}
+
+static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
+{
+    const size_t i_size = EsOutGetFifoSize( out );
     //msg_Info( out, "----- EsOutIsExtraBufferingAllowed =% 5d KiB -- ", i_size / 1024 );
 
     /* TODO maybe we want to be able to tune it ? */
@@ -1925,7 +1931,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 
     if( libvlc_stats( p_input ) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_UpdateInteger( p_input, p_input->p->counters.p_demux_read,
                              p_block->i_buffer, &i_total );
         stats_UpdateFloat( p_input , p_input->p->counters.p_demux_bitrate,
@@ -1943,7 +1948,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
             stats_UpdateInteger( p_input, p_input->p->counters.p_demux_discontinuity,
                                  1, NULL );
         }
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 
     vlc_mutex_lock( &p_sys->lock );
@@ -2555,6 +2559,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             return VLC_SUCCESS;
         }
 
+        case ES_OUT_GET_FIFO_SIZE:
+        {
+            size_t *pi_size = va_arg( args, size_t* );
+            *pi_size = EsOutGetFifoSize( out );
+            return VLC_SUCCESS;
+        }
+
         case ES_OUT_SET_DELAY:
         {
             const int i_cat = (int)va_arg( args, int );
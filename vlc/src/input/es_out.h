@@ -83,6 +83,9 @@ enum es_out_query_private_e
 
     /* Get forced group */
     ES_OUT_GET_GROUP_FORCED,                        /* arg1=int * res=cannot fail */
+
+    /* Get the size of the data waiting in the decoder fifos */
+    ES_OUT_GET_FIFO_SIZE,                           /* arg1=size_t*             res=cannot fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -106,6 +109,14 @@ static inline bool es_out_GetBuffering( es_out_t *p_out )
     assert( !i_ret );
     return b;
 }
+static inline size_t es_out_GetFifoSize( es_out_t *p_out )
+{
+    size_t i_size;
+    int i_ret = es_out_Control( p_out, ES_OUT_GET_FIFO_SIZE, &i_size );
+
+    assert( !i_ret );
+    return i_size;
+}
 static inline bool es_out_GetEmpty( es_out_t *p_out )
 {
     bool b;
@@ -37,6 +37,9 @@
 #ifdef HAVE_SYS_STAT_H
 #   include <sys/stat.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -46,6 +49,7 @@
 #include <vlc_input.h>
 #include <vlc_es_out.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "input_internal.h"
 #include "es_out.h"
 #include "es_out_timeshift.h"
@@ -151,6 +155,39 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Size of the write batches, blocks bigger than that are written directly */
+#define TS_STORAGE_BATCH (512*1024)
+/* Alignment of the block headers and payloads inside a storage file */
+#define TS_STORAGE_ALIGN(x) (((x) + 15) & ~(size_t)15)
+/* Initial size of the storage file mappings, they grow with the file */
+#define TS_STORAGE_MAP (4*1024*1024)
+
+/* Header written in front of each block payload in the storage file */
+typedef struct
+{
+    mtime_t  i_dts;
+    mtime_t  i_pts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    unsigned i_nb_samples;
+    int      i_rate;
+    uint32_t i_buffer;
+} ts_block_header_t;
+
+/* Mapping of a storage file, shared by the blocks read from it */
+typedef struct
+{
+    vlc_atomic_t refs;
+    uint8_t      *p_base;
+    size_t       i_length;
+} ts_map_t;
+
+typedef struct
+{
+    block_t  self;
+    ts_map_t *p_map;
+} ts_block_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -159,9 +196,17 @@ struct ts_storage_t
     /* */
     char    *psz_file;  /* Filename */
     size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
+    int64_t i_file_size;/* Current size in bytes (including the batch) */
+    int64_t i_file_written; /* Size in bytes already written to the file */
     FILE    *p_filew;   /* FILE handle for data writing */
     FILE    *p_filer;   /* FILE handle for data reading */
+    ts_map_t *p_map;    /* Mapping of the file for zero copy reading, or NULL */
+    bool    b_map_error;/* The file cannot be mapped */
+    bool    b_error;    /* A write failed */
+
+    /* Pending write batch */
+    uint8_t *p_batch;
+    size_t  i_batch;
 
     /* */
     int      i_cmd_r;
@@ -261,7 +306,7 @@ static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
 static void CmdClean( ts_cmd_t * );
@@ -698,6 +743,11 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
         int *pi_group = va_arg( args, int * );
         return es_out_Control( p_sys->p_out, ES_OUT_GET_GROUP_FORCED, pi_group );
     }
+    case ES_OUT_GET_FIFO_SIZE:
+    {
+        size_t *pi_size = va_arg( args, size_t * );
+        return es_out_Control( p_sys->p_out, ES_OUT_GET_FIFO_SIZE, pi_size );
+    }
 
 
     default:
@@ -840,7 +890,7 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_ts->p_storage_w, p_cmd );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -1060,6 +1110,86 @@ static void *TsRun( vlc_object_t *p_thread )
 /*****************************************************************************
  *
  *****************************************************************************/
+#ifdef HAVE_MMAP
+static ts_map_t *TsMapNew( FILE *p_file, size_t i_length )
+{
+    ts_map_t *p_map = malloc( sizeof(*p_map) );
+    if( !p_map )
+        return NULL;
+
+    /* The file is read only up to what has been written, the mapping can thus
+     * extend past its end. It is writable because some decoders modify their
+     * input in place. */
+    void *p_base = mmap( NULL, i_length, PROT_READ|PROT_WRITE, MAP_SHARED,
+                         fileno( p_file ), 0 );
+    if( p_base == MAP_FAILED )
+    {
+        free( p_map );
+        return NULL;
+    }
+    vlc_atomic_set( &p_map->refs, 1 );
+    p_map->p_base = p_base;
+    p_map->i_length = i_length;
+    return p_map;
+}
+static void TsMapRelease( ts_map_t *p_map )
+{
+    if( vlc_atomic_dec( &p_map->refs ) > 0 )
+        return;
+
+    munmap( p_map->p_base, p_map->i_length );
+    free( p_map );
+}
+static void TsMapBlockRelease( block_t *p_block )
+{
+    ts_block_t *p_sys = (ts_block_t *)p_block;
+
+    TsMapRelease( p_sys->p_map );
+    free( p_sys );
+}
+static block_t *TsMapBlockNew( ts_map_t *p_map, size_t i_offset, size_t i_size )
+{
+    ts_block_t *p_sys = malloc( sizeof(*p_sys) );
+    if( !p_sys )
+        return NULL;
+
+    block_Init( &p_sys->self, &p_map->p_base[i_offset], i_size );
+    p_sys->self.pf_release = TsMapBlockRelease;
+    p_sys->p_map = p_map;
+    vlc_atomic_inc( &p_map->refs );
+    return &p_sys->self;
+}
+/* Returns a mapping of the storage file covering its first i_end bytes, or
+ * NULL. The mapping is replaced by one at least twice as large when the file
+ * outgrows it; the blocks still pointing into the old one keep it alive. */
+static ts_map_t *TsStorageMap( ts_storage_t *p_storage, uint64_t i_end )
+{
+    ts_map_t *p_map = p_storage->p_map;
+
+    if( p_map && i_end <= p_map->i_length )
+        return p_map;
+    if( p_storage->b_map_error || i_end > p_storage->i_file_max )
+        return NULL;
+
+    size_t i_length = p_map ? 2 * p_map->i_length : TS_STORAGE_MAP;
+    if( i_length < i_end )
+        i_length = i_end;
+    if( i_length > p_storage->i_file_max )
+        i_length = p_storage->i_file_max;
+
+    p_map = TsMapNew( p_storage->p_filew, i_length );
+    if( !p_map )
+    {
+        p_storage->b_map_error = true;
+        return NULL;
+    }
+    if( p_storage->p_map )
+        TsMapRelease( p_storage->p_map );
+    p_storage->p_map = p_map;
+    return p_map;
+}
+#endif
+
 static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
 {
     ts_storage_t *p_storage = calloc( 1, sizeof(ts_storage_t) );
@@ -1072,9 +1202,17 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     /* */
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
+    p_storage->i_file_written = 0;
     p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
     if( p_storage->psz_file )
         p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    if( p_storage->p_filew )
+    {
+        /* Writes are already batched */
+        setvbuf( p_storage->p_filew, NULL, _IONBF, 0 );
+    }
+    p_storage->i_batch = 0;
+    p_storage->p_batch = malloc( TS_STORAGE_BATCH );
 
     /* */
     p_storage->i_cmd_w = 0;
@@ -1083,7 +1221,8 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
-    if( !p_storage->p_cmd || !p_storage->p_filew || !p_storage->p_filer )
+    if( !p_storage->p_cmd || !p_storage->p_batch ||
+        !p_storage->p_filew || !p_storage->p_filer )
     {
         TsStorageDelete( p_storage );
         return NULL;
@@ -1101,7 +1240,13 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd );
+    free( p_storage->p_batch );
 
+    /* The blocks still in use keep the mapping alive */
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
+        TsMapRelease( p_storage->p_map );
+#endif
     if( p_storage->p_filer )
         fclose( p_storage->p_filer );
     if( p_storage->p_filew )
@@ -1115,8 +1260,128 @@ static void TsStorageDelete( ts_storage_t *p_storage )
 
     free( p_storage );
 }
+static int TsStorageWriteFile( ts_storage_t *p_storage, const void *p_data, size_t i_data )
+{
+    /* After a write error, the file offsets are unknown and nothing more is
+     * written: only what was written before can be read back */
+    if( p_storage->b_error ||
+        fwrite( p_data, i_data, 1, p_storage->p_filew ) != 1 )
+    {
+        p_storage->b_error = true;
+        return VLC_EGENERIC;
+    }
+    p_storage->i_file_written += i_data;
+    return VLC_SUCCESS;
+}
+static int TsStorageFlush( ts_storage_t *p_storage )
+{
+    const size_t i_batch = p_storage->i_batch;
+
+    if( i_batch == 0 )
+        return VLC_SUCCESS;
+
+    p_storage->i_batch = 0;
+    return TsStorageWriteFile( p_storage, p_storage->p_batch, i_batch );
+}
+static int TsStorageWrite( ts_storage_t *p_storage, const void *p_data, size_t i_data )
+{
+    const size_t i_size = TS_STORAGE_ALIGN( i_data );
+
+    if( p_storage->b_error )
+        return VLC_EGENERIC;
+    if( i_data == 0 )
+        return VLC_SUCCESS;
+
+    if( p_storage->i_batch + i_size > TS_STORAGE_BATCH &&
+        TsStorageFlush( p_storage ) )
+        return VLC_EGENERIC;
+
+    if( i_size > TS_STORAGE_BATCH )
+    {
+        /* Too big to be batched, the padding goes in the next batch */
+        if( TsStorageWriteFile( p_storage, p_data, i_data ) )
+            return VLC_EGENERIC;
+    }
+    else
+    {
+        memcpy( &p_storage->p_batch[p_storage->i_batch], p_data, i_data );
+        p_storage->i_batch += i_data;
+    }
+    memset( &p_storage->p_batch[p_storage->i_batch], 0, i_size - i_data );
+    p_storage->i_batch += i_size - i_data;
+    p_storage->i_file_size += i_size;
+    return VLC_SUCCESS;
+}
+static int TsStorageSync( ts_storage_t *p_storage, int64_t i_end )
+{
+    /* Makes sure that the data up to i_end are in the file */
+    if( i_end > p_storage->i_file_written &&
+        ( TsStorageFlush( p_storage ) || i_end > p_storage->i_file_written ) )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+static int TsStorageRead( ts_storage_t *p_storage, void *p_data,
+                          int64_t i_offset, size_t i_data )
+{
+    if( TsStorageSync( p_storage, i_offset + i_data ) )
+        return VLC_EGENERIC;
+
+#ifdef HAVE_MMAP
+    ts_map_t *p_map = TsStorageMap( p_storage, (uint64_t)i_offset + i_data );
+    if( p_map )
+    {
+        memcpy( p_data, &p_map->p_base[i_offset], i_data );
+        return VLC_SUCCESS;
+    }
+#endif
+    if( fseek( p_storage->p_filer, i_offset, SEEK_SET ) ||
+        fread( p_data, i_data, 1, p_storage->p_filer ) != 1 )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+static block_t *TsStorageReadBlock( ts_storage_t *p_storage, int64_t i_offset )
+{
+    ts_block_header_t header;
+
+    if( TsStorageRead( p_storage, &header, i_offset, sizeof(header) ) )
+        return NULL;
+    i_offset += TS_STORAGE_ALIGN( sizeof(header) );
+
+    if( TsStorageSync( p_storage, i_offset + header.i_buffer ) )
+        return NULL;
+
+    block_t *p_block = NULL;
+#ifdef HAVE_MMAP
+    /* Zero copy from the mapping */
+    ts_map_t *p_map = TsStorageMap( p_storage,
+                                    (uint64_t)i_offset + header.i_buffer );
+    if( p_map )
+        p_block = TsMapBlockNew( p_map, i_offset, header.i_buffer );
+#endif
+    if( !p_block )
+    {
+        p_block = block_Alloc( header.i_buffer );
+        if( !p_block )
+            return NULL;
+        if( header.i_buffer > 0 &&
+            TsStorageRead( p_storage, p_block->p_buffer, i_offset, header.i_buffer ) )
+            p_block->i_buffer = 0;
+    }
+    p_block->i_dts      = header.i_dts;
+    p_block->i_pts      = header.i_pts;
+    p_block->i_flags    = header.i_flags;
+    p_block->i_length   = header.i_length;
+    p_block->i_rate     = header.i_rate;
+    p_block->i_nb_samples = header.i_nb_samples;
+    return p_block;
+}
 static void TsStoragePack( ts_storage_t *p_storage )
 {
+    /* No more writes will happen */
+    TsStorageFlush( p_storage );
+    free( p_storage->p_batch );
+    p_storage->p_batch = NULL;
+
     /* Try to release a bit of memory */
     if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
         return;
@@ -1131,7 +1396,8 @@ static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = TS_STORAGE_ALIGN( sizeof(ts_block_header_t) ) +
+                        TS_STORAGE_ALIGN( p_cmd->u.send.p_block->i_buffer );
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1142,7 +1408,7 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     ts_cmd_t cmd = *p_cmd;
 
@@ -1151,29 +1417,26 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const ts_block_header_t header = {
+            .i_dts = p_block->i_dts,
+            .i_pts = p_block->i_pts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_rate = p_block->i_rate,
+            .i_buffer = p_block->i_buffer,
+        };
 
         cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
+        cmd.u.send.i_offset = p_storage->i_file_size;
 
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        if( TsStorageWrite( p_storage, &header, sizeof(header) ) ||
+            TsStorageWrite( p_storage, p_block->p_buffer, p_block->i_buffer ) )
         {
             block_Release( p_block );
             return;
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
-        }
-        p_storage->i_file_size += p_block->i_buffer;
         block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
@@ -1184,30 +1447,16 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        block_t *p_block = NULL;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
-        {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_rate     = block.i_rate;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
-        }
-        else
+        if( !b_flush )
+            p_block = TsStorageReadBlock( p_storage, p_cmd->u.send.i_offset );
+        if( !p_block )
         {
             //fprintf( stderr, "TsStoragePopCmd: %m\n" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            p_block = block_Alloc( 1 );
         }
+        p_cmd->u.send.p_block = p_block;
     }
 }
 
@@ -3208,7 +3208,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
 {
     assert( p_input->p->i_state != INIT_S );
 
-    vlc_mutex_lock( &p_input->p->counters.counters_lock);
     switch( i_type )
     {
 #define I(c) stats_UpdateInteger( p_input, p_input->p->counters.c, i_delta, NULL )
@@ -3237,7 +3236,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
         msg_Err( p_input, "Invalid statistic type %d (internal error)", i_type );
         break;
     }
-    vlc_mutex_unlock( &p_input->p->counters.counters_lock);
 }
 
 /**/
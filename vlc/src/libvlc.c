@@ -996,6 +996,11 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     /* Free playlist now, all threads are gone */
     playlist_Destroy( p_playlist );
 
+    uint64_t i_block_hits, i_block_misses;
+    block_PoolStats( &i_block_hits, &i_block_misses );
+    msg_Dbg( p_libvlc, "block pool: %"PRIu64" hits, %"PRIu64" misses",
+             i_block_hits, i_block_misses );
+
 #if defined(MEDIA_LIBRARY)
     media_library_t* p_ml = priv->p_ml;
     if( p_ml )
@@ -1060,6 +1065,7 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
     {
         /* System specific cleaning code */
         system_End( p_libvlc );
+        block_PoolCleanup();
     }
     vlc_mutex_unlock( &global_lock );
 
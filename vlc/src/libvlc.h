@@ -60,6 +60,37 @@ int vlc_object_waitpipe (vlc_object_t *obj);
 
 void vlc_threads_setup (libvlc_int_t *);
 
+/**
+ * Pool of worker threads, started with the first reference and stopped with
+ * the last one. Each thread calls pf_run() in a loop with the lock held;
+ * pf_run() either does some work, possibly unlocking meanwhile, or waits on
+ * the wait condition.
+ * The threads are detached: they exit on their own once stopped, so that the
+ * last reference can be released from one of them.
+ */
+#define VLC_WORKERS_MAX 16
+
+typedef struct vlc_workers_t
+{
+    vlc_mutex_t   lock; /**< protects the pool and the work data */
+    vlc_cond_t    wait; /**< wakes the threads up */
+    vlc_cond_t    done; /**< signals the end of some work */
+    void        (*pf_run) (struct vlc_workers_t *);
+    void        (*pf_stop) (struct vlc_workers_t *); /**< last release, or NULL */
+
+    unsigned      refs;
+    unsigned      count; /**< number of running threads */
+    unsigned      exiting; /**< number of stopped threads yet to exit */
+    bool          initialized;
+} vlc_workers_t;
+
+#define VLC_WORKERS_INITIALIZER(run, stop) \
+    { .lock = VLC_STATIC_MUTEX, .pf_run = run, .pf_stop = stop, \
+      .initialized = false, }
+
+int vlc_workers_hold (vlc_workers_t *, unsigned count, int priority);
+void vlc_workers_release (vlc_workers_t *);
+
 void vlc_trace (const char *fn, const char *file, unsigned line);
 #define vlc_backtrace() vlc_trace(__func__, __FILE__, __LINE__)
 
@@ -76,6 +107,18 @@ extern uint32_t cpu_flags;
 uint32_t CPUCapabilities( void );
 bool vlc_CPU_CheckPluginDir (const char *name);
 
+/*
+ * Block pool
+ */
+void block_PoolStats (uint64_t *hits, uint64_t *misses);
+void block_PoolCleanup (void);
+
+/*
+ * Video filters slice threads
+ */
+struct filter_slices_t *filter_slices_Hold (vlc_object_t *);
+void filter_slices_Release (struct filter_slices_t *);
+
 /*
  * Message/logging stuff
  */
@@ -157,7 +200,10 @@ struct vlc_object_internals
     char           *psz_name; /* given name */
 
     /* Object variables */
-    void           *var_root;
+    variable_t    **var_table; /* open addressing hash table */
+    unsigned        var_count;
+    unsigned        var_mask; /* table size - 1 */
+    void           *var_cache; /* owners of inherited variables */
     vlc_mutex_t     var_lock;
     vlc_cond_t      var_wait;
 
@@ -267,7 +313,7 @@ int stats_Get (vlc_object_t*, counter_t *, vlc_value_t*);
 void stats_CounterClean (counter_t * );
 
 static inline int stats_GetInteger( vlc_object_t *p_obj, counter_t *p_counter,
-                                    int *value )
+                                    int64_t *value )
 {
     int i_ret;
     vlc_value_t val; val.i_int = 0;
@@ -32,7 +32,9 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <vlc_atomic.h>
 #include "vlc_block.h"
+#include "../libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -45,6 +47,7 @@ struct block_sys_t
 {
     block_t     self;
     size_t      i_allocated_buffer;
+    unsigned    i_class; /**< pool size class, or BLOCK_POOL_CLASSES */
     uint8_t     p_allocated_buffer[];
 };
 
@@ -73,9 +76,348 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
+/**
+ * @section Block pool
+ *
+ * Heap blocks are recycled through a small set of size classes rather than
+ * going back to malloc() and free() each time. Every thread keeps a loaded
+ * and a previous magazine of free blocks per class, so that allocation and
+ * release normally do not take any lock. Full and empty magazines are
+ * exchanged with a global depot, whose size is bounded per class.
+ */
+
+/* Number of size classes (blocks larger than the last class are not pooled) */
+#define BLOCK_POOL_CLASSES 4
+/* Number of free blocks per magazine */
+#define BLOCK_MAGAZINE_SIZE 32
+/* Approximate maximum bytes of free blocks kept in the depot per class */
+#define BLOCK_DEPOT_BYTES  (1 << 22)
+/* Maximum number of empty magazines kept in the depot */
+#define BLOCK_DEPOT_EMPTY  16
+
+/* Total allocation size (including block_sys_t) of each size class */
+static const size_t block_class_size[BLOCK_POOL_CLASSES] = {
+    512, 2048, 8192, 32768
+};
+
+typedef struct block_magazine_t block_magazine_t;
+
+struct block_magazine_t
+{
+    block_magazine_t *p_next;
+    unsigned          i_rounds;
+    block_sys_t      *pp_rounds[BLOCK_MAGAZINE_SIZE];
+};
+
+/** Per-thread block cache */
+typedef struct
+{
+    block_magazine_t *p_loaded[BLOCK_POOL_CLASSES];
+    block_magazine_t *p_previous[BLOCK_POOL_CLASSES];
+    uint64_t          i_hits;
+    uint64_t          i_misses;
+} block_cache_t;
+
+static struct
+{
+    vlc_mutex_t       lock;
+    vlc_threadvar_t   key;
+    vlc_atomic_t      ready; /* 0: not initialized, 1: ready, 2: failed */
+
+    block_magazine_t *p_full[BLOCK_POOL_CLASSES]; /**< depot of full mags */
+    unsigned          i_full[BLOCK_POOL_CLASSES];
+    block_magazine_t *p_empty; /**< depot of empty magazines */
+    unsigned          i_empty;
+
+    uint64_t          i_hits;
+    uint64_t          i_misses;
+} block_pool = { .lock = VLC_STATIC_MUTEX, };
+
+static unsigned BlockPoolClass( size_t i_alloc )
+{
+#ifndef OPTIMIZE_MEMORY
+    for( unsigned i = 0; i < BLOCK_POOL_CLASSES; i++ )
+        if( i_alloc <= block_class_size[i] )
+            return i;
+#else
+    (void) i_alloc;
+#endif
+    return BLOCK_POOL_CLASSES;
+}
+
+static unsigned BlockDepotMax( unsigned i_class )
+{
+    size_t max = BLOCK_DEPOT_BYTES
+               / (block_class_size[i_class] * BLOCK_MAGAZINE_SIZE);
+    return max > 0 ? max : 1;
+}
+
+static void BlockMagazineFree( block_magazine_t *p_mag )
+{
+    for( unsigned i = 0; i < p_mag->i_rounds; i++ )
+        free( p_mag->pp_rounds[i] );
+    free( p_mag );
+}
+
+/* Hands a magazine (full or not) over to the depot. Pool lock must be held. */
+static void BlockDepotPut( unsigned i_class, block_magazine_t *p_mag )
+{
+    if( p_mag->i_rounds == 0 )
+    {
+        if( block_pool.i_empty < BLOCK_DEPOT_EMPTY )
+        {
+            p_mag->p_next = block_pool.p_empty;
+            block_pool.p_empty = p_mag;
+            block_pool.i_empty++;
+        }
+        else
+            free( p_mag );
+    }
+    else if( block_pool.i_full[i_class] < BlockDepotMax( i_class ) )
+    {
+        p_mag->p_next = block_pool.p_full[i_class];
+        block_pool.p_full[i_class] = p_mag;
+        block_pool.i_full[i_class]++;
+    }
+    else
+        BlockMagazineFree( p_mag );
+}
+
+/* Flushes the per-thread statistics. Pool lock must be held. */
+static void BlockCacheFlushStats( block_cache_t *p_cache )
+{
+    block_pool.i_hits += p_cache->i_hits;
+    block_pool.i_misses += p_cache->i_misses;
+    p_cache->i_hits = p_cache->i_misses = 0;
+}
+
+/* Thread-specific variable destructor */
+static void BlockCacheRelease( void *data )
+{
+    block_cache_t *p_cache = data;
+
+    vlc_mutex_lock( &block_pool.lock );
+    for( unsigned i = 0; i < BLOCK_POOL_CLASSES; i++ )
+    {
+        if( p_cache->p_loaded[i] != NULL )
+            BlockDepotPut( i, p_cache->p_loaded[i] );
+        if( p_cache->p_previous[i] != NULL )
+            BlockDepotPut( i, p_cache->p_previous[i] );
+    }
+    BlockCacheFlushStats( p_cache );
+    vlc_mutex_unlock( &block_pool.lock );
+    free( p_cache );
+}
+
+static block_cache_t *BlockCacheGet( void )
+{
+    uintptr_t ready = vlc_atomic_get( &block_pool.ready );
+
+    if( unlikely(ready != 1) )
+    {
+        if( ready == 2 )
+            return NULL;
+
+        vlc_mutex_lock( &block_pool.lock );
+        if( vlc_atomic_get( &block_pool.ready ) == 0 )
+            vlc_atomic_set( &block_pool.ready,
+                vlc_threadvar_create( &block_pool.key, BlockCacheRelease )
+                    ? 2 : 1 );
+        ready = vlc_atomic_get( &block_pool.ready );
+        vlc_mutex_unlock( &block_pool.lock );
+        if( ready != 1 )
+            return NULL;
+    }
+
+    block_cache_t *p_cache = vlc_threadvar_get( block_pool.key );
+    if( unlikely(p_cache == NULL) )
+    {
+        p_cache = calloc( 1, sizeof(*p_cache) );
+        if( p_cache == NULL )
+            return NULL;
+        if( vlc_threadvar_set( block_pool.key, p_cache ) )
+        {
+            free( p_cache );
+            return NULL;
+        }
+    }
+    return p_cache;
+}
+
+/**
+ * Takes a free block of the given class from the pool.
+ * @return a recycled block, or a new heap allocation (NULL on error).
+ */
+static block_sys_t *BlockPoolGet( unsigned i_class )
+{
+    block_cache_t *p_cache = BlockCacheGet();
+    if( p_cache == NULL )
+        return malloc( block_class_size[i_class] );
+
+    block_magazine_t *p_mag = p_cache->p_loaded[i_class];
+    if( p_mag == NULL || p_mag->i_rounds == 0 )
+    {
+        block_magazine_t *p_prev = p_cache->p_previous[i_class];
+
+        if( p_prev != NULL && p_prev->i_rounds > 0 )
+        {   /* Swap loaded and previous magazines */
+            p_cache->p_previous[i_class] = p_mag;
+            p_cache->p_loaded[i_class] = p_mag = p_prev;
+        }
+        else
+        {   /* Exchange the empty magazine for a full one from the depot */
+            vlc_mutex_lock( &block_pool.lock );
+            BlockCacheFlushStats( p_cache );
+            block_magazine_t *p_full = block_pool.p_full[i_class];
+            if( p_full != NULL )
+            {
+                block_pool.p_full[i_class] = p_full->p_next;
+                block_pool.i_full[i_class]--;
+                if( p_prev != NULL )
+                    BlockDepotPut( i_class, p_prev );
+                p_cache->p_previous[i_class] = p_mag;
+                p_cache->p_loaded[i_class] = p_mag = p_full;
+            }
+            vlc_mutex_unlock( &block_pool.lock );
+
+            if( p_full == NULL )
+            {
+                p_cache->i_misses++;
+                return malloc( block_class_size[i_class] );
+            }
+        }
+    }
+
+    p_cache->i_hits++;
+    return p_mag->pp_rounds[--p_mag->i_rounds];
+}
+
+/**
+ * Gives a block back to the pool of its class.
+ */
+static void BlockPoolPut( block_sys_t *p_sys )
+{
+    const unsigned i_class = p_sys->i_class;
+    block_cache_t *p_cache = BlockCacheGet();
+    if( p_cache == NULL )
+    {
+        free( p_sys );
+        return;
+    }
+
+    block_magazine_t *p_mag = p_cache->p_loaded[i_class];
+    if( p_mag == NULL || p_mag->i_rounds == BLOCK_MAGAZINE_SIZE )
+    {
+        block_magazine_t *p_prev = p_cache->p_previous[i_class];
+
+        if( p_prev != NULL && p_prev->i_rounds < BLOCK_MAGAZINE_SIZE )
+        {   /* Swap loaded and previous magazines */
+            p_cache->p_previous[i_class] = p_mag;
+            p_cache->p_loaded[i_class] = p_mag = p_prev;
+        }
+        else
+        {   /* Exchange the full magazine for an empty one from the depot */
+            vlc_mutex_lock( &block_pool.lock );
+            block_magazine_t *p_empty = block_pool.p_empty;
+            if( p_empty != NULL )
+            {
+                block_pool.p_empty = p_empty->p_next;
+                block_pool.i_empty--;
+            }
+            vlc_mutex_unlock( &block_pool.lock );
+
+            if( p_empty == NULL )
+            {
+                p_empty = malloc( sizeof(*p_empty) );
+                if( p_empty == NULL )
+                {
+                    free( p_sys );
+                    return;
+                }
+            }
+            p_empty->i_rounds = 0;
+
+            if( p_prev != NULL )
+            {
+                vlc_mutex_lock( &block_pool.lock );
+                BlockDepotPut( i_class, p_prev );
+                vlc_mutex_unlock( &block_pool.lock );
+            }
+            p_cache->p_previous[i_class] = p_mag;
+            p_cache->p_loaded[i_class] = p_mag = p_empty;
+        }
+    }
+
+    p_mag->pp_rounds[p_mag->i_rounds++] = p_sys;
+}
+
+/**
+ * Reports block pool statistics: the number of block allocations served from
+ * the pool, and the number of allocations that had to fall back to the heap.
+ * Counters of running threads are only accounted for periodically.
+ */
+void block_PoolStats( uint64_t *pi_hits, uint64_t *pi_misses )
+{
+    vlc_mutex_lock( &block_pool.lock );
+    *pi_hits = block_pool.i_hits;
+    *pi_misses = block_pool.i_misses;
+    vlc_mutex_unlock( &block_pool.lock );
+}
+
+/**
+ * Frees the magazines of the depot and those of the calling thread.
+ * Other threads give their magazines back to the depot when they exit.
+ */
+void block_PoolCleanup( void )
+{
+    block_cache_t *p_cache = NULL;
+
+    vlc_mutex_lock( &block_pool.lock );
+    if( vlc_atomic_get( &block_pool.ready ) == 1 )
+        p_cache = vlc_threadvar_get( block_pool.key );
+    if( p_cache != NULL )
+    {
+        for( unsigned i = 0; i < BLOCK_POOL_CLASSES; i++ )
+        {
+            if( p_cache->p_loaded[i] != NULL )
+                BlockMagazineFree( p_cache->p_loaded[i] );
+            if( p_cache->p_previous[i] != NULL )
+                BlockMagazineFree( p_cache->p_previous[i] );
+            p_cache->p_loaded[i] = p_cache->p_previous[i] = NULL;
+        }
+        BlockCacheFlushStats( p_cache );
+    }
+
+    for( unsigned i = 0; i < BLOCK_POOL_CLASSES; i++ )
+    {
+        while( block_pool.p_full[i] != NULL )
+        {
+            block_magazine_t *p_mag = block_pool.p_full[i];
+
+            block_pool.p_full[i] = p_mag->p_next;
+            BlockMagazineFree( p_mag );
+        }
+        block_pool.i_full[i] = 0;
+    }
+    while( block_pool.p_empty != NULL )
+    {
+        block_magazine_t *p_mag = block_pool.p_empty;
+
+        block_pool.p_empty = p_mag->p_next;
+        free( p_mag );
+    }
+    block_pool.i_empty = 0;
+    vlc_mutex_unlock( &block_pool.lock );
+}
+
 static void BlockRelease( block_t *p_block )
 {
-    free( p_block );
+    block_sys_t *p_sys = (block_sys_t *)p_block;
+
+    if( p_sys->i_class < BLOCK_POOL_CLASSES )
+        BlockPoolPut( p_sys );
+    else
+        free( p_sys );
 }
 
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
@@ -96,16 +438,28 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /* Maximum size of reserved footer before we release with realloc() */
 #define BLOCK_WASTE_SIZE   2048
 
+#define ALIGN(x) (((x) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+
+/* Size class of a heap block with i_size bytes of payload */
+static unsigned BlockClass( size_t i_size )
+{
+    const size_t i_alloc = sizeof(block_sys_t) + BLOCK_ALIGN
+                         + (2 * BLOCK_PADDING) + ALIGN(i_size);
+
+    if( unlikely(i_alloc < i_size) ) /* integer overflow */
+        return BLOCK_POOL_CLASSES;
+    return BlockPoolClass( i_alloc );
+}
+
 block_t *block_Alloc( size_t i_size )
 {
-    /* We do only one malloc
-     * TODO: bench if doing 2 malloc but keeping a pool of buffer is better
+    /* We do only one allocation, from the block pool if the block is small
+     * enough, otherwise from the heap.
      * 2 * BLOCK_PADDING -> pre + post padding
      */
     block_sys_t *p_sys;
     uint8_t *buf;
 
-#define ALIGN(x) (((x) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
 #if 0 /*def HAVE_POSIX_MEMALIGN */
     /* posix_memalign(,16,) is much slower than malloc() on glibc.
      * -- Courmisch, September 2009, glibc 2.5 & 2.9 */
@@ -117,14 +471,26 @@ block_t *block_Alloc( size_t i_size )
         return NULL;
 
     p_sys = ptr;
+    p_sys->i_class = BLOCK_POOL_CLASSES;
     buf = p_sys->p_allocated_buffer + (-sizeof(*p_sys) & (BLOCK_ALIGN - 1));
 
 #else
-    const size_t i_alloc = sizeof(*p_sys) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                         + ALIGN(i_size);
-    p_sys = malloc( i_alloc );
+    size_t i_alloc = sizeof(*p_sys) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                   + ALIGN(i_size);
+    if( unlikely(i_alloc < i_size) ) /* integer overflow */
+        return NULL;
+
+    unsigned i_class = BlockPoolClass( i_alloc );
+    if( i_class < BLOCK_POOL_CLASSES )
+    {
+        i_alloc = block_class_size[i_class];
+        p_sys = BlockPoolGet( i_class );
+    }
+    else
+        p_sys = malloc( i_alloc );
     if( p_sys == NULL )
         return NULL;
+    p_sys->i_class = i_class;
 
     buf = (void *)ALIGN((uintptr_t)p_sys->p_allocated_buffer);
 
@@ -231,7 +597,9 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     else
     /* We have a very large reserved footer now? Release some of it.
      * XXX it might not preserve the alignment of p_buffer */
-    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE )
+    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE
+     && ( p_sys->i_class == BLOCK_POOL_CLASSES
+       || BlockClass( requested ) != p_sys->i_class ) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
@@ -464,6 +832,8 @@ block_t *block_File (int fd)
  * @section Thread-safe block queue functions
  */
 
+typedef struct block_spsc_t block_spsc_t;
+
 /**
  * Internal state for block queues
  */
@@ -478,6 +848,8 @@ struct block_fifo_t
     size_t              i_depth;
     size_t              i_size;
     bool          b_force_wake;
+
+    block_spsc_t        *p_spsc; /**< Lock-less state, or NULL */
 };
 
 block_fifo_t *block_FifoNew( void )
@@ -493,12 +865,350 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
     p_fifo->b_force_wake = false;
+    p_fifo->p_spsc = NULL;
 
     return p_fifo;
 }
 
+/*
+ * Single producer, single consumer queues
+ *
+ * Blocks (or chains of blocks) are passed through a ring of pointers, where
+ * an empty slot is NULL: the producer fills the slots and the consumer
+ * empties them, so that neither needs to see the index of the other.
+ * When the ring is full, the producer moves on to a ring twice as large,
+ * and the consumer frees the old ring once it has drained it.
+ *
+ * Each side only writes its own counters. The queue depth and size are
+ * computed from their differences. Emptying the queue from the producer
+ * side only records how many blocks to discard; the consumer discards them.
+ *
+ * The mutex and condition variables of the FIFO are only used to park and
+ * wake up a thread which has to wait, as announced by its waiting flag.
+ */
+#define BLOCK_SPSC_RING 256 /* initial ring size (power of two) */
+
+typedef struct block_ring_t
+{
+    struct block_ring_t *volatile next; /**< Next ring of the producer */
+    size_t               mask;
+    block_t     *volatile slots[];
+} block_ring_t;
+
+struct block_spsc_t
+{
+    /* Producer side */
+    block_ring_t      *p_tail;
+    size_t             i_write;
+    volatile uintptr_t i_pushed, i_pushed_bytes;
+    volatile uintptr_t i_flushed, i_flushed_bytes; /**< Values at last flush */
+    volatile bool      b_pacing;                  /**< Producer waits */
+    volatile bool      b_wake;                    /**< block_FifoWake() */
+
+    uint8_t            pad[64]; /* keep sides on different cache lines */
+
+    /* Consumer side */
+    block_ring_t      *p_head;
+    size_t             i_read;
+    block_t           *p_chain;        /**< Rest of the last dequeued chain */
+    volatile uintptr_t i_popped, i_popped_bytes;
+    volatile bool      b_waiting;                 /**< Consumer waits */
+};
+
+static block_ring_t *block_RingNew( size_t size )
+{
+    block_ring_t *ring = malloc( sizeof( *ring ) + size * sizeof( block_t * ) );
+    if( unlikely(ring == NULL) )
+        return NULL;
+
+    ring->next = NULL;
+    ring->mask = size - 1;
+    for( size_t i = 0; i < size; i++ )
+        ring->slots[i] = NULL;
+    return ring;
+}
+
+/**
+ * Creates a FIFO which must have at most one thread putting blocks (and
+ * pacing or emptying the FIFO) and one thread getting (or showing) blocks
+ * at any time. Putting and getting blocks do not take any lock, unless the
+ * other thread has to be woken up.
+ *
+ * The other functions can be used as with block_FifoNew(). Note that
+ * block_FifoEmpty() defers the deletion of the blocks to the consumer thread.
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( p_fifo == NULL )
+        return NULL;
+
+    block_spsc_t *q = malloc( sizeof( *q ) );
+    block_ring_t *ring = block_RingNew( BLOCK_SPSC_RING );
+    if( unlikely(q == NULL || ring == NULL) )
+    {
+        free( ring );
+        free( q );
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+
+    memset( q, 0, sizeof( *q ) );
+    q->p_tail = q->p_head = ring;
+    p_fifo->p_spsc = q;
+    return p_fifo;
+}
+
+/* Number of blocks and bytes in the queue, from any thread */
+static size_t SpscCount( const block_spsc_t *q, size_t *pi_size )
+{
+    /* Read the consumer and flush counters first: they never exceed the
+     * producer counters. */
+    uintptr_t popped = q->i_popped, popped_bytes = q->i_popped_bytes;
+    uintptr_t flushed = q->i_flushed, flushed_bytes = q->i_flushed_bytes;
+
+    barrier();
+    if( (intptr_t)(flushed - popped) > 0 )
+    {
+        popped = flushed;
+        popped_bytes = flushed_bytes;
+    }
+    if( pi_size != NULL )
+        *pi_size = q->i_pushed_bytes - popped_bytes;
+    return q->i_pushed - popped;
+}
+
+static void SpscWakeConsumer( block_fifo_t *p_fifo )
+{
+    /* Pairs with the barrier in SpscWait() */
+    barrier();
+    if( p_fifo->p_spsc->b_waiting )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_signal( &p_fifo->wait );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+}
+
+static size_t SpscPut( block_fifo_t *p_fifo, block_t *p_block )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+    block_ring_t *ring = q->p_tail;
+    size_t i_size = 0, i_depth = 0;
+
+    for( block_t *b = p_block; b != NULL; b = b->p_next )
+    {
+        i_size += b->i_buffer;
+        i_depth++;
+    }
+
+    if( ring->slots[q->i_write & ring->mask] != NULL )
+    {   /* Full ring: move on to a larger one */
+        block_ring_t *next = block_RingNew( 2 * (ring->mask + 1) );
+        if( unlikely(next == NULL) )
+        {
+            block_ChainRelease( p_block );
+            return 0;
+        }
+
+        barrier(); /* last slot before the next ring */
+        ring->next = next;
+        q->p_tail = ring = next;
+        q->i_write = 0;
+    }
+
+    barrier(); /* block contents before the slot */
+    ring->slots[q->i_write++ & ring->mask] = p_block;
+    q->i_pushed_bytes += i_size;
+    q->i_pushed += i_depth;
+
+    SpscWakeConsumer( p_fifo );
+    return i_size;
+}
+
+/* Gets the next chain of blocks from the rings, consumer side, no wait */
+static block_t *SpscChain( block_spsc_t *q )
+{
+    if( q->p_chain != NULL )
+        return q->p_chain;
+
+    for( ;; )
+    {
+        block_ring_t *ring = q->p_head;
+        size_t i = q->i_read & ring->mask;
+        block_t *p_block = ring->slots[i];
+
+        if( p_block == NULL )
+        {
+            block_ring_t *next = ring->next;
+            if( next == NULL )
+                return NULL; /* empty */
+
+            barrier(); /* the next ring before the last slot */
+            p_block = ring->slots[i];
+            if( p_block == NULL )
+            {   /* The producer has left this ring, and it is drained */
+                free( ring );
+                q->p_head = next;
+                q->i_read = 0;
+                continue;
+            }
+        }
+
+        ring->slots[i] = NULL;
+        q->i_read++;
+        q->p_chain = p_block;
+        return p_block;
+    }
+}
+
+/* Dequeues one block without waiting, consumer side */
+static block_t *SpscPop( block_spsc_t *q )
+{
+    block_t *b = SpscChain( q );
+    if( b == NULL )
+        return NULL;
+
+    q->p_chain = b->p_next;
+    b->p_next = NULL;
+    q->i_popped_bytes += b->i_buffer;
+    q->i_popped++;
+    return b;
+}
+
+/* Discards the blocks emptied by the producer, consumer side */
+static void SpscDiscard( block_fifo_t *p_fifo )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+    uintptr_t flushed = q->i_flushed;
+
+    if( likely(flushed == q->i_popped) )
+        return;
+
+    barrier();
+    while( (intptr_t)(flushed - q->i_popped) > 0 )
+    {
+        block_t *b = SpscPop( q );
+        assert( b != NULL ); /* the producer queued these already */
+        block_Release( b );
+    }
+}
+
+static void SpscWakeProducer( block_fifo_t *p_fifo )
+{
+    /* Pairs with the barrier in SpscPace() */
+    barrier();
+    if( p_fifo->p_spsc->b_pacing )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_signal( &p_fifo->wait_room );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+}
+
+static void SpscWaitCleanup( void *data )
+{
+    block_fifo_t *p_fifo = data;
+
+    p_fifo->p_spsc->b_waiting = false;
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
+/* Waits for a block (or a wake up if requested), consumer side */
+static void SpscWait( block_fifo_t *p_fifo, bool b_wakeable )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    q->b_waiting = true;
+    vlc_cleanup_push( SpscWaitCleanup, p_fifo );
+    /* Pairs with the barrier in SpscWakeConsumer() */
+    barrier();
+    while( SpscChain( q ) == NULL && !(b_wakeable && q->b_wake) )
+        vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+    vlc_cleanup_run();
+}
+
+static block_t *SpscGet( block_fifo_t *p_fifo, bool b_remove )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+
+    for( ;; )
+    {
+        SpscDiscard( p_fifo );
+
+        block_t *b = b_remove ? SpscPop( q ) : SpscChain( q );
+        if( b != NULL )
+        {
+            if( b_remove )
+                SpscWakeProducer( p_fifo );
+            q->b_wake = false;
+            return b;
+        }
+
+        if( b_remove && q->b_wake )
+        {   /* Forced wakeup */
+            q->b_wake = false;
+            return NULL;
+        }
+        SpscWait( p_fifo, b_remove );
+    }
+}
+
+static void SpscPaceCleanup( void *data )
+{
+    block_fifo_t *p_fifo = data;
+
+    p_fifo->p_spsc->b_pacing = false;
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
+static void SpscPace( block_fifo_t *p_fifo, size_t max_depth, size_t max_size )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+    size_t i_size;
+
+    if( SpscCount( q, &i_size ) <= max_depth && i_size <= max_size )
+        return;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    q->b_pacing = true;
+    vlc_cleanup_push( SpscPaceCleanup, p_fifo );
+    /* Pairs with the barrier in SpscWakeProducer() */
+    barrier();
+    while( SpscCount( q, &i_size ) > max_depth || i_size > max_size )
+        vlc_cond_wait( &p_fifo->wait_room, &p_fifo->lock );
+    vlc_cleanup_run();
+}
+
+static void SpscEmpty( block_fifo_t *p_fifo )
+{
+    block_spsc_t *q = p_fifo->p_spsc;
+
+    /* The consumer discards everything queued so far on its next call */
+    q->i_flushed_bytes = q->i_pushed_bytes;
+    barrier();
+    q->i_flushed = q->i_pushed;
+}
+
+static void SpscRelease( block_spsc_t *q )
+{
+    block_t *b;
+
+    /* Neither the producer nor the consumer are running anymore */
+    while( (b = SpscPop( q )) != NULL )
+        block_Release( b );
+    free( q->p_head );
+    free( q );
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+    {
+        SpscRelease( p_fifo->p_spsc );
+        p_fifo->p_spsc = NULL;
+    }
     block_FifoEmpty( p_fifo );
     vlc_cond_destroy( &p_fifo->wait_room );
     vlc_cond_destroy( &p_fifo->wait );
@@ -510,6 +1220,12 @@ void block_FifoEmpty( block_fifo_t *p_fifo )
 {
     block_t *block;
 
+    if( p_fifo->p_spsc != NULL )
+    {
+        SpscEmpty( p_fifo );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     block = p_fifo->p_first;
     if (block != NULL)
@@ -552,6 +1268,12 @@ void block_FifoPace (block_fifo_t *fifo, size_t max_depth, size_t max_size)
 {
     vlc_testcancel ();
 
+    if (fifo->p_spsc != NULL)
+    {
+        SpscPace (fifo, max_depth, max_size);
+        return;
+    }
+
     vlc_mutex_lock (&fifo->lock);
     while ((fifo->i_depth > max_depth) || (fifo->i_size > max_size))
     {
@@ -575,6 +1297,8 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 
     if (p_block == NULL)
         return 0;
+    if (p_fifo->p_spsc != NULL)
+        return SpscPut (p_fifo, p_block);
     for (p_last = p_block; ; p_last = p_last->p_next)
     {
         i_size += p_last->i_buffer;
@@ -597,6 +1321,14 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 
 void block_FifoWake( block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+    {
+        if( SpscCount( p_fifo->p_spsc, NULL ) == 0 )
+            p_fifo->p_spsc->b_wake = true;
+        SpscWakeConsumer( p_fifo );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     if( p_fifo->p_first == NULL )
         p_fifo->b_force_wake = true;
@@ -616,6 +1348,9 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->p_spsc != NULL )
+        return SpscGet( p_fifo, true );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -669,6 +1404,9 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->p_spsc != NULL )
+        return SpscGet( p_fifo, false );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -684,11 +1422,20 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 /* FIXME: not thread-safe */
 size_t block_FifoSize( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+    {
+        size_t i_size;
+
+        SpscCount( p_fifo->p_spsc, &i_size );
+        return i_size;
+    }
     return p_fifo->i_size;
 }
 
 /* FIXME: not thread-safe */
 size_t block_FifoCount( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+        return SpscCount( p_fifo->p_spsc, NULL );
     return p_fifo->i_depth;
 }
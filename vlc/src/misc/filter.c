@@ -25,9 +25,12 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <libvlc.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 filter_t *filter_NewBlend( vlc_object_t *p_this,
                            const video_format_t *p_dst_chroma )
@@ -114,6 +117,163 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/*** Slice threads ***/
+
+/* Maximum number of threads working on the bands of a picture */
+#define FILTER_SLICES_MAX 16
+
+/* Smaller bands are not worth a thread switch */
+#define FILTER_SLICE_MIN_LINES 16
+
+typedef struct filter_slice_job_t filter_slice_job_t;
+
+/* A filter_ProcessSlices() call, queued until all its bands are started */
+struct filter_slice_job_t
+{
+    filter_slice_job_t *p_next;
+    filter_t           *p_filter;
+    filter_slice_cb     pf_slice;
+    void               *p_data;
+    unsigned            i_lines;
+    unsigned            i_band;    /**< number of lines per band */
+    unsigned            i_next;    /**< first line of the next band */
+    unsigned            i_running; /**< number of bands being processed */
+};
+
+static void SliceThreadRun( vlc_workers_t * );
+
+/**
+ * Slice threads shared by all the video filter chains: they are started with
+ * the first chain and stopped with the last one.
+ * All the jobs data are protected by the workers lock. The wait condition
+ * signals queued jobs, and the done condition the end of a band.
+ */
+struct filter_slices_t
+{
+    vlc_workers_t       workers;
+    filter_slice_job_t *p_jobs; /**< jobs with bands left to start */
+};
+
+static filter_slices_t slices = {
+    .workers = VLC_WORKERS_INITIALIZER( SliceThreadRun, NULL ),
+};
+
+/* Lock must be held. The job must have bands left to start. */
+static void SliceRun( filter_slice_job_t *p_job )
+{
+    const unsigned i_first = p_job->i_next;
+    const unsigned i_last = __MIN( i_first + p_job->i_band, p_job->i_lines );
+
+    p_job->i_next = i_last;
+    if( i_last == p_job->i_lines )
+    {
+        /* Last band: unqueue the job */
+        filter_slice_job_t **pp_job = &slices.p_jobs;
+
+        while( *pp_job != p_job )
+            pp_job = &(*pp_job)->p_next;
+        *pp_job = p_job->p_next;
+    }
+    p_job->i_running++;
+    vlc_mutex_unlock( &slices.workers.lock );
+
+    p_job->pf_slice( p_job->p_filter, p_job->p_data, i_first, i_last );
+
+    vlc_mutex_lock( &slices.workers.lock );
+    if( --p_job->i_running == 0 && p_job->i_next == p_job->i_lines )
+        vlc_cond_broadcast( &slices.workers.done );
+}
+
+static void SliceThreadRun( vlc_workers_t *p_workers )
+{
+    if( slices.p_jobs == NULL )
+        vlc_cond_wait( &p_workers->wait, &p_workers->lock );
+    else
+        SliceRun( slices.p_jobs );
+}
+
+/**
+ * Takes a reference on the slice threads, starting them if needed.
+ * The number of threads comes from the "filter-threads" option.
+ *
+ * \return the slice threads, or NULL if the filters shall not be threaded
+ */
+filter_slices_t *filter_slices_Hold( vlc_object_t *p_this )
+{
+    unsigned i_count = var_InheritInteger( p_this, "filter-threads" );
+
+    if( i_count == 0 )
+        i_count = vlc_GetCPUCount();
+    if( i_count > FILTER_SLICES_MAX )
+        i_count = FILTER_SLICES_MAX;
+    if( i_count <= 1 )
+        return NULL;
+
+    /* The calling thread is the first worker */
+    if( vlc_workers_hold( &slices.workers, i_count - 1,
+                          VLC_THREAD_PRIORITY_VIDEO ) )
+        return NULL;
+    return &slices;
+}
+
+/**
+ * Releases a reference taken with filter_slices_Hold(). The threads are
+ * stopped with the last reference.
+ */
+void filter_slices_Release( filter_slices_t *p_slices )
+{
+    vlc_workers_release( &p_slices->workers );
+}
+
+void filter_ProcessSlices( filter_t *p_filter, filter_slice_cb pf_slice,
+                           void *p_data, unsigned i_lines, unsigned i_align )
+{
+    /* The thread count cannot change while the threads are held */
+    const unsigned i_threads = p_filter->p_slices != NULL ?
+                               p_filter->p_slices->workers.count : 0;
+
+    if( i_align == 0 )
+        i_align = 1;
+
+    /* Two bands per thread leave some room for load balancing */
+    const unsigned i_bands = 2 * (i_threads + 1);
+    unsigned i_band = __MAX( (i_lines + i_bands - 1) / i_bands,
+                             FILTER_SLICE_MIN_LINES );
+    i_band = (i_band + i_align - 1) / i_align * i_align;
+
+    if( i_threads == 0 || i_band >= i_lines )
+    {
+        pf_slice( p_filter, p_data, 0, i_lines );
+        return;
+    }
+
+    filter_slice_job_t job = {
+        .p_next = NULL,
+        .p_filter = p_filter,
+        .pf_slice = pf_slice,
+        .p_data = p_data,
+        .i_lines = i_lines,
+        .i_band = i_band,
+        .i_next = 0,
+        .i_running = 0,
+    };
+    filter_slice_job_t **pp_job;
+
+    /* The job lives on the stack: do not get cancelled before its end */
+    int canc = vlc_savecancel();
+    vlc_mutex_lock( &slices.workers.lock );
+    for( pp_job = &slices.p_jobs; *pp_job != NULL; pp_job = &(*pp_job)->p_next );
+    *pp_job = &job;
+    vlc_cond_broadcast( &slices.workers.wait );
+
+    while( job.i_next < job.i_lines )
+        SliceRun( &job );
+    while( job.i_running > 0 )
+        vlc_cond_wait( &slices.workers.done, &slices.workers.lock );
+    vlc_mutex_unlock( &slices.workers.lock );
+    vlc_restorecancel( canc );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
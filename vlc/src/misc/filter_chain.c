@@ -81,6 +81,7 @@ struct filter_chain_t
     es_format_t fmt_out; /**< Chain current output format */
     unsigned length; /**< Number of filters */
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
+    filter_slices_t *p_slices; /**< Slice threads for video filters */
     char psz_capability[1]; /**< Module capability for all chained filters */
 };
 
@@ -129,6 +130,11 @@ filter_chain_t *filter_chain_New( vlc_object_t *p_this,
     p_chain->allocator.pf_clean = pf_buffer_allocation_clean;
     p_chain->allocator.p_data = p_buffer_allocation_data;
 
+    if( !strcmp( psz_capability, "video filter2" ) )
+        p_chain->p_slices = filter_slices_Hold( p_this );
+    else
+        p_chain->p_slices = NULL;
+
     return p_chain;
 }
 
@@ -142,6 +148,8 @@ void filter_chain_Delete( filter_chain_t *p_chain )
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
 
+    if( p_chain->p_slices != NULL )
+        filter_slices_Release( p_chain->p_slices );
     free( p_chain );
 }
 /**
@@ -347,6 +355,7 @@ static filter_t *filter_chain_AppendFilterInternal( filter_chain_t *p_chain,
     es_format_Copy( &p_filter->fmt_out, p_fmt_out );
     p_filter->p_cfg = p_cfg;
     p_filter->b_allow_fmt_out_change = p_chain->b_allow_fmt_out_change;
+    p_filter->p_slices = p_chain->p_slices;
 
     p_filter->p_module = module_need( p_filter, p_chain->psz_capability,
                                       psz_name, psz_name != NULL );
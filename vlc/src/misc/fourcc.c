@@ -28,7 +28,9 @@
 # include "config.h"
 #endif
 
+#include <vlc_common.h>
 #include <vlc_fourcc.h>
+#include <vlc_atomic.h>
 #include <assert.h>
 
 typedef struct
@@ -38,6 +40,27 @@ typedef struct
     const char *psz_description;
 } entry_t;
 
+/* Entry of the sorted indexes of the lists below, see IndexFind() */
+typedef struct
+{
+    vlc_fourcc_t i_fourcc;
+    vlc_fourcc_t i_class;   /* codec lists only */
+    const void  *p_data;    /* description */
+    unsigned     i_order;   /* position in the list, the first one wins */
+} index_entry_t;
+
+enum
+{
+    INDEX_VIDEO,
+    INDEX_AUDIO,
+    INDEX_SPU,
+    INDEX_CHROMA,
+    INDEX_COUNT
+};
+
+static const index_entry_t *IndexFind( unsigned i_list,
+                                       vlc_fourcc_t i_fourcc );
+
 #define NULL4 "\x00\x00\x00\x00"
 
 /* XXX You don't want to see the preprocessor generated code ;) */
@@ -1183,62 +1206,25 @@ static inline vlc_fourcc_t CreateFourcc( const char *psz_fourcc )
 }
 
 /* */
-static entry_t Lookup( const entry_t p_list[], vlc_fourcc_t i_fourcc )
+static const index_entry_t *Find( int i_cat, vlc_fourcc_t i_fourcc )
 {
-    const char *p_class = NULL;
-    const char *psz_description = NULL;
-
-    entry_t e = B(0, "");
-
-    for( int i = 0; ; i++ )
-    {
-        const entry_t *p = &p_list[i];
-        const vlc_fourcc_t i_entry_fourcc = CreateFourcc( p->p_fourcc );
-        const vlc_fourcc_t i_entry_class = CreateFourcc( p->p_class );
-
-        if( i_entry_fourcc == 0 )
-            break;
-
-        if( i_entry_class != 0 )
-        {
-            p_class = p->p_class;
-            psz_description = p->psz_description;
-        }
-
-        if( i_entry_fourcc == i_fourcc )
-        {
-            assert( p_class != NULL );
-
-            memcpy( e.p_class, p_class, 4 );
-            memcpy( e.p_fourcc, p->p_fourcc, 4 );
-            e.psz_description = p->psz_description ?
-                                p->psz_description : psz_description;
-            break;
-        }
-    }
-    return e;
-}
-
-/* */
-static entry_t Find( int i_cat, vlc_fourcc_t i_fourcc )
-{
-    entry_t e;
+    const index_entry_t *e;
 
     switch( i_cat )
     {
     case VIDEO_ES:
-        return Lookup( p_list_video, i_fourcc );
+        return IndexFind( INDEX_VIDEO, i_fourcc );
     case AUDIO_ES:
-        return Lookup( p_list_audio, i_fourcc );
+        return IndexFind( INDEX_AUDIO, i_fourcc );
     case SPU_ES:
-        return Lookup( p_list_spu, i_fourcc );
+        return IndexFind( INDEX_SPU, i_fourcc );
 
     default:
-        e = Find( VIDEO_ES, i_fourcc );
-        if( CreateFourcc( e.p_class ) == 0 )
-            e = Find( AUDIO_ES, i_fourcc );
-        if( CreateFourcc( e.p_class ) == 0 )
-            e = Find( SPU_ES, i_fourcc );
+        e = IndexFind( INDEX_VIDEO, i_fourcc );
+        if( e == NULL )
+            e = IndexFind( INDEX_AUDIO, i_fourcc );
+        if( e == NULL )
+            e = IndexFind( INDEX_SPU, i_fourcc );
         return e;
     }
 }
@@ -1246,11 +1232,11 @@ static entry_t Find( int i_cat, vlc_fourcc_t i_fourcc )
 /* */
 vlc_fourcc_t vlc_fourcc_GetCodec( int i_cat, vlc_fourcc_t i_fourcc )
 {
-    entry_t e = Find( i_cat, i_fourcc );
+    const index_entry_t *e = Find( i_cat, i_fourcc );
 
-    if( CreateFourcc( e.p_class ) == 0 )
+    if( e == NULL )
         return i_fourcc;
-    return CreateFourcc( e.p_class );
+    return e->i_class;
 }
 
 vlc_fourcc_t vlc_fourcc_GetCodecFromString( int i_cat, const char *psz_fourcc )
@@ -1337,9 +1323,11 @@ vlc_fourcc_t vlc_fourcc_GetCodecAudio( vlc_fourcc_t i_fourcc, int i_bits )
 /* */
 const char *vlc_fourcc_GetDescription( int i_cat, vlc_fourcc_t i_fourcc )
 {
-    entry_t e = Find( i_cat, i_fourcc );
+    const index_entry_t *e = Find( i_cat, i_fourcc );
 
-    return e.psz_description;
+    if( e == NULL )
+        return "";
+    return e->p_data;
 }
 
 
@@ -1606,6 +1594,8 @@ static const struct
     { { VLC_CODEC_YUV_PLANAR_440, 0 },         PLANAR(3, 1, 2) },
     { { VLC_CODEC_YUV_PLANAR_444, 0 },         PLANAR(3, 1, 1) },
     { { VLC_CODEC_YUVA, 0 },                   PLANAR(4, 1, 1) },
+    { { VLC_CODEC_NV12, 0 },                   { 2, { {{1,1}, {1,1}},
+                                                      {{1,1}, {1,2}} }, 1 } },
 
     { { VLC_CODEC_YUV_PACKED, 0 },             PACKED(2) },
     { { VLC_CODEC_RGB8, VLC_CODEC_GREY,
@@ -1624,15 +1614,156 @@ static const struct
 
 const vlc_chroma_description_t *vlc_fourcc_GetChromaDescription( vlc_fourcc_t i_fourcc )
 {
+    const index_entry_t *e = IndexFind( INDEX_CHROMA, i_fourcc );
+
+    return e ? e->p_data : NULL;
+}
+
+/*****************************************************************************
+ * Sorted indexes
+ *****************************************************************************
+ * The lists above are kept in their human friendly order. On first use, they
+ * are copied once into arrays sorted by fourcc, with the class and
+ * description of each alias resolved, which are then searched by dichotomy.
+ *****************************************************************************/
+#define LIST_SIZE(list) (sizeof(list) / sizeof((list)[0]))
+
+typedef struct
+{
+    index_entry_t video[LIST_SIZE(p_list_video)];
+    index_entry_t audio[LIST_SIZE(p_list_audio)];
+    index_entry_t spu[LIST_SIZE(p_list_spu)];
+    index_entry_t chroma[LIST_SIZE(p_list_chroma_description)
+                         * LIST_SIZE(p_list_chroma_description[0].p_fourcc)];
+
+    const index_entry_t *pp_entries[INDEX_COUNT];
+    size_t               pi_count[INDEX_COUNT];
+} fourcc_index_t;
+
+static fourcc_index_t index_data;
+
+static vlc_mutex_t index_lock = VLC_STATIC_MUTEX;
+static vlc_atomic_t index_ready; /* pointer to index once built */
+
+static int IndexCmp( const void *a, const void *b )
+{
+    const index_entry_t *ea = a, *eb = b;
+
+    if( ea->i_fourcc != eb->i_fourcc )
+        return ea->i_fourcc < eb->i_fourcc ? -1 : 1;
+    return ea->i_order < eb->i_order ? -1 : ea->i_order > eb->i_order;
+}
+
+static int IndexCmpFourcc( const void *key, const void *entry )
+{
+    const vlc_fourcc_t i_fourcc = *(const vlc_fourcc_t *)key;
+    const index_entry_t *e = entry;
+
+    return i_fourcc < e->i_fourcc ? -1 : i_fourcc > e->i_fourcc;
+}
+
+/* Sorts the entries and only keeps the first one of each fourcc */
+static size_t IndexSort( index_entry_t *p_entries, size_t i_count )
+{
+    size_t i_unique = 0;
+
+    qsort( p_entries, i_count, sizeof(*p_entries), IndexCmp );
+    for( size_t i = 0; i < i_count; i++ )
+        if( i_unique == 0
+         || p_entries[i].i_fourcc != p_entries[i_unique - 1].i_fourcc )
+            p_entries[i_unique++] = p_entries[i];
+    return i_unique;
+}
+
+static size_t IndexList( index_entry_t *p_entries, const entry_t p_list[] )
+{
+    vlc_fourcc_t i_class = 0;
+    const char *psz_description = NULL;
+    size_t i_count = 0;
+
+    for( unsigned i = 0; CreateFourcc( p_list[i].p_fourcc ) != 0; i++ )
+    {
+        const entry_t *p = &p_list[i];
+
+        if( CreateFourcc( p->p_class ) != 0 )
+        {
+            i_class = CreateFourcc( p->p_class );
+            psz_description = p->psz_description;
+        }
+        assert( i_class != 0 );
+
+        p_entries[i_count].i_fourcc = CreateFourcc( p->p_fourcc );
+        p_entries[i_count].i_class = i_class;
+        p_entries[i_count].p_data = p->psz_description ? p->psz_description
+                                                       : psz_description;
+        p_entries[i_count].i_order = i;
+        i_count++;
+    }
+    return IndexSort( p_entries, i_count );
+}
+
+static size_t IndexChroma( index_entry_t *p_entries )
+{
+    const unsigned i_width = LIST_SIZE(p_list_chroma_description[0].p_fourcc);
+    size_t i_count = 0;
+
     for( unsigned i = 0; p_list_chroma_description[i].p_fourcc[0]; i++ )
     {
         const vlc_fourcc_t *p_fourcc = p_list_chroma_description[i].p_fourcc;
+
         for( unsigned j = 0; p_fourcc[j]; j++ )
         {
-            if( p_fourcc[j] == i_fourcc )
-                return &p_list_chroma_description[i].description;
+            p_entries[i_count].i_fourcc = p_fourcc[j];
+            p_entries[i_count].i_class = 0;
+            p_entries[i_count].p_data =
+                &p_list_chroma_description[i].description;
+            p_entries[i_count].i_order = i * i_width + j;
+            i_count++;
+        }
+    }
+    return IndexSort( p_entries, i_count );
+}
+
+static void IndexBuild( fourcc_index_t *p_index )
+{
+    p_index->pp_entries[INDEX_VIDEO] = p_index->video;
+    p_index->pi_count[INDEX_VIDEO] = IndexList( p_index->video, p_list_video );
+    p_index->pp_entries[INDEX_AUDIO] = p_index->audio;
+    p_index->pi_count[INDEX_AUDIO] = IndexList( p_index->audio, p_list_audio );
+    p_index->pp_entries[INDEX_SPU] = p_index->spu;
+    p_index->pi_count[INDEX_SPU] = IndexList( p_index->spu, p_list_spu );
+    p_index->pp_entries[INDEX_CHROMA] = p_index->chroma;
+    p_index->pi_count[INDEX_CHROMA] = IndexChroma( p_index->chroma );
+}
+
+static const index_entry_t *IndexFind( unsigned i_list,
+                                       vlc_fourcc_t i_fourcc )
+{
+    /* The pointer is only published once the index is complete, the
+     * entries are read through it */
+    uintptr_t i_index = vlc_atomic_get( &index_ready );
+
+    if( unlikely(i_index == 0) )
+    {
+        vlc_mutex_lock( &index_lock );
+        i_index = vlc_atomic_get( &index_ready );
+        if( i_index == 0 )
+        {
+            IndexBuild( &index_data );
+
+            /* The entries must be visible before the pointer */
+            barrier();
+            i_index = (uintptr_t)&index_data;
+            vlc_atomic_set( &index_ready, i_index );
         }
+        vlc_mutex_unlock( &index_lock );
     }
-    return NULL;
+
+    const fourcc_index_t *p_index = (const fourcc_index_t *)i_index;
+
+    assert( i_list < INDEX_COUNT );
+    return bsearch( &i_fourcc, p_index->pp_entries[i_list],
+                    p_index->pi_count[i_list], sizeof(index_entry_t),
+                    IndexCmpFourcc );
 }
 
@@ -53,6 +53,7 @@
 #include <assert.h>
 
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 typedef struct
@@ -91,9 +92,14 @@ static inline msg_bank_t *libvlc_bank (libvlc_int_t *inst)
  * Local prototypes
  *****************************************************************************/
 static void PrintMsg ( vlc_object_t *, msg_item_t * );
+static void msg_Queue (msg_bank_t *, msg_item_t *);
+static void *msg_Thread (void *);
 
 static vlc_mutex_t msg_stack_lock = VLC_STATIC_MUTEX;
 
+/** Number of messages waiting to be dispatched to the subscribers */
+#define MSG_RING_SIZE 1024
+
 /**
  * Store all data required by messages interfaces.
  */
@@ -105,12 +111,35 @@ struct msg_bank_t
     /* Subscribers */
     int i_sub;
     msg_subscription_t **pp_sub;
+    vlc_atomic_t sub_verbosity; /**< Highest subscriber verbosity plus one */
+
+    /* Messages to dispatch to the subscribers, from any thread to the
+     * dispatcher thread. Slot i is free for the producer holding ticket i
+     * when its sequence is i, and ready for the dispatcher when it is i+1. */
+    struct
+    {
+        vlc_atomic_t seq;
+        msg_item_t  *item;
+    } ring[MSG_RING_SIZE];
+    vlc_atomic_t ring_tail; /**< Next producer ticket */
+    vlc_atomic_t ring_free; /**< Free slots */
+    vlc_atomic_t ring_drops; /**< Messages dropped as the ring was full */
+    uintptr_t    ring_head; /**< Next dispatcher ticket */
+    vlc_sem_t    ring_wait;
+    vlc_thread_t thread;
+    vlc_atomic_t closing;
+    bool         threaded;
 
     locale_t locale; /**< C locale for error messages */
     vlc_dictionary_t enabled_objects; ///< Enabled objects
     bool all_objects_enabled; ///< Should we print all objects?
 };
 
+/** Minimum verbosity to show each type of message */
+static const signed char msg_levels[4] = {
+    [VLC_MSG_INFO] = 0, [VLC_MSG_ERR] = 0, [VLC_MSG_WARN] = 1, [VLC_MSG_DBG] = 2,
+};
+
 /**
  * Initialize messages queues
  * This function initializes all message queues
@@ -125,6 +154,22 @@ msg_bank_t *msg_Create (void)
 
     bank->i_sub = 0;
     bank->pp_sub = NULL;
+    vlc_atomic_set (&bank->sub_verbosity, 0);
+
+    for (unsigned i = 0; i < MSG_RING_SIZE; i++)
+    {
+        vlc_atomic_set (&bank->ring[i].seq, i);
+        bank->ring[i].item = NULL;
+    }
+    vlc_atomic_set (&bank->ring_tail, 0);
+    vlc_atomic_set (&bank->ring_free, MSG_RING_SIZE);
+    vlc_atomic_set (&bank->ring_drops, 0);
+    bank->ring_head = 0;
+    vlc_sem_init (&bank->ring_wait, 0);
+    vlc_atomic_set (&bank->closing, false);
+    /* Without a thread, messages are dispatched synchronously */
+    bank->threaded = !vlc_clone (&bank->thread, msg_Thread, bank,
+                                 VLC_THREAD_PRIORITY_LOW);
 
     /* C locale to get error messages in English in the logs */
     bank->locale = newlocale (LC_MESSAGES_MASK, "C", (locale_t)0);
@@ -183,6 +228,14 @@ void msg_Destroy (msg_bank_t *bank)
     if (unlikely(bank->i_sub != 0))
         fputs ("stale interface subscribers (LibVLC might crash)\n", stderr);
 
+    if (bank->threaded)
+    {
+        vlc_atomic_set (&bank->closing, true);
+        vlc_sem_post (&bank->ring_wait);
+        vlc_join (bank->thread, NULL);
+    }
+    vlc_sem_destroy (&bank->ring_wait);
+
     vlc_mutex_lock( &msg_stack_lock );
     assert(banks > 0);
     if( --banks == 0 )
@@ -206,10 +259,24 @@ struct msg_subscription_t
     int             verbosity;
 };
 
+/**
+ * Updates the highest subscriber verbosity, checked before formatting.
+ * The bank must be write-locked.
+ */
+static void msg_UpdateVerbosity (msg_bank_t *bank)
+{
+    int verbosity = -1;
+
+    for (int i = 0; i < bank->i_sub; i++)
+        verbosity = __MAX(verbosity, bank->pp_sub[i]->verbosity);
+    vlc_atomic_set (&bank->sub_verbosity, verbosity + 1);
+}
+
 /**
  * Subscribe to the message queue.
  * Whenever a message is emitted, a callback will be called.
- * Callback invocation are serialized within a subscription.
+ * Callback invocation are serialized within a subscription. They occur on a
+ * dedicated thread, shortly after the message was emitted.
  *
  * @param instance LibVLC instance to get messages from
  * @param cb callback function
@@ -231,6 +298,7 @@ msg_subscription_t *msg_Subscribe (libvlc_int_t *instance, msg_callback_t cb,
     msg_bank_t *bank = libvlc_bank (instance);
     vlc_rwlock_wrlock (&bank->lock);
     TAB_APPEND (bank->i_sub, bank->pp_sub, sub);
+    msg_UpdateVerbosity (bank);
     vlc_rwlock_unlock (&bank->lock);
 
     return sub;
@@ -246,6 +314,7 @@ void msg_Unsubscribe (msg_subscription_t *sub)
 
     vlc_rwlock_wrlock (&bank->lock);
     TAB_REMOVE (bank->i_sub, bank->pp_sub, sub);
+    msg_UpdateVerbosity (bank);
     vlc_rwlock_unlock (&bank->lock);
     free (sub);
 }
@@ -259,6 +328,7 @@ void msg_SubscriptionSetVerbosity( msg_subscription_t *sub, const int i_verbosit
     vlc_rwlock_wrlock (&bank->lock);
 
     sub->verbosity = i_verbosity;
+    msg_UpdateVerbosity (bank);
 
     vlc_rwlock_unlock (&bank->lock);
 }
@@ -315,7 +385,16 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
         (p_this->i_flags & OBJECT_FLAGS_NODBG && i_type == VLC_MSG_DBG) )
         return;
 
-    msg_bank_t *bank = libvlc_bank (p_this->p_libvlc);
+    /* Do not format messages that nobody would see */
+    libvlc_priv_t *priv = libvlc_priv (p_this->p_libvlc);
+    msg_bank_t *bank = priv->msg_bank;
+    int level = msg_levels[i_type & 3];
+    bool b_print = priv->i_verbose >= level;
+    bool b_sub = (int)vlc_atomic_get (&bank->sub_verbosity) - 1 >= level;
+
+    if (!b_print && !b_sub)
+        return;
+
     locale_t locale = uselocale (bank->locale);
 
 #ifndef __GLIBC__
@@ -451,8 +530,19 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
     p_item->psz_msg =       psz_str;
     p_item->psz_header =    psz_header;
 
-    PrintMsg( p_this, p_item );
+    if (b_print)
+        PrintMsg( p_this, p_item );
+    if (b_sub)
+        msg_Queue (bank, p_item);
+    msg_Release (p_item);
+}
 
+/**
+ * Sends a message to the subscribers that want it.
+ */
+static void msg_Dispatch (msg_bank_t *bank, msg_item_t *p_item,
+                          unsigned i_drop)
+{
     vlc_rwlock_rdlock (&bank->lock);
     for (int i = 0; i < bank->i_sub; i++)
     {
@@ -484,10 +574,88 @@ void msg_GenericVa (vlc_object_t *p_this, int i_type,
                 break;
         }
 
-        sub->func (sub->opaque, p_item, 0);
+        sub->func (sub->opaque, p_item, i_drop);
     }
     vlc_rwlock_unlock (&bank->lock);
-    msg_Release (p_item);
+}
+
+/**
+ * Queues a message for the dispatcher thread.
+ *
+ * Any number of threads can queue concurrently without locking. A message is
+ * dropped, and later reported to the subscribers, if the ring is full, so
+ * that a slow subscriber never blocks the thread that emitted the message.
+ */
+static void msg_Queue (msg_bank_t *bank, msg_item_t *p_item)
+{
+    if (!bank->threaded)
+    {
+        msg_Dispatch (bank, p_item, 0);
+        return;
+    }
+
+    /* Reserve a slot */
+    if ((intptr_t)vlc_atomic_dec (&bank->ring_free) < 0)
+    {
+        vlc_atomic_inc (&bank->ring_free);
+        vlc_atomic_inc (&bank->ring_drops);
+        return;
+    }
+
+    /* The reservation guarantees that the dispatcher already released the
+     * slot of that ticket, as it releases a slot before freeing it. */
+    uintptr_t ticket = vlc_atomic_inc (&bank->ring_tail) - 1;
+    unsigned i = ticket % MSG_RING_SIZE;
+
+    assert (vlc_atomic_get (&bank->ring[i].seq) == ticket);
+    bank->ring[i].item = msg_Hold (p_item);
+    vlc_atomic_inc (&bank->ring[i].seq);
+    vlc_sem_post (&bank->ring_wait);
+}
+
+/**
+ * Dispatcher thread: delivers the queued messages to the subscribers.
+ */
+static void *msg_Thread (void *data)
+{
+    msg_bank_t *bank = data;
+    int canc = vlc_savecancel ();
+
+    for (;;)
+    {
+        unsigned i = bank->ring_head % MSG_RING_SIZE;
+
+        /* Full barrier: the item must not be read before its sequence */
+        if (vlc_atomic_add (&bank->ring[i].seq, 0) != bank->ring_head + 1)
+        {   /* Nothing published at the head yet */
+            if (vlc_atomic_get (&bank->closing)
+             && vlc_atomic_get (&bank->ring_free) == MSG_RING_SIZE)
+                break;
+            vlc_sem_wait (&bank->ring_wait);
+            continue;
+        }
+
+        msg_item_t *p_item = bank->ring[i].item;
+        unsigned i_drop = vlc_atomic_get (&bank->ring_drops);
+
+        if (i_drop)
+            vlc_atomic_sub (&bank->ring_drops, i_drop);
+        msg_Dispatch (bank, p_item, i_drop);
+
+        /* Hand the slot over to the producer of the next lap */
+        bank->ring[i].item = NULL;
+        vlc_atomic_add (&bank->ring[i].seq, MSG_RING_SIZE - 1);
+        bank->ring_head++;
+        vlc_atomic_inc (&bank->ring_free);
+        msg_Release (p_item);
+    }
+
+    unsigned i_drop = vlc_atomic_get (&bank->ring_drops);
+    if (i_drop)
+        fprintf (stderr, "%u log message(s) were not delivered to the "
+                 "subscribers\n", i_drop);
+    vlc_restorecancel (canc);
+    return NULL;
 }
 
 /*****************************************************************************
@@ -61,7 +61,6 @@
 # define close( a )       closesocket (a)
 #endif
 
-#include <search.h>
 #include <limits.h>
 #include <assert.h>
 
@@ -140,7 +139,10 @@ void *vlc_custom_create( vlc_object_t *p_this, size_t i_size,
         p_new->i_flags = p_this->i_flags
             & (OBJECT_FLAGS_NODBG|OBJECT_FLAGS_QUIET|OBJECT_FLAGS_NOINTERACT);
 
-    p_priv->var_root = NULL;
+    p_priv->var_table = NULL;
+    p_priv->var_count = 0;
+    p_priv->var_mask = 0;
+    p_priv->var_cache = NULL;
 
     if( p_this == NULL )
     {
@@ -639,6 +641,9 @@ void vlc_object_attach( vlc_object_t *p_this, vlc_object_t *p_parent )
         priv->next->prev = priv;
     pap->first = priv;
     libvlc_unlock (p_this->p_libvlc);
+
+    /* Variables may now be inherited from the new ancestors */
+    var_FlushInheritCache ();
 }
 
 
@@ -669,13 +674,8 @@ vlc_list_t *vlc_list_children( vlc_object_t *obj )
     return l;
 }
 
-static void DumpVariable (const void *data, const VISIT which, const int depth)
+static void DumpVariable (const variable_t *p_var)
 {
-    if (which != postorder && which != leaf)
-        return;
-    (void) depth;
-
-    const variable_t *p_var = *(const variable_t **)data;
     const char *psz_type = "unknown";
 
     switch( p_var->i_type & VLC_VAR_TYPE )
@@ -783,10 +783,12 @@ static int DumpCommand( vlc_object_t *p_this, char const *psz_cmd,
 
         PrintObject( vlc_internals(p_object), "" );
         vlc_mutex_lock( &vlc_internals( p_object )->var_lock );
-        if( vlc_internals( p_object )->var_root == NULL )
+        if( vlc_internals( p_object )->var_count == 0 )
             puts( " `-o No variables" );
         else
-            twalk( vlc_internals( p_object )->var_root, DumpVariable );
+            for( unsigned i = 0; i <= vlc_internals( p_object )->var_mask; i++ )
+                if( vlc_internals( p_object )->var_table[i] != NULL )
+                    DumpVariable( vlc_internals( p_object )->var_table[i] );
         vlc_mutex_unlock( &vlc_internals( p_object )->var_lock );
     }
     libvlc_unlock (p_this->p_libvlc);
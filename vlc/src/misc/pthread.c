@@ -796,69 +796,238 @@ void vlc_control_cancel (int cmd, ...)
 }
 
 
+/*** Timers ***/
+
+/* Number of threads servicing all timers */
+#define VLC_TIMER_THREADS 4
+
 struct vlc_timer
 {
-    vlc_thread_t thread;
-    vlc_mutex_t  lock;
-    vlc_cond_t   wait;
     void       (*func) (void *);
     void        *data;
-    mtime_t      value, interval;
-    unsigned     users;
+    mtime_t      value, interval; /**< next expiry, repetition interval */
+    unsigned     index; /**< position in the timer heap, if armed */
+    bool         running; /**< whether the callback is being executed */
+    bool         pending; /**< expired while running, to be run again */
     unsigned     overruns;
+    /* Blocking timers only (see vlc_timer_create_blocking()) */
+    bool         blocking;
+    bool         stopping;
+    vlc_cond_t   reschedule;
+    vlc_thread_t thread;
 };
 
-static void *vlc_timer_do (void *data)
-{
-    struct vlc_timer *timer = data;
+static void vlc_timer_run (vlc_workers_t *);
+static void vlc_timer_stop (vlc_workers_t *);
 
-    timer->func (timer->data);
+/**
+ * Timer service: armed timers are kept in a binary heap sorted by expiry
+ * date, and processed by a fixed pool of worker threads, which hold one
+ * reference per timer. The wait condition signals changes of the heap, and
+ * the done condition the end of a timer callback.
+ * All timers data are protected by the workers lock.
+ */
+static struct
+{
+    vlc_workers_t      workers;
+    struct vlc_timer **heap;
+    unsigned           armed, size;
+} timers = {
+    .workers = VLC_WORKERS_INITIALIZER (vlc_timer_run, vlc_timer_stop),
+};
 
-    vlc_mutex_lock (&timer->lock);
-    assert (timer->users > 0);
-    if (--timer->users == 0)
-        vlc_cond_signal (&timer->wait);
-    vlc_mutex_unlock (&timer->lock);
-    return NULL;
+static void vlc_timer_heap_set (unsigned i, struct vlc_timer *timer)
+{
+    timers.heap[i] = timer;
+    timer->index = i;
 }
 
-static void *vlc_timer_thread (void *data)
+static void vlc_timer_heap_up (unsigned i)
 {
-    struct vlc_timer *timer = data;
-    mtime_t value, interval;
+    struct vlc_timer *timer = timers.heap[i];
 
-    vlc_mutex_lock (&timer->lock);
-    value = timer->value;
-    interval = timer->interval;
-    vlc_mutex_unlock (&timer->lock);
+    while (i > 0)
+    {
+        unsigned parent = (i - 1) / 2;
+
+        if (timers.heap[parent]->value <= timer->value)
+            break;
+        vlc_timer_heap_set (i, timers.heap[parent]);
+        i = parent;
+    }
+    vlc_timer_heap_set (i, timer);
+}
+
+static void vlc_timer_heap_down (unsigned i)
+{
+    struct vlc_timer *timer = timers.heap[i];
 
     for (;;)
     {
-         vlc_thread_t th;
+        unsigned child = 2 * i + 1;
+
+        if (child >= timers.armed)
+            break;
+        if (child + 1 < timers.armed
+         && timers.heap[child + 1]->value < timers.heap[child]->value)
+            child++;
+        if (timer->value <= timers.heap[child]->value)
+            break;
+        vlc_timer_heap_set (i, timers.heap[child]);
+        i = child;
+    }
+    vlc_timer_heap_set (i, timer);
+}
+
+/* Service lock must be held. The timer must be disarmed. */
+static int vlc_timer_heap_insert (struct vlc_timer *timer)
+{
+    if (timers.armed >= timers.size)
+    {
+        unsigned size = timers.size ? (2 * timers.size) : 16;
+        struct vlc_timer **heap = realloc (timers.heap,
+                                           size * sizeof (*heap));
+        if (unlikely(heap == NULL))
+            return ENOMEM;
+        timers.heap = heap;
+        timers.size = size;
+    }
+    timers.heap[timers.armed] = timer;
+    vlc_timer_heap_up (timers.armed++);
+    if (timer->index == 0)
+        vlc_cond_signal (&timers.workers.wait); /* new earliest deadline */
+    return 0;
+}
+
+/* Service lock must be held. The timer must be armed. */
+static void vlc_timer_heap_remove (struct vlc_timer *timer)
+{
+    unsigned i = timer->index;
+    struct vlc_timer *last = timers.heap[--timers.armed];
+
+    assert (i <= timers.armed && timers.heap[i] == timer);
+    timer->value = 0;
+    if (last == timer)
+        return;
+    vlc_timer_heap_set (i, last);
+    vlc_timer_heap_up (i);
+    vlc_timer_heap_down (last->index);
+}
+
+static void vlc_timer_run (vlc_workers_t *workers)
+{
+    if (timers.armed == 0)
+    {
+        vlc_cond_wait (&workers->wait, &workers->lock);
+        return;
+    }
 
-         mwait (value);
+    struct vlc_timer *timer = timers.heap[0];
+    mtime_t now = mdate ();
 
-         vlc_mutex_lock (&timer->lock);
-         if (vlc_clone (&th, vlc_timer_do, timer, VLC_THREAD_PRIORITY_INPUT))
-             timer->overruns++;
-         else
-         {
-             vlc_detach (th);
-             timer->users++;
-         }
-         vlc_mutex_unlock (&timer->lock);
+    if (timer->value > now)
+    {
+        vlc_cond_timedwait (&workers->wait, &workers->lock, timer->value);
+        return;
+    }
 
-         if (interval == 0)
-             return NULL;
+    /* Rearm or disarm the timer before running it */
+    if (timer->interval > 0)
+    {
+        mtime_t late = (now - timer->value) / timer->interval;
 
-         value += interval;
+        timer->overruns += late;
+        timer->value += (late + 1) * timer->interval;
+        vlc_timer_heap_down (0);
     }
+    else
+        vlc_timer_heap_remove (timer);
+
+    /* A previous occurence of the timer is still running: an interval timer
+     * skips this one, a one-shot timer is run again right after it */
+    if (timer->running)
+    {
+        if (timer->interval > 0)
+            timer->overruns++;
+        else
+            timer->pending = true;
+        return;
+    }
+
+    if (timers.armed > 0)
+        vlc_cond_signal (&workers->wait); /* next timer for another thread */
+
+    timer->running = true;
+    do
+    {
+        timer->pending = false;
+        vlc_mutex_unlock (&workers->lock);
+        timer->func (timer->data);
+        vlc_mutex_lock (&workers->lock);
+    }
+    while (timer->pending);
+    timer->running = false;
+    vlc_cond_broadcast (&workers->done);
+}
+
+/* Last timer destroyed. Workers lock must be held. */
+static void vlc_timer_stop (vlc_workers_t *workers)
+{
+    assert (timers.armed == 0);
+    free (timers.heap);
+    timers.heap = NULL;
+    timers.size = 0;
+    (void) workers;
+}
+
+/* Thread of a blocking timer */
+static void *vlc_timer_own_thread (void *data)
+{
+    struct vlc_timer *timer = data;
+
+    vlc_mutex_lock (&timers.workers.lock);
+    while (!timer->stopping)
+    {
+        if (timer->value == 0)
+        {
+            vlc_cond_wait (&timer->reschedule, &timers.workers.lock);
+            continue;
+        }
+
+        mtime_t now = mdate ();
+
+        if (timer->value > now)
+        {
+            vlc_cond_timedwait (&timer->reschedule, &timers.workers.lock,
+                                timer->value);
+            continue;
+        }
+
+        if (timer->interval > 0)
+        {
+            mtime_t late = (now - timer->value) / timer->interval;
+
+            timer->overruns += late;
+            timer->value += (late + 1) * timer->interval;
+        }
+        else
+            timer->value = 0;
+
+        timer->running = true;
+        vlc_mutex_unlock (&timers.workers.lock);
+        timer->func (timer->data);
+        vlc_mutex_lock (&timers.workers.lock);
+        timer->running = false;
+    }
+    vlc_mutex_unlock (&timers.workers.lock);
+    return NULL;
 }
 
 /**
  * Initializes an asynchronous timer.
  * @warning Asynchronous timers are processed from an unspecified thread.
- * Also, multiple occurences of an interval timer can run concurrently.
+ * All timers share a small pool of threads, so timer functions should not
+ * block for long: see vlc_timer_create_blocking() otherwise.
  *
  * @param id pointer to timer to be initialized
  * @param func function that the timer will call
@@ -871,15 +1040,66 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
     if (unlikely(timer == NULL))
         return ENOMEM;
-    vlc_mutex_init (&timer->lock);
-    vlc_cond_init (&timer->wait);
     assert (func);
     timer->func = func;
     timer->data = data;
     timer->value = 0;
     timer->interval = 0;
-    timer->users = 0;
+    timer->index = 0;
+    timer->running = false;
+    timer->pending = false;
     timer->overruns = 0;
+    timer->blocking = false;
+
+    /* The timer threads are started with the first timer */
+    int val = vlc_workers_hold (&timers.workers, VLC_TIMER_THREADS,
+                                VLC_THREAD_PRIORITY_INPUT);
+    if (unlikely(val))
+    {
+        free (timer);
+        return val;
+    }
+
+    *id = timer;
+    return 0;
+}
+
+/**
+ * Initializes an asynchronous timer whose function may block for long,
+ * e.g. on network or process I/O. Such a timer gets a thread of its own,
+ * so that it cannot delay the other timers.
+ *
+ * @param id pointer to timer to be initialized
+ * @param func function that the timer will call
+ * @param data parameter for the timer function
+ * @return 0 on success, a system error code otherwise.
+ */
+int vlc_timer_create_blocking (vlc_timer_t *id, void (*func) (void *),
+                               void *data)
+{
+    struct vlc_timer *timer = malloc (sizeof (*timer));
+
+    if (unlikely(timer == NULL))
+        return ENOMEM;
+    assert (func);
+    timer->func = func;
+    timer->data = data;
+    timer->value = 0;
+    timer->interval = 0;
+    timer->running = false;
+    timer->overruns = 0;
+    timer->blocking = true;
+    timer->stopping = false;
+    vlc_cond_init (&timer->reschedule);
+
+    int val = vlc_clone (&timer->thread, vlc_timer_own_thread, timer,
+                         VLC_THREAD_PRIORITY_INPUT);
+    if (unlikely(val))
+    {
+        vlc_cond_destroy (&timer->reschedule);
+        free (timer);
+        return val;
+    }
     *id = timer;
     return 0;
 }
@@ -895,14 +1115,29 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
  */
 void vlc_timer_destroy (vlc_timer_t timer)
 {
-    vlc_timer_schedule (timer, false, 0, 0);
-    vlc_mutex_lock (&timer->lock);
-    while (timer->users != 0)
-        vlc_cond_wait (&timer->wait, &timer->lock);
-    vlc_mutex_unlock (&timer->lock);
+    if (timer->blocking)
+    {
+        vlc_mutex_lock (&timers.workers.lock);
+        timer->stopping = true;
+        vlc_cond_signal (&timer->reschedule);
+        vlc_mutex_unlock (&timers.workers.lock);
+
+        vlc_join (timer->thread, NULL);
+        vlc_cond_destroy (&timer->reschedule);
+        free (timer);
+        return;
+    }
 
-    vlc_cond_destroy (&timer->wait);
-    vlc_mutex_destroy (&timer->lock);
+    vlc_mutex_lock (&timers.workers.lock);
+    if (timer->value)
+        vlc_timer_heap_remove (timer);
+    timer->pending = false;
+    while (timer->running)
+        vlc_cond_wait (&timers.workers.done, &timers.workers.lock);
+    vlc_mutex_unlock (&timers.workers.lock);
+
+    /* The timer threads are stopped with the last timer */
+    vlc_workers_release (&timers.workers);
     free (timer);
 }
 
@@ -926,27 +1161,23 @@ void vlc_timer_destroy (vlc_timer_t timer)
 void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
                          mtime_t value, mtime_t interval)
 {
-    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
-
-    vlc_mutex_lock (&lock);
-    vlc_mutex_lock (&timer->lock);
-    if (timer->value)
-    {
-        vlc_mutex_unlock (&timer->lock);
-        vlc_cancel (timer->thread);
-        vlc_join (timer->thread, NULL);
-        vlc_mutex_lock (&timer->lock);
-        timer->value = 0;
-    }
-    if ((value != 0)
-     && (vlc_clone (&timer->thread, vlc_timer_thread, timer,
-                    VLC_THREAD_PRIORITY_INPUT) == 0))
+    vlc_mutex_lock (&timers.workers.lock);
+    if (timer->value && !timer->blocking)
+        vlc_timer_heap_remove (timer);
+    timer->value = 0;
+    timer->pending = false;
+    if (value != 0)
     {
         timer->value = (absolute ? 0 : mdate ()) + value;
         timer->interval = interval;
+        if (timer->value == 0) /* zero means disarmed */
+            timer->value = 1;
+        if (!timer->blocking && vlc_timer_heap_insert (timer))
+            timer->value = 0;
     }
-    vlc_mutex_unlock (&timer->lock);
-    vlc_mutex_unlock (&lock);
+    if (timer->blocking)
+        vlc_cond_signal (&timer->reschedule);
+    vlc_mutex_unlock (&timers.workers.lock);
 }
 
 /**
@@ -960,9 +1191,9 @@ unsigned vlc_timer_getoverrun (vlc_timer_t timer)
 {
     unsigned ret;
 
-    vlc_mutex_lock (&timer->lock);
+    vlc_mutex_lock (&timers.workers.lock);
     ret = timer->overruns;
     timer->overruns = 0;
-    vlc_mutex_unlock (&timer->lock);
+    vlc_mutex_unlock (&timers.workers.lock);
     return ret;
 }
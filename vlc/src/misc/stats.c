@@ -31,8 +31,10 @@
 
 #include <vlc_common.h>
 #include <stdio.h>                                               /* required */
+#include <assert.h>
 
 #include "input/input_internal.h"
+#include "input/es_out.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -40,6 +42,8 @@
 static int CounterUpdate( vlc_object_t *p_this,
                           counter_t *p_counter,
                           vlc_value_t val, vlc_value_t * );
+static void CounterSample( counter_t *p_counter );
+static vlc_value_t CounterGetValue( counter_t *p_counter );
 static void TimerDump( vlc_object_t *p_this, counter_t *p_counter, bool);
 
 /*****************************************************************************
@@ -72,6 +76,10 @@ counter_t * stats_CounterCreate( vlc_object_t *p_this,
 
     p_counter->update_interval = 0;
     p_counter->last_update = 0;
+    vlc_mutex_init( &p_counter->value_lock );
+    p_counter->value.i_int = 0;
+    if( i_type == VLC_VAR_FLOAT )
+        p_counter->value.f_float = 0.;
 
     return p_counter;
 }
@@ -82,6 +90,9 @@ counter_t * stats_CounterCreate( vlc_object_t *p_this,
  * \param val the vlc_value union containing the new value to aggregate. For
  * more information on how data is aggregated, \see stats_Create
  * \param val_new a pointer that will be filled with new data
+ *
+ * STATS_COUNTER and STATS_DERIVATIVE counters can be updated concurrently
+ * without locking. Other counters must be serialized by the caller.
  */
 int stats_Update( vlc_object_t *p_this, counter_t *p_counter,
                   vlc_value_t val, vlc_value_t *val_new )
@@ -97,10 +108,27 @@ int stats_Update( vlc_object_t *p_this, counter_t *p_counter,
  * \param val a pointer to an initialized vlc_value union. It will contain the
  * retrieved value
  * \return an error code
+ *
+ * Derivatives are sampled here, at most once per update interval, so calls
+ * for a given counter must be serialized by the caller.
  */
 int stats_Get( vlc_object_t *p_this, counter_t *p_counter, vlc_value_t *val )
 {
-    if( !libvlc_stats (p_this) || !p_counter || p_counter->i_samples == 0 )
+    if( !libvlc_stats (p_this) || !p_counter )
+    {
+        val->i_int = 0;
+        return VLC_EGENERIC;
+    }
+
+    if( p_counter->i_compute_type == STATS_COUNTER )
+    {
+        *val = CounterGetValue( p_counter );
+        return VLC_SUCCESS;
+    }
+    if( p_counter->i_compute_type == STATS_DERIVATIVE )
+        CounterSample( p_counter );
+
+    if( p_counter->i_samples == 0 )
     {
         val->i_int = 0;
         return VLC_EGENERIC;
@@ -111,7 +139,6 @@ int stats_Get( vlc_object_t *p_this, counter_t *p_counter, vlc_value_t *val )
     case STATS_LAST:
     case STATS_MIN:
     case STATS_MAX:
-    case STATS_COUNTER:
         *val = p_counter->pp_samples[0]->value;
         break;
     case STATS_DERIVATIVE:
@@ -159,6 +186,10 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
 {
     if( !libvlc_stats (p_input) ) return;
 
+    size_t i_fifo = 0;
+    if( p_input->p->p_es_out_display )
+        i_fifo = es_out_GetFifoSize( p_input->p->p_es_out_display );
+
     vlc_mutex_lock( &p_input->p->counters.counters_lock );
     vlc_mutex_lock( &p_stats->lock );
 
@@ -183,6 +214,7 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
                       &p_stats->i_decoded_video );
     stats_GetInteger( p_input, p_input->p->counters.p_decoded_audio,
                       &p_stats->i_decoded_audio );
+    p_stats->i_decoder_fifo = i_fifo;
 
     /* Sout */
     if( p_input->p->counters.p_sout_send_bitrate )
@@ -222,6 +254,7 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
+    p_stats->i_decoder_fifo =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
      = 0;
     vlc_mutex_unlock( &p_stats->lock );
@@ -408,6 +441,7 @@ void stats_CounterClean( counter_t *p_c )
             free( p_s );
             i--;
         }
+        vlc_mutex_destroy( &p_c->value_lock );
         free( p_c->psz_name );
         free( p_c );
     }
@@ -420,8 +454,9 @@ void stats_CounterClean( counter_t *p_c )
 
 /**
  * Update a statistics counter, according to its type
- * If needed, perform a bit of computation (derivative, mostly)
- * This function must be entered with stats handler lock
+ * Counters and derivatives only store the value, atomically or under the
+ * counter lock, derivatives are computed by the readers. Other types must be
+ * entered with the stats lock.
  * \param p_counter the counter to update
  * \param val the "new" value
  * \return an error code
@@ -485,74 +520,101 @@ static int CounterUpdate( vlc_object_t *p_handler,
         }
         break;
     case STATS_DERIVATIVE:
-    {
-        counter_sample_t *p_new, *p_old;
-        mtime_t now = mdate();
-        if( now - p_counter->last_update < p_counter->update_interval )
+        if( p_counter->i_type == VLC_VAR_INTEGER )
         {
-            return VLC_EGENERIC;
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8
+            int64_t i_old;
+
+            /* A torn read of the old value only makes the swap fail */
+            do
+                i_old = p_counter->value.i_int;
+            while( !__sync_bool_compare_and_swap( &p_counter->value.i_int,
+                                                  i_old, val.i_int ) );
+            break;
+#endif
         }
-        p_counter->last_update = now;
-        if( p_counter->i_type != VLC_VAR_FLOAT &&
-            p_counter->i_type != VLC_VAR_INTEGER )
+        else if( p_counter->i_type != VLC_VAR_FLOAT )
         {
             msg_Err( p_handler, "Unable to compute DERIVATIVE for this type");
             return VLC_EGENERIC;
         }
-        /* Insert the new one at the beginning */
-        p_new = (counter_sample_t*)malloc( sizeof( counter_sample_t ) );
-        p_new->value = val;
-        p_new->date = p_counter->last_update;
-        INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                     0, p_new );
-
-        if( p_counter->i_samples == 3 )
-        {
-            p_old = p_counter->pp_samples[2];
-            REMOVE_ELEM( p_counter->pp_samples, p_counter->i_samples, 2 );
-            free( p_old );
-        }
+        vlc_mutex_lock( &p_counter->value_lock );
+        p_counter->value = val;
+        vlc_mutex_unlock( &p_counter->value_lock );
         break;
-    }
     case STATS_COUNTER:
-        if( p_counter->i_samples > 1)
+        if( p_counter->i_type != VLC_VAR_INTEGER )
         {
-            msg_Err( p_handler, "LAST counter has several samples !" );
+            msg_Err( p_handler, "Trying to increment invalid variable %s",
+                     p_counter->psz_name );
             return VLC_EGENERIC;
         }
-        if( p_counter->i_samples == 0 )
-        {
-            counter_sample_t *p_new = (counter_sample_t*)malloc(
-                                               sizeof( counter_sample_t ) );
-            p_new->value.psz_string = NULL;
-
-            INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                         p_counter->i_samples, p_new );
-        }
-        if( p_counter->i_samples == 1 )
-        {
-            switch( p_counter->i_type )
-            {
-            case VLC_VAR_INTEGER:
-                p_counter->pp_samples[0]->value.i_int += val.i_int;
-                if( new_val )
-                    new_val->i_int = p_counter->pp_samples[0]->value.i_int;
-                break;
-            case VLC_VAR_FLOAT:
-                p_counter->pp_samples[0]->value.f_float += val.f_float;
-                if( new_val )
-                    new_val->f_float = p_counter->pp_samples[0]->value.f_float;
-            default:
-                msg_Err( p_handler, "Trying to increment invalid variable %s",
-                         p_counter->psz_name );
-                return VLC_EGENERIC;
-            }
-        }
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8
+        val.i_int = __sync_add_and_fetch( &p_counter->value.i_int, val.i_int );
+#else
+        vlc_mutex_lock( &p_counter->value_lock );
+        val.i_int = p_counter->value.i_int += val.i_int;
+        vlc_mutex_unlock( &p_counter->value_lock );
+#endif
+        if( new_val )
+            new_val->i_int = val.i_int;
         break;
     }
     return VLC_SUCCESS;
 }
 
+/**
+ * Takes a sample of a derivative counter, if the last one is older than the
+ * update interval. Only the two last samples are kept.
+ */
+static void CounterSample( counter_t *p_counter )
+{
+    mtime_t now = mdate();
+    vlc_value_t val;
+
+    if( p_counter->i_samples > 0
+     && now - p_counter->last_update < p_counter->update_interval )
+        return;
+
+    val = CounterGetValue( p_counter );
+
+    counter_sample_t *p_new;
+    if( p_counter->i_samples == 2 )
+    {   /* Recycle the oldest sample */
+        p_new = p_counter->pp_samples[1];
+        REMOVE_ELEM( p_counter->pp_samples, p_counter->i_samples, 1 );
+    }
+    else
+    {
+        p_new = malloc( sizeof( *p_new ) );
+        if( !p_new )
+            return;
+    }
+    p_new->value = val;
+    p_new->date = p_counter->last_update = now;
+    INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples, 0, p_new );
+}
+
+/**
+ * Reads the current value of a counter or derivative.
+ */
+static vlc_value_t CounterGetValue( counter_t *p_counter )
+{
+    vlc_value_t val;
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8
+    if( p_counter->i_type == VLC_VAR_INTEGER )
+    {
+        val.i_int = __sync_add_and_fetch( &p_counter->value.i_int, 0 );
+        return val;
+    }
+#endif
+    vlc_mutex_lock( &p_counter->value_lock );
+    val = p_counter->value;
+    vlc_mutex_unlock( &p_counter->value_lock );
+    return val;
+}
+
 static void TimerDump( vlc_object_t *p_obj, counter_t *p_counter,
                        bool b_total )
 {
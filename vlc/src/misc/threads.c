@@ -234,6 +234,82 @@ void vlc_thread_cancel (vlc_object_t *obj)
         vlc_cancel (priv->thread_id);
 }
 
+/*** Worker threads ***/
+
+static void *vlc_workers_thread (void *data)
+{
+    vlc_workers_t *workers = data;
+
+    /* The threads are interchangeable: whichever wakes up first exits */
+    vlc_mutex_lock (&workers->lock);
+    while (workers->exiting == 0)
+        workers->pf_run (workers);
+    workers->exiting--;
+    vlc_mutex_unlock (&workers->lock);
+    return NULL;
+}
+
+/**
+ * Takes a reference on a pool of worker threads. The first reference starts
+ * up to count threads.
+ * @return 0 on success, an error code if no thread could be started.
+ */
+int vlc_workers_hold (vlc_workers_t *workers, unsigned count, int priority)
+{
+    int ret = 0;
+
+    if (count > VLC_WORKERS_MAX)
+        count = VLC_WORKERS_MAX;
+
+    vlc_mutex_lock (&workers->lock);
+    if (!workers->initialized)
+    {
+        vlc_cond_init (&workers->wait);
+        vlc_cond_init (&workers->done);
+        workers->initialized = true;
+    }
+    if (workers->refs == 0)
+    {
+        while (workers->count < count)
+        {
+            vlc_thread_t th;
+
+            ret = vlc_clone (&th, vlc_workers_thread, workers, priority);
+            if (ret)
+                break;
+            vlc_detach (th);
+            workers->count++;
+        }
+    }
+    if (workers->count > 0)
+    {
+        workers->refs++;
+        ret = 0;
+    }
+    vlc_mutex_unlock (&workers->lock);
+    return ret;
+}
+
+/**
+ * Releases a reference taken with vlc_workers_hold(). The last reference
+ * calls pf_stop(), if any, and stops the threads. It does not wait for them,
+ * and can thus be released from one of the threads.
+ */
+void vlc_workers_release (vlc_workers_t *workers)
+{
+    vlc_mutex_lock (&workers->lock);
+    assert (workers->refs > 0);
+    if (--workers->refs == 0)
+    {
+        if (workers->pf_stop != NULL)
+            workers->pf_stop (workers);
+        workers->exiting += workers->count;
+        workers->count = 0;
+        vlc_cond_broadcast (&workers->wait);
+    }
+    vlc_mutex_unlock (&workers->lock);
+}
+
 /*** Global locks ***/
 
 void vlc_global_mutex (unsigned n, bool acquire)
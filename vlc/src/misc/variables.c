@@ -30,11 +30,11 @@
 
 #include <vlc_common.h>
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 #include "variables.h"
 
 #include "libvlc.h"
 
-#include <search.h>
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
@@ -48,6 +48,24 @@ struct callback_entry_t
     void *         p_data;
 };
 
+/**
+ * Where var_Inherit() last found a variable. The owner is the object itself
+ * or one of its ancestors, which the object holds, or NULL if the value came
+ * from the configuration. Any variable creation or destruction anywhere, and
+ * any object attachment, bump the generation and thus invalidate all entries.
+ */
+typedef struct
+{
+    char         *psz_name;
+    uint32_t      i_hash;
+    uintptr_t     i_generation;
+    vlc_object_t *p_owner;
+} inherit_entry_t;
+
+#define INHERIT_CACHE_SIZE 8
+
+static vlc_atomic_t inherit_generation;
+
 /*****************************************************************************
  * Local comparison functions, returns 0 if v == w, < 0 if v < w, > 0 if v > w
  *****************************************************************************/
@@ -136,23 +154,113 @@ static void     CheckValue  ( variable_t *, vlc_value_t * );
 static int      TriggerCallback( vlc_object_t *, variable_t *, const char *,
                                  vlc_value_t );
 
-static int varcmp( const void *a, const void *b )
+static uint32_t Hash( const char *psz_name )
+{
+    uint32_t i_hash = 2166136261u; /* FNV-1a */
+
+    while( *psz_name )
+        i_hash = (i_hash ^ (unsigned char)*psz_name++) * 16777619u;
+    return i_hash;
+}
+
+/**
+ * Finds a variable in the open addressing table of the object. The name is
+ * only compared if the hash matches, and the hash can be computed once for
+ * several objects.
+ */
+static variable_t *LookupHash( vlc_object_t *obj, const char *psz_name,
+                               uint32_t i_hash )
 {
-    const variable_t *va = a, *vb = b;
+    vlc_object_internals_t *priv = vlc_internals( obj );
+
+    vlc_assert_locked( &priv->var_lock );
+    if( priv->var_table == NULL )
+        return NULL;
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
-    return strcmp( va->psz_name, vb->psz_name );
+    /* The table is never full, there is always an empty slot */
+    for( unsigned i = i_hash & priv->var_mask;; i = (i + 1) & priv->var_mask )
+    {
+        variable_t *p_var = priv->var_table[i];
+
+        if( p_var == NULL )
+            return NULL;
+        if( p_var->i_hash == i_hash && !strcmp( p_var->psz_name, psz_name ) )
+            return p_var;
+    }
 }
 
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
+{
+    return LookupHash( obj, psz_name, Hash( psz_name ) );
+}
+
+static void Place( variable_t **table, unsigned mask, variable_t *p_var )
+{
+    unsigned i = p_var->i_hash & mask;
+
+    while( table[i] != NULL )
+        i = (i + 1) & mask;
+    table[i] = p_var;
+}
+
+/**
+ * Adds a new variable to the table of the object, which is grown as needed
+ * to stay at most three quarters full.
+ */
+static int Insert( vlc_object_t *obj, variable_t *p_var )
+{
+    vlc_object_internals_t *priv = vlc_internals( obj );
+    unsigned i_size = priv->var_table ? priv->var_mask + 1 : 0;
+
+    vlc_assert_locked( &priv->var_lock );
+    if( 4 * (priv->var_count + 1) > 3 * i_size )
+    {
+        unsigned i_new = i_size ? 2 * i_size : 16;
+        variable_t **table = calloc( i_new, sizeof( *table ) );
+
+        if( unlikely(table == NULL) )
+            return VLC_ENOMEM;
+        for( unsigned i = 0; i < i_size; i++ )
+            if( priv->var_table[i] != NULL )
+                Place( table, i_new - 1, priv->var_table[i] );
+        free( priv->var_table );
+        priv->var_table = table;
+        priv->var_mask = i_new - 1;
+    }
+
+    Place( priv->var_table, priv->var_mask, p_var );
+    priv->var_count++;
+    return VLC_SUCCESS;
+}
+
+/**
+ * Removes a variable from the table of the object. The following entries
+ * of the same cluster are shifted back, so that no tombstones are needed.
+ */
+static void Remove( vlc_object_t *obj, variable_t *p_var )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-    variable_t **pp_var;
+    variable_t **table = priv->var_table;
+    const unsigned mask = priv->var_mask;
+    unsigned i = p_var->i_hash & mask;
 
     vlc_assert_locked( &priv->var_lock );
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
-    return (pp_var != NULL) ? *pp_var : NULL;
+    while( table[i] != p_var )
+        i = (i + 1) & mask;
+    table[i] = NULL;
+    priv->var_count--;
+
+    for( unsigned j = (i + 1) & mask; table[j] != NULL; j = (j + 1) & mask )
+    {
+        unsigned k = table[j]->i_hash & mask;
+
+        /* Leave the entry if its home slot is cyclically within (i, j] */
+        if( (i <= j) ? (i < k && k <= j) : (i < k || k <= j) )
+            continue;
+        table[i] = table[j];
+        table[j] = NULL;
+        i = j;
+    }
 }
 
 static void Destroy( variable_t *p_var )
@@ -178,9 +286,9 @@ static void Destroy( variable_t *p_var )
 /**
  * Initialize a vlc variable
  *
- * We hash the given string and insert it into the sorted list. The insertion
- * may require slow memory copies, but think about what we gain in the log(n)
- * lookup phase when setting/getting the variable value!
+ * We hash the given string and insert it into the hash table of the object.
+ * The table is grown when it gets three quarters full, so that lookups stay
+ * cheap when setting/getting the variable value.
  *
  * \param p_this The object in which to create the variable
  * \param psz_name The name of the variable
@@ -196,6 +304,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = Hash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -278,16 +387,22 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
     }
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
-    variable_t **pp_var, *p_oldvar;
+    variable_t *p_oldvar;
     int ret = VLC_SUCCESS;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
-    if( unlikely(pp_var == NULL) )
-        ret = VLC_ENOMEM;
-    else if( (p_oldvar = *pp_var) == p_var )
-        p_var = NULL;
+    p_oldvar = LookupHash( p_this, psz_name, p_var->i_hash );
+    if( p_oldvar == NULL )
+    {
+        ret = Insert( p_this, p_var );
+        if( likely(ret == VLC_SUCCESS) )
+        {
+            p_var = NULL;
+            /* The new variable may hide an inherited one */
+            var_FlushInheritCache();
+        }
+    }
     else if( unlikely((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) )
     {    /* If the types differ, variable creation failed. */
          msg_Err( p_this, "Variable '%s' (0x%04x) already exist "
@@ -312,8 +427,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
 /**
  * Destroy a vlc variable
  *
- * Look for the variable and destroy it if it is found. As in var_Create we
- * do a call to memmove() but we have performance counterparts elsewhere.
+ * Look for the variable and destroy it if it is found.
  *
  * \param p_this The object that holds the variable
  * \param psz_name The name of the variable
@@ -338,7 +452,10 @@ int var_Destroy( vlc_object_t *p_this, const char *psz_name )
     WaitUnused( p_this, p_var );
 
     if( --p_var->i_usage == 0 )
-        tdelete( p_var, &p_priv->var_root, varcmp );
+    {
+        Remove( p_this, p_var );
+        var_FlushInheritCache();
+    }
     else
         p_var = NULL;
     vlc_mutex_unlock( &p_priv->var_lock );
@@ -348,16 +465,21 @@ int var_Destroy( vlc_object_t *p_this, const char *psz_name )
     return VLC_SUCCESS;
 }
 
-static void CleanupVar( void *var )
-{
-    Destroy( var );
-}
-
 void var_DestroyAll( vlc_object_t *obj )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
-
-    tdestroy( priv->var_root, CleanupVar );
+    inherit_entry_t *cache = priv->var_cache;
+
+    if( priv->var_table != NULL )
+        for( unsigned i = 0; i <= priv->var_mask; i++ )
+            if( priv->var_table[i] != NULL )
+                Destroy( priv->var_table[i] );
+    free( priv->var_table );
+
+    if( cache != NULL )
+        for( unsigned i = 0; i < INHERIT_CACHE_SIZE; i++ )
+            free( cache[i].psz_name );
+    free( cache );
 }
 
 #undef var_Change
@@ -768,9 +890,8 @@ int var_Set( vlc_object_t *p_this, const char *psz_name, vlc_value_t val )
     return var_SetChecked( p_this, psz_name, 0, val );
 }
 
-#undef var_GetChecked
-int var_GetChecked( vlc_object_t *p_this, const char *psz_name,
-                    int expected_type, vlc_value_t *p_val )
+static int GetChecked( vlc_object_t *p_this, const char *psz_name,
+                       uint32_t i_hash, int expected_type, vlc_value_t *p_val )
 {
     assert( p_this );
 
@@ -780,7 +901,7 @@ int var_GetChecked( vlc_object_t *p_this, const char *psz_name,
 
     vlc_mutex_lock( &p_priv->var_lock );
 
-    p_var = Lookup( p_this, psz_name );
+    p_var = LookupHash( p_this, psz_name, i_hash );
     if( p_var != NULL )
     {
         assert( expected_type == 0 ||
@@ -805,6 +926,14 @@ int var_GetChecked( vlc_object_t *p_this, const char *psz_name,
     return err;
 }
 
+#undef var_GetChecked
+int var_GetChecked( vlc_object_t *p_this, const char *psz_name,
+                    int expected_type, vlc_value_t *p_val )
+{
+    return GetChecked( p_this, psz_name, Hash( psz_name ), expected_type,
+                       p_val );
+}
+
 #undef var_Get
 /**
  * Get a variable's value
@@ -1176,11 +1305,21 @@ static void CheckValue ( variable_t *p_var, vlc_value_t *p_val )
     }
 }
 
+/**
+ * Invalidates the owners of inherited variables cached by var_Inherit() in
+ * all objects.
+ */
+void var_FlushInheritCache( void )
+{
+    vlc_atomic_inc( &inherit_generation );
+}
+
 /**
  * Finds the value of a variable. If the specified object does not hold a
  * variable with the specified name, try the parent object, and iterate until
  * the top of the tree. If no match is found, the value is read from the
- * configuration.
+ * configuration. The object where the variable was found, if any, is cached
+ * until a variable is created or destroyed, or an object is attached.
  */
 int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
                  vlc_value_t *p_val )
@@ -1193,11 +1332,48 @@ int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
         //vlc_backtrace ();
     }
 #endif
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    const uint32_t i_hash = Hash( psz_name );
+    const uintptr_t i_generation = vlc_atomic_get( &inherit_generation );
+    inherit_entry_t *p_entry;
+    vlc_object_t *p_owner = NULL;
+    bool b_cached = false;
+
     i_type &= VLC_VAR_CLASS;
-    for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->p_parent )
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    if( p_priv->var_cache != NULL )
+    {
+        p_entry = (inherit_entry_t *)p_priv->var_cache
+                + i_hash % INHERIT_CACHE_SIZE;
+        if( p_entry->i_generation == i_generation
+         && p_entry->psz_name != NULL && p_entry->i_hash == i_hash
+         && !strcmp( p_entry->psz_name, psz_name ) )
+        {
+            p_owner = p_entry->p_owner;
+            b_cached = true;
+        }
+    }
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    if( b_cached )
     {
-        if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
+        if( p_owner == NULL )
+            goto config;
+        if( GetChecked( p_owner, psz_name, i_hash, i_type, p_val )
+                == VLC_SUCCESS )
             return VLC_SUCCESS;
+        p_owner = NULL; /* destroyed in the mean time */
+    }
+
+    for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->p_parent )
+    {
+        if( GetChecked( obj, psz_name, i_hash, i_type, p_val )
+                == VLC_SUCCESS )
+        {
+            p_owner = obj;
+            break;
+        }
 #ifndef NDEBUG
         if (obj != p_this && obj != VLC_OBJECT(p_this->p_libvlc)
          && unlikely(obj->p_parent == NULL))
@@ -1209,6 +1385,32 @@ int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
 #endif
     }
 
+    /* Remember where the variable was found. The generation was read before
+     * looking, so that any concurrent change will invalidate the entry. */
+    vlc_mutex_lock( &p_priv->var_lock );
+    if( p_priv->var_cache == NULL )
+        p_priv->var_cache = calloc( INHERIT_CACHE_SIZE,
+                                    sizeof( inherit_entry_t ) );
+    if( likely(p_priv->var_cache != NULL) )
+    {
+        p_entry = (inherit_entry_t *)p_priv->var_cache
+                + i_hash % INHERIT_CACHE_SIZE;
+        if( p_entry->psz_name == NULL
+         || strcmp( p_entry->psz_name, psz_name ) )
+        {
+            free( p_entry->psz_name );
+            p_entry->psz_name = strdup( psz_name );
+        }
+        p_entry->i_hash = i_hash;
+        p_entry->i_generation = i_generation;
+        p_entry->p_owner = p_owner;
+    }
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    if( p_owner != NULL )
+        return VLC_SUCCESS;
+
+config:
     /* else take value from config */
     switch( i_type & VLC_VAR_CLASS )
     {
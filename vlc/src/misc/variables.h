@@ -43,7 +43,8 @@ typedef struct variable_ops_t
  */
 struct variable_t
 {
-    char *       psz_name; /**< The variable unique name (must be first) */
+    char *       psz_name; /**< The variable unique name */
+    uint32_t     i_hash;   /**< Hash of the name */
 
     /** The variable's exported value */
     vlc_value_t  val;
@@ -77,5 +78,6 @@ struct variable_t
 };
 
 extern void var_DestroyAll( vlc_object_t * );
+extern void var_FlushInheritCache( void );
 
 #endif
@@ -36,7 +36,9 @@
 #include <string.h>                                              /* strdup() */
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
+#include <vlc_block.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include <sys/types.h>
 #ifdef HAVE_UNISTD_H
@@ -55,11 +57,9 @@
  * Local prototypes
  *****************************************************************************/
 #ifdef HAVE_DYNAMIC_PLUGINS
-static int    CacheLoadConfig  ( module_t *, FILE * );
-
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 11
+#define CACHE_SUBVERSION_NUM 13
 
 /* Format string for the cache filename */
 #define CACHENAME_FORMAT \
@@ -67,8 +67,126 @@ static int    CacheLoadConfig  ( module_t *, FILE * );
 /* Magic for the cache filename */
 #define CACHENAME_VALUES \
     sizeof(int), sizeof(void *), *(uint8_t *)&(uint16_t){ 0xbe1e }, vlc_CPU()
-#define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
+#ifdef DISTRO_VERSION
+# define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION" "DISTRO_VERSION
+#else
+# define CACHE_STRING "cache "PACKAGE_NAME" "PACKAGE_VERSION
+#endif
 
+/*
+ * The cache file is used in place, from a read-only private file mapping.
+ * It only contains fixed-size records and offsets relative to the beginning
+ * of the file; all strings are stored once in a pool of nul-terminated
+ * strings. Loading it takes one allocation per file, for the module
+ * descriptors that LibVLC needs to be able to write.
+ */
+typedef uint32_t cache_str_t; /* offset in the string pool, 0 for NULL */
+#define CACHE_NONE UINT32_MAX
+
+typedef struct
+{
+    uint32_t size;              /* file size */
+    uint32_t version;           /* CACHE_SUBVERSION_NUM */
+    char     magic[64];         /* CACHE_STRING, truncated and zero-padded */
+    uint32_t plugins, plugins_offset;
+    uint32_t modules, modules_offset;
+    uint32_t configs, configs_offset;
+    uint32_t refs, refs_offset; /* string references, for string tables */
+    uint32_t ints, ints_offset; /* integers, for integer tables */
+    uint32_t magics, magics_offset; /* module_magic_t records */
+    uint32_t strings, strings_offset; /* pool size in bytes */
+} cache_header_t;
+
+typedef struct
+{
+    int64_t     time;
+    int64_t     size;
+    cache_str_t file;
+    cache_str_t filename;
+    uint32_t    module;         /* index of the module; submodules follow */
+    uint32_t    submodules;
+    uint32_t    config;         /* index of the first configuration item */
+    uint32_t    confsize;
+    uint32_t    config_items;
+    uint32_t    bool_items;
+    uint32_t    reserved;
+} cache_plugin_t;
+
+typedef struct
+{
+    cache_str_t name;
+    cache_str_t shortname;
+    cache_str_t longname;
+    cache_str_t help;
+    cache_str_t capability;
+    cache_str_t domain;
+    int32_t     score;
+    uint32_t    shortcuts;      /* index of the first shortcut reference */
+    uint32_t    shortcuts_count;
+    uint32_t    magics;         /* index of the first magic */
+    uint32_t    magics_count;
+    uint32_t    extensions;     /* index of the first extension reference */
+    uint32_t    extensions_count;
+    uint32_t    unloadable;
+} cache_module_t;
+
+enum
+{
+    CACHE_CONFIG_ADVANCED   = 0x0001,
+    CACHE_CONFIG_INTERNAL   = 0x0002,
+    CACHE_CONFIG_RESTART    = 0x0004,
+    CACHE_CONFIG_AUTOSAVE   = 0x0008,
+    CACHE_CONFIG_UNSAVEABLE = 0x0010,
+    CACHE_CONFIG_SAFE       = 0x0020,
+    CACHE_CONFIG_REMOVED    = 0x0040,
+    CACHE_CONFIG_CALLBACK   = 0x0080,
+};
+
+typedef struct
+{
+    int64_t     orig;           /* module_value_t, unless string */
+    int64_t     min;
+    int64_t     max;
+    cache_str_t type;
+    cache_str_t name;
+    cache_str_t text;
+    cache_str_t longtext;
+    cache_str_t oldname;
+    cache_str_t orig_psz;
+    uint32_t    list;           /* NULL-terminated string references */
+    uint32_t    list_text;      /* idem */
+    uint32_t    int_list;       /* index in the integers table */
+    int32_t     i_list;
+    uint32_t    action_text;    /* string references */
+    int32_t     i_action;
+    int32_t     i_type;
+    int32_t     i_short;
+    uint32_t    flags;
+    uint32_t    reserved;
+} cache_config_t;
+
+/**
+ * A loaded plugins cache file
+ */
+struct module_cache_map_t
+{
+    block_t        *file;       /* private file mapping (or copy) */
+    size_t          count;
+    module_cache_t *entries;    /* sorted by file name */
+    module_t       *modules;
+    size_t          modules_count;
+};
+
+static void CacheModuleDestruct (gc_object_t *obj)
+{
+    (void) obj; /* owned by the cache map */
+}
+
+static int CacheEntryCmp (const void *a, const void *b)
+{
+    const module_cache_t *ea = a, *eb = b;
+    return strcmp (ea->psz_file, eb->psz_file);
+}
 
 void CacheDelete( vlc_object_t *obj, const char *dir )
 {
@@ -84,378 +202,698 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
+/* This function should never be called.
+ * It is only used as a non-NULL vlc_callback_t value for comparison. */
+static int dummy_callback (vlc_object_t *obj, const char *name,
+                           vlc_value_t oldval, vlc_value_t newval, void *data)
+{
+    (void) obj; (void)name; (void)oldval; (void)newval; (void)data;
+    assert (0);
+}
+
+/* Checks that a table of n records of the given size fits in the file */
+static const void *CacheTable (const block_t *file, uint32_t offset,
+                               uint32_t n, size_t size)
+{
+    if ((offset % 8) || offset > file->i_buffer
+     || n > (file->i_buffer - offset) / size)
+        return NULL;
+    return file->p_buffer + offset;
+}
+
 /*****************************************************************************
- * LoadPluginsCache: loads the plugins cache file
+ * CacheLoad: loads the plugins cache file
  *****************************************************************************
  * This function will load the plugin cache if present and valid. This cache
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ * Returns the number of plugins in the cache.
  *****************************************************************************/
-void CacheLoad( vlc_object_t *p_this, module_bank_t *p_bank, const char *dir )
+size_t CacheLoad( vlc_object_t *p_this, module_bank_t *p_bank,
+                  const char *dir )
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
-    size_t i_cache;
-    module_cache_t **pp_cache = NULL;
-    int32_t i_file_size, i_marker;
+    block_t *file;
+    int fd;
 
     assert( dir != NULL );
 
     if( !p_bank->b_cache )
-        return;
+        return 0;
 
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHENAME_FORMAT,
                   dir, CACHENAME_VALUES ) == -1 )
-        return;
+        return 0;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
+    fd = vlc_open( psz_filename, O_RDONLY );
+    if( fd == -1 )
     {
         msg_Warn( p_this, "cannot read %s (%m)",
                   psz_filename );
         free( psz_filename );
-        return;
+        return 0;
     }
     free( psz_filename );
 
-    /* Check the file size */
-    i_read = fread( &i_file_size, 1, sizeof(i_file_size), file );
-    if( i_read != sizeof(i_file_size) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(too short)" );
-        fclose( file );
-        return;
-    }
+    file = block_File( fd );
+    close( fd );
+    if( file == NULL )
+        return 0;
 
-    fseek( file, 0, SEEK_END );
-    if( ftell( file ) != i_file_size )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted size)" );
-        fclose( file );
-        return;
-    }
-    fseek( file, sizeof(i_file_size), SEEK_SET );
+    /* Check the header */
+    const cache_header_t *hdr = (const cache_header_t *)file->p_buffer;
+    char magic[sizeof (hdr->magic)];
 
-    /* Check the file is a plugins cache */
-    i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
+    strncpy( magic, CACHE_STRING, sizeof (magic) );
+    if( file->i_buffer < sizeof (*hdr)
+     || hdr->size != file->i_buffer
+     || memcmp( hdr->magic, magic, sizeof (magic) ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return;
+        block_Release( file );
+        return 0;
     }
 
-#ifdef DISTRO_VERSION
-    /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
-    i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return;
-    }
-#endif
-
-    /* Check Sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
+    if( hdr->version != CACHE_SUBVERSION_NUM )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
-        return;
+        block_Release( file );
+        return 0;
     }
 
-    /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
+    const cache_plugin_t *plugins = CacheTable( file, hdr->plugins_offset,
+                                                hdr->plugins,
+                                                sizeof (*plugins) );
+    const cache_module_t *modules = CacheTable( file, hdr->modules_offset,
+                                                hdr->modules,
+                                                sizeof (*modules) );
+    const cache_config_t *configs = CacheTable( file, hdr->configs_offset,
+                                                hdr->configs,
+                                                sizeof (*configs) );
+    const cache_str_t *refs = CacheTable( file, hdr->refs_offset, hdr->refs,
+                                          sizeof (*refs) );
+    const int32_t *ints = CacheTable( file, hdr->ints_offset, hdr->ints,
+                                      sizeof (*ints) );
+    const module_magic_t *magics = CacheTable( file, hdr->magics_offset,
+                                               hdr->magics,
+                                               sizeof (*magics) );
+    const char *strings = CacheTable( file, hdr->strings_offset,
+                                      hdr->strings, 1 );
+    if( plugins == NULL || modules == NULL || configs == NULL
+     || refs == NULL || ints == NULL || magics == NULL || strings == NULL
+     || hdr->strings == 0 || strings[0] || strings[hdr->strings - 1] )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted header)" );
-        fclose( file );
-        return;
+                  "(corrupted tables)" );
+        block_Release( file );
+        return 0;
     }
 
-    if (fread( &i_cache, 1, sizeof(i_cache), file ) != sizeof(i_cache) )
+    /* Allocate the writable descriptors at once */
+    module_cache_map_t *map;
+    size_t size = sizeof (*map)
+                + hdr->plugins * sizeof (module_cache_t)
+                + hdr->modules * sizeof (module_t)
+                + hdr->configs * sizeof (module_config_t)
+                + hdr->refs * sizeof (char *);
+    module_cache_map_t **pp_maps = realloc( p_bank->pp_cache_maps,
+                    (p_bank->i_cache_maps + 1) * sizeof (*pp_maps) );
+
+    if( unlikely(pp_maps == NULL) )
     {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(file too short)" );
-        fclose( file );
-        return;
+        block_Release( file );
+        return 0;
     }
+    p_bank->pp_cache_maps = pp_maps;
 
-    if( i_cache )
+    map = calloc( 1, size );
+    if( unlikely(map == NULL) )
     {
-        size_t i_already = p_bank->i_loaded_cache;
-        pp_cache = realloc( p_bank->pp_loaded_cache,
-                            (i_already + i_cache) * sizeof(*pp_cache) );
-        if( unlikely(pp_cache == NULL) )
-            i_cache = 0; /* don't load */
-        else
-        {
-            p_bank->pp_loaded_cache = pp_cache;
-            pp_cache += i_already;
-        }
-   }
-
-#define LOAD_IMMEDIATE(a) \
-    if( fread( (void *)&a, sizeof(char), sizeof(a), file ) != sizeof(a) ) goto error
-#define LOAD_STRING(a) \
-{ \
-    a = NULL; \
-    if( ( fread( &i_size, sizeof(i_size), 1, file ) != 1 ) \
-     || ( i_size > 16384 ) ) \
-        goto error; \
-    if( i_size ) { \
-        char *psz = xmalloc( i_size ); \
-        if( fread( psz, i_size, 1, file ) != 1 ) { \
-            free( psz ); \
-            goto error; \
-        } \
-        if( psz[i_size-1] ) { \
-            free( psz ); \
-            goto error; \
-        } \
-        a = psz; \
-    } \
-}
-
-    for( size_t i = 0; i < i_cache; i++ )
+        block_Release( file );
+        return 0;
+    }
+    map->file = file;
+    map->count = hdr->plugins;
+    map->entries = (module_cache_t *)(map + 1);
+    map->modules = (module_t *)(map->entries + hdr->plugins);
+    map->modules_count = hdr->modules;
+
+    module_config_t *config = (module_config_t *)(map->modules + hdr->modules);
+    char **ptrs = (char **)(config + hdr->configs);
+
+    /* Out-of-range strings are replaced by NULL and flag the file corrupt */
+#define STR(off) \
+    ((off) ? ((off) < hdr->strings ? (char *)strings + (off) \
+                                   : (corrupt = true, (char *)NULL)) \
+           : NULL)
+    bool corrupt = false;
+    uint32_t next_module = 0, next_config = 0;
+
+    for( uint32_t i = 0; i < hdr->refs; i++ )
+        ptrs[i] = (refs[i] == CACHE_NONE) ? NULL : STR(refs[i]);
+
+    for( uint32_t i = 0; i < hdr->plugins && !corrupt; i++ )
     {
-        uint16_t i_size;
-        int i_submodules;
-
-        pp_cache[i] = xmalloc( sizeof(module_cache_t) );
-
-        /* Load common info */
-        LOAD_STRING( pp_cache[i]->psz_file );
-        LOAD_IMMEDIATE( pp_cache[i]->i_time );
-        LOAD_IMMEDIATE( pp_cache[i]->i_size );
-
-        pp_cache[i]->p_module = vlc_module_create( p_this );
-
-        /* Load additional infos */
-        free( pp_cache[i]->p_module->psz_object_name );
-        LOAD_STRING( pp_cache[i]->p_module->psz_object_name );
-        LOAD_STRING( pp_cache[i]->p_module->psz_shortname );
-        LOAD_STRING( pp_cache[i]->p_module->psz_longname );
-        LOAD_STRING( pp_cache[i]->p_module->psz_help );
+        const cache_plugin_t *plugin = plugins + i;
+        module_cache_t *entry = map->entries + i;
+
+        /* Plugins follow each other in the tables */
+        if( plugin->module != next_module || next_module >= hdr->modules
+         || plugin->submodules >= hdr->modules - next_module
+         || plugin->config != next_config
+         || plugin->confsize > hdr->configs - next_config )
+            goto error;
+        next_module += 1 + plugin->submodules;
+        next_config += plugin->confsize;
 
-        LOAD_IMMEDIATE( pp_cache[i]->p_module->i_shortcuts );
-        if( pp_cache[i]->p_module->i_shortcuts > MODULE_SHORTCUT_MAX )
+        entry->psz_file = STR(plugin->file);
+        entry->i_time = plugin->time;
+        entry->i_size = plugin->size;
+        if( entry->psz_file == NULL )
             goto error;
-        else if( pp_cache[i]->p_module->i_shortcuts == 0 )
-            pp_cache[i]->p_module->pp_shortcuts = NULL;
-        else
-        {
-            pp_cache[i]->p_module->pp_shortcuts =
-                    xmalloc( sizeof( char ** ) * pp_cache[i]->p_module->i_shortcuts );
-            for( unsigned j = 0; j < pp_cache[i]->p_module->i_shortcuts; j++ )
-                LOAD_STRING( pp_cache[i]->p_module->pp_shortcuts[j] );
-        }
 
-        LOAD_STRING( pp_cache[i]->p_module->psz_capability );
-        LOAD_IMMEDIATE( pp_cache[i]->p_module->i_score );
-        LOAD_IMMEDIATE( pp_cache[i]->p_module->b_unloadable );
-        LOAD_IMMEDIATE( pp_cache[i]->p_module->b_submodule );
+        /* Module and submodules */
+        module_t *parent = map->modules + plugin->module, **pp_next = NULL;
 
-        /* Config stuff */
-        if( CacheLoadConfig( pp_cache[i]->p_module, file ) != VLC_SUCCESS )
-            goto error;
+        for( uint32_t j = 0; j <= plugin->submodules; j++ )
+        {
+            const cache_module_t *m = modules + plugin->module + j;
+            module_t *p_module = parent + j;
+
+            if( m->shortcuts > hdr->refs
+             || m->shortcuts_count > hdr->refs - m->shortcuts
+             || m->shortcuts_count > MODULE_SHORTCUT_MAX
+             || m->magics > hdr->magics
+             || m->magics_count > hdr->magics - m->magics
+             || m->extensions > hdr->refs
+             || m->extensions_count > hdr->refs - m->extensions )
+                goto error;
 
-        LOAD_STRING( pp_cache[i]->p_module->psz_filename );
-        LOAD_STRING( pp_cache[i]->p_module->domain );
-        if( pp_cache[i]->p_module->domain != NULL )
-            vlc_bindtextdomain( pp_cache[i]->p_module->domain );
+            vlc_gc_init( p_module, CacheModuleDestruct );
+            p_module->psz_object_name = STR(m->name);
+            p_module->psz_shortname = STR(m->shortname);
+            p_module->psz_longname = STR(m->longname);
+            p_module->psz_help = STR(m->help);
+            p_module->psz_capability = STR(m->capability);
+            p_module->i_score = m->score;
+            p_module->i_shortcuts = m->shortcuts_count;
+            p_module->pp_shortcuts = m->shortcuts_count ? ptrs + m->shortcuts
+                                                        : NULL;
+            p_module->i_magics = m->magics_count;
+            p_module->p_magics = m->magics_count
+                ? (module_magic_t *)(magics + m->magics) : NULL;
+            p_module->i_extensions = m->extensions_count;
+            p_module->pp_extensions = m->extensions_count
+                                    ? ptrs + m->extensions : NULL;
+            p_module->b_unloadable = m->unloadable != 0;
+            p_module->b_mapped = true;
+            p_module->domain = STR(m->domain);
+            if( p_module->psz_object_name == NULL
+             || p_module->psz_longname == NULL
+             || p_module->psz_capability == NULL )
+                goto error;
+            for( unsigned k = 0; k < p_module->i_shortcuts; k++ )
+                if( p_module->pp_shortcuts[k] == NULL )
+                    goto error;
+            for( unsigned k = 0; k < p_module->i_extensions; k++ )
+                if( p_module->pp_extensions[k] == NULL )
+                    goto error;
+            for( unsigned k = 0; k < p_module->i_magics; k++ )
+                if( p_module->p_magics[k].i_length == 0
+                 || p_module->p_magics[k].i_length > MODULE_MAGIC_MAX
+                 || p_module->p_magics[k].i_offset
+                    > MODULE_PROBE_SIZE - p_module->p_magics[k].i_length )
+                    goto error;
+
+            if( j == 0 )
+            {
+                pp_next = &p_module->submodule;
+                continue;
+            }
+            p_module->b_submodule = true;
+            p_module->parent = parent;
+            *pp_next = p_module;
+            pp_next = &p_module->next;
+            parent->submodule_count++;
+        }
 
-        LOAD_IMMEDIATE( i_submodules );
+        parent->psz_filename = STR(plugin->filename);
+        parent->i_config_items = plugin->config_items;
+        parent->i_bool_items = plugin->bool_items;
+        parent->confsize = plugin->confsize;
+        parent->p_config = plugin->confsize ? config + plugin->config : NULL;
+        entry->p_module = parent;
 
-        while( i_submodules-- )
+        /* Configuration items */
+        for( uint32_t j = 0; j < plugin->confsize; j++ )
         {
-            module_t *p_module = vlc_submodule_create( pp_cache[i]->p_module );
-            free( p_module->psz_object_name );
-            free( p_module->pp_shortcuts );
-            LOAD_STRING( p_module->psz_object_name );
-            LOAD_STRING( p_module->psz_shortname );
-            LOAD_STRING( p_module->psz_longname );
-            LOAD_STRING( p_module->psz_help );
-
-            LOAD_IMMEDIATE( p_module->i_shortcuts );
-            if( p_module->i_shortcuts > MODULE_SHORTCUT_MAX )
+            const cache_config_t *c = configs + plugin->config + j;
+            module_config_t *item = parent->p_config + j;
+
+            if( c->i_list < 0 || c->i_action < 0
+             || (c->list != CACHE_NONE && (c->list > hdr->refs
+                 || (uint32_t)c->i_list >= hdr->refs - c->list
+                 || ptrs[c->list + c->i_list] != NULL))
+             || (c->list_text != CACHE_NONE && (c->list_text > hdr->refs
+                 || (uint32_t)c->i_list >= hdr->refs - c->list_text
+                 || ptrs[c->list_text + c->i_list] != NULL))
+             || (c->int_list != CACHE_NONE && (c->int_list > hdr->ints
+                 || (uint32_t)c->i_list > hdr->ints - c->int_list))
+             || c->action_text > hdr->refs
+             || (uint32_t)c->i_action > hdr->refs - c->action_text )
                 goto error;
-            else if( p_module->i_shortcuts == 0 )
-                p_module->pp_shortcuts = NULL;
+
+            item->psz_type = STR(c->type);
+            item->psz_name = STR(c->name);
+            item->psz_text = STR(c->text);
+            item->psz_longtext = STR(c->longtext);
+            item->psz_oldname = STR(c->oldname);
+            item->i_type = c->i_type;
+            item->i_short = c->i_short;
+            memcpy( &item->min, &c->min, sizeof (item->min) );
+            memcpy( &item->max, &c->max, sizeof (item->max) );
+
+            if( IsConfigStringType( item->i_type ) )
+            {
+                item->orig.psz = STR(c->orig_psz);
+                /* Only the current and saved values are owned by the item */
+                item->value.psz = (item->orig.psz != NULL)
+                                ? strdup( item->orig.psz ) : NULL;
+                item->saved.psz = NULL;
+            }
             else
             {
-                p_module->pp_shortcuts = xmalloc( sizeof( char ** ) * p_module->i_shortcuts );
-                for( unsigned j = 0; j < p_module->i_shortcuts; j++ )
-                    LOAD_STRING( p_module->pp_shortcuts[j] );
+                memcpy( &item->orig, &c->orig, sizeof (item->orig) );
+                item->value = item->saved = item->orig;
             }
 
-            LOAD_STRING( p_module->psz_capability );
-            LOAD_IMMEDIATE( p_module->i_score );
-            LOAD_IMMEDIATE( p_module->b_unloadable );
-            LOAD_STRING( p_module->domain );
+            item->i_list = c->i_list;
+            if( c->list != CACHE_NONE )
+                item->ppsz_list = ptrs + c->list;
+            if( c->list_text != CACHE_NONE )
+                item->ppsz_list_text = ptrs + c->list_text;
+            if( c->int_list != CACHE_NONE )
+                item->pi_list = (int *)(ints + c->int_list);
+            item->i_action = c->i_action;
+            if( c->i_action )
+                item->ppsz_action_text = ptrs + c->action_text;
+
+            item->b_advanced = (c->flags & CACHE_CONFIG_ADVANCED) != 0;
+            item->b_internal = (c->flags & CACHE_CONFIG_INTERNAL) != 0;
+            item->b_restart = (c->flags & CACHE_CONFIG_RESTART) != 0;
+            item->b_autosave = (c->flags & CACHE_CONFIG_AUTOSAVE) != 0;
+            item->b_unsaveable = (c->flags & CACHE_CONFIG_UNSAVEABLE) != 0;
+            item->b_safe = (c->flags & CACHE_CONFIG_SAFE) != 0;
+            item->b_removed = (c->flags & CACHE_CONFIG_REMOVED) != 0;
+            if( c->flags & CACHE_CONFIG_CALLBACK )
+                item->pf_callback = dummy_callback;
         }
+
+        if( parent->domain != NULL )
+            vlc_bindtextdomain( parent->domain );
     }
-    p_bank->i_loaded_cache += i_cache;
+#undef STR
+    if( corrupt )
+        goto error;
 
-    fclose( file );
-    return;
+    qsort( map->entries, map->count, sizeof (*map->entries), CacheEntryCmp );
+    p_bank->pp_cache_maps[p_bank->i_cache_maps++] = map;
+    return map->count;
 
  error:
-
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
-    fclose( file );
-    return;
+    for( uint32_t i = 0; i < hdr->configs; i++ )
+        if( IsConfigStringType( config[i].i_type ) )
+            free( config[i].value.psz );
+    free( map );
+    block_Release( file );
+    return 0;
 }
 
-
-/* This function should never be called.
- * It is only used as a non-NULL vlc_callback_t value for comparison. */
-static int dummy_callback (vlc_object_t *obj, const char *name,
-                           vlc_value_t oldval, vlc_value_t newval, void *data)
+/*****************************************************************************
+ * CacheUnload: releases a plugins cache file
+ *****************************************************************************
+ * The modules of the cache must have been deleted already.
+ *****************************************************************************/
+void CacheUnload( module_cache_map_t *map )
 {
-    (void) obj; (void)name; (void)oldval; (void)newval; (void)data;
-    assert (0);
+    block_Release( map->file );
+    free( map );
 }
 
+/*****************************************************************************
+ * CacheGet: gets the plugins of a cache file
+ *****************************************************************************/
+size_t CacheGet( const module_cache_map_t *map, module_cache_t **pp_entries )
+{
+    *pp_entries = map->entries;
+    return map->count;
+}
 
-static int CacheLoadConfig( module_t *p_module, FILE *file )
+/*
+ * Cache file writer: all tables are built in memory, then written at once.
+ */
+typedef struct
 {
-    uint32_t i_lines;
-    uint16_t i_size;
+    uint8_t *p_data;
+    size_t   i_size;
+    size_t   i_max;
+} cache_buf_t;
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE( p_module->i_config_items );
-    LOAD_IMMEDIATE( p_module->i_bool_items );
+typedef struct
+{
+    cache_buf_t plugins, modules, configs, refs, ints, magics, strings;
 
-    LOAD_IMMEDIATE( i_lines );
+    /* String interning: open addressing hash table of pool offsets */
+    cache_str_t *hash;
+    size_t       hash_size; /* power of two */
+    size_t       hash_count;
+} cache_writer_t;
 
-    /* Allocate memory */
-    if (i_lines)
+static void *CacheAppend (cache_buf_t *buf, const void *data, size_t len)
+{
+    if (buf->i_size + len > buf->i_max)
     {
-        p_module->p_config =
-            (module_config_t *)calloc( i_lines, sizeof(module_config_t) );
-        if( p_module->p_config == NULL )
+        size_t max = buf->i_max ? buf->i_max : 4096;
+        while (buf->i_size + len > max)
+            max *= 2;
+
+        uint8_t *p = realloc (buf->p_data, max);
+        if (p == NULL)
+            return NULL;
+        buf->p_data = p;
+        buf->i_max = max;
+    }
+
+    void *p = buf->p_data + buf->i_size;
+    if (data != NULL)
+        memcpy (p, data, len);
+    else
+        memset (p, 0, len);
+    buf->i_size += len;
+    return p;
+}
+
+static uint32_t CacheHash (const char *str)
+{
+    uint32_t h = 2166136261u; /* FNV-1a */
+
+    while (*str)
+        h = (h ^ (uint8_t)*(str++)) * 16777619u;
+    return h;
+}
+
+/* Interns a string in the pool; returns 0 for NULL, CACHE_NONE on error */
+static cache_str_t CacheString (cache_writer_t *w, const char *str)
+{
+    if (str == NULL)
+        return 0;
+
+    if (2 * (w->hash_count + 1) > w->hash_size)
+    {   /* Grow and rehash */
+        size_t size = w->hash_size ? 2 * w->hash_size : 4096;
+        cache_str_t *hash = calloc (size, sizeof (*hash));
+        if (hash == NULL)
+            return CACHE_NONE;
+
+        for (size_t i = 0; i < w->hash_size; i++)
         {
-            p_module->confsize = 0;
-            return VLC_ENOMEM;
+            cache_str_t off = w->hash[i];
+            if (off == 0)
+                continue;
+
+            size_t h = CacheHash ((char *)w->strings.p_data + off);
+            while (hash[h & (size - 1)])
+                h++;
+            hash[h & (size - 1)] = off;
         }
+        free (w->hash);
+        w->hash = hash;
+        w->hash_size = size;
     }
-    p_module->confsize = i_lines;
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < i_lines; i++ )
+    size_t h = CacheHash (str);
+    for (;; h++)
     {
-        LOAD_IMMEDIATE( p_module->p_config[i] );
+        cache_str_t off = w->hash[h & (w->hash_size - 1)];
+        if (off == 0)
+            break;
+        if (!strcmp ((char *)w->strings.p_data + off, str))
+            return off;
+    }
 
-        LOAD_STRING( p_module->p_config[i].psz_type );
-        LOAD_STRING( p_module->p_config[i].psz_name );
-        LOAD_STRING( p_module->p_config[i].psz_text );
-        LOAD_STRING( p_module->p_config[i].psz_longtext );
-        LOAD_STRING( p_module->p_config[i].psz_oldname );
-        LOAD_IMMEDIATE( p_module->p_config[i].b_removed );
+    size_t len = strlen (str) + 1;
+    if (w->strings.i_size + len > CACHE_NONE)
+        return CACHE_NONE;
 
-        if (IsConfigStringType (p_module->p_config[i].i_type))
-        {
-            LOAD_STRING (p_module->p_config[i].orig.psz);
-            p_module->p_config[i].value.psz =
-                    (p_module->p_config[i].orig.psz != NULL)
-                        ? strdup (p_module->p_config[i].orig.psz) : NULL;
-            p_module->p_config[i].saved.psz = NULL;
-        }
+    cache_str_t off = w->strings.i_size;
+    if (CacheAppend (&w->strings, str, len) == NULL)
+        return CACHE_NONE;
+    w->hash[h & (w->hash_size - 1)] = off;
+    w->hash_count++;
+    return off;
+}
+
+#define SAVE_STRING( dst, a ) \
+    do { \
+        if ((dst = CacheString (w, a)) == CACHE_NONE) \
+            goto error; \
+    } while (0)
+
+/* Appends a string table, NULL-terminated if requested */
+static uint32_t CacheStrings (cache_writer_t *w, char *const *tab, size_t n,
+                              bool terminated)
+{
+    uint32_t first = w->refs.i_size / sizeof (cache_str_t);
+
+    for (size_t i = 0; i < n + terminated; i++)
+    {
+        cache_str_t ref = CACHE_NONE;
+
+        if (i < n && tab[i] != NULL)
+            SAVE_STRING( ref, tab[i] );
+        if (CacheAppend (&w->refs, &ref, sizeof (ref)) == NULL)
+            goto error;
+    }
+    return first;
+error:
+    return CACHE_NONE;
+}
+
+static int CacheSaveModule (cache_writer_t *w, const module_t *p_module)
+{
+    cache_module_t m;
+
+    memset (&m, 0, sizeof (m));
+    SAVE_STRING( m.name, p_module->psz_object_name );
+    SAVE_STRING( m.shortname, p_module->psz_shortname );
+    SAVE_STRING( m.longname, p_module->psz_longname );
+    SAVE_STRING( m.help, p_module->psz_help );
+    SAVE_STRING( m.capability, p_module->psz_capability );
+    SAVE_STRING( m.domain, p_module->domain );
+    m.score = p_module->i_score;
+    m.shortcuts_count = p_module->i_shortcuts;
+    m.shortcuts = CacheStrings (w, p_module->pp_shortcuts,
+                                p_module->i_shortcuts, false);
+    m.magics_count = p_module->i_magics;
+    m.magics = w->magics.i_size / sizeof (module_magic_t);
+    m.extensions_count = p_module->i_extensions;
+    m.extensions = CacheStrings (w, p_module->pp_extensions,
+                                 p_module->i_extensions, false);
+    m.unloadable = p_module->b_unloadable;
+    if (m.shortcuts == CACHE_NONE || m.extensions == CACHE_NONE
+     || (p_module->i_magics > 0
+      && CacheAppend (&w->magics, p_module->p_magics,
+                      p_module->i_magics * sizeof (module_magic_t)) == NULL)
+     || CacheAppend (&w->modules, &m, sizeof (m)) == NULL)
+        goto error;
+    return 0;
+error:
+    return -1;
+}
+
+static int CacheSaveConfig (cache_writer_t *w, const module_t *p_module)
+{
+    for (size_t i = 0; i < p_module->confsize; i++)
+    {
+        const module_config_t *item = p_module->p_config + i;
+        cache_config_t c;
+
+        memset (&c, 0, sizeof (c));
+        SAVE_STRING( c.type, item->psz_type );
+        SAVE_STRING( c.name, item->psz_name );
+        SAVE_STRING( c.text, item->psz_text );
+        SAVE_STRING( c.longtext, item->psz_longtext );
+        SAVE_STRING( c.oldname, item->psz_oldname );
+        if (IsConfigStringType (item->i_type))
+            SAVE_STRING( c.orig_psz, item->orig.psz );
         else
+            memcpy (&c.orig, &item->orig, sizeof (item->orig));
+        memcpy (&c.min, &item->min, sizeof (item->min));
+        memcpy (&c.max, &item->max, sizeof (item->max));
+        c.i_type = item->i_type;
+        c.i_short = item->i_short;
+        c.i_list = item->i_list;
+        c.i_action = item->i_action;
+
+        c.list = c.list_text = c.int_list = CACHE_NONE;
+        if (item->i_list && item->ppsz_list != NULL)
         {
-            memcpy (&p_module->p_config[i].value, &p_module->p_config[i].orig,
-                    sizeof (p_module->p_config[i].value));
-            memcpy (&p_module->p_config[i].saved, &p_module->p_config[i].orig,
-                    sizeof (p_module->p_config[i].saved));
+            c.list = CacheStrings (w, item->ppsz_list, item->i_list, true);
+            if (c.list == CACHE_NONE)
+                goto error;
         }
-
-        p_module->p_config[i].b_dirty = false;
-
-        if( p_module->p_config[i].i_list )
+        if (item->i_list && item->ppsz_list_text != NULL)
         {
-            if( p_module->p_config[i].ppsz_list )
-            {
-                int j;
-                p_module->p_config[i].ppsz_list =
-                    xmalloc( (p_module->p_config[i].i_list+1) * sizeof(char *));
-                if( p_module->p_config[i].ppsz_list )
-                {
-                    for( j = 0; j < p_module->p_config[i].i_list; j++ )
-                        LOAD_STRING( p_module->p_config[i].ppsz_list[j] );
-                    p_module->p_config[i].ppsz_list[j] = NULL;
-                }
-            }
-            if( p_module->p_config[i].ppsz_list_text )
-            {
-                int j;
-                p_module->p_config[i].ppsz_list_text =
-                    xmalloc( (p_module->p_config[i].i_list+1) * sizeof(char *));
-                if( p_module->p_config[i].ppsz_list_text )
-                {
-                  for( j = 0; j < p_module->p_config[i].i_list; j++ )
-                      LOAD_STRING( p_module->p_config[i].ppsz_list_text[j] );
-                  p_module->p_config[i].ppsz_list_text[j] = NULL;
-                }
-            }
-            if( p_module->p_config[i].pi_list )
-            {
-                p_module->p_config[i].pi_list =
-                    xmalloc( (p_module->p_config[i].i_list + 1) * sizeof(int) );
-                if( p_module->p_config[i].pi_list )
-                {
-                    for (int j = 0; j < p_module->p_config[i].i_list; j++)
-                        LOAD_IMMEDIATE( p_module->p_config[i].pi_list[j] );
-                }
-            }
+            c.list_text = CacheStrings (w, item->ppsz_list_text,
+                                        item->i_list, true);
+            if (c.list_text == CACHE_NONE)
+                goto error;
         }
-
-        if( p_module->p_config[i].i_action )
+        if (item->i_list && item->pi_list != NULL)
         {
-            p_module->p_config[i].ppf_action =
-                xmalloc( p_module->p_config[i].i_action * sizeof(void *) );
-            p_module->p_config[i].ppsz_action_text =
-                xmalloc( p_module->p_config[i].i_action * sizeof(char *) );
-
-            for (int j = 0; j < p_module->p_config[i].i_action; j++)
+            c.int_list = w->ints.i_size / sizeof (int32_t);
+            for (int j = 0; j < item->i_list; j++)
             {
-                p_module->p_config[i].ppf_action[j] = NULL;
-                LOAD_STRING( p_module->p_config[i].ppsz_action_text[j] );
+                int32_t val = item->pi_list[j];
+                if (CacheAppend (&w->ints, &val, sizeof (val)) == NULL)
+                    goto error;
             }
         }
+        c.action_text = CacheStrings (w, item->ppsz_action_text,
+                                      item->i_action, false);
+        if (c.action_text == CACHE_NONE)
+            goto error;
 
-        bool has_callback;
-        LOAD_IMMEDIATE( has_callback );
-        if (has_callback)
-            p_module->p_config[i].pf_callback = dummy_callback;
+        c.flags = (item->b_advanced ? CACHE_CONFIG_ADVANCED : 0)
+                | (item->b_internal ? CACHE_CONFIG_INTERNAL : 0)
+                | (item->b_restart ? CACHE_CONFIG_RESTART : 0)
+                | (item->b_autosave ? CACHE_CONFIG_AUTOSAVE : 0)
+                | (item->b_unsaveable ? CACHE_CONFIG_UNSAVEABLE : 0)
+                | (item->b_safe ? CACHE_CONFIG_SAFE : 0)
+                | (item->b_removed ? CACHE_CONFIG_REMOVED : 0);
+        /* Dynamic lists need the module code as well */
+        if (item->pf_callback != NULL || item->pf_update_list != NULL)
+            c.flags |= CACHE_CONFIG_CALLBACK;
+
+        if (CacheAppend (&w->configs, &c, sizeof (c)) == NULL)
+            goto error;
     }
+    return 0;
+error:
+    return -1;
+}
 
-    return VLC_SUCCESS;
-
- error:
+static int CacheSavePlugin (cache_writer_t *w, const module_cache_t *entry)
+{
+    const module_t *p_module = entry->p_module;
+    cache_plugin_t plugin;
+
+    memset (&plugin, 0, sizeof (plugin));
+    SAVE_STRING( plugin.file, entry->psz_file );
+    SAVE_STRING( plugin.filename, p_module->psz_filename );
+    plugin.time = entry->i_time;
+    plugin.size = entry->i_size;
+    plugin.module = w->modules.i_size / sizeof (cache_module_t);
+    plugin.submodules = p_module->submodule_count;
+    plugin.config = w->configs.i_size / sizeof (cache_config_t);
+    plugin.confsize = p_module->confsize;
+    plugin.config_items = p_module->i_config_items;
+    plugin.bool_items = p_module->i_bool_items;
+
+    if (CacheSaveModule (w, p_module))
+        goto error;
+    for (const module_t *subm = p_module->submodule; subm; subm = subm->next)
+        if (CacheSaveModule (w, subm))
+            goto error;
+    if (CacheSaveConfig (w, p_module)
+     || CacheAppend (&w->plugins, &plugin, sizeof (plugin)) == NULL)
+        goto error;
+    return 0;
+error:
+    return -1;
+}
 
-    return VLC_EGENERIC;
+static int CacheWriteTable (FILE *file, cache_header_t *hdr,
+                            uint32_t *poffset, const cache_buf_t *buf)
+{
+    static const uint8_t zero[8];
+    size_t pad = (8 - (hdr->size % 8)) % 8;
+
+    if (fwrite (zero, 1, pad, file) != pad)
+        return -1;
+    hdr->size += pad;
+    *poffset = hdr->size;
+    if (buf->i_size > 0 && fwrite (buf->p_data, buf->i_size, 1, file) != 1)
+        return -1;
+    hdr->size += buf->i_size;
+    return 0;
 }
 
-static int CacheSaveBank( FILE *file, module_cache_t *const *, size_t );
+static int CacheSaveBank (FILE *file, module_cache_t *const *pp_cache,
+                          size_t i_cache)
+{
+    cache_writer_t w;
+    cache_header_t hdr;
+    int ret = -1;
+
+    memset (&w, 0, sizeof (w));
+    memset (&hdr, 0, sizeof (hdr));
+
+    /* The empty string at offset zero stands for NULL */
+    if (CacheAppend (&w.strings, "", 1) == NULL)
+        goto error;
+
+    for (size_t i = 0; i < i_cache; i++)
+        if (CacheSavePlugin (&w, pp_cache[i]))
+            goto error;
+
+    hdr.version = CACHE_SUBVERSION_NUM;
+    strncpy (hdr.magic, CACHE_STRING, sizeof (hdr.magic));
+    hdr.plugins = w.plugins.i_size / sizeof (cache_plugin_t);
+    hdr.modules = w.modules.i_size / sizeof (cache_module_t);
+    hdr.configs = w.configs.i_size / sizeof (cache_config_t);
+    hdr.refs = w.refs.i_size / sizeof (cache_str_t);
+    hdr.ints = w.ints.i_size / sizeof (int32_t);
+    hdr.magics = w.magics.i_size / sizeof (module_magic_t);
+    hdr.strings = w.strings.i_size;
+
+    /* Empty space for the header */
+    if (fwrite (&hdr, sizeof (hdr), 1, file) != 1)
+        goto error;
+    hdr.size = sizeof (hdr);
+
+    if (CacheWriteTable (file, &hdr, &hdr.plugins_offset, &w.plugins)
+     || CacheWriteTable (file, &hdr, &hdr.modules_offset, &w.modules)
+     || CacheWriteTable (file, &hdr, &hdr.configs_offset, &w.configs)
+     || CacheWriteTable (file, &hdr, &hdr.refs_offset, &w.refs)
+     || CacheWriteTable (file, &hdr, &hdr.ints_offset, &w.ints)
+     || CacheWriteTable (file, &hdr, &hdr.magics_offset, &w.magics)
+     || CacheWriteTable (file, &hdr, &hdr.strings_offset, &w.strings))
+        goto error;
+
+    /* Fill-up the header */
+    if (fseek (file, 0, SEEK_SET)
+     || fwrite (&hdr, sizeof (hdr), 1, file) != 1
+     || fflush (file)) /* flush libc buffers */
+        goto error;
+    ret = 0; /* success! */
+
+error:
+    free (w.plugins.p_data);
+    free (w.modules.p_data);
+    free (w.configs.p_data);
+    free (w.refs.p_data);
+    free (w.ints.p_data);
+    free (w.magics.p_data);
+    free (w.strings.p_data);
+    free (w.hash);
+    return ret;
+}
 
 /*****************************************************************************
  * SavePluginsCache: saves the plugins cache to a file
@@ -506,179 +944,6 @@ out:
     free (tmpname);
 }
 
-static int CacheSaveConfig (FILE *, const module_t *);
-static int CacheSaveSubmodule (FILE *, const module_t *);
-
-static int CacheSaveBank (FILE *file, module_cache_t *const *pp_cache,
-                          size_t i_cache)
-{
-    uint32_t i_file_size = 0;
-
-    /* Empty space for file size */
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
-        goto error;
-
-    /* Contains version number */
-    if (fputs (CACHE_STRING, file) == EOF)
-        goto error;
-#ifdef DISTRO_VERSION
-    /* Allow binary maintaner to pass a string to detect new binary version*/
-    if (fputs( DISTRO_VERSION, file ) == EOF)
-        goto error;
-#endif
-    /* Sub-version number (to avoid breakage in the dev version when cache
-     * structure changes) */
-    i_file_size = CACHE_SUBVERSION_NUM;
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1 )
-        goto error;
-
-    /* Header marker */
-    i_file_size = ftell( file );
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
-        goto error;
-
-    if (fwrite( &i_cache, sizeof (i_cache), 1, file) != 1)
-        goto error;
-
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&a, sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_STRING( a ) \
-    { \
-        uint16_t i_size = (a != NULL) ? (strlen (a) + 1) : 0; \
-        if ((fwrite (&i_size, sizeof (i_size), 1, file) != 1) \
-         || (a && (fwrite (a, 1, i_size, file) != i_size))) \
-            goto error; \
-    } while(0)
-
-    for (unsigned i = 0; i < i_cache; i++)
-    {
-        uint32_t i_submodule;
-
-        /* Save common info */
-        SAVE_STRING( pp_cache[i]->psz_file );
-        SAVE_IMMEDIATE( pp_cache[i]->i_time );
-        SAVE_IMMEDIATE( pp_cache[i]->i_size );
-
-        /* Save additional infos */
-        SAVE_STRING( pp_cache[i]->p_module->psz_object_name );
-        SAVE_STRING( pp_cache[i]->p_module->psz_shortname );
-        SAVE_STRING( pp_cache[i]->p_module->psz_longname );
-        SAVE_STRING( pp_cache[i]->p_module->psz_help );
-        SAVE_IMMEDIATE( pp_cache[i]->p_module->i_shortcuts );
-        for (unsigned j = 0; j < pp_cache[i]->p_module->i_shortcuts; j++)
-            SAVE_STRING( pp_cache[i]->p_module->pp_shortcuts[j] );
-
-        SAVE_STRING( pp_cache[i]->p_module->psz_capability );
-        SAVE_IMMEDIATE( pp_cache[i]->p_module->i_score );
-        SAVE_IMMEDIATE( pp_cache[i]->p_module->b_unloadable );
-        SAVE_IMMEDIATE( pp_cache[i]->p_module->b_submodule );
-
-        /* Config stuff */
-        if (CacheSaveConfig (file, pp_cache[i]->p_module))
-            goto error;
-
-        SAVE_STRING( pp_cache[i]->p_module->psz_filename );
-        SAVE_STRING( pp_cache[i]->p_module->domain );
-
-        i_submodule = pp_cache[i]->p_module->submodule_count;
-        SAVE_IMMEDIATE( i_submodule );
-        if( CacheSaveSubmodule( file, pp_cache[i]->p_module->submodule ) )
-            goto error;
-    }
-
-    /* Fill-up file size */
-    i_file_size = ftell( file );
-    fseek( file, 0, SEEK_SET );
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1
-     || fflush (file)) /* flush libc buffers */
-        goto error;
-    return 0; /* success! */
-
-error:
-    return -1;
-}
-
-static int CacheSaveSubmodule( FILE *file, const module_t *p_module )
-{
-    if( !p_module )
-        return 0;
-    if( CacheSaveSubmodule( file, p_module->next ) )
-        goto error;
-
-    SAVE_STRING( p_module->psz_object_name );
-    SAVE_STRING( p_module->psz_shortname );
-    SAVE_STRING( p_module->psz_longname );
-    SAVE_STRING( p_module->psz_help );
-    SAVE_IMMEDIATE( p_module->i_shortcuts );
-    for( unsigned j = 0; j < p_module->i_shortcuts; j++ )
-         SAVE_STRING( p_module->pp_shortcuts[j] );
-
-    SAVE_STRING( p_module->psz_capability );
-    SAVE_IMMEDIATE( p_module->i_score );
-    SAVE_IMMEDIATE( p_module->b_unloadable );
-    SAVE_STRING( p_module->domain );
-    return 0;
-
-error:
-    return -1;
-}
-
-
-static int CacheSaveConfig (FILE *file, const module_t *p_module)
-{
-    uint32_t i_lines = p_module->confsize;
-
-    SAVE_IMMEDIATE( p_module->i_config_items );
-    SAVE_IMMEDIATE( p_module->i_bool_items );
-    SAVE_IMMEDIATE( i_lines );
-
-    for (size_t i = 0; i < i_lines ; i++)
-    {
-        SAVE_IMMEDIATE( p_module->p_config[i] );
-
-        SAVE_STRING( p_module->p_config[i].psz_type );
-        SAVE_STRING( p_module->p_config[i].psz_name );
-        SAVE_STRING( p_module->p_config[i].psz_text );
-        SAVE_STRING( p_module->p_config[i].psz_longtext );
-        SAVE_STRING( p_module->p_config[i].psz_oldname );
-        SAVE_IMMEDIATE( p_module->p_config[i].b_removed );
-
-        if (IsConfigStringType (p_module->p_config[i].i_type))
-            SAVE_STRING( p_module->p_config[i].orig.psz );
-
-        if( p_module->p_config[i].i_list )
-        {
-            if( p_module->p_config[i].ppsz_list )
-            {
-                for (int j = 0; j < p_module->p_config[i].i_list; j++)
-                    SAVE_STRING( p_module->p_config[i].ppsz_list[j] );
-            }
-
-            if( p_module->p_config[i].ppsz_list_text )
-            {
-                for (int j = 0; j < p_module->p_config[i].i_list; j++)
-                    SAVE_STRING( p_module->p_config[i].ppsz_list_text[j] );
-            }
-            if( p_module->p_config[i].pi_list )
-            {
-                for (int j = 0; j < p_module->p_config[i].i_list; j++)
-                    SAVE_IMMEDIATE( p_module->p_config[i].pi_list[j] );
-            }
-        }
-
-        for (int j = 0; j < p_module->p_config[i].i_action; j++)
-            SAVE_STRING( p_module->p_config[i].ppsz_action_text[j] );
-
-        bool has_callback = p_module->p_config[i].pf_callback != NULL;
-        SAVE_IMMEDIATE( has_callback );
-    }
-    return 0;
-
-error:
-    return -1;
-}
-
 /*****************************************************************************
  * CacheMerge: Merge a cache module descriptor with a full module descriptor.
  *****************************************************************************/
@@ -713,17 +978,17 @@ void CacheMerge( vlc_object_t *p_this, module_t *p_cache, module_t *p_module )
 module_cache_t *CacheFind( module_bank_t *p_bank, const char *psz_file,
                            int64_t i_time, int64_t i_size )
 {
-    module_cache_t **pp_cache;
-    int i_cache, i;
+    module_cache_t key = { .psz_file = (char *)psz_file };
 
-    pp_cache = p_bank->pp_loaded_cache;
-    i_cache = p_bank->i_loaded_cache;
-
-    for( i = 0; i < i_cache; i++ )
+    for( unsigned i = 0; i < p_bank->i_cache_maps; i++ )
     {
-        if( !strcmp( pp_cache[i]->psz_file, psz_file ) &&
-            pp_cache[i]->i_time == i_time &&
-            pp_cache[i]->i_size == i_size ) return pp_cache[i];
+        module_cache_map_t *map = p_bank->pp_cache_maps[i];
+        module_cache_t *entry = bsearch( &key, map->entries, map->count,
+                                         sizeof (key), CacheEntryCmp );
+
+        if( entry != NULL && entry->i_time == i_time
+         && entry->i_size == i_size )
+            return entry;
     }
 
     return NULL;
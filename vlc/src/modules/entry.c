@@ -39,6 +39,8 @@ static void vlc_module_destruct (gc_object_t *obj)
     module_t *module = vlc_priv (obj, module_t);
 
     free (module->pp_shortcuts);
+    free (module->p_magics);
+    free (module->pp_extensions);
     free (module->psz_object_name);
     free (module);
 }
@@ -63,6 +65,10 @@ module_t *vlc_module_create (vlc_object_t *obj)
     module->psz_help = NULL;
     module->pp_shortcuts = NULL;
     module->i_shortcuts = 0;
+    module->p_magics = NULL;
+    module->i_magics = 0;
+    module->pp_extensions = NULL;
+    module->i_extensions = 0;
     module->psz_capability = (char*)"";
     module->i_score = 1;
     module->b_unloadable = true;
@@ -78,6 +84,7 @@ module_t *vlc_module_create (vlc_object_t *obj)
     module->domain = NULL;
     module->b_builtin = false;
     module->b_loaded = false;
+    module->b_mapped = false;
 
     (void)obj;
     return module;
@@ -88,6 +95,8 @@ static void vlc_submodule_destruct (gc_object_t *obj)
 {
     module_t *module = vlc_priv (obj, module_t);
     free (module->pp_shortcuts);
+    free (module->p_magics);
+    free (module->pp_extensions);
     free (module->psz_object_name);
     free (module);
 }
@@ -206,6 +215,53 @@ int vlc_plugin_set (module_t *module, module_config_t *item, int propid, ...)
             break;
         }
 
+        case VLC_MODULE_MAGIC:
+        {
+            unsigned offset = va_arg (ap, unsigned);
+            const char *bytes = va_arg (ap, const char *);
+            size_t length = va_arg (ap, size_t);
+
+            if (length == 0 || length > MODULE_MAGIC_MAX
+             || offset > MODULE_PROBE_SIZE - length)
+            {
+                ret = -1;
+                break;
+            }
+
+            module_magic_t *tab = realloc (module->p_magics,
+                                   sizeof (*tab) * (module->i_magics + 1));
+            if (unlikely(tab == NULL))
+            {
+                ret = -1;
+                break;
+            }
+            module->p_magics = tab;
+            tab += module->i_magics++;
+            memset (tab, 0, sizeof (*tab));
+            tab->i_offset = offset;
+            tab->i_length = length;
+            memcpy (tab->p_bytes, bytes, length);
+            break;
+        }
+
+        case VLC_MODULE_EXTENSION:
+        {
+            unsigned count = va_arg (ap, unsigned);
+            unsigned index = module->i_extensions;
+            const char *const *tab = va_arg (ap, const char *const *);
+            const char **pp = realloc (module->pp_extensions,
+                                       sizeof (pp[0]) * (index + count));
+            if (unlikely(pp == NULL))
+            {
+                ret = -1;
+                break;
+            }
+            module->pp_extensions = (char **)pp;
+            module->i_extensions = index + count;
+            memcpy (pp + index, tab, sizeof (pp[0]) * count);
+            break;
+        }
+
         case VLC_MODULE_CAPABILITY:
             module->psz_capability = va_arg (ap, char *);
             break;
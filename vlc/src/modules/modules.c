@@ -78,6 +78,7 @@ static module_t * AllocatePlugin( vlc_object_t *, const char * );
 #endif
 static int  AllocateBuiltinModule( vlc_object_t *, int ( * ) ( module_t * ) );
 static void DeleteModule ( module_bank_t *, module_t * );
+static void module_BuildIndex( module_bank_t * );
 #ifdef HAVE_DYNAMIC_PLUGINS
 static void   DupModule        ( module_t * );
 static void   UndupModule      ( module_t * );
@@ -102,10 +103,13 @@ void module_InitBank( vlc_object_t *p_this )
     {
         p_bank = calloc (1, sizeof(*p_bank));
         p_bank->i_usage = 1;
-        p_bank->i_cache = p_bank->i_loaded_cache = 0;
-        p_bank->pp_cache = p_bank->pp_loaded_cache = NULL;
+        p_bank->i_cache = 0;
+        p_bank->pp_cache = NULL;
+        p_bank->i_cache_maps = 0;
+        p_bank->pp_cache_maps = NULL;
         p_bank->b_cache = p_bank->b_cache_dirty = false;
         p_bank->head = NULL;
+        p_bank->index = NULL;
 
         /* Everything worked, attach the object */
         p_module_bank = p_bank;
@@ -167,18 +171,24 @@ void module_EndBank( vlc_object_t *p_this, bool b_plugins )
     p_module_bank = NULL;
     vlc_mutex_unlock( &module_lock );
 
+    while( p_bank->index != NULL )
+    {
+        module_index_t *index = p_bank->index;
+        p_bank->index = index->prev;
+        free( index );
+    }
+
 #ifdef HAVE_DYNAMIC_PLUGINS
-    while( p_bank->i_loaded_cache-- )
+    for( unsigned i = 0; i < p_bank->i_cache_maps; i++ )
     {
-        if( p_bank->pp_loaded_cache[p_bank->i_loaded_cache] )
-        {
-            DeleteModule( p_bank,
-                    p_bank->pp_loaded_cache[p_bank->i_loaded_cache]->p_module );
-            free( p_bank->pp_loaded_cache[p_bank->i_loaded_cache]->psz_file );
-            free( p_bank->pp_loaded_cache[p_bank->i_loaded_cache] );
-        }
+        module_cache_t *entries;
+        size_t n = CacheGet( p_bank->pp_cache_maps[i], &entries );
+
+        for( size_t j = 0; j < n; j++ )
+            DeleteModule( p_bank, entries[j].p_module );
+        CacheUnload( p_bank->pp_cache_maps[i] );
     }
-    free( p_bank->pp_loaded_cache );
+    free( p_bank->pp_cache_maps );
     while( p_bank->i_cache-- )
     {
         free( p_bank->pp_cache[p_bank->i_cache]->psz_file );
@@ -225,6 +235,8 @@ void module_LoadPlugins( vlc_object_t * p_this, const void **builtins )
         config_SortConfig ();
     }
 #endif
+    if( p_bank->index == NULL || builtins != NULL )
+        module_BuildIndex( p_bank );
     vlc_mutex_unlock( &module_lock );
 }
 
@@ -379,6 +391,70 @@ module_t **module_list_get (size_t *n)
     return tab;
 }
 
+static int moduleindexcmp (const void *a, const void *b)
+{
+    const module_t *ma = *(module_t *const *)a, *mb = *(module_t *const *)b;
+    int ret = strcmp (ma->psz_capability, mb->psz_capability);
+
+    return ret ? ret : mb->i_score - ma->i_score;
+}
+
+/**
+ * Builds the capability index of the module bank.
+ * The previous index, if any, may still be in use: it is retired.
+ */
+static void module_BuildIndex (module_bank_t *p_bank)
+{
+    module_index_t *index;
+    size_t count = 0;
+
+    for (module_t *mod = p_bank->head; mod; mod = mod->next)
+        count += 1 + mod->submodule_count;
+
+    index = malloc (sizeof (*index) + count * sizeof (index->modules[0]));
+    if (index == NULL)
+        return; /* module_need() will search the whole bank */
+
+    count = 0;
+    for (module_t *mod = p_bank->head; mod; mod = mod->next)
+    {
+        index->modules[count++] = mod;
+        for (module_t *subm = mod->submodule; subm; subm = subm->next)
+            index->modules[count++] = subm;
+    }
+    index->count = count;
+    qsort (index->modules, count, sizeof (index->modules[0]), moduleindexcmp);
+
+    index->prev = p_bank->index;
+    p_bank->index = index;
+}
+
+/**
+ * Finds the modules providing a capability in the index.
+ * @return the first module, by decreasing score (count in *n)
+ */
+static module_t *const *module_index_find (const module_index_t *index,
+                                           const char *cap, size_t *n)
+{
+    size_t lo = 0, hi = index->count;
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+
+        if (strcmp (index->modules[mid]->psz_capability, cap) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (hi = lo; hi < index->count; hi++)
+        if (!module_provides (index->modules[hi], cap))
+            break;
+    *n = hi - lo;
+    return index->modules + lo;
+}
+
 typedef struct module_list_t
 {
     module_t *p_module;
@@ -394,6 +470,41 @@ static int modulecmp (const void *a, const void *b)
     return lb->i_score - la->i_score;
 }
 
+/* Score bonuses of modules matching the probed stream, below shortcuts */
+#define MODULE_MAGIC_BONUS     2000
+#define MODULE_EXTENSION_BONUS 1000
+
+/**
+ * Matches the signatures of a module against the start of a stream.
+ * @return the score bonus of the module, 0 if it does not match
+ */
+static int module_match (const module_t *m, const module_probe_t *probe)
+{
+    int bonus = 0;
+
+    for (unsigned i = 0; i < m->i_magics; i++)
+    {
+        const module_magic_t *magic = m->p_magics + i;
+
+        if (magic->i_offset + magic->i_length <= probe->i_peek
+         && !memcmp (probe->p_peek + magic->i_offset, magic->p_bytes,
+                     magic->i_length))
+        {
+            bonus += MODULE_MAGIC_BONUS;
+            break;
+        }
+    }
+
+    if (probe->psz_ext != NULL)
+        for (unsigned i = 0; i < m->i_extensions; i++)
+            if (!strcasecmp (probe->psz_ext, m->pp_extensions[i]))
+            {
+                bonus += MODULE_EXTENSION_BONUS;
+                break;
+            }
+    return bonus;
+}
+
 #undef module_need
 /**
  * module Need
@@ -409,6 +520,21 @@ static int modulecmp (const void *a, const void *b)
  */
 module_t * module_need( vlc_object_t *p_this, const char *psz_capability,
                         const char *psz_name, bool b_strict )
+{
+    return module_need_probe( p_this, psz_capability, psz_name, b_strict,
+                              NULL );
+}
+
+#undef module_need_probe
+/**
+ * Same as module_need(), but tries the modules whose signature (magic bytes
+ * or file extension) matches the probed stream first.
+ *
+ * \param probe start of the stream and file extension, or NULL
+ */
+module_t *module_need_probe( vlc_object_t *p_this, const char *psz_capability,
+                             const char *psz_name, bool b_strict,
+                             const module_probe_t *probe )
 {
     stats_TimerStart( p_this, "module_need()", STATS_TIMER_MODULE_NEED );
 
@@ -465,17 +591,30 @@ module_t * module_need( vlc_object_t *p_this, const char *psz_capability,
         }
     }
 
-    /* Sort the modules and test them */
-    size_t count;
-    module_t **p_all = module_list_get (&count);
-    p_list = malloc( count * sizeof( module_list_t ) );
+    /* Look the capability up, or fall back to the whole list */
+    size_t count, i_cands;
+    module_t **p_all = NULL;
+    module_t *const *pp_cands;
+    const module_index_t *index = p_module_bank->index;
+
+    if( likely(index != NULL) )
+        pp_cands = module_index_find( index, psz_capability, &i_cands );
+    else
+    {
+        p_all = module_list_get (&i_cands);
+        pp_cands = p_all;
+    }
+    p_list = malloc( i_cands * sizeof( module_list_t ) );
 
     /* Parse the module list for capabilities and probe each of them */
+    unsigned i_matches = 0;
     count = 0;
-    for (size_t i = 0; (p_module = p_all[i]) != NULL; i++)
+    for (size_t i = 0; i < i_cands; i++)
     {
         int i_shortcut_bonus = 0;
 
+        p_module = pp_cands[i];
+
         /* Test that this module can do what we need */
         if( !module_provides( p_module, psz_capability ) )
             continue;
@@ -523,16 +662,29 @@ found_shortcut:
         p_list[count].p_module = module_hold (p_module);
         p_list[count].i_score = p_module->i_score + i_shortcut_bonus;
         p_list[count].b_force = i_shortcut_bonus && b_strict;
+        if( probe != NULL && i_shortcut_bonus == 0 )
+        {
+            int i_match_bonus = module_match( p_module, probe );
+            if( i_match_bonus )
+            {
+                p_list[count].i_score += i_match_bonus;
+                i_matches++;
+            }
+        }
         count++;
     }
 
     /* We can release the list, interesting modules are held */
     module_list_free (p_all);
 
-    /* Sort candidates by descending score */
-    qsort (p_list, count, sizeof (p_list[0]), modulecmp);
+    /* Sort candidates by descending score (the index is sorted already) */
+    if( p_all != NULL || i_shortcuts > 0 || i_matches > 0 )
+        qsort (p_list, count, sizeof (p_list[0]), modulecmp);
     msg_Dbg( p_this, "looking for %s module: %zu candidate%s", psz_capability,
              count, count == 1 ? "" : "s" );
+    if( i_matches > 0 )
+        msg_Dbg( p_this, "%u candidate%s matching the stream signature",
+                 i_matches, i_matches == 1 ? "" : "s" );
 
     /* Parse the linked list and use the first successful module */
     p_module = NULL;
@@ -846,20 +998,24 @@ static void AllocateAllPlugins( vlc_object_t *p_this, module_bank_t *p_bank )
         if( !path )
             continue;
 
-        size_t offset = p_module_bank->i_cache;
+        size_t offset = p_module_bank->i_cache, loaded = 0;
         if( b_reset )
             CacheDelete( p_this, path );
         else
-            CacheLoad( p_this, p_module_bank, path );
+            loaded = CacheLoad( p_this, p_module_bank, path );
 
         msg_Dbg( p_this, "recursively browsing `%s'", path );
 
         /* Don't go deeper than 5 subdirectories */
+        p_bank->b_cache_dirty = false;
         AllocatePluginDir( p_this, p_bank, path, 5 );
 
-
-        CacheSave( p_this, path, p_module_bank->pp_cache + offset,
-                   p_module_bank->i_cache - offset );
+        /* Only rewrite the cache if plugins were added, changed or removed */
+        if( p_bank->b_cache
+         && (p_bank->b_cache_dirty
+          || (size_t)p_module_bank->i_cache - offset != loaded) )
+            CacheSave( p_this, path, p_module_bank->pp_cache + offset,
+                       p_module_bank->i_cache - offset );
         free( path );
     }
 
@@ -941,6 +1097,7 @@ static int AllocatePluginFile( vlc_object_t * p_this, module_bank_t *p_bank,
     if( !p_cache_entry )
     {
         p_module = AllocatePlugin( p_this, psz_file );
+        p_bank->b_cache_dirty = true;
     }
     else
     {
@@ -1061,6 +1218,8 @@ static void DupModule( module_t *p_module )
     char **pp_shortcuts = p_module->pp_shortcuts;
     for( unsigned i = 0; i < p_module->i_shortcuts; i++ )
         pp_shortcuts[i] = strdup( p_module->pp_shortcuts[i] );
+    for( unsigned i = 0; i < p_module->i_extensions; i++ )
+        p_module->pp_extensions[i] = strdup( p_module->pp_extensions[i] );
 
     /* We strdup() these entries so that they are still valid when the
      * module is unloaded. */
@@ -1090,6 +1249,8 @@ static void UndupModule( module_t *p_module )
 
     for( unsigned i = 0; i < p_module->i_shortcuts; i++ )
         free( pp_shortcuts[i] );
+    for( unsigned i = 0; i < p_module->i_extensions; i++ )
+        free( p_module->pp_extensions[i] );
 
     free( p_module->psz_capability );
     FREENULL( p_module->psz_shortname );
@@ -1165,8 +1326,12 @@ static void DeleteModule( module_bank_t *p_bank, module_t * p_module )
         {
             module_Unload( p_module->handle );
         }
-        UndupModule( p_module );
-        free( p_module->psz_filename );
+        /* Strings of cached modules belong to the cache file */
+        if( !p_module->b_mapped )
+        {
+            UndupModule( p_module );
+            free( p_module->psz_filename );
+        }
     }
 #endif
 
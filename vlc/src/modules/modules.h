@@ -28,6 +28,19 @@
 #ifndef LIBVLC_MODULES_H
 # define LIBVLC_MODULES_H 1
 
+typedef struct module_cache_map_t module_cache_map_t;
+
+/**
+ * All modules sorted by capability then decreasing score, for module_need().
+ * The bank is read-only once loaded, so a replaced index is only retired.
+ */
+typedef struct module_index_t
+{
+    struct module_index_t *prev; /**< Retired index */
+    size_t    count;
+    module_t *modules[];
+} module_index_t;
+
 /*****************************************************************************
  * module_bank_t: the module bank
  *****************************************************************************
@@ -44,10 +57,13 @@ struct module_bank_t
     int            i_cache;
     module_cache_t **pp_cache;
 
-    int            i_loaded_cache;
-    module_cache_t **pp_loaded_cache;
+    unsigned            i_cache_maps;
+    module_cache_map_t **pp_cache_maps;
 
     module_t       *head;
+
+    /* Capability index */
+    module_index_t *index;
 };
 
 /*****************************************************************************
@@ -67,6 +83,31 @@ struct module_cache_t
 
 #define MODULE_SHORTCUT_MAX 20
 
+/* Signatures must match within the first MODULE_PROBE_SIZE bytes */
+#define MODULE_PROBE_SIZE 2048
+#define MODULE_MAGIC_MAX 13
+
+/**
+ * Magic bytes of a format (also stored as is in the plugins cache)
+ */
+typedef struct module_magic_t
+{
+    uint16_t i_offset;
+    uint8_t  i_length;
+    uint8_t  p_bytes[MODULE_MAGIC_MAX];
+} module_magic_t;
+
+/**
+ * Start of a stream and file extension, to try the modules whose signature
+ * matches first
+ */
+typedef struct module_probe_t
+{
+    const uint8_t *p_peek;
+    size_t         i_peek;
+    const char    *psz_ext; /**< Extension without the dot, or NULL */
+} module_probe_t;
+
 /* The module handle type. */
 #if defined(HAVE_DL_DYLD) && !defined(__x86_64__)
 #   if defined (HAVE_MACH_O_DYLD_H)
@@ -100,6 +141,12 @@ struct module_t
     unsigned    i_shortcuts;
     char        **pp_shortcuts;
 
+    /** Signatures of the handled format */
+    unsigned        i_magics;
+    module_magic_t *p_magics;
+    unsigned        i_extensions;
+    char          **pp_extensions;
+
     /*
      * Variables set by the module to identify itself
      */
@@ -114,6 +161,7 @@ struct module_t
     bool          b_loaded;        /* Set to true if the dll is loaded */
     bool b_unloadable;                        /**< Can we be dlclosed? */
     bool b_submodule;                        /**< Is this a submodule? */
+    bool b_mapped;          /**< Are strings and config in the cache file? */
 
     /* Callbacks */
     int  ( * pf_activate )   ( vlc_object_t * );
@@ -146,6 +194,11 @@ void module_LoadPlugins( vlc_object_t *, const void ** );
 void module_EndBank( vlc_object_t *, bool );
 #define module_EndBank(a,b) module_EndBank(VLC_OBJECT(a), b)
 
+module_t *module_need_probe (vlc_object_t *, const char *, const char *,
+                             bool, const module_probe_t *);
+#define module_need_probe(a,b,c,d,e) \
+        module_need_probe(VLC_OBJECT(a),b,c,d,e)
+
 int vlc_bindtextdomain (const char *);
 
 /* Low-level OS-dependent handler */
@@ -156,7 +209,9 @@ void module_Unload (module_handle_t);
 /* Plugins cache */
 void   CacheMerge (vlc_object_t *, module_t *, module_t *);
 void   CacheDelete(vlc_object_t *, const char *);
-void   CacheLoad  (vlc_object_t *, module_bank_t *, const char *);
+size_t CacheLoad  (vlc_object_t *, module_bank_t *, const char *);
+void   CacheUnload(module_cache_map_t *);
+size_t CacheGet   (const module_cache_map_t *, module_cache_t **);
 void   CacheSave  (vlc_object_t *, const char *, module_cache_t *const *, size_t);
 module_cache_t * CacheFind (module_bank_t *, const char *, int64_t, int64_t);
 
@@ -37,10 +37,13 @@
 #include <vlc_acl.h>
 #include <vlc_strings.h>
 #include <vlc_rand.h>
+#include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 
 #ifdef HAVE_UNISTD_H
 #   include <unistd.h>
@@ -49,6 +52,9 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined( UNDER_CE )
 #   include <winsock.h>
@@ -65,7 +71,52 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of events handled per host thread wake-up */
+#define HTTPD_EVENTS_MAX 64
+
+/* delay between checks for new data of waiting clients */
+#define HTTPD_WAITING_DELAY (CLOCK_FREQ / 50)
+
+/* maximum number of shared stream chunks queued on a client at once */
+#define HTTPD_CHUNKS_MAX 16
+
+/* idle clients expiry timer wheel */
+#define HTTPD_WHEEL_SLOTS 64
+#define HTTPD_WHEEL_TICK  (CLOCK_FREQ / 4)
+
+typedef struct httpd_chunk_t httpd_chunk_t;
+
 static void httpd_ClientClean( httpd_client_t *cl );
+static void httpd_ClientReady( httpd_host_t *host, httpd_client_t *cl );
+
+/* descriptor watched by a host thread */
+typedef struct httpd_io_t
+{
+    int             fd;
+    short           events; /* armed events, cleared once they are reported */
+    unsigned        slot;   /* index in the poll() set or HTTPD_IO_NONE */
+    httpd_client_t *cl;     /* NULL for listening sockets and the wait pipe */
+} httpd_io_t;
+
+#define HTTPD_IO_NONE UINT_MAX
+
+/* list of clients to be processed by a host thread */
+typedef struct httpd_queue_t
+{
+    int             i_count;
+    int             i_max;
+    httpd_client_t **clients;
+} httpd_queue_t;
+
+/* set of descriptors watched by a host thread (epoll if available) */
+typedef struct httpd_poller_t
+{
+    int            epfd;    /* -1 if poll() is used */
+    unsigned       count;
+    unsigned       size;
+    struct pollfd *ufd;
+    httpd_io_t   **io;
+} httpd_poller_t;
 
 struct httpd_t
 {
@@ -106,6 +157,16 @@ struct httpd_host_t
     int            i_client;
     httpd_client_t **client;
 
+    /* clients to be processed without waiting for I/O */
+    httpd_queue_t  ready;
+    httpd_queue_t  waiting; /* HTTPD_CLIENT_WAITING clients */
+
+    /* event loop (only used by the host thread) */
+    httpd_poller_t poller;
+    httpd_client_t *wheel[HTTPD_WHEEL_SLOTS];
+    int64_t        i_wheel_tick;
+    unsigned       i_wheel;
+
     /* TLS data */
     tls_server_t *p_tls;
 };
@@ -169,6 +230,12 @@ struct httpd_client_t
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
 
+    /* event loop */
+    httpd_io_t      io;
+    bool            b_queued; /* in the ready or waiting clients list */
+    httpd_client_t  *p_wheel_next;
+    httpd_client_t **pp_wheel_prev;
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
@@ -178,6 +245,12 @@ struct httpd_client_t
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
 
+    /* shared stream data, sent after p_buffer */
+    httpd_chunk_t *chunk[HTTPD_CHUNKS_MAX];
+    unsigned i_chunk;
+    size_t   i_chunk_offset; /* already sent from the first chunk */
+    size_t   i_chunk_size;   /* left to send */
+
     /* TLS data */
     tls_session_t *p_tls;
 };
@@ -707,6 +780,30 @@ void httpd_RedirectDelete( httpd_redirect_t *rdir )
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+/* Stream data is shared by all clients: each client only holds references to
+ * the chunks it is sending, and a read position. */
+struct httpd_chunk_t
+{
+    vlc_atomic_t refs;
+    int64_t      i_pos;     /* absolute position of the first byte */
+    block_t     *p_block;
+};
+
+static httpd_chunk_t *httpd_ChunkHold( httpd_chunk_t *chunk )
+{
+    vlc_atomic_inc( &chunk->refs );
+    return chunk;
+}
+
+static void httpd_ChunkRelease( httpd_chunk_t *chunk )
+{
+    if( vlc_atomic_dec( &chunk->refs ) == 0 )
+    {
+        block_Release( chunk->p_block );
+        free( chunk );
+    }
+}
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -718,13 +815,58 @@ struct httpd_stream_t
     uint8_t *p_header;
     int     i_header;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* ring of chunks, from the oldest to the newest */
+    httpd_chunk_t **pp_chunk;
+    unsigned    i_chunk_max;        /* ring capacity (power of two) */
+    unsigned    i_chunk_first;      /* index of the oldest chunk */
+    unsigned    i_chunk;            /* number of chunks */
+
+    int64_t     i_buffer_size;      /* maximum amount of buffered data */
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 };
 
+static httpd_chunk_t *httpd_StreamChunk( const httpd_stream_t *stream,
+                                         unsigned i )
+{
+    return stream->pp_chunk[(stream->i_chunk_first + i)
+                            & (stream->i_chunk_max - 1)];
+}
+
+/* Queues the stream data from a given position on a client */
+static int64_t httpd_StreamQueue( httpd_stream_t *stream, httpd_client_t *cl,
+                                  int64_t i_pos )
+{
+    unsigned lo = 0, hi = stream->i_chunk;
+
+    assert( cl->i_chunk == 0 );
+
+    /* find the last chunk starting at or before i_pos */
+    while( hi - lo > 1 )
+    {
+        unsigned mid = (lo + hi) / 2;
+
+        if( httpd_StreamChunk( stream, mid )->i_pos <= i_pos )
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    cl->i_chunk_offset = i_pos - httpd_StreamChunk( stream, lo )->i_pos;
+    cl->i_chunk_size = 0;
+    for( unsigned i = lo;
+         i < stream->i_chunk && cl->i_chunk < HTTPD_CHUNKS_MAX; i++ )
+    {
+        httpd_chunk_t *chunk = httpd_StreamChunk( stream, i );
+
+        cl->chunk[cl->i_chunk++] = httpd_ChunkHold( chunk );
+        cl->i_chunk_size += chunk->p_block->i_buffer;
+        i_pos = chunk->i_pos + chunk->p_block->i_buffer;
+    }
+    cl->i_chunk_size -= cl->i_chunk_offset;
+    return i_pos;
+}
+
 static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query )
@@ -738,21 +880,20 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
 
     if( answer->i_body_offset > 0 )
     {
-        int64_t i_write;
-        int     i_pos;
-
 #if 0
         fprintf( stderr, "httpd_StreamCallBack i_body_offset=%lld\n",
                  answer->i_body_offset );
 #endif
 
+        vlc_mutex_lock( &stream->lock );
         if( answer->i_body_offset >= stream->i_buffer_pos )
         {
             /* fprintf( stderr, "httpd_StreamCallBack: no data\n" ); */
+            vlc_mutex_unlock( &stream->lock );
             return VLC_EGENERIC;    /* wait, no data available */
         }
-        if( answer->i_body_offset + stream->i_buffer_size <
-            stream->i_buffer_pos )
+        if( answer->i_body_offset <
+            httpd_StreamChunk( stream, 0 )->i_pos )
         {
             /* this client isn't fast enough */
 #if 0
@@ -762,31 +903,16 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
             answer->i_body_offset = stream->i_buffer_last_pos;
         }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        i_write = stream->i_buffer_pos - answer->i_body_offset;
-        if( i_write > HTTPD_CL_BUFSIZE )
-        {
-            i_write = HTTPD_CL_BUFSIZE;
-        }
-        else if( i_write <= 0 )
-        {
-            return VLC_EGENERIC;    /* wait, no data available */
-        }
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN( i_write, stream->i_buffer_size - i_pos );
+        /* the data is shared, not copied */
+        answer->i_body_offset = httpd_StreamQueue( stream, cl,
+                                                   answer->i_body_offset );
+        vlc_mutex_unlock( &stream->lock );
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc( i_write );
-        memcpy( answer->p_body, &stream->p_buffer[i_pos], i_write );
-
-        answer->i_body_offset += i_write;
-
         return VLC_SUCCESS;
     }
     else
@@ -879,8 +1005,11 @@ httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
     }
     stream->i_header = 0;
     stream->p_header = NULL;
+    stream->pp_chunk = NULL;
+    stream->i_chunk_max = 0;
+    stream->i_chunk_first = 0;
+    stream->i_chunk = 0;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc( stream->i_buffer_size );
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -915,37 +1044,73 @@ int httpd_StreamHeader( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 
 int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 {
-    int i_count;
-    int i_pos;
+    httpd_chunk_t *chunk = NULL;
+    httpd_chunk_t *old[16];
+    unsigned i_old = 0;
 
     if( i_data < 0 || p_data == NULL )
     {
         return VLC_SUCCESS;
     }
+
+    /* copy the data once, it is then shared by all clients */
+    if( i_data > 0 )
+    {
+        chunk = malloc( sizeof (*chunk) );
+        if( chunk == NULL )
+            return VLC_ENOMEM;
+        chunk->p_block = block_Alloc( i_data );
+        if( chunk->p_block == NULL )
+        {
+            free( chunk );
+            return VLC_ENOMEM;
+        }
+        memcpy( chunk->p_block->p_buffer, p_data, i_data );
+        vlc_atomic_set( &chunk->refs, 1 );
+    }
+
     vlc_mutex_lock( &stream->lock );
 
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
-    i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    i_count = i_data;
-    while( i_count > 0)
+    if( chunk != NULL )
     {
-        int i_copy;
-
-        i_copy = __MIN( i_count, stream->i_buffer_size - i_pos );
+        if( stream->i_chunk == stream->i_chunk_max )
+        {   /* grow the ring, keeping the chunks in order */
+            unsigned i_max = stream->i_chunk_max ? 2 * stream->i_chunk_max
+                                                 : 64;
+            httpd_chunk_t **pp = xmalloc( i_max * sizeof (*pp) );
+
+            for( unsigned i = 0; i < stream->i_chunk; i++ )
+                pp[i] = httpd_StreamChunk( stream, i );
+            free( stream->pp_chunk );
+            stream->pp_chunk = pp;
+            stream->i_chunk_max = i_max;
+            stream->i_chunk_first = 0;
+        }
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy( &stream->p_buffer[i_pos], p_data, i_copy );
+        chunk->i_pos = stream->i_buffer_pos;
+        stream->pp_chunk[(stream->i_chunk_first + stream->i_chunk++)
+                         & (stream->i_chunk_max - 1)] = chunk;
+        stream->i_buffer_pos += i_data;
 
-        i_pos = ( i_pos + i_copy ) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+        /* drop the oldest data (clients may still hold it) */
+        while( stream->i_chunk > 1 && i_old < sizeof (old) / sizeof (old[0])
+            && stream->i_buffer_pos - httpd_StreamChunk( stream, 0 )->i_pos
+                                                    > stream->i_buffer_size )
+        {
+            old[i_old++] = httpd_StreamChunk( stream, 0 );
+            stream->i_chunk_first = (stream->i_chunk_first + 1)
+                                  & (stream->i_chunk_max - 1);
+            stream->i_chunk--;
+        }
     }
 
-    stream->i_buffer_pos += i_data;
-
     vlc_mutex_unlock( &stream->lock );
+
+    while( i_old > 0 )
+        httpd_ChunkRelease( old[--i_old] );
     return VLC_SUCCESS;
 }
 
@@ -953,9 +1118,11 @@ void httpd_StreamDelete( httpd_stream_t *stream )
 {
     httpd_UrlDelete( stream->url );
     vlc_mutex_destroy( &stream->lock );
+    for( unsigned i = 0; i < stream->i_chunk; i++ )
+        httpd_ChunkRelease( httpd_StreamChunk( stream, i ) );
+    free( stream->pp_chunk );
     free( stream->psz_mime );
     free( stream->p_header );
-    free( stream->p_buffer );
     free( stream );
 }
 
@@ -1104,6 +1271,8 @@ httpd_host_t *httpd_TLSHostNew( vlc_object_t *p_this, const char *psz_hostname,
     host->url       = NULL;
     host->i_client  = 0;
     host->client    = NULL;
+    memset( &host->ready, 0, sizeof (host->ready) );
+    memset( &host->waiting, 0, sizeof (host->waiting) );
 
     host->p_tls = p_tls;
 
@@ -1182,13 +1351,16 @@ void httpd_HostDelete( httpd_host_t *host )
     for( i = 0; i < host->i_client; i++ )
     {
         httpd_client_t *cl = host->client[i];
-        msg_Warn( host, "client still connected" );
+        if( cl->i_state != HTTPD_CLIENT_DEAD )
+            msg_Warn( host, "client still connected" );
         httpd_ClientClean( cl );
         TAB_REMOVE( host->i_client, host->client, cl );
         free( cl );
         i--;
         /* TODO */
     }
+    free( host->ready.clients );
+    free( host->waiting.clients );
 
     if( host->p_tls != NULL)
         tls_ServerDelete( host->p_tls );
@@ -1307,10 +1479,12 @@ void httpd_UrlDelete( httpd_url_t *url )
         {
             /* TODO complete it */
             msg_Warn( host, "force closing connections" );
-            httpd_ClientClean( client );
-            TAB_REMOVE( host->i_client, host->client, client );
-            free( client );
-            i--;
+            /* The host thread may be waiting on this client: have it close
+             * the connection. Shutting the socket down wakes the thread. */
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            shutdown( client->fd, SHUT_RDWR );
+            httpd_ClientReady( host, client );
         }
     }
     free( url );
@@ -1406,6 +1580,9 @@ static void httpd_ClientInit( httpd_client_t *cl, mtime_t now )
     cl->p_buffer = xmalloc( cl->i_buffer_size );
     cl->i_mode   = HTTPD_CLIENT_FILE;
     cl->b_read_waiting = false;
+    cl->i_chunk = 0;
+    cl->i_chunk_offset = 0;
+    cl->i_chunk_size = 0;
 
     httpd_MsgInit( &cl->query );
     httpd_MsgInit( &cl->answer );
@@ -1446,6 +1623,9 @@ static void httpd_ClientClean( httpd_client_t *cl )
 
     free( cl->p_buffer );
     cl->p_buffer = NULL;
+
+    while( cl->i_chunk > 0 )
+        httpd_ChunkRelease( cl->chunk[--cl->i_chunk] );
 }
 
 static httpd_client_t *httpd_ClientNew( int fd, tls_session_t *p_tls, mtime_t now )
@@ -1459,6 +1639,14 @@ static httpd_client_t *httpd_ClientNew( int fd, tls_session_t *p_tls, mtime_t no
     cl->url     = NULL;
     cl->p_tls = p_tls;
 
+    cl->io.fd     = fd;
+    cl->io.events = 0;
+    cl->io.slot   = HTTPD_IO_NONE;
+    cl->io.cl     = cl;
+    cl->b_queued  = false;
+    cl->p_wheel_next  = NULL;
+    cl->pp_wheel_prev = NULL;
+
     httpd_ClientInit( cl, now );
 
     return cl;
@@ -1492,6 +1680,64 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return val;
 }
 
+/* Sends the shared stream chunks queued on a client, and releases the chunks
+ * which were completely sent */
+static
+ssize_t httpd_NetSendChunks (httpd_client_t *cl)
+{
+    ssize_t val;
+
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+    if (cl->p_tls == NULL)
+    {
+        struct iovec iov[HTTPD_CHUNKS_MAX];
+        struct msghdr hdr;
+
+        for (unsigned i = 0; i < cl->i_chunk; i++)
+        {
+            block_t *p_block = cl->chunk[i]->p_block;
+
+            iov[i].iov_base = p_block->p_buffer;
+            iov[i].iov_len = p_block->i_buffer;
+        }
+        iov[0].iov_base = (uint8_t *)iov[0].iov_base + cl->i_chunk_offset;
+        iov[0].iov_len -= cl->i_chunk_offset;
+
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = cl->i_chunk;
+        do
+            val = sendmsg (cl->fd, &hdr, 0);
+        while (val == -1 && errno == EINTR);
+    }
+    else
+#endif
+    {
+        block_t *p_block = cl->chunk[0]->p_block;
+
+        val = httpd_NetSend (cl, p_block->p_buffer + cl->i_chunk_offset,
+                             p_block->i_buffer - cl->i_chunk_offset);
+    }
+
+    if (val <= 0)
+        return val;
+
+    size_t i_sent = val;
+    unsigned i = 0;
+
+    cl->i_chunk_size -= i_sent;
+    i_sent += cl->i_chunk_offset;
+    while (i < cl->i_chunk && i_sent >= cl->chunk[i]->p_block->i_buffer)
+    {
+        i_sent -= cl->chunk[i]->p_block->i_buffer;
+        httpd_ChunkRelease (cl->chunk[i++]);
+    }
+    cl->i_chunk -= i;
+    memmove (cl->chunk, cl->chunk + i, cl->i_chunk * sizeof (cl->chunk[0]));
+    cl->i_chunk_offset = i_sent;
+    return val;
+}
+
 
 static const struct
 {
@@ -1942,8 +2188,11 @@ static void httpd_ClientSend( httpd_client_t *cl )
         fprintf( stderr, "%s",  cl->p_buffer );*/
     }
 
-    i_len = httpd_NetSend( cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer );
+    if( cl->i_buffer < cl->i_buffer_size && cl->p_buffer == NULL )
+        i_len = httpd_NetSendChunks( cl );
+    else
+        i_len = httpd_NetSend( cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer );
     if( i_len >= 0 )
     {
         cl->i_buffer += i_len;
@@ -1975,6 +2224,14 @@ static void httpd_ClientSend( httpd_client_t *cl )
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
             }
+            else if( cl->i_chunk > 0 )
+            {
+                /* send the shared data */
+                free( cl->p_buffer );
+                cl->p_buffer = NULL;
+                cl->i_buffer_size = cl->i_chunk_size;
+                cl->i_buffer = 0;
+            }
             else
             {
                 /* send finished */
@@ -2033,446 +2290,774 @@ static void httpd_ClientTlsHsOut( httpd_client_t *cl )
     }
 }
 
-static void* httpd_HostThread( void *data )
+/*****************************************************************************
+ * Event loop
+ *****************************************************************************/
+static void httpd_PollerInit( httpd_poller_t *p )
 {
-    httpd_host_t *host = data;
-    tls_session_t *p_tls = NULL;
-    counter_t *p_total_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
-    counter_t *p_active_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
-    int evfd = vlc_object_waitpipe( VLC_OBJECT( host ) );
+#ifdef HAVE_SYS_EPOLL_H
+    p->epfd = epoll_create1( EPOLL_CLOEXEC );
+#else
+    p->epfd = -1;
+#endif
+    p->count = 0;
+    p->size = 0;
+    p->ufd = NULL;
+    p->io = NULL;
+}
 
-    for( ;; )
+static void httpd_PollerClean( httpd_poller_t *p )
+{
+    if( p->epfd != -1 )
+        close( p->epfd );
+    free( p->ufd );
+    free( p->io );
+}
+
+/* Arms the events to wait for on a descriptor. Events are reported only once,
+ * the descriptor must be armed again to get further events. */
+static int httpd_PollerArm( httpd_poller_t *p, httpd_io_t *io, short events )
+{
+    if( io->events == events && io->slot != HTTPD_IO_NONE )
+        return 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if( p->epfd != -1 )
     {
-        /* prepare a new TLS session */
-        if( ( p_tls == NULL ) && ( host->p_tls != NULL ) )
-            p_tls = tls_ServerSessionPrepare( host->p_tls );
+        struct epoll_event ev;
+
+        ev.events = EPOLLONESHOT;
+        if( events & POLLIN )
+            ev.events |= EPOLLIN;
+        if( events & POLLOUT )
+            ev.events |= EPOLLOUT;
+        ev.data.ptr = io;
+
+        if( epoll_ctl( p->epfd, (io->slot == HTTPD_IO_NONE) ? EPOLL_CTL_ADD
+                                                            : EPOLL_CTL_MOD,
+                       io->fd, &ev ) )
+            return -1;
+        io->slot = 0;
+        io->events = events;
+        return 0;
+    }
+#endif
 
-        struct pollfd ufd[host->nfd + host->i_client + 1];
-        unsigned nfd;
-        for( nfd = 0; nfd < host->nfd; nfd++ )
+    if( io->slot == HTTPD_IO_NONE )
+    {
+        if( p->count == p->size )
         {
-            ufd[nfd].fd = host->fds[nfd];
-            ufd[nfd].events = POLLIN;
-            ufd[nfd].revents = 0;
+            unsigned size = p->size ? (2 * p->size) : 64;
+            struct pollfd *ufd = realloc( p->ufd, size * sizeof (*ufd) );
+            if( ufd == NULL )
+                return -1;
+            p->ufd = ufd;
+
+            httpd_io_t **tab = realloc( p->io, size * sizeof (*tab) );
+            if( tab == NULL )
+                return -1;
+            p->io = tab;
+            p->size = size;
         }
+        io->slot = p->count++;
+        p->io[io->slot] = io;
+    }
 
-        /* add all socket that should be read/write and close dead connection */
-        vlc_mutex_lock( &host->lock );
-        while( host->i_url <= 0 && host->i_ref > 0 )
-            vlc_cond_wait( &host->wait, &host->lock );
+    struct pollfd *ufd = &p->ufd[io->slot];
+    ufd->fd = events ? io->fd : -1; /* negative descriptors are ignored */
+    ufd->events = events;
+    ufd->revents = 0;
+    io->events = events;
+    return 0;
+}
 
-        mtime_t now = mdate();
-        bool b_low_delay = false;
+static void httpd_PollerRemove( httpd_poller_t *p, httpd_io_t *io )
+{
+    if( io->slot == HTTPD_IO_NONE )
+        return;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if( p->epfd != -1 )
+    {
+        struct epoll_event ev; /* for kernels older than 2.6.9 */
+        epoll_ctl( p->epfd, EPOLL_CTL_DEL, io->fd, &ev );
+    }
+    else
+#endif
+    {
+        unsigned last = --p->count;
+
+        if( io->slot != last )
+        {
+            p->ufd[io->slot] = p->ufd[last];
+            p->io[io->slot] = p->io[last];
+            p->io[io->slot]->slot = io->slot;
+        }
+    }
+    io->slot = HTTPD_IO_NONE;
+    io->events = 0;
+}
+
+/* Waits for armed events. Returns the number of reported descriptors (at most
+ * max), or -1 on error. */
+static int httpd_PollerWait( httpd_poller_t *p, httpd_io_t **io,
+                             short *revents, unsigned max, int timeout )
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if( p->epfd != -1 )
+    {
+        struct epoll_event ev[max];
+        int n = epoll_wait( p->epfd, ev, max, timeout );
+
+        for( int i = 0; i < n; i++ )
+        {
+            short events = 0;
+
+            if( ev[i].events & EPOLLIN )
+                events |= POLLIN;
+            if( ev[i].events & EPOLLOUT )
+                events |= POLLOUT;
+            if( ev[i].events & EPOLLERR )
+                events |= POLLERR;
+            if( ev[i].events & EPOLLHUP )
+                events |= POLLHUP;
+
+            io[i] = ev[i].data.ptr;
+            io[i]->events = 0; /* one-shot */
+            revents[i] = events;
+        }
+        return n;
+    }
+#endif
+
+    int n = poll( p->ufd, p->count, timeout );
+    if( n <= 0 )
+        return n;
+
+    n = 0;
+    for( unsigned i = 0; i < p->count && (unsigned)n < max; i++ )
+    {
+        struct pollfd *ufd = &p->ufd[i];
+
+        if( ufd->revents == 0 )
+            continue;
+
+        io[n] = p->io[i];
+        revents[n] = ufd->revents;
+        n++;
 
-        for(int i_client = 0; i_client < host->i_client; i_client++ )
+        /* emulate one-shot notifications */
+        ufd->fd = -1;
+        ufd->events = ufd->revents = 0;
+        p->io[i]->events = 0;
+    }
+    return n;
+}
+
+/* Idle clients are kept in a timer wheel. The deadline is only checked once
+ * the slot of the client expires, so that activity does not move clients. */
+static void httpd_WheelRemove( httpd_host_t *host, httpd_client_t *cl )
+{
+    if( cl->pp_wheel_prev == NULL )
+        return;
+
+    *cl->pp_wheel_prev = cl->p_wheel_next;
+    if( cl->p_wheel_next != NULL )
+        cl->p_wheel_next->pp_wheel_prev = cl->pp_wheel_prev;
+    cl->p_wheel_next = NULL;
+    cl->pp_wheel_prev = NULL;
+    host->i_wheel--;
+}
+
+static void httpd_WheelInsert( httpd_host_t *host, httpd_client_t *cl )
+{
+    int64_t tick = (cl->i_activity_date + cl->i_activity_timeout)
+                 / HTTPD_WHEEL_TICK + 1;
+
+    if( tick <= host->i_wheel_tick )
+        tick = host->i_wheel_tick + 1;
+    if( tick >= host->i_wheel_tick + HTTPD_WHEEL_SLOTS )
+        tick = host->i_wheel_tick + HTTPD_WHEEL_SLOTS - 1;
+
+    httpd_client_t **pp_head = &host->wheel[tick % HTTPD_WHEEL_SLOTS];
+
+    cl->p_wheel_next = *pp_head;
+    if( cl->p_wheel_next != NULL )
+        cl->p_wheel_next->pp_wheel_prev = &cl->p_wheel_next;
+    cl->pp_wheel_prev = pp_head;
+    *pp_head = cl;
+    host->i_wheel++;
+}
+
+static void httpd_QueuePush( httpd_queue_t *q, httpd_client_t *cl )
+{
+    if( q->i_count == q->i_max )
+    {
+        q->i_max = q->i_max ? (2 * q->i_max) : 16;
+        q->clients = xrealloc( q->clients, q->i_max * sizeof (*q->clients) );
+    }
+    q->clients[q->i_count++] = cl;
+    cl->b_queued = true;
+}
+
+/* Queues a client for processing by the host thread (host lock held) */
+static void httpd_ClientReady( httpd_host_t *host, httpd_client_t *cl )
+{
+    if( !cl->b_queued )
+        httpd_QueuePush( &host->ready, cl );
+}
+
+static void httpd_WheelExpire( httpd_host_t *host, mtime_t now )
+{
+    int64_t tick = now / HTTPD_WHEEL_TICK;
+
+    if( tick - host->i_wheel_tick > HTTPD_WHEEL_SLOTS )
+        host->i_wheel_tick = tick - HTTPD_WHEEL_SLOTS;
+
+    while( host->i_wheel_tick < tick )
+    {
+        httpd_client_t **pp_head;
+
+        host->i_wheel_tick++;
+        pp_head = &host->wheel[host->i_wheel_tick % HTTPD_WHEEL_SLOTS];
+
+        while( *pp_head != NULL )
         {
-            httpd_client_t *cl = host->client[i_client];
-            if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
-                ( cl->i_state == HTTPD_CLIENT_DEAD ||
-                  ( cl->i_activity_timeout > 0 &&
-                    cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
+            httpd_client_t *cl = *pp_head;
+
+            httpd_WheelRemove( host, cl );
+            if( cl->i_activity_timeout <= 0 )
+                continue; /* timeout disabled */
+
+            if( cl->i_ref == 0
+             && cl->i_activity_date + cl->i_activity_timeout < now )
             {
-                httpd_ClientClean( cl );
-                stats_UpdateInteger( host, p_active_counter, -1, NULL );
-                TAB_REMOVE( host->i_client, host->client, cl );
-                free( cl );
-                i_client--;
-                continue;
+                cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_ClientReady( host, cl );
             }
+            else
+                httpd_WheelInsert( host, cl );
+        }
+    }
+}
+
+/* Waits for the next I/O event of a client, or queues it for processing */
+static void httpd_ClientWatch( httpd_host_t *host, httpd_client_t *cl )
+{
+    short events = 0;
+
+    if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
+          || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
+    {
+        events = POLLIN;
+    }
+    else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
+          || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
+    {
+        events = POLLOUT;
+    }
+
+    /* Special for BIDIR mode we also check reading */
+    if( cl->i_mode == HTTPD_CLIENT_BIDIR &&
+        cl->i_state == HTTPD_CLIENT_SENDING )
+    {
+        events |= POLLIN;
+    }
+
+    if( httpd_PollerArm( &host->poller, &cl->io, events ) )
+    {
+        msg_Err( host, "cannot watch client: %m" );
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        events = 0;
+    }
+
+    if( events != 0 || cl->b_queued )
+        return;
+
+    if( cl->i_state == HTTPD_CLIENT_WAITING )
+        httpd_QueuePush( &host->waiting, cl ); /* check for new data later */
+    else
+        httpd_ClientReady( host, cl );
+}
+
+static void httpd_ClientDestroy( httpd_host_t *host, httpd_client_t *cl )
+{
+    httpd_PollerRemove( &host->poller, &cl->io );
+    httpd_WheelRemove( host, cl );
+    httpd_ClientClean( cl );
+    TAB_REMOVE( host->i_client, host->client, cl );
+    free( cl );
+}
 
-            struct pollfd *pufd = ufd + nfd;
-            assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+/* Processes a client which is not waiting for I/O */
+static void httpd_ClientProcess( httpd_host_t *host, httpd_client_t *cl )
+{
+    if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
+    {
+        httpd_message_t *answer = &cl->answer;
+        httpd_message_t *query  = &cl->query;
+        int i_msg = query->i_type;
 
-            pufd->fd = cl->fd;
-            pufd->events = pufd->revents = 0;
+        httpd_MsgInit( answer );
 
-            if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
+        /* Handle what we received */
+        if( (cl->i_mode != HTTPD_CLIENT_BIDIR) &&
+            (i_msg == HTTPD_MSG_ANSWER || i_msg == HTTPD_MSG_CHANNEL) )
+        {
+            /* we can only receive request from client when not
+             * in BIDIR mode */
+            cl->url     = NULL;
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        }
+        else if( i_msg == HTTPD_MSG_ANSWER )
+        {
+            /* We are in BIDIR mode, trigger the callback and then
+             * check for new data */
+            if( cl->url && cl->url->catch[i_msg].cb )
             {
-                pufd->events = POLLIN;
+                cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys,
+                                          cl, NULL, query );
             }
-            else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
+            cl->i_state = HTTPD_CLIENT_WAITING;
+        }
+        else if( i_msg == HTTPD_MSG_CHANNEL )
+        {
+            /* We are in BIDIR mode, trigger the callback and then
+             * check for new data */
+            if( cl->url && cl->url->catch[i_msg].cb )
             {
-                pufd->events = POLLOUT;
+                cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys,
+                                          cl, NULL, query );
             }
-            else if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
-            {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
-                int i_msg = query->i_type;
+            cl->i_state = HTTPD_CLIENT_WAITING;
+        }
+        else if( i_msg == HTTPD_MSG_OPTIONS )
+        {
 
-                httpd_MsgInit( answer );
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_proto  = query->i_proto;
+            answer->i_status = 200;
+            answer->i_body = 0;
+            answer->p_body = NULL;
 
-                /* Handle what we received */
-                if( (cl->i_mode != HTTPD_CLIENT_BIDIR) &&
-                    (i_msg == HTTPD_MSG_ANSWER || i_msg == HTTPD_MSG_CHANNEL) )
-                {
-                    /* we can only receive request from client when not
-                     * in BIDIR mode */
-                    cl->url     = NULL;
-                    cl->i_state = HTTPD_CLIENT_DEAD;
-                }
-                else if( i_msg == HTTPD_MSG_ANSWER )
-                {
-                    /* We are in BIDIR mode, trigger the callback and then
-                     * check for new data */
-                    if( cl->url && cl->url->catch[i_msg].cb )
-                    {
-                        cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys,
-                                                  cl, NULL, query );
-                    }
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                else if( i_msg == HTTPD_MSG_CHANNEL )
+            httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
+            httpd_MsgAdd( answer, "Content-Length", "0" );
+
+            switch( query->i_proto )
+            {
+                case HTTPD_PROTO_HTTP:
+                    answer->i_version = 1;
+                    httpd_MsgAdd( answer, "Allow",
+                                  "GET,HEAD,POST,OPTIONS" );
+                    break;
+
+                case HTTPD_PROTO_RTSP:
                 {
-                    /* We are in BIDIR mode, trigger the callback and then
-                     * check for new data */
-                    if( cl->url && cl->url->catch[i_msg].cb )
+                    const char *p;
+                    answer->i_version = 0;
+
+                    p = httpd_MsgGet( query, "Cseq" );
+                    if( p != NULL )
+                        httpd_MsgAdd( answer, "Cseq", "%s", p );
+                    p = httpd_MsgGet( query, "Timestamp" );
+                    if( p != NULL )
+                        httpd_MsgAdd( answer, "Timestamp", "%s", p );
+
+                    p = httpd_MsgGet( query, "Require" );
+                    if( p != NULL )
                     {
-                        cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys,
-                                                  cl, NULL, query );
+                        answer->i_status = 551;
+                        httpd_MsgAdd( query, "Unsupported", "%s", p );
                     }
-                    cl->i_state = HTTPD_CLIENT_WAITING;
+
+                    httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
+                                  "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
+                    break;
                 }
-                else if( i_msg == HTTPD_MSG_OPTIONS )
-                {
+            }
 
-                    answer->i_type   = HTTPD_MSG_ANSWER;
-                    answer->i_proto  = query->i_proto;
-                    answer->i_status = 200;
-                    answer->i_body = 0;
-                    answer->p_body = NULL;
+            cl->i_buffer = -1;  /* Force the creation of the answer in
+                                 * httpd_ClientSend */
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+        else if( i_msg == HTTPD_MSG_NONE )
+        {
+            if( query->i_proto == HTTPD_PROTO_NONE )
+            {
+                cl->url = NULL;
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            }
+            else
+            {
+                char *p;
 
-                    httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
-                    httpd_MsgAdd( answer, "Content-Length", "0" );
+                /* unimplemented */
+                answer->i_proto  = query->i_proto ;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
+                answer->i_status = 501;
 
-                    switch( query->i_proto )
-                    {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd( answer, "Allow",
-                                          "GET,HEAD,POST,OPTIONS" );
-                            break;
+                answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                answer->p_body = (uint8_t *)p;
+                httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
 
-                        case HTTPD_PROTO_RTSP:
-                        {
-                            const char *p;
-                            answer->i_version = 0;
-
-                            p = httpd_MsgGet( query, "Cseq" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Cseq", "%s", p );
-                            p = httpd_MsgGet( query, "Timestamp" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Timestamp", "%s", p );
-
-                            p = httpd_MsgGet( query, "Require" );
-                            if( p != NULL )
-                            {
-                                answer->i_status = 551;
-                                httpd_MsgAdd( query, "Unsupported", "%s", p );
-                            }
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+        }
+        else
+        {
+            bool b_auth_failed = false;
+            bool b_hosts_failed = false;
 
-                            httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
-                                          "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
-                            break;
-                        }
-                    }
+            /* Search the url and trigger callbacks */
+            for(int i = 0; i < host->i_url; i++ )
+            {
+                httpd_url_t *url = host->url[i];
 
-                    cl->i_buffer = -1;  /* Force the creation of the answer in
-                                         * httpd_ClientSend */
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-                else if( i_msg == HTTPD_MSG_NONE )
+                if( !strcmp( url->psz_url, query->psz_url ) )
                 {
-                    if( query->i_proto == HTTPD_PROTO_NONE )
-                    {
-                        cl->url = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    else
+                    if( url->catch[i_msg].cb )
                     {
-                        char *p;
-
-                        /* unimplemented */
-                        answer->i_proto  = query->i_proto ;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
-                        answer->i_status = 501;
-
-                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                        answer->p_body = (uint8_t *)p;
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
-
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                else
-                {
-                    bool b_auth_failed = false;
-                    bool b_hosts_failed = false;
+                        if( answer && ( url->p_acl != NULL ) )
+                        {
+                            char ip[NI_MAXNUMERICHOST];
 
-                    /* Search the url and trigger callbacks */
-                    for(int i = 0; i < host->i_url; i++ )
-                    {
-                        httpd_url_t *url = host->url[i];
+                            if( ( httpd_ClientIP( cl, ip ) == NULL )
+                             || ACL_Check( url->p_acl, ip ) )
+                            {
+                                b_hosts_failed = true;
+                                break;
+                            }
+                        }
 
-                        if( !strcmp( url->psz_url, query->psz_url ) )
+                        if( answer && ( *url->psz_user || *url->psz_password ) )
                         {
-                            if( url->catch[i_msg].cb )
-                            {
-                                if( answer && ( url->p_acl != NULL ) )
-                                {
-                                    char ip[NI_MAXNUMERICHOST];
-
-                                    if( ( httpd_ClientIP( cl, ip ) == NULL )
-                                     || ACL_Check( url->p_acl, ip ) )
-                                    {
-                                        b_hosts_failed = true;
-                                        break;
-                                    }
-                                }
+                            /* create the headers */
+                            const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
+                            char *user = NULL, *pass = NULL;
 
-                                if( answer && ( *url->psz_user || *url->psz_password ) )
-                                {
-                                    /* create the headers */
-                                    const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
-                                    char *user = NULL, *pass = NULL;
-
-                                    if( b64 != NULL
-                                     && !strncasecmp( b64, "BASIC", 5 ) )
-                                    {
-                                        b64 += 5;
-                                        while( *b64 == ' ' )
-                                            b64++;
-
-                                        user = vlc_b64_decode( b64 );
-                                        if (user != NULL)
-                                        {
-                                            pass = strchr (user, ':');
-                                            if (pass != NULL)
-                                                *pass++ = '\0';
-                                        }
-                                    }
-
-                                    if ((user == NULL) || (pass == NULL)
-                                     || strcmp (user, url->psz_user)
-                                     || strcmp (pass, url->psz_password))
-                                    {
-                                        httpd_MsgAdd( answer,
-                                                      "WWW-Authenticate",
-                                                      "Basic realm=\"VLC stream\"" );
-                                        /* We fail for all url */
-                                        b_auth_failed = true;
-                                        free( user );
-                                        break;
-                                    }
-
-                                    free( user );
-                                }
+                            if( b64 != NULL
+                             && !strncasecmp( b64, "BASIC", 5 ) )
+                            {
+                                b64 += 5;
+                                while( *b64 == ' ' )
+                                    b64++;
 
-                                if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
+                                user = vlc_b64_decode( b64 );
+                                if (user != NULL)
                                 {
-                                    if( answer->i_proto == HTTPD_PROTO_NONE )
-                                    {
-                                        /* Raw answer from a CGI */
-                                        cl->i_buffer = cl->i_buffer_size;
-                                    }
-                                    else
-                                        cl->i_buffer = -1;
-
-                                    /* only one url can answer */
-                                    answer = NULL;
-                                    if( cl->url == NULL )
-                                    {
-                                        cl->url = url;
-                                    }
+                                    pass = strchr (user, ':');
+                                    if (pass != NULL)
+                                        *pass++ = '\0';
                                 }
                             }
-                        }
-                    }
 
-                    if( answer )
-                    {
-                        char *p;
-
-                        answer->i_proto  = query->i_proto;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
+                            if ((user == NULL) || (pass == NULL)
+                             || strcmp (user, url->psz_user)
+                             || strcmp (pass, url->psz_password))
+                            {
+                                httpd_MsgAdd( answer,
+                                              "WWW-Authenticate",
+                                              "Basic realm=\"VLC stream\"" );
+                                /* We fail for all url */
+                                b_auth_failed = true;
+                                free( user );
+                                break;
+                            }
 
-                        if( b_hosts_failed )
-                        {
-                            answer->i_status = 403;
-                        }
-                        else if( b_auth_failed )
-                        {
-                            answer->i_status = 401;
-                        }
-                        else
-                        {
-                            /* no url registered */
-                            answer->i_status = 404;
+                            free( user );
                         }
 
-                        answer->i_body = httpd_HtmlError (&p,
-                                                          answer->i_status,
-                                                          query->psz_url);
-                        answer->p_body = (uint8_t *)p;
+                        if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
+                        {
+                            if( answer->i_proto == HTTPD_PROTO_NONE )
+                            {
+                                /* Raw answer from a CGI */
+                                cl->i_buffer = cl->i_buffer_size;
+                            }
+                            else
+                                cl->i_buffer = -1;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
-                        httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
+                            /* only one url can answer */
+                            answer = NULL;
+                            if( cl->url == NULL )
+                            {
+                                cl->url = url;
+                            }
+                        }
                     }
-
-                    cl->i_state = HTTPD_CLIENT_SENDING;
                 }
             }
-            else if( cl->i_state == HTTPD_CLIENT_SEND_DONE )
+
+            if( answer )
             {
-                if( cl->i_mode == HTTPD_CLIENT_FILE || cl->answer.i_body_offset == 0 )
-                {
-                    const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
-                    const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if( psz_connection )
-                    {
-                        b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
-                        b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
-                    }
+                char *p;
 
-                    if( psz_query )
-                    {
-                        b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
-                    }
+                answer->i_proto  = query->i_proto;
+                answer->i_type   = HTTPD_MSG_ANSWER;
+                answer->i_version= 0;
 
-                    if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
-                          ( ( cl->query.i_version == 0 && b_keepalive ) ||
-                            ( cl->query.i_version == 1 && !b_connection ) ) ) ||
-                        ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
-                          !b_query && !b_connection ) )
-                    {
-                        httpd_MsgClean( &cl->query );
-                        httpd_MsgInit( &cl->query );
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free( cl->p_buffer );
-                        cl->p_buffer = xmalloc( cl->i_buffer_size );
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    }
-                    else
-                    {
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    httpd_MsgClean( &cl->answer );
+                if( b_hosts_failed )
+                {
+                    answer->i_status = 403;
                 }
-                else if( cl->b_read_waiting )
+                else if( b_auth_failed )
                 {
-                    /* we have a message waiting for us to read it */
-                    httpd_MsgClean( &cl->answer );
-                    httpd_MsgClean( &cl->query );
-
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 1000;
-                    free( cl->p_buffer );
-                    cl->p_buffer = xmalloc( cl->i_buffer_size );
-                    cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    cl->b_read_waiting = false;
+                    answer->i_status = 401;
                 }
                 else
                 {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean( &cl->answer );
+                    /* no url registered */
+                    answer->i_status = 404;
+                }
 
-                    cl->answer.i_body_offset = i_offset;
-                    free( cl->p_buffer );
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                answer->i_body = httpd_HtmlError (&p,
+                                                  answer->i_status,
+                                                  query->psz_url);
+                answer->p_body = (uint8_t *)p;
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
+                cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+                httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
             }
-            else if( cl->i_state == HTTPD_CLIENT_WAITING )
-            {
-                int64_t i_offset = cl->answer.i_body_offset;
-                int     i_msg = cl->query.i_type;
 
-                httpd_MsgInit( &cl->answer );
-                cl->answer.i_body_offset = i_offset;
-
-                cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query );
-                if( cl->answer.i_type != HTTPD_MSG_NONE )
-                {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+    }
+    else if( cl->i_state == HTTPD_CLIENT_SEND_DONE )
+    {
+        if( cl->i_mode == HTTPD_CLIENT_FILE || cl->answer.i_body_offset == 0 )
+        {
+            const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
+            const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
+            bool b_connection = false;
+            bool b_keepalive = false;
+            bool b_query = false;
+
+            cl->url = NULL;
+            if( psz_connection )
+            {
+                b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
+                b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
             }
 
-            /* Special for BIDIR mode we also check reading */
-            if( cl->i_mode == HTTPD_CLIENT_BIDIR &&
-                cl->i_state == HTTPD_CLIENT_SENDING )
+            if( psz_query )
             {
-                pufd->events |= POLLIN;
+                b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
             }
 
-            if (pufd->events != 0)
-                nfd++;
+            if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
+                  ( ( cl->query.i_version == 0 && b_keepalive ) ||
+                    ( cl->query.i_version == 1 && !b_connection ) ) ) ||
+                ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
+                  !b_query && !b_connection ) )
+            {
+                httpd_MsgClean( &cl->query );
+                httpd_MsgInit( &cl->query );
+
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 1000;
+                free( cl->p_buffer );
+                cl->p_buffer = xmalloc( cl->i_buffer_size );
+                cl->i_state = HTTPD_CLIENT_RECEIVING;
+            }
             else
-                b_low_delay = true;
+            {
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            }
+            httpd_MsgClean( &cl->answer );
         }
-        vlc_mutex_unlock( &host->lock );
+        else if( cl->b_read_waiting )
+        {
+            /* we have a message waiting for us to read it */
+            httpd_MsgClean( &cl->answer );
+            httpd_MsgClean( &cl->query );
+
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 1000;
+            free( cl->p_buffer );
+            cl->p_buffer = xmalloc( cl->i_buffer_size );
+            cl->i_state = HTTPD_CLIENT_RECEIVING;
+            cl->b_read_waiting = false;
+        }
+        else
+        {
+            int64_t i_offset = cl->answer.i_body_offset;
+            httpd_MsgClean( &cl->answer );
+
+            cl->answer.i_body_offset = i_offset;
+            free( cl->p_buffer );
+            cl->p_buffer = NULL;
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 0;
+
+            cl->i_state = HTTPD_CLIENT_WAITING;
+        }
+    }
+    else if( cl->i_state == HTTPD_CLIENT_WAITING )
+    {
+        int64_t i_offset = cl->answer.i_body_offset;
+        int     i_msg = cl->query.i_type;
+
+        httpd_MsgInit( &cl->answer );
+        cl->answer.i_body_offset = i_offset;
+
+        cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
+                                  &cl->answer, &cl->query );
+        if( cl->answer.i_type != HTTPD_MSG_NONE )
+        {
+            /* we have new data, so re-enter send mode */
+            cl->i_buffer      = 0;
+            cl->p_buffer      = cl->answer.p_body;
+            cl->i_buffer_size = cl->answer.i_body;
+            if( cl->p_buffer == NULL )
+                cl->i_buffer_size = cl->i_chunk_size; /* shared data */
+            cl->answer.p_body = NULL;
+            cl->answer.i_body = 0;
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+    }
+
+}
+
+static void* httpd_HostThread( void *data )
+{
+    httpd_host_t *host = data;
+    tls_session_t *p_tls = NULL;
+    counter_t *p_total_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
+    counter_t *p_active_counter = stats_CounterCreate( host, VLC_VAR_INTEGER, STATS_COUNTER );
+    int evfd = vlc_object_waitpipe( VLC_OBJECT( host ) );
+    httpd_io_t wait_io = { evfd, 0, HTTPD_IO_NONE, NULL };
+    httpd_io_t listen_io[host->nfd];
+    httpd_queue_t spare = { 0, 0, NULL };
+    mtime_t i_waiting_date = 0;
+
+    httpd_PollerInit( &host->poller );
+    if( host->poller.epfd == -1 )
+        msg_Dbg( host, "using poll() event loop" );
+    memset( host->wheel, 0, sizeof (host->wheel) );
+    host->i_wheel_tick = mdate() / HTTPD_WHEEL_TICK;
+    host->i_wheel = 0;
+
+    for( unsigned i = 0; i < host->nfd; i++ )
+    {
+        listen_io[i].fd = host->fds[i];
+        listen_io[i].events = 0;
+        listen_io[i].slot = HTTPD_IO_NONE;
+        listen_io[i].cl = NULL;
+        if( httpd_PollerArm( &host->poller, &listen_io[i], POLLIN ) )
+            msg_Err( host, "cannot watch listening socket: %m" );
+    }
+    if( httpd_PollerArm( &host->poller, &wait_io, POLLIN ) )
+        msg_Err( host, "cannot watch signaling pipe: %m" );
+
+    for( ;; )
+    {
+        /* prepare a new TLS session */
+        if( ( p_tls == NULL ) && ( host->p_tls != NULL ) )
+            p_tls = tls_ServerSessionPrepare( host->p_tls );
+
+        vlc_mutex_lock( &host->lock );
+        while( host->i_url <= 0 && host->i_ref > 0 )
+            vlc_cond_wait( &host->wait, &host->lock );
+
+        mtime_t now = mdate();
 
-        ufd[nfd].fd = evfd;
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-        nfd++;
+        /* expire idle clients */
+        httpd_WheelExpire( host, now );
 
-        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-        switch( poll( ufd, nfd, b_low_delay ? 20 : -1) )
+        /* process clients which are not waiting for I/O,
+         * and close dead connections */
+        for( int pass = 0; pass < 2; pass++ )
         {
-            case -1:
-                if (errno != EINTR)
+            httpd_queue_t *q = pass ? &host->waiting : &host->ready;
+
+            if( pass == 1 )
+            {
+                /* we will check every 20ms (not too big) for new data */
+                if( now < i_waiting_date )
+                    break;
+                i_waiting_date = now + HTTPD_WAITING_DELAY;
+            }
+
+            /* swap with the spare queue, clients may be queued again */
+            httpd_queue_t cur = *q;
+            *q = spare;
+            spare = cur;
+
+            for( int i = 0; i < cur.i_count; i++ )
+            {
+                httpd_client_t *cl = cur.clients[i];
+
+                cl->b_queued = false;
+                if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
+                    cl->i_state == HTTPD_CLIENT_DEAD ) )
                 {
-                    /* Kernel on low memory or a bug: pace */
-                    msg_Err( host, "polling error: %m" );
-                    msleep( 100000 );
+                    httpd_ClientDestroy( host, cl );
+                    stats_UpdateInteger( host, p_active_counter, -1, NULL );
+                    continue;
                 }
-            case 0:
-                continue;
+
+                do
+                {
+                    httpd_ClientProcess( host, cl );
+                    /* sockets are mostly writable: do not wait to send */
+                    if( cl->i_state == HTTPD_CLIENT_SENDING )
+                        httpd_ClientSend( cl );
+                }
+                while( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE
+                    || cl->i_state == HTTPD_CLIENT_SEND_DONE );
+                httpd_ClientWatch( host, cl );
+            }
+            spare.i_count = 0;
         }
 
-        if( ufd[nfd - 1].revents )
+        mtime_t deadline = INT64_MAX;
+        if( host->ready.i_count > 0 )
+            deadline = now;
+        else if( host->waiting.i_count > 0 )
+            deadline = i_waiting_date;
+        if( host->i_wheel > 0 )
+            deadline = __MIN( deadline,
+                              (host->i_wheel_tick + 1) * HTTPD_WHEEL_TICK );
+        vlc_mutex_unlock( &host->lock );
+
+        int timeout = -1;
+        if( deadline != INT64_MAX )
+            timeout = (deadline > now) ? ((deadline - now + 999) / 1000) : 0;
+
+        httpd_io_t *io[HTTPD_EVENTS_MAX];
+        short revents[HTTPD_EVENTS_MAX];
+        int n = httpd_PollerWait( &host->poller, io, revents,
+                                  HTTPD_EVENTS_MAX, timeout );
+        if( n == -1 )
+        {
+            if (errno != EINTR)
+            {
+                /* Kernel on low memory or a bug: pace */
+                msg_Err( host, "polling error: %m" );
+                msleep( 100000 );
+            }
+            continue;
+        }
+
+        bool b_die = false;
+        for( int i = 0; i < n; i++ )
+            if( io[i] == &wait_io )
+                b_die = true;
+        if( b_die )
             break;
 
         /* Handle client sockets */
         vlc_mutex_lock( &host->lock );
         now = mdate();
-        nfd = host->nfd;
-        for( int i_client = 0; i_client < host->i_client; i_client++ )
+        for( int i = 0; i < n; i++ )
         {
-            httpd_client_t *cl = host->client[i_client];
-            const struct pollfd *pufd = &ufd[nfd];
-
-            assert( pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])] );
+            httpd_client_t *cl = io[i]->cl;
 
-            if( cl->fd != pufd->fd )
-                continue; // we were not waiting for this client
-            ++nfd;
-            if( pufd->revents == 0 )
-                continue; // no event received
+            if( cl == NULL )
+                continue; // listening socket
 
             cl->i_activity_date = now;
 
@@ -2495,27 +3080,32 @@ static void* httpd_HostThread( void *data )
 
             if( cl->i_mode == HTTPD_CLIENT_BIDIR &&
                 cl->i_state == HTTPD_CLIENT_SENDING &&
-                (pufd->revents & POLLIN) )
+                (revents[i] & POLLIN) )
             {
                 cl->b_read_waiting = true;
             }
+
+            httpd_ClientWatch( host, cl );
         }
         vlc_mutex_unlock( &host->lock );
 
         /* Handle server sockets (accept new connections) */
-        for( nfd = 0; nfd < host->nfd; nfd++ )
+        for( int i = 0; i < n; i++ )
         {
             httpd_client_t *cl;
             int i_state = -1;
-            int fd = ufd[nfd].fd;
+            int fd;
 
-            assert (fd == host->fds[nfd]);
-
-            if( ufd[nfd].revents == 0 )
+            if( io[i]->cl != NULL )
                 continue;
 
+            assert( io[i] >= listen_io && io[i] < listen_io + host->nfd );
+
+            /* keep listening */
+            httpd_PollerArm( &host->poller, io[i], POLLIN );
+
             /* */
-            fd = vlc_accept (fd, NULL, NULL, true);
+            fd = vlc_accept (io[i]->fd, NULL, NULL, true);
             if (fd == -1)
                 continue;
             setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
@@ -2545,22 +3135,33 @@ static void* httpd_HostThread( void *data )
                     break; // wasted TLS session, cannot accept() anymore
             }
 
-            stats_UpdateInteger( host, p_total_counter, 1, NULL );
-            stats_UpdateInteger( host, p_active_counter, 1, NULL );
             cl = httpd_ClientNew( fd, p_tls, now );
+            if( cl == NULL )
+            {
+                if( p_tls != NULL )
+                    tls_ServerSessionClose( p_tls );
+                net_Close( fd );
+                p_tls = NULL;
+                continue;
+            }
             p_tls = NULL;
+            stats_UpdateInteger( host, p_total_counter, 1, NULL );
+            stats_UpdateInteger( host, p_active_counter, 1, NULL );
             vlc_mutex_lock( &host->lock );
             TAB_APPEND( host->i_client, host->client, cl );
-            vlc_mutex_unlock( &host->lock );
             if( i_state != -1 )
                 cl->i_state = i_state; // override state for TLS
+            httpd_WheelInsert( host, cl );
+            httpd_ClientWatch( host, cl );
+            vlc_mutex_unlock( &host->lock );
 
             if (host->p_tls != NULL)
                 break; // cannot accept further without new TLS session
         }
-
     }
 
+    httpd_PollerClean( &host->poller );
+    free( spare.clients );
     if( p_tls != NULL )
         tls_ServerSessionClose( p_tls );
     if( p_total_counter )
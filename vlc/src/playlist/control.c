@@ -208,6 +208,26 @@ int playlist_PreparseEnqueue( playlist_t *p_playlist, input_item_t *p_item )
     return VLC_SUCCESS;
 }
 
+/** Move an item ahead in the preparsing queue */
+int playlist_PreparsePrioritize( playlist_t *p_playlist, input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( p_sys->p_preparser )
+        playlist_preparser_Prioritize( p_sys->p_preparser, p_item );
+
+    return VLC_SUCCESS;
+}
+
+/** Withdraw a preparsing request */
+void playlist_PreparseCancel( playlist_t *p_playlist, input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( p_sys->p_preparser )
+        playlist_preparser_Cancel( p_sys->p_preparser, p_item );
+}
+
 int playlist_AskForArtEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 {
     playlist_private_t *p_sys = pl_priv(p_playlist);
@@ -25,6 +25,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_playlist.h>
 
@@ -37,6 +39,27 @@
 /*****************************************************************************
  * Structures/definitions
  *****************************************************************************/
+/* Priorities of the queued items, the highest first */
+enum
+{
+    PREPARSER_PRIORITY_NORMAL,
+    PREPARSER_PRIORITY_VISIBLE,
+    PREPARSER_PRIORITY_COUNT
+};
+
+/* An item to preparse, queued or being preparsed */
+typedef struct preparser_entry_t preparser_entry_t;
+struct preparser_entry_t
+{
+    input_item_t      *p_item;
+    unsigned           i_requests;  /* pushes not cancelled */
+    int                i_priority;  /* -1 once dequeued */
+
+    preparser_entry_t *p_prev;      /* in the queue of its priority */
+    preparser_entry_t *p_next;
+    preparser_entry_t *p_hash_next; /* in its bucket */
+};
+
 struct playlist_preparser_t
 {
     playlist_t          *p_playlist;
@@ -44,15 +67,123 @@ struct playlist_preparser_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    input_item_t  **pp_waiting;
-    int             i_waiting;
+    int             i_live;     /* worker threads */
+    int             i_busy;     /* of which preparsing */
+    int             i_threads;  /* at most */
+
+    /* FIFO per priority */
+    struct
+    {
+        preparser_entry_t *p_first;
+        preparser_entry_t *p_last;
+    } queue[PREPARSER_PRIORITY_COUNT];
+
+    /* All the entries, by item */
+    preparser_entry_t **pp_buckets;
+    unsigned        i_buckets;  /* power of two */
+    unsigned        i_entries;
 
     int             i_art_policy;
 };
 
 static void *Thread( void * );
 
+/*****************************************************************************
+ * Queue and index of the entries
+ *****************************************************************************/
+static inline unsigned Hash( const playlist_preparser_t *p_preparser,
+                             const input_item_t *p_item )
+{
+    return ( ( (uintptr_t)p_item >> 4 ) * 2654435761u )
+           & ( p_preparser->i_buckets - 1 );
+}
+
+static preparser_entry_t *Find( playlist_preparser_t *p_preparser,
+                                const input_item_t *p_item )
+{
+    preparser_entry_t *p_entry;
+
+    for( p_entry = p_preparser->pp_buckets[Hash( p_preparser, p_item )];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+        if( p_entry->p_item == p_item )
+            break;
+    return p_entry;
+}
+
+static void HashInsert( playlist_preparser_t *p_preparser,
+                        preparser_entry_t *p_entry )
+{
+    /* Keep the chains short when importing large libraries */
+    if( p_preparser->i_entries >= 2 * p_preparser->i_buckets )
+    {
+        const unsigned i_old = p_preparser->i_buckets;
+        preparser_entry_t **pp_old = p_preparser->pp_buckets;
+        preparser_entry_t **pp_new = calloc( 2 * i_old, sizeof(*pp_new) );
+
+        if( pp_new )
+        {
+            p_preparser->pp_buckets = pp_new;
+            p_preparser->i_buckets = 2 * i_old;
+            for( unsigned i = 0; i < i_old; i++ )
+                while( pp_old[i] )
+                {
+                    preparser_entry_t *p_moved = pp_old[i];
+                    const unsigned h = Hash( p_preparser, p_moved->p_item );
+
+                    pp_old[i] = p_moved->p_hash_next;
+                    p_moved->p_hash_next = pp_new[h];
+                    pp_new[h] = p_moved;
+                }
+            free( pp_old );
+        }
+    }
+
+    const unsigned h = Hash( p_preparser, p_entry->p_item );
+    p_entry->p_hash_next = p_preparser->pp_buckets[h];
+    p_preparser->pp_buckets[h] = p_entry;
+    p_preparser->i_entries++;
+}
+
+static void HashRemove( playlist_preparser_t *p_preparser,
+                        preparser_entry_t *p_entry )
+{
+    preparser_entry_t **pp = &p_preparser->pp_buckets[Hash( p_preparser,
+                                                        p_entry->p_item )];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+    p_preparser->i_entries--;
+}
+
+static void QueueAppend( playlist_preparser_t *p_preparser,
+                         preparser_entry_t *p_entry, int i_priority )
+{
+    p_entry->i_priority = i_priority;
+    p_entry->p_next = NULL;
+    p_entry->p_prev = p_preparser->queue[i_priority].p_last;
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry;
+    else
+        p_preparser->queue[i_priority].p_first = p_entry;
+    p_preparser->queue[i_priority].p_last = p_entry;
+}
+
+static void QueueRemove( playlist_preparser_t *p_preparser,
+                         preparser_entry_t *p_entry )
+{
+    const int i_priority = p_entry->i_priority;
+
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_preparser->queue[i_priority].p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_preparser->queue[i_priority].p_last = p_entry->p_prev;
+    p_entry->i_priority = -1;
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -62,56 +193,136 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_f
     if( !p_preparser )
         return NULL;
 
+    p_preparser->i_buckets = 64;
+    p_preparser->pp_buckets = calloc( p_preparser->i_buckets,
+                                      sizeof(*p_preparser->pp_buckets) );
+    if( !p_preparser->pp_buckets )
+    {
+        free( p_preparser );
+        return NULL;
+    }
+    p_preparser->i_entries = 0;
+
     p_preparser->p_playlist = p_playlist;
     p_preparser->p_fetcher = p_fetcher;
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    p_preparser->i_live = 0;
+    p_preparser->i_busy = 0;
+    p_preparser->i_threads = var_InheritInteger( p_playlist,
+                                                 "preparse-threads" );
+    if( p_preparser->i_threads < 1 )
+        p_preparser->i_threads = 1;
     p_preparser->i_art_policy = var_GetInteger( p_playlist, "album-art" );
-    p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
+    for( int i = 0; i < PREPARSER_PRIORITY_COUNT; i++ )
+        p_preparser->queue[i].p_first = p_preparser->queue[i].p_last = NULL;
 
     return p_preparser;
 }
 
 void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
 {
+    vlc_mutex_lock( &p_preparser->lock );
+    preparser_entry_t *p_entry = Find( p_preparser, p_item );
+    if( p_entry )
+    {
+        /* Already queued or being preparsed */
+        p_entry->i_requests++;
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
+
+    p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
     vlc_gc_incref( p_item );
+    p_entry->p_item = p_item;
+    p_entry->i_requests = 1;
+    HashInsert( p_preparser, p_entry );
+    QueueAppend( p_preparser, p_entry, PREPARSER_PRIORITY_NORMAL );
 
-    vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
+    /* The workers exit once the queue is empty, none is idle */
+    if( p_preparser->i_live < p_preparser->i_threads )
     {
         vlc_thread_t th;
 
         if( vlc_clone( &th, Thread, p_preparser, VLC_THREAD_PRIORITY_LOW ) )
-            msg_Warn( p_preparser->p_playlist,
-                      "cannot spawn pre-parser thread" );
+        {
+            if( p_preparser->i_live == 0 )
+                msg_Warn( p_preparser->p_playlist,
+                          "cannot spawn pre-parser thread" );
+        }
         else
         {
             vlc_detach( th );
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
         }
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
 
-void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
+void playlist_preparser_Prioritize( playlist_preparser_t *p_preparser,
+                                    input_item_t *p_item )
 {
     vlc_mutex_lock( &p_preparser->lock );
-    /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    preparser_entry_t *p_entry = Find( p_preparser, p_item );
+    if( p_entry && p_entry->i_priority >= 0
+     && p_entry->i_priority < PREPARSER_PRIORITY_VISIBLE )
     {
-        vlc_gc_decref( p_preparser->pp_waiting[0] );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        QueueRemove( p_preparser, p_entry );
+        QueueAppend( p_preparser, p_entry, PREPARSER_PRIORITY_VISIBLE );
     }
+    vlc_mutex_unlock( &p_preparser->lock );
+}
 
-    while( p_preparser->b_live )
+void playlist_preparser_Cancel( playlist_preparser_t *p_preparser,
+                                input_item_t *p_item )
+{
+    vlc_mutex_lock( &p_preparser->lock );
+    preparser_entry_t *p_entry = Find( p_preparser, p_item );
+    if( !p_entry || p_entry->i_requests == 0 || --p_entry->i_requests > 0 )
+        p_entry = NULL;
+    else if( p_entry->i_priority >= 0 )
+    {
+        QueueRemove( p_preparser, p_entry );
+        HashRemove( p_preparser, p_entry );
+    }
+    else
+        p_entry = NULL; /* being preparsed, the art will not be fetched */
+    vlc_mutex_unlock( &p_preparser->lock );
+
+    if( p_entry )
+    {
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
+    }
+}
+
+void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
+{
+    vlc_mutex_lock( &p_preparser->lock );
+    /* Remove pending items to speed up the workers exit */
+    for( int i = 0; i < PREPARSER_PRIORITY_COUNT; i++ )
+        while( p_preparser->queue[i].p_first )
+        {
+            preparser_entry_t *p_entry = p_preparser->queue[i].p_first;
+
+            QueueRemove( p_preparser, p_entry );
+            HashRemove( p_preparser, p_entry );
+            vlc_gc_decref( p_entry->p_item );
+            free( p_entry );
+        }
+
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
     /* Destroy the item preparser */
+    assert( p_preparser->i_entries == 0 );
+    free( p_preparser->pp_buckets );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
     free( p_preparser );
@@ -132,8 +343,6 @@ static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
     if( i_type != ITEM_TYPE_FILE )
         return;
 
-    stats_TimerStart( p_playlist, "Preparse run", STATS_TIMER_PREPARSE );
-
     /* Do not preparse if it is already done (like by playing it) */
     if( !input_item_IsPreparsed( p_item ) )
     {
@@ -142,8 +351,6 @@ static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
 
         var_SetAddress( p_playlist, "item-change", p_item );
     }
-
-    stats_TimerStop( p_playlist, STATS_TIMER_PREPARSE );
 }
 
 /**
@@ -188,7 +395,8 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 }
 
 /**
- * This function does the preparsing and issues the art fetching requests
+ * This function does the preparsing and issues the art fetching requests,
+ * in as many threads as allowed.
  */
 static void *Thread( void *data )
 {
@@ -197,30 +405,45 @@ static void *Thread( void *data )
 
     for( ;; )
     {
-        input_item_t *p_current;
+        preparser_entry_t *p_entry = NULL;
+        bool b_art;
 
         /* */
         vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
+        for( int i = PREPARSER_PRIORITY_COUNT - 1; i >= 0 && !p_entry; i-- )
+            p_entry = p_preparser->queue[i].p_first;
+
+        if( p_entry )
         {
-            p_current = p_preparser->pp_waiting[0];
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+            QueueRemove( p_preparser, p_entry );
+            /* The timer measures the time spent with any item preparsing */
+            if( p_preparser->i_busy++ == 0 )
+                stats_TimerStart( p_playlist, "Preparse run",
+                                  STATS_TIMER_PREPARSE );
         }
         else
         {
-            p_current = NULL;
-            p_preparser->b_live = false;
+            p_preparser->i_live--;
             vlc_cond_signal( &p_preparser->wait );
         }
         vlc_mutex_unlock( &p_preparser->lock );
 
-        if( !p_current )
+        if( !p_entry )
             break;
 
-        Preparse( p_playlist, p_current );
+        Preparse( p_playlist, p_entry->p_item );
 
-        Art( p_preparser, p_current );
+        vlc_mutex_lock( &p_preparser->lock );
+        b_art = p_entry->i_requests > 0;
+        HashRemove( p_preparser, p_entry );
+        if( --p_preparser->i_busy == 0 )
+            stats_TimerStop( p_playlist, STATS_TIMER_PREPARSE );
+        vlc_mutex_unlock( &p_preparser->lock );
+
+        if( b_art )
+            Art( p_preparser, p_entry->p_item );
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
     }
     return NULL;
 }
-
@@ -35,7 +35,9 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
+ *
+ * Up to "preparse-threads" worker threads are started as items are pushed.
  */
 playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t * );
 
@@ -43,12 +45,27 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t *
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. An item already queued or being preparsed is
+ * not queued again.
  */
 void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function moves a queued item ahead of the items that are not visible
+ * to the user.
+ */
+void playlist_preparser_Prioritize( playlist_preparser_t *, input_item_t * );
+
+/**
+ * This function withdraws one push of the provided item.
+ *
+ * Once all its pushes are withdrawn, the item is removed from the queue and
+ * released, or if it is being preparsed, its art will not be fetched.
+ */
+void playlist_preparser_Cancel( playlist_preparser_t *, input_item_t * );
+
+/**
+ * This function destroys the preparser object and threads.
  *
  * All pending input items will be released.
  */
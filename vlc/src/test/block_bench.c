@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * block_bench.c: Benchmark for block_t allocation
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../libvlc.h"
+
+#define ITERATIONS 2000000
+#define BURST      64
+#define MAX_THREADS 8
+
+/* Payload sizes seen on the TS, UDP and RTP input paths */
+static const size_t sizes[] = { 188, 1316, 1500, 4096 };
+#define NB_SIZES (sizeof (sizes) / sizeof (sizes[0]))
+
+/* Allocation as done before the block pool: one malloc() per block */
+static void *heap_alloc (size_t size)
+{
+    return malloc (96 + 16 + 64 + ((size + 15) & ~15));
+}
+
+struct bench
+{
+    bool pooled;
+    size_t size;
+};
+
+static void *bench_thread (void *data)
+{
+    const struct bench *bench = data;
+    void *tab[BURST];
+
+    for (unsigned i = 0; i < ITERATIONS / BURST; i++)
+    {
+        if (bench->pooled)
+        {
+            for (unsigned j = 0; j < BURST; j++)
+                tab[j] = block_Alloc (bench->size);
+            for (unsigned j = 0; j < BURST; j++)
+                block_Release (tab[j]);
+        }
+        else
+        {
+            for (unsigned j = 0; j < BURST; j++)
+                tab[j] = heap_alloc (bench->size);
+            for (unsigned j = 0; j < BURST; j++)
+                free (tab[j]);
+        }
+    }
+    return NULL;
+}
+
+/* Producer/consumer pair: blocks are released by another thread */
+static void *consumer_thread (void *data)
+{
+    block_fifo_t *fifo = data;
+    block_t *block;
+
+    while ((block = block_FifoGet (fifo)) != NULL && block->i_buffer > 0)
+        block_Release (block);
+    if (block != NULL)
+        block_Release (block);
+    return NULL;
+}
+
+static mtime_t bench_run (bool pooled, size_t size, unsigned threads)
+{
+    vlc_thread_t th[MAX_THREADS];
+    struct bench bench = { pooled, size };
+    mtime_t start = mdate ();
+
+    for (unsigned i = 0; i < threads; i++)
+        if (vlc_clone (th + i, bench_thread, &bench, VLC_THREAD_PRIORITY_LOW))
+            abort ();
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join (th[i], NULL);
+    return mdate () - start;
+}
+
+static mtime_t bench_pipeline (size_t size)
+{
+    block_fifo_t *fifo = block_FifoNew ();
+    vlc_thread_t th;
+    mtime_t start = mdate ();
+
+    if (fifo == NULL
+     || vlc_clone (&th, consumer_thread, fifo, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+    {
+        block_t *block = block_Alloc (size);
+        if (block == NULL)
+            abort ();
+        block_FifoPace (fifo, 4096, SIZE_MAX);
+        block_FifoPut (fifo, block);
+    }
+    block_FifoPut (fifo, block_Alloc (0));
+    vlc_join (th, NULL);
+    block_FifoRelease (fifo);
+    return mdate () - start;
+}
+
+int main (void)
+{
+    printf ("%-6s %-8s %12s %12s\n", "size", "threads", "heap Mop/s",
+            "pool Mop/s");
+    for (unsigned i = 0; i < NB_SIZES; i++)
+        for (unsigned threads = 1; threads <= MAX_THREADS; threads *= 2)
+        {
+            mtime_t heap = bench_run (false, sizes[i], threads);
+            mtime_t pool = bench_run (true, sizes[i], threads);
+
+            printf ("%-6zu %-8u %12.2f %12.2f\n", sizes[i], threads,
+                    (double)threads * ITERATIONS / heap,
+                    (double)threads * ITERATIONS / pool);
+        }
+
+    for (unsigned i = 0; i < NB_SIZES; i++)
+        printf ("pipeline %4zu bytes: %.1f ns/block\n", sizes[i],
+                bench_pipeline (sizes[i]) * 1000. / ITERATIONS);
+
+    uint64_t hits, misses;
+    block_PoolStats (&hits, &misses);
+    printf ("pool: %"PRIu64" hits, %"PRIu64" misses\n", hits, misses);
+    return 0;
+}
@@ -29,6 +29,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include "../libvlc.h"
 
 static const char text[] =
     "This is a test!\n"
@@ -84,10 +85,117 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Grow (void)
+{
+    /* Walk the block across all pool size classes and into the heap */
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+
+    for (size_t size = 256; size <= 65536; size *= 2)
+    {
+        block = block_Realloc (block, 0, size);
+        assert (block != NULL);
+        assert (block->i_buffer == size);
+        assert (!memcmp (block->p_buffer, text, sizeof (text)));
+        memset (block->p_buffer + sizeof (text), 0xA5, size - sizeof (text));
+    }
+
+    block = block_Realloc (block, 0, sizeof (text));
+    assert (block != NULL);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (block);
+}
+
+#define POOL_BLOCKS 1000
+
+static void *pool_thread (void *data)
+{
+    block_t **tab = data;
+
+    for (unsigned round = 0; round < 2; round++)
+    {
+        for (unsigned i = 0; i < POOL_BLOCKS; i++)
+        {
+            tab[i] = block_Alloc (188 + (i % 3));
+            assert (tab[i] != NULL);
+            memset (tab[i]->p_buffer, i, tab[i]->i_buffer);
+        }
+        for (unsigned i = 0; i < POOL_BLOCKS; i++)
+        {
+            assert (tab[i]->p_buffer[0] == (uint8_t)i);
+            block_Release (tab[i]);
+        }
+    }
+    return NULL;
+}
+
+static void *release_thread (void *data)
+{
+    block_t **tab = data;
+
+    for (unsigned i = 0; i < POOL_BLOCKS; i++)
+        block_Release (tab[i]);
+    return NULL;
+}
+
+static void test_block_Pool (void)
+{
+    block_t *tab[POOL_BLOCKS];
+    uint64_t hits, misses, hits2, misses2;
+    vlc_thread_t th;
+
+    /* Statistics of a thread are accounted for when it exits */
+    block_PoolStats (&hits, &misses);
+    assert (vlc_clone (&th, pool_thread, tab, VLC_THREAD_PRIORITY_LOW) == 0);
+    vlc_join (th, NULL);
+    block_PoolStats (&hits2, &misses2);
+
+    printf ("Pool: %"PRIu64" hits, %"PRIu64" misses\n",
+            hits2 - hits, misses2 - misses);
+    assert ((hits2 - hits) + (misses2 - misses) == 2 * POOL_BLOCKS);
+    assert ((hits2 - hits) >= POOL_BLOCKS);
+
+    /* Blocks released from another thread must be recycled too */
+    for (unsigned i = 0; i < POOL_BLOCKS; i++)
+    {
+        tab[i] = block_Alloc (1316);
+        assert (tab[i] != NULL);
+    }
+    assert (vlc_clone (&th, release_thread, tab, VLC_THREAD_PRIORITY_LOW) == 0);
+    vlc_join (th, NULL);
+
+    block_PoolStats (&hits, &misses);
+    assert (vlc_clone (&th, pool_thread, tab, VLC_THREAD_PRIORITY_LOW) == 0);
+    vlc_join (th, NULL);
+    block_PoolStats (&hits2, &misses2);
+    assert ((hits2 - hits) + (misses2 - misses) == 2 * POOL_BLOCKS);
+
+    /* Shrinking within the same size class keeps the block in place */
+    block_t *block = block_Alloc (30000);
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block_t *shrunk = block_Realloc (block, 0, 27000);
+    assert (shrunk == block);
+    assert (!memcmp (shrunk->p_buffer, text, sizeof (text)));
+    block_Release (shrunk);
+
+    /* The pool remains usable once emptied */
+    block_PoolCleanup ();
+    block = block_Alloc (188);
+    assert (block != NULL);
+    block_Release (block);
+    block_PoolCleanup ();
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_Grow ();
+#ifndef OPTIMIZE_MEMORY
+    test_block_Pool ();
+#endif
     return 0;
 }
 
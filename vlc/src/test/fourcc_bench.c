@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * fourcc_bench.c: fourcc lookup benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <vlc_common.h>
+#include <vlc_fourcc.h>
+
+#define ITERATIONS 100000
+
+/* Codecs and aliases as found in files, from the head and the tail of the
+ * lists, and a fourcc that no list knows about (the worst case) */
+static const struct
+{
+    int          i_cat;
+    vlc_fourcc_t i_fourcc;
+} lookups[] = {
+    { VIDEO_ES,   VLC_FOURCC('m','p','g','v') },
+    { VIDEO_ES,   VLC_FOURCC('a','v','c','1') },
+    { VIDEO_ES,   VLC_FOURCC('D','I','V','X') },
+    { VIDEO_ES,   VLC_FOURCC('M','J','P','G') },
+    { VIDEO_ES,   VLC_FOURCC('M','J','2','C') },
+    { AUDIO_ES,   VLC_FOURCC('m','p','4','a') },
+    { AUDIO_ES,   VLC_FOURCC('a','5','2',' ') },
+    { AUDIO_ES,   VLC_FOURCC('T','W','I','N') },
+    { SPU_ES,     VLC_FOURCC('s','u','b','t') },
+    { UNKNOWN_ES, VLC_FOURCC('w','v','c','1') },
+    { UNKNOWN_ES, VLC_FOURCC('z','z','z','z') },
+};
+
+static const vlc_fourcc_t chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_YV12, VLC_CODEC_UYVY, VLC_CODEC_RGB32,
+    VLC_CODEC_Y211, VLC_FOURCC('z','z','z','z'),
+};
+
+#define COUNT(t) (sizeof(t) / sizeof((t)[0]))
+
+int main (void)
+{
+    volatile uintptr_t sink = 0;
+    mtime_t start, duration;
+
+    start = mdate ();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+        for (unsigned j = 0; j < COUNT(lookups); j++)
+            sink += vlc_fourcc_GetCodec (lookups[j].i_cat,
+                                         lookups[j].i_fourcc);
+    duration = mdate () - start;
+    printf ("%-30s %8.1f ns per call\n", "vlc_fourcc_GetCodec",
+            duration * 1000. / (ITERATIONS * COUNT(lookups)));
+
+    start = mdate ();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+        for (unsigned j = 0; j < COUNT(lookups); j++)
+            sink += (uintptr_t)vlc_fourcc_GetDescription (lookups[j].i_cat,
+                                                          lookups[j].i_fourcc);
+    duration = mdate () - start;
+    printf ("%-30s %8.1f ns per call\n", "vlc_fourcc_GetDescription",
+            duration * 1000. / (ITERATIONS * COUNT(lookups)));
+
+    start = mdate ();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+        for (unsigned j = 0; j < COUNT(chromas); j++)
+            sink += (uintptr_t)vlc_fourcc_GetChromaDescription (chromas[j]);
+    duration = mdate () - start;
+    printf ("%-30s %8.1f ns per call\n", "vlc_fourcc_GetChromaDescription",
+            duration * 1000. / (ITERATIONS * COUNT(chromas)));
+
+    (void) sink;
+    return 0;
+}
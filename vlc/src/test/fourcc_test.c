@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * fourcc_test.c: Test for the fourcc lookup tables
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The sorted indexes are checked against linear scans of the lists, as done
+ * before they existed, for every fourcc of the lists, for variants of them,
+ * and for random fourccs. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include "../misc/fourcc.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+static const int categories[] = { VIDEO_ES, AUDIO_ES, SPU_ES, UNKNOWN_ES };
+
+/* Linear scan of a list, returns the class and sets the description */
+static vlc_fourcc_t ScanList( const entry_t p_list[], vlc_fourcc_t i_fourcc,
+                              const char **ppsz_description )
+{
+    vlc_fourcc_t i_class = 0;
+    const char *psz_class_description = NULL;
+
+    for( unsigned i = 0; CreateFourcc( p_list[i].p_fourcc ) != 0; i++ )
+    {
+        const entry_t *p = &p_list[i];
+
+        if( CreateFourcc( p->p_class ) != 0 )
+        {
+            i_class = CreateFourcc( p->p_class );
+            psz_class_description = p->psz_description;
+        }
+        if( CreateFourcc( p->p_fourcc ) == i_fourcc )
+        {
+            *ppsz_description = p->psz_description ? p->psz_description
+                                                   : psz_class_description;
+            return i_class;
+        }
+    }
+    *ppsz_description = "";
+    return 0;
+}
+
+static vlc_fourcc_t Scan( int i_cat, vlc_fourcc_t i_fourcc,
+                          const char **ppsz_description )
+{
+    vlc_fourcc_t i_class;
+
+    switch( i_cat )
+    {
+        case VIDEO_ES:
+            return ScanList( p_list_video, i_fourcc, ppsz_description );
+        case AUDIO_ES:
+            return ScanList( p_list_audio, i_fourcc, ppsz_description );
+        case SPU_ES:
+            return ScanList( p_list_spu, i_fourcc, ppsz_description );
+    }
+    i_class = ScanList( p_list_video, i_fourcc, ppsz_description );
+    if( i_class == 0 )
+        i_class = ScanList( p_list_audio, i_fourcc, ppsz_description );
+    if( i_class == 0 )
+        i_class = ScanList( p_list_spu, i_fourcc, ppsz_description );
+    return i_class;
+}
+
+static const vlc_chroma_description_t *ScanChroma( vlc_fourcc_t i_fourcc )
+{
+    for( unsigned i = 0; p_list_chroma_description[i].p_fourcc[0]; i++ )
+        for( unsigned j = 0; p_list_chroma_description[i].p_fourcc[j]; j++ )
+            if( p_list_chroma_description[i].p_fourcc[j] == i_fourcc )
+                return &p_list_chroma_description[i].description;
+    return NULL;
+}
+
+static unsigned checked;
+
+static void check( vlc_fourcc_t i_fourcc )
+{
+    for( unsigned i = 0; i < sizeof(categories) / sizeof(categories[0]); i++ )
+    {
+        const char *psz_description;
+        vlc_fourcc_t i_class = Scan( categories[i], i_fourcc,
+                                     &psz_description );
+
+        if( i_class == 0 )
+            i_class = i_fourcc;
+        assert( vlc_fourcc_GetCodec( categories[i], i_fourcc ) == i_class );
+        assert( !strcmp( vlc_fourcc_GetDescription( categories[i], i_fourcc ),
+                         psz_description ) );
+    }
+    assert( vlc_fourcc_GetChromaDescription( i_fourcc )
+            == ScanChroma( i_fourcc ) );
+    checked++;
+}
+
+/* Checks the fourcc, and the same with each character in the other case */
+static void check_variants( vlc_fourcc_t i_fourcc )
+{
+    check( i_fourcc );
+    for( unsigned i = 0; i < 32; i += 8 )
+    {
+        int c = (i_fourcc >> i) & 0xff;
+        int o = isupper( c ) ? tolower( c ) : toupper( c );
+
+        if( o != c )
+            check( (i_fourcc & ~(0xffu << i)) | ((vlc_fourcc_t)o << i) );
+    }
+}
+
+static void check_list( const entry_t p_list[] )
+{
+    for( unsigned i = 0; CreateFourcc( p_list[i].p_fourcc ) != 0; i++ )
+        check_variants( CreateFourcc( p_list[i].p_fourcc ) );
+}
+
+int main( void )
+{
+    check_list( p_list_video );
+    check_list( p_list_audio );
+    check_list( p_list_spu );
+    for( unsigned i = 0; p_list_chroma_description[i].p_fourcc[0]; i++ )
+        for( unsigned j = 0; p_list_chroma_description[i].p_fourcc[j]; j++ )
+            check_variants( p_list_chroma_description[i].p_fourcc[j] );
+
+    check( 0 );
+    srand( 0 );
+    for( unsigned i = 0; i < 100000; i++ )
+        check( ((vlc_fourcc_t)rand() << 16) ^ (vlc_fourcc_t)rand() );
+
+    printf( "%u fourccs checked\n", checked );
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*****************************************************************************
+ * stats_bench.c: Statistics counters overhead benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../libvlc.h"
+#undef NDEBUG
+#include <assert.h>
+
+#define ITERATIONS 2000000
+#define MAX_THREADS 4
+#define PACKET     188
+
+/* Only the stats flag of the instance is used by the counters */
+static libvlc_priv_t priv;
+static vlc_object_t obj;
+
+static counter_t *bytes, *packets, *bitrate;
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+
+/* Same updates as EsOutSend() for each demuxed block */
+static void *bench_thread (void *data)
+{
+    const bool *locked = data;
+
+    for (unsigned i = 0; i < ITERATIONS; i++)
+    {
+        int i_total = 0;
+
+        if (*locked)
+            vlc_mutex_lock (&lock);
+        stats_UpdateInteger (&obj, bytes, PACKET, &i_total);
+        stats_UpdateFloat (&obj, bitrate, (float)i_total, NULL);
+        stats_UpdateInteger (&obj, packets, 1, NULL);
+        if (*locked)
+            vlc_mutex_unlock (&lock);
+    }
+    return NULL;
+}
+
+/* The input thread reads the counters every second, do it more often */
+static void *reader_thread (void *data)
+{
+    int64_t i_packets;
+    float f_bitrate;
+
+    for (;;)
+    {
+        mwait (mdate () + 20000);
+        vlc_mutex_lock (&lock);
+        stats_GetInteger (&obj, packets, &i_packets);
+        stats_GetFloat (&obj, bitrate, &f_bitrate);
+        vlc_mutex_unlock (&lock);
+    }
+    (void) data;
+    return NULL;
+}
+
+static double bench_run (bool enabled, bool locked, unsigned threads)
+{
+    vlc_thread_t th[MAX_THREADS], reader;
+
+    priv.b_stats = enabled;
+    bytes = stats_CounterCreate (&obj, VLC_VAR_INTEGER, STATS_COUNTER);
+    packets = stats_CounterCreate (&obj, VLC_VAR_INTEGER, STATS_COUNTER);
+    bitrate = stats_CounterCreate (&obj, VLC_VAR_FLOAT, STATS_DERIVATIVE);
+    assert (bytes != NULL && packets != NULL && bitrate != NULL);
+    bitrate->update_interval = 10000;
+
+    if (vlc_clone (&reader, reader_thread, NULL, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < threads; i++)
+        if (vlc_clone (th + i, bench_thread, &locked, VLC_THREAD_PRIORITY_LOW))
+            abort ();
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join (th[i], NULL);
+    mtime_t duration = mdate () - start;
+
+    vlc_cancel (reader);
+    vlc_join (reader, NULL);
+
+    if (enabled)
+    {   /* No update may be lost */
+        int64_t i_packets;
+
+        assert (stats_GetInteger (&obj, packets, &i_packets) == VLC_SUCCESS);
+        assert (i_packets == (int64_t)threads * ITERATIONS);
+    }
+
+    stats_CounterClean (bitrate);
+    stats_CounterClean (packets);
+    stats_CounterClean (bytes);
+    return duration * 1000. / ((double)threads * ITERATIONS);
+}
+
+int main (void)
+{
+    obj.p_libvlc = &priv.public_data;
+
+    printf ("%-8s %12s %12s %12s\n", "threads", "off ns/blk", "on ns/blk",
+            "locked ns/blk");
+    for (unsigned threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        double off = bench_run (false, false, threads);
+        double on = bench_run (true, false, threads);
+        double locked = bench_run (true, true, threads);
+
+        printf ("%-8u %12.1f %12.1f %12.1f\n", threads, off, on, locked);
+    }
+    return 0;
+}
@@ -45,6 +45,107 @@ static void callback (void *ptr)
     vlc_mutex_unlock (&data->lock);
 }
 
+static void rearm_callback (void *ptr)
+{
+    struct timer_data *data = ptr;
+
+    vlc_mutex_lock (&data->lock);
+    if (++data->count < 10)
+        vlc_timer_schedule (data->timer, false, CLOCK_FREQ / 100, 0);
+    vlc_mutex_unlock (&data->lock);
+}
+
+struct count_data
+{
+    struct timer_data *data;
+    mtime_t deadline;
+    mtime_t fired;
+    unsigned count;
+};
+
+static void count_callback (void *ptr)
+{
+    struct count_data *t = ptr;
+    mtime_t now = mdate ();
+
+    vlc_mutex_lock (&t->data->lock);
+    t->data->count++;
+    t->count++;
+    t->fired = now;
+    vlc_mutex_unlock (&t->data->lock);
+}
+
+static void block_callback (void *ptr)
+{
+    struct timer_data *data = ptr;
+
+    mwait (mdate () + CLOCK_FREQ / 2);
+    vlc_mutex_lock (&data->lock);
+    data->count++;
+    vlc_mutex_unlock (&data->lock);
+}
+
+static void check_callback (void *ptr)
+{
+    struct timer_data *data = ptr;
+
+    /* The blocking timers must not have delayed this one */
+    vlc_mutex_lock (&data->lock);
+    assert (data->count == 0);
+    data->count = 1000;
+    vlc_mutex_unlock (&data->lock);
+}
+
+static void slow_callback (void *ptr)
+{
+    struct timer_data *data = ptr;
+
+    vlc_mutex_lock (&data->lock);
+    data->count++;
+    vlc_mutex_unlock (&data->lock);
+    mwait (mdate () + CLOCK_FREQ / 10);
+}
+
+struct other_data
+{
+    struct timer_data *data;
+    vlc_timer_t other;
+};
+
+static void other_callback (void *ptr)
+{
+    struct other_data *o = ptr;
+    vlc_timer_t timer;
+
+    /* Timers can be destroyed and created from another timer callback */
+    vlc_timer_destroy (o->other);
+    assert (vlc_timer_create (&timer, callback, o->data) == 0);
+    vlc_timer_destroy (timer);
+
+    vlc_mutex_lock (&o->data->lock);
+    o->data->count = 1;
+    vlc_mutex_unlock (&o->data->lock);
+}
+
+/* Waits until the count reaches the given value, or at most a second */
+static unsigned wait_count (struct timer_data *data, unsigned count)
+{
+    mtime_t deadline = mdate () + CLOCK_FREQ;
+    unsigned val;
+
+    for (;;)
+    {
+        vlc_mutex_lock (&data->lock);
+        val = data->count;
+        vlc_mutex_unlock (&data->lock);
+        if (val >= count || mdate () >= deadline)
+            return val;
+        mwait (mdate () + CLOCK_FREQ / 100);
+    }
+}
+
+#define TIMERS   1000
+#define BLOCKING 8
 
 int main (void)
 {
@@ -80,6 +181,100 @@ int main (void)
     vlc_mutex_unlock (&data.lock);
 
     vlc_timer_destroy (data.timer);
+
+    /* One-shot timer rearmed from its own callback */
+    data.count = 0;
+    val = vlc_timer_create (&data.timer, rearm_callback, &data);
+    assert (val == 0);
+    vlc_timer_schedule (data.timer, false, CLOCK_FREQ / 100, 0);
+    msleep (CLOCK_FREQ / 2);
+    vlc_mutex_lock (&data.lock);
+    printf ("Count = %u\n", data.count);
+    assert (data.count == 10);
+    vlc_mutex_unlock (&data.lock);
+    vlc_timer_destroy (data.timer);
+
+    /* One-shot timer expiring again while its callback still runs */
+    data.count = 0;
+    val = vlc_timer_create (&data.timer, slow_callback, &data);
+    assert (val == 0);
+    vlc_timer_schedule (data.timer, false, 1, 0);
+    assert (wait_count (&data, 1) == 1);
+    vlc_timer_schedule (data.timer, false, CLOCK_FREQ / 100, 0);
+    val = wait_count (&data, 2);
+    printf ("Count = %u\n", val);
+    assert (val == 2);
+    vlc_timer_destroy (data.timer);
+
+    /* Timer destroying the last other timer from its callback */
+    struct other_data other = { .data = &data };
+
+    data.count = 0;
+    val = vlc_timer_create (&data.timer, other_callback, &other);
+    assert (val == 0);
+    val = vlc_timer_create (&other.other, callback, &data);
+    assert (val == 0);
+    vlc_timer_schedule (data.timer, false, 1, 0);
+    assert (wait_count (&data, 1) == 1);
+    vlc_timer_destroy (data.timer);
+
+    /* Many concurrent timers */
+    vlc_timer_t timers[TIMERS];
+    struct count_data counts[TIMERS];
+
+    data.count = 0;
+    now = mdate ();
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        counts[i].data = &data;
+        counts[i].deadline = now + 1 + (i % 100) * 1000;
+        if (!(i & 1)) /* to be disarmed before it may fire */
+            counts[i].deadline += 10 * CLOCK_FREQ;
+        counts[i].count = 0;
+        val = vlc_timer_create (timers + i, count_callback, counts + i);
+        assert (val == 0);
+        vlc_timer_schedule (timers[i], true, counts[i].deadline, 0);
+    }
+    /* Disarmed timers must not fire */
+    for (unsigned i = 0; i < TIMERS; i += 2)
+        vlc_timer_schedule (timers[i], false, 0, 0);
+    msleep (CLOCK_FREQ / 2);
+    for (unsigned i = 0; i < TIMERS; i++)
+        vlc_timer_destroy (timers[i]);
+    printf ("Count = %u\n", data.count);
+    assert (data.count <= TIMERS / 2);
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        assert (counts[i].count <= (i & 1));
+        /* A timer never fires early */
+        if (counts[i].count)
+            assert (counts[i].fired >= counts[i].deadline);
+    }
+
+    /* Blocking timers do not hold the shared timer threads */
+    vlc_timer_t blocking[BLOCKING], check;
+
+    data.count = 0;
+    for (unsigned i = 0; i < BLOCKING; i++)
+    {
+        val = vlc_timer_create_blocking (blocking + i, block_callback, &data);
+        assert (val == 0);
+        vlc_timer_schedule (blocking[i], false, 1, 0);
+    }
+    val = vlc_timer_create (&check, check_callback, &data);
+    assert (val == 0);
+    vlc_timer_schedule (check, false, CLOCK_FREQ / 20, 0);
+    for (unsigned count = 0; count != 1000 + BLOCKING;)
+    {
+        msleep (CLOCK_FREQ / 10);
+        vlc_mutex_lock (&data.lock);
+        count = data.count;
+        vlc_mutex_unlock (&data.lock);
+    }
+    for (unsigned i = 0; i < BLOCKING; i++)
+        vlc_timer_destroy (blocking[i]);
+    vlc_timer_destroy (check);
+
     vlc_mutex_destroy (&data.lock);
 
     return 0;
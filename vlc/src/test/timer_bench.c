@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * timer_bench.c: Stress test for the timer API
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#define TIMERS   10000
+#define DURATION (5 * CLOCK_FREQ)
+/* Lateness histogram: 100 microseconds buckets, up to 100 milliseconds */
+#define BUCKET   100
+#define BUCKETS  1000
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static unsigned histogram[BUCKETS + 1];
+static uint64_t runs, overruns;
+static mtime_t late_max, late_sum;
+
+struct bench_timer
+{
+    vlc_timer_t timer;
+    mtime_t     expected, interval;
+};
+
+static void callback (void *data)
+{
+    struct bench_timer *t = data;
+    mtime_t now = mdate ();
+    unsigned overrun = vlc_timer_getoverrun (t->timer);
+
+    /* Only one thread runs a given timer at a time */
+    t->expected += overrun * t->interval;
+
+    mtime_t late = now - t->expected;
+    unsigned bucket = (late > 0) ? (late / BUCKET) : 0;
+    if (bucket > BUCKETS)
+        bucket = BUCKETS;
+
+    vlc_mutex_lock (&lock);
+    histogram[bucket]++;
+    runs++;
+    overruns += overrun;
+    late_sum += late;
+    if (late > late_max)
+        late_max = late;
+    vlc_mutex_unlock (&lock);
+
+    t->expected += t->interval;
+}
+
+static unsigned count_threads (void)
+{
+    FILE *stream = fopen ("/proc/self/status", "r");
+    unsigned threads = 0;
+    char line[256];
+
+    if (stream == NULL)
+        return 0;
+    while (fgets (line, sizeof (line), stream) != NULL)
+        if (sscanf (line, "Threads: %u", &threads) == 1)
+            break;
+    fclose (stream);
+    return threads;
+}
+
+static mtime_t percentile (unsigned permille)
+{
+    uint64_t target = runs * permille / 1000, sum = 0;
+
+    for (unsigned i = 0; i <= BUCKETS; i++)
+    {
+        sum += histogram[i];
+        if (sum >= target)
+            return (mtime_t)i * BUCKET;
+    }
+    return (mtime_t)BUCKETS * BUCKET;
+}
+
+int main (void)
+{
+    struct bench_timer *tab = malloc (TIMERS * sizeof (*tab));
+    unsigned threads_before = count_threads (), threads_max = 0;
+
+    assert (tab != NULL);
+
+    mtime_t start = mdate () + CLOCK_FREQ / 10;
+    for (unsigned i = 0; i < TIMERS; i++)
+    {
+        struct bench_timer *t = tab + i;
+
+        /* Intervals between 10 and 100 milliseconds */
+        t->interval = (10 + (i % 91)) * (CLOCK_FREQ / 1000);
+        t->expected = start + (i % 1000) * 10;
+        assert (vlc_timer_create (&t->timer, callback, t) == 0);
+        vlc_timer_schedule (t->timer, true, t->expected, t->interval);
+    }
+
+    for (mtime_t end = start + DURATION; mdate () < end;)
+    {
+        unsigned threads = count_threads ();
+        if (threads > threads_max)
+            threads_max = threads;
+        msleep (CLOCK_FREQ / 4);
+    }
+
+    for (unsigned i = 0; i < TIMERS; i++)
+        vlc_timer_destroy (tab[i].timer);
+    free (tab);
+
+    vlc_mutex_lock (&lock);
+    printf ("%u timers, %"PRIu64" runs, %"PRIu64" overruns\n", TIMERS, runs,
+            overruns);
+    printf ("lateness: mean %"PRId64" us, 50%% %"PRId64" us, "
+            "99%% %"PRId64" us, 99.9%% %"PRId64" us, max %"PRId64" us\n",
+            runs ? late_sum / (mtime_t)runs : 0, percentile (500),
+            percentile (990), percentile (999), late_max);
+    printf ("threads: %u before, %u at most while running\n",
+            threads_before, threads_max);
+    vlc_mutex_unlock (&lock);
+    return 0;
+}
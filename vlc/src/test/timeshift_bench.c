@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * timeshift_bench.c: Timeshift storage throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_timeshift [directory]
+ * Writes blocks to a timeshift storage file in the given directory (the
+ * timeshift default one otherwise), reads them back, and prints the
+ * sustained Mbit/s of both, with the mmap reads and with the stdio ones. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include "../input/es_out_timeshift.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Only used by the timeshift thread, which is not run here */
+void input_ControlPush( input_thread_t *p_input, int i_type,
+                        vlc_value_t *p_val )
+{
+    (void) p_input; (void) i_type; (void) p_val;
+    abort();
+}
+
+#undef vlc_custom_create
+void *vlc_custom_create( vlc_object_t *p_this, size_t i_size, int i_type,
+                         const char *psz_type )
+{
+    (void) p_this; (void) i_size; (void) i_type; (void) psz_type;
+    abort();
+}
+
+#if defined (LIBVLC_USE_PTHREAD)
+# undef vlc_assert_locked
+void vlc_assert_locked( vlc_mutex_t *p_mutex )
+{
+    (void) p_mutex;
+}
+#endif
+
+#define STORAGE_MAX (INT64_C(256) << 20)
+
+static const size_t sizes[] = {
+    1316,       /* 7 TS packets, as received from UDP */
+    16384,
+    65536,      /* large video frames */
+};
+
+/* Reads the payload as a decoder would, so that the mapped pages are
+ * actually faulted in */
+static uint64_t Touch( const block_t *p_block )
+{
+    uint64_t i_sum = 0;
+
+    for( size_t i = 0; i < p_block->i_buffer; i += 64 )
+        i_sum += p_block->p_buffer[i];
+    return i_sum;
+}
+
+static void bench( const char *psz_path, size_t i_size, bool b_mmap )
+{
+    ts_storage_t *p_storage = TsStorageNew( psz_path, STORAGE_MAX );
+    assert( p_storage != NULL );
+    p_storage->b_map_error = !b_mmap;
+
+    /* Writes, until the storage file is full */
+    block_t *p_model = block_Alloc( i_size );
+    assert( p_model != NULL );
+    for( size_t i = 0; i < i_size; i++ )
+        p_model->p_buffer[i] = i * 7;
+
+    int64_t i_written = 0;
+    mtime_t i_duration = 0;
+    for( ;; )
+    {
+        ts_cmd_t cmd;
+
+        /* The copy is not accounted, the input allocates its blocks anyway */
+        cmd.i_type = C_SEND;
+        cmd.i_date = 0;
+        cmd.u.send.p_es = NULL;
+        cmd.u.send.p_block = block_Duplicate( p_model );
+        assert( cmd.u.send.p_block != NULL );
+        if( TsStorageIsFull( p_storage, &cmd ) )
+        {
+            block_Release( cmd.u.send.p_block );
+            break;
+        }
+
+        mtime_t i_start = mdate();
+        TsStoragePushCmd( p_storage, &cmd );
+        i_duration += mdate() - i_start;
+        i_written += i_size;
+    }
+    block_Release( p_model );
+
+    mtime_t i_start = mdate();
+    TsStoragePack( p_storage );
+    i_duration += mdate() - i_start;
+    assert( !p_storage->b_error );
+    const double f_write = 8. * i_written / i_duration;
+
+    /* Reads */
+    int64_t i_read = 0;
+    uint64_t i_sum = 0;
+    i_start = mdate();
+    while( !TsStorageIsEmpty( p_storage ) )
+    {
+        ts_cmd_t cmd;
+
+        TsStoragePopCmd( p_storage, &cmd, false );
+        assert( cmd.i_type == C_SEND );
+        assert( cmd.u.send.p_block->i_buffer == i_size );
+        i_read += cmd.u.send.p_block->i_buffer;
+        i_sum += Touch( cmd.u.send.p_block );
+        CmdClean( &cmd );
+    }
+    i_duration = mdate() - i_start;
+    assert( i_read == i_written );
+    assert( (p_storage->p_map != NULL) == b_mmap );
+
+    printf( "%6zu %5s %6"PRId64" %10.1f %10.1f %8"PRIu64"\n", i_size,
+            b_mmap ? "mmap" : "stdio", i_read >> 20, f_write,
+            8. * i_read / i_duration, i_sum % 100000000 );
+    TsStorageDelete( p_storage );
+}
+
+int main( int argc, char *argv[] )
+{
+    char *psz_path = GetTmpPath( argc > 1 ? strdup( argv[1] ) : NULL );
+    assert( psz_path != NULL );
+
+    printf( "timeshift storage in %s, at most %"PRId64" MiB per file\n", psz_path,
+            STORAGE_MAX >> 20 );
+    printf( "%6s %5s %6s %10s %10s %8s\n", "block", "read", "MiB",
+            "write Mb/s", "read Mb/s", "checksum" );
+    for( unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ )
+    {
+#ifdef HAVE_MMAP
+        bench( psz_path, sizes[i], true );
+#endif
+        bench( psz_path, sizes[i], false );
+    }
+    free( psz_path );
+    return 0;
+}
@@ -735,6 +735,7 @@ struct vlc_timer
 {
 #ifndef UNDER_CE
     HANDLE handle;
+    ULONG flags;
 #else
     unsigned id;
     unsigned interval;
@@ -782,6 +783,7 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
     timer->data = data;
 #ifndef UNDER_CE
     timer->handle = INVALID_HANDLE_VALUE;
+    timer->flags = WT_EXECUTEDEFAULT;
 #else
     timer->id = 0;
     timer->interval = 0;
@@ -790,6 +792,17 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
     return 0;
 }
 
+int vlc_timer_create_blocking (vlc_timer_t *id, void (*func) (void *),
+                               void *data)
+{
+    int val = vlc_timer_create (id, func, data);
+#ifndef UNDER_CE
+    if (val == 0)
+        (*id)->flags = WT_EXECUTELONGFUNCTION;
+#endif
+    return val;
+}
+
 void vlc_timer_destroy (vlc_timer_t timer)
 {
 #ifndef UNDER_CE
@@ -830,7 +843,7 @@ void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
 
 #ifndef UNDER_CE
     if (!CreateTimerQueueTimer (&timer->handle, NULL, vlc_timer_do, timer,
-                                value, interval, WT_EXECUTEDEFAULT))
+                                value, interval, timer->flags))
 #else
     TIMECAPS caps;
     timeGetDevCaps (&caps, sizeof(caps));
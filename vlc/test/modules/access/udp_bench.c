@@ -0,0 +1,199 @@
+/*****************************************************************************
+ * udp_bench.c: UDP input and output loopback benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_sout.h>
+#include <vlc_stream.h>
+#include <vlc_atomic.h>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/* The udp sout access sends one TS datagram per block */
+#define PORT        18555
+#define DATAGRAM    (7 * 188)
+#define RATE        50000   /* datagrams per second */
+#define DURATION    5       /* seconds */
+#define TICK        1000    /* microseconds between bursts */
+
+typedef struct
+{
+    vlc_object_t *obj;
+    unsigned      rate;
+    unsigned      duration;
+    unsigned      sent;
+    vlc_atomic_t  done;
+} sender_t;
+
+static block_t *datagram (uint32_t seq)
+{
+    block_t *block = block_Alloc (DATAGRAM);
+    assert (block != NULL);
+
+    memset (block->p_buffer, 0x47, DATAGRAM);
+    SetDWLE (block->p_buffer + 4, seq);
+    block->i_dts = mdate ();
+    return block;
+}
+
+static void *Send (void *data)
+{
+    sender_t *sender = data;
+    sout_access_out_t *out;
+    char dst[32];
+
+    snprintf (dst, sizeof (dst), "127.0.0.1:%d", PORT);
+    out = sout_AccessOutNew (sender->obj, "udp", dst);
+    assert (out != NULL);
+
+    /* Bursts of one tick worth of datagrams, as a muxer would output */
+    const unsigned total = sender->rate * sender->duration;
+    const unsigned burst = sender->rate / (CLOCK_FREQ / TICK);
+    mtime_t deadline = mdate ();
+
+    while (sender->sent < total)
+    {
+        for (unsigned i = 0; i < burst && sender->sent < total; i++)
+            sout_AccessOutWrite (out, datagram (sender->sent++));
+        deadline += TICK;
+        mwait (deadline);
+    }
+
+    /* End of stream marker, until the receiver has seen it */
+    while (!vlc_atomic_get (&sender->done))
+    {
+        block_t *block = datagram (UINT32_MAX);
+        block->p_buffer[0] = 0xff;
+        sout_AccessOutWrite (out, block);
+        msleep (CLOCK_FREQ / 100);
+    }
+
+    sout_AccessOutDelete (out);
+    return NULL;
+}
+
+static double cpu_time (void)
+{
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+         + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static double thread_cpu_time (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench (vlc_object_t *parent, int batch, unsigned rate,
+                   unsigned duration)
+{
+    sender_t sender = {
+        .obj = parent, .rate = rate, .duration = duration, .sent = 0,
+    };
+    uint8_t buf[DATAGRAM];
+    unsigned received = 0, disordered = 0;
+    uint32_t expected = 0;
+    char url[32];
+    vlc_thread_t th;
+
+    vlc_atomic_set (&sender.done, 0);
+    var_SetInteger (parent, "udp-batch", batch);
+    var_SetInteger (parent, "sout-udp-batch", batch);
+
+    snprintf (url, sizeof (url), "udp://@127.0.0.1:%d", PORT);
+    stream_t *s = stream_UrlNew (parent, url);
+    assert (s != NULL);
+
+    double cpu = cpu_time (), rx_cpu = thread_cpu_time ();
+    mtime_t start = mdate ();
+
+    if (vlc_clone (&th, Send, &sender, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    while (stream_Read (s, buf, DATAGRAM) == DATAGRAM && buf[0] != 0xff)
+    {
+        uint32_t seq = GetDWLE (buf + 4);
+
+        if (seq != expected)
+            disordered++;
+        expected = seq + 1;
+        received++;
+    }
+    rx_cpu = thread_cpu_time () - rx_cpu;
+    vlc_atomic_set (&sender.done, 1);
+    vlc_join (th, NULL);
+
+    mtime_t elapsed = mdate () - start;
+    cpu = cpu_time () - cpu;
+    stream_Delete (s);
+
+    printf ("batch=%-4d %9.0f pkt/s sent %9.0f pkt/s received %6.2f%% lost "
+            "%5u gaps\n", batch, sender.sent * (double)CLOCK_FREQ / elapsed,
+            received * (double)CLOCK_FREQ / elapsed,
+            100. * (sender.sent - received) / sender.sent, disordered);
+    printf ("           %9.0f pkt/s per core overall, "
+            "%9.0f pkt/s per core receiving\n",
+            received / cpu, received / rx_cpu);
+}
+
+int main (int argc, char *argv[])
+{
+    static const int batches[] = { 1, 8, 32, 64 };
+    unsigned rate = (argc > 1) ? strtoul (argv[1], NULL, 10) : RATE;
+    unsigned duration = (argc > 2) ? strtoul (argv[2], NULL, 10) : DURATION;
+    libvlc_instance_t *vlc;
+
+    if (rate < CLOCK_FREQ / TICK || duration == 0)
+    {
+        fprintf (stderr, "Usage: %s [datagrams per second] [seconds]\n",
+                 argv[0]);
+        return 1;
+    }
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *parent = vlc_object_create (vlc->p_libvlc_int,
+                                              sizeof (vlc_object_t));
+    assert (parent != NULL);
+    vlc_object_attach (parent, vlc->p_libvlc_int);
+    var_Create (parent, "udp-batch", VLC_VAR_INTEGER);
+    var_Create (parent, "sout-udp-batch", VLC_VAR_INTEGER);
+    var_Create (parent, "sout-udp-caching", VLC_VAR_INTEGER);
+    var_SetInteger (parent, "sout-udp-caching", 0);
+
+    printf ("%u byte datagrams, %u per second, %u seconds\n", DATAGRAM, rate,
+            duration);
+    for (unsigned i = 0; i < sizeof (batches) / sizeof (batches[0]); i++)
+        bench (parent, batches[i], rate, duration);
+
+    vlc_object_release (parent);
+    libvlc_release (vlc);
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*****************************************************************************
+ * pcm.c: test for the PCM mixing and conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that the vector kernels available on this CPU give the same bits
+ * as the C versions, for all lengths up to MAX_SAMPLES and several
+ * alignments, including the samples around the converted ones. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include "../../../modules/audio_filter/converter/pcm_helper.h"
+
+#define MAX_SAMPLES 67
+#define ROUNDS      100
+#define SLACK       4
+
+typedef void (*mix_t)( float *, const float *, size_t, float );
+typedef void (*fl32tos16_t)( int16_t *, const float *, size_t );
+typedef void (*s16tofl32_t)( float *, const int16_t *, size_t );
+typedef void (*s32tofl32_t)( float *, const int32_t *, size_t );
+typedef void (*s24tofl32_t)( float *, const uint8_t *, size_t );
+typedef void (*swap_t)( uint8_t *, size_t );
+
+typedef union
+{
+    float    f[MAX_SAMPLES + SLACK];
+    int32_t  i[MAX_SAMPLES + SLACK];
+    int16_t  s[2 * (MAX_SAMPLES + SLACK)];
+    uint8_t  b[4 * (MAX_SAMPLES + SLACK)];
+} buffer_t;
+
+static buffer_t in, ref, out;
+
+static uint32_t rand32( void )
+{
+    return ((uint32_t)rand() << 20) ^ ((uint32_t)rand() << 10) ^ rand();
+}
+
+/* Floats around the saturation thresholds and other tricky values */
+static float rand_float( void )
+{
+    static const uint32_t specials[] = {
+        0x00000000, 0x80000000, 0x00000001, 0x807fffff, /* zeros, denormals */
+        0x3f800000, 0xbf800000, 0x3f7fffff, 0xbf800001, /* about +-1 */
+        0x7f800000, 0xff800000, 0x7fc00000, 0xffc00000, /* infinites, NaN */
+        0x43c00000, 0xc3c00000, 0xc3bfffff, 0xc3c00001, /* about +-384 */
+        0x7f7fffff, 0xff7fffff, 0x38000000, 0xb8000000, /* max, 2^-15 */
+    };
+    union { float f; uint32_t i; } u;
+
+    switch( rand() % 4 )
+    {
+        case 0:
+            u.i = specials[rand() % (sizeof(specials) / sizeof(specials[0]))];
+            break;
+        case 1:
+            u.i = rand32();
+            break;
+        default:
+            u.f = (rand32() / 2147483648.f - 1.f) * 1.1f;
+            break;
+    }
+    return u.f;
+}
+
+/* Same random input in all buffers */
+static void fill( bool b_float )
+{
+    for( size_t i = 0; i < MAX_SAMPLES + SLACK; i++ )
+    {
+        if( b_float )
+            in.f[i] = rand_float();
+        else
+            in.i[i] = rand32();
+    }
+    ref = out = in;
+}
+
+/* The payload of a NaN sum or product depends on the operand order the
+ * compiler picked, so there are no NaN inputs to the mixing kernels */
+static float rand_number( void )
+{
+    float f = rand_float();
+    return (f != f) ? 0.f : f; /* NaN */
+}
+
+static void check_mix( mix_t c, mix_t simd, size_t n, size_t align )
+{
+    const float f = rand_number();
+
+    for( size_t i = 0; i < MAX_SAMPLES + SLACK; i++ )
+    {
+        in.f[i] = rand_number();
+        ref.f[i] = out.f[i] = rand_number();
+    }
+    c( &ref.f[align], &in.f[align], n, f );
+    simd( &out.f[align], &in.f[align], n, f );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_fl32tos16( fl32tos16_t c, fl32tos16_t simd, size_t n,
+                             size_t align )
+{
+    fill( true );
+    c( (int16_t *)&ref.f[align], &ref.f[align], n );
+    simd( (int16_t *)&out.f[align], &out.f[align], n );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_s16tofl32( s16tofl32_t c, s16tofl32_t simd, size_t n,
+                             size_t align )
+{
+    fill( false );
+    c( &ref.f[align], &in.s[align], n );
+    simd( &out.f[align], &in.s[align], n );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_s32tofl32( s32tofl32_t c, s32tofl32_t simd, size_t n,
+                             size_t align )
+{
+    fill( false );
+    c( &ref.f[align], &ref.i[align], n );
+    simd( &out.f[align], &out.i[align], n );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_s24tofl32( s24tofl32_t c, s24tofl32_t simd, size_t n,
+                             size_t align )
+{
+    fill( false );
+    c( &ref.f[align], &in.b[align], n );
+    simd( &out.f[align], &in.b[align], n );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_swap( swap_t c, swap_t simd, size_t n, size_t align )
+{
+    fill( false );
+    c( &ref.b[align], n );
+    simd( &out.b[align], n );
+    assert( !memcmp( &ref, &out, sizeof(ref) ) );
+}
+
+static void check_all( size_t n, size_t align )
+{
+    /* The selected versions */
+    check_mix( pcm_ScaleFl32_C, pcm_ScaleFl32, n, align );
+    check_mix( pcm_MixFl32_C, pcm_MixFl32, n, align );
+    check_fl32tos16( pcm_Fl32toS16_C, pcm_Fl32toS16, n, align );
+    check_s16tofl32( pcm_S16toFl32_C, pcm_S16toFl32, n, align );
+    check_s32tofl32( pcm_S32toFl32_C, pcm_S32toFl32, n, align );
+    check_s24tofl32( pcm_S24toFl32_C, pcm_S24toFl32, n, align );
+    check_swap( pcm_Swap16_C, pcm_Swap16, 2 * n, align );
+    check_swap( pcm_Swap32_C, pcm_Swap32, n, align );
+
+    /* Then the others this CPU supports */
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU() & CPU_CAPABILITY_SSE )
+    {
+        check_mix( pcm_ScaleFl32_C, pcm_ScaleFl32_SSE, n, align );
+        check_mix( pcm_MixFl32_C, pcm_MixFl32_SSE, n, align );
+    }
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+    {
+        check_fl32tos16( pcm_Fl32toS16_C, pcm_Fl32toS16_SSE2, n, align );
+        check_s16tofl32( pcm_S16toFl32_C, pcm_S16toFl32_SSE2, n, align );
+        check_s32tofl32( pcm_S32toFl32_C, pcm_S32toFl32_SSE2, n, align );
+        check_swap( pcm_Swap16_C, pcm_Swap16_SSE2, 2 * n, align );
+        check_swap( pcm_Swap32_C, pcm_Swap32_SSE2, n, align );
+    }
+#endif
+#if defined(CAN_COMPILE_SSSE3) && !defined(WORDS_BIGENDIAN)
+    if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
+        check_s24tofl32( pcm_S24toFl32_C, pcm_S24toFl32_SSSE3, n, align );
+#endif
+}
+
+int main( void )
+{
+    libvlc_instance_t *p_vlc;
+
+    test_init();
+
+    /* Initializes the CPU capabilities */
+    p_vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( p_vlc != NULL );
+
+    log( "Testing PCM kernels (CPU flags 0x%x)\n", vlc_CPU() );
+    srand( 0 );
+    for( unsigned i = 0; i < ROUNDS; i++ )
+        for( size_t n = 0; n <= MAX_SAMPLES; n++ )
+            check_all( n, i % SLACK );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
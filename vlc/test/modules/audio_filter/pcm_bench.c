@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * pcm_bench.c: PCM mixing and conversion kernels benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_audio_filter_pcm [megasamples]
+ * Runs each kernel with each available path on buffers of 1024 samples
+ * (a typical audio output period, which stays in the cache), and prints
+ * the throughput in millions of samples per second. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include "../../../modules/audio_filter/converter/pcm_helper.h"
+
+#define MEGASAMPLES 256
+#define SAMPLES     1024
+
+typedef void (*mix_t)( float *, const float *, size_t, float );
+typedef void (*fl32tos16_t)( int16_t *, const float *, size_t );
+typedef void (*s16tofl32_t)( float *, const int16_t *, size_t );
+typedef void (*s32tofl32_t)( float *, const int32_t *, size_t );
+typedef void (*s24tofl32_t)( float *, const uint8_t *, size_t );
+typedef void (*swap_t)( uint8_t *, size_t );
+
+static union
+{
+    float    f[SAMPLES];
+    int32_t  i[SAMPLES];
+    int16_t  s[2 * SAMPLES];
+    uint8_t  b[4 * SAMPLES];
+} in, out;
+
+static unsigned rounds;
+
+static void fill_float( void )
+{
+    for( size_t i = 0; i < SAMPLES; i++ )
+        in.f[i] = out.f[i] = (rand() / (float)RAND_MAX - .5f) * 2.2f;
+}
+
+static void fill_int( void )
+{
+    for( size_t i = 0; i < SAMPLES; i++ )
+        in.i[i] = out.i[i] = rand() ^ (rand() << 16);
+}
+
+static void report( const char *kernel, const char *name, mtime_t duration )
+{
+    printf( "%-9s %-5s %8.1f Msamples/s\n", kernel, name,
+            (double)rounds * SAMPLES / duration );
+}
+
+static void bench_mix( const char *kernel, const char *name, mix_t f )
+{
+    fill_float();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.f, in.f, SAMPLES, .5f );
+    report( kernel, name, mdate() - start );
+}
+
+static void bench_fl32tos16( const char *name, fl32tos16_t f )
+{
+    fill_float();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.s, in.f, SAMPLES );
+    report( "fl32>s16", name, mdate() - start );
+}
+
+static void bench_s16tofl32( const char *name, s16tofl32_t f )
+{
+    fill_int();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.f, in.s, SAMPLES );
+    report( "s16>fl32", name, mdate() - start );
+}
+
+static void bench_s32tofl32( const char *name, s32tofl32_t f )
+{
+    fill_int();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.f, in.i, SAMPLES );
+    report( "s32>fl32", name, mdate() - start );
+}
+
+static void bench_s24tofl32( const char *name, s24tofl32_t f )
+{
+    fill_int();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.f, in.b, SAMPLES );
+    report( "s24>fl32", name, mdate() - start );
+}
+
+static void bench_swap( const char *kernel, const char *name, swap_t f,
+                        size_t n )
+{
+    fill_int();
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < rounds; i++ )
+        f( out.b, n );
+    report( kernel, name, mdate() - start );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned megasamples = (argc > 1) ? strtoul( argv[1], NULL, 10 )
+                                      : MEGASAMPLES;
+    libvlc_instance_t *vlc;
+
+    if( megasamples == 0 )
+    {
+        fprintf( stderr, "Usage: %s [megasamples]\n", argv[0] );
+        return 1;
+    }
+    rounds = (megasamples << 20) / SAMPLES;
+
+    /* Initializes the CPU capabilities */
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    bench_mix( "scale", "C", pcm_ScaleFl32_C );
+    bench_mix( "mix", "C", pcm_MixFl32_C );
+    bench_fl32tos16( "C", pcm_Fl32toS16_C );
+    bench_s16tofl32( "C", pcm_S16toFl32_C );
+    bench_s32tofl32( "C", pcm_S32toFl32_C );
+    bench_s24tofl32( "C", pcm_S24toFl32_C );
+    bench_swap( "swap16", "C", pcm_Swap16_C, 2 * SAMPLES );
+    bench_swap( "swap32", "C", pcm_Swap32_C, SAMPLES );
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU() & CPU_CAPABILITY_SSE )
+    {
+        bench_mix( "scale", "SSE", pcm_ScaleFl32_SSE );
+        bench_mix( "mix", "SSE", pcm_MixFl32_SSE );
+    }
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+    {
+        bench_fl32tos16( "SSE2", pcm_Fl32toS16_SSE2 );
+        bench_s16tofl32( "SSE2", pcm_S16toFl32_SSE2 );
+        bench_s32tofl32( "SSE2", pcm_S32toFl32_SSE2 );
+        bench_swap( "swap16", "SSE2", pcm_Swap16_SSE2, 2 * SAMPLES );
+        bench_swap( "swap32", "SSE2", pcm_Swap32_SSE2, SAMPLES );
+    }
+#endif
+#if defined(CAN_COMPILE_SSSE3) && !defined(WORDS_BIGENDIAN)
+    if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
+        bench_s24tofl32( "SSSE3", pcm_S24toFl32_SSSE3 );
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+    {
+        bench_mix( "scale", "NEON", pcm_ScaleFl32_NEON );
+        bench_mix( "mix", "NEON", pcm_MixFl32_NEON );
+        bench_fl32tos16( "NEON", pcm_Fl32toS16_NEON );
+        bench_s16tofl32( "NEON", pcm_S16toFl32_NEON );
+        bench_s32tofl32( "NEON", pcm_S32toFl32_NEON );
+        bench_s24tofl32( "NEON", pcm_S24toFl32_NEON );
+        bench_swap( "swap16", "NEON", pcm_Swap16_NEON, 2 * SAMPLES );
+        bench_swap( "swap32", "NEON", pcm_Swap32_NEON, SAMPLES );
+    }
+#endif
+
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * resampler_bench.c: audio resamplers speed and quality benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Resamples a stepped stereo sine sweep, in blocks of 1024 frames as the
+ * audio output does, with the bandlimited resampler and each quality of the
+ * polyphase one. For each ratio, prints the CPU time per second of one
+ * channel, and the worst signal to noise (and distortion) ratio over the
+ * tones, which are fitted to the output at their exact frequency. */
+
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#define BLOCK       1024
+#define CHANNELS    2
+#define TONE_LENGTH 2       /* seconds */
+
+static const double tones[] = { 50., 440., 1000., 4000., 10000., 16000. };
+
+static const struct
+{
+    unsigned i_in;
+    unsigned i_out;
+} ratios[] = {
+    { 44100, 48000 }, { 48000, 44100 }, { 44100, 96000 }, { 96000, 44100 },
+    { 44102, 48000 }, /* drift correction */
+};
+
+static block_t *NewBuffer( filter_t *p_filter, int i_size )
+{
+    (void) p_filter;
+    return block_Alloc( i_size );
+}
+
+static filter_t *CreateResampler( vlc_object_t *parent, const char *psz_name,
+                                  unsigned i_in, unsigned i_out )
+{
+    filter_t *p_filter = vlc_object_create( parent, sizeof(*p_filter) );
+    assert( p_filter != NULL );
+    vlc_object_attach( p_filter, parent );
+
+    audio_format_t *fmt = &p_filter->fmt_in.audio;
+    fmt->i_format = VLC_CODEC_FL32;
+    fmt->i_rate = i_in;
+    fmt->i_physical_channels = fmt->i_original_channels =
+        AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT;
+    aout_FormatPrepare( fmt );
+    p_filter->fmt_in.i_codec = VLC_CODEC_FL32;
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->fmt_out.audio.i_rate = i_out;
+    p_filter->pf_audio_buffer_new = NewBuffer;
+
+    p_filter->p_module = module_need( p_filter, "audio filter", psz_name,
+                                      true );
+    assert( p_filter->p_module != NULL );
+    return p_filter;
+}
+
+static void DeleteResampler( filter_t *p_filter )
+{
+    module_unneed( p_filter, p_filter->p_module );
+    vlc_object_release( p_filter );
+}
+
+/* Signal to noise ratio of one channel of the output, for a tone */
+static double ToneSNR( const float *p, size_t i_frames, double w )
+{
+    /* Least squares fit of a sin(w n) + b cos(w n) */
+    double ss = 0., sc = 0., cc = 0., ys = 0., yc = 0.;
+
+    for( size_t n = 0; n < i_frames; n++ )
+    {
+        const double s = sin( w * n ), c = cos( w * n ), y = p[n * CHANNELS];
+
+        ss += s * s; sc += s * c; cc += c * c;
+        ys += y * s; yc += y * c;
+    }
+
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det;
+    const double b = (yc * ss - ys * sc) / det;
+    double d_noise = 0.;
+
+    for( size_t n = 0; n < i_frames; n++ )
+    {
+        const double e = p[n * CHANNELS] - a * sin( w * n ) - b * cos( w * n );
+        d_noise += e * e;
+    }
+    return 10. * log10( (a * a + b * b) / 2. * i_frames / d_noise );
+}
+
+static void bench( vlc_object_t *parent, const char *psz_name,
+                   const char *psz_label, unsigned i_in, unsigned i_out )
+{
+    const size_t i_tone = TONE_LENGTH * i_in;
+    const size_t i_max = (size_t)TONE_LENGTH * i_out + 2 * BLOCK;
+    float *p_in = malloc( i_tone * CHANNELS * sizeof(float) );
+    float *p_out = malloc( i_max * CHANNELS * sizeof(float) );
+    double d_snr = HUGE_VAL;
+    mtime_t duration = 0;
+
+    assert( p_in != NULL && p_out != NULL );
+
+    for( unsigned t = 0; t < sizeof(tones) / sizeof(tones[0]); t++ )
+    {
+        const double w = 2. * M_PI * tones[t] / i_in;
+        size_t i_out_frames = 0;
+
+        for( size_t n = 0; n < i_tone; n++ )
+        {
+            p_in[n * CHANNELS] = .9 * sin( w * n );
+            p_in[n * CHANNELS + 1] = .9 * cos( w * n );
+        }
+
+        /* A new filter for each tone, as the fit needs a single one */
+        filter_t *p_filter = CreateResampler( parent, psz_name, i_in, i_out );
+
+        for( size_t i = 0; i < i_tone; i += BLOCK )
+        {
+            const size_t i_frames = __MIN( BLOCK, i_tone - i );
+            block_t *p_block = block_Alloc( i_frames * CHANNELS
+                                            * sizeof(float) );
+
+            assert( p_block != NULL );
+            memcpy( p_block->p_buffer, &p_in[i * CHANNELS],
+                    p_block->i_buffer );
+            p_block->i_nb_samples = i_frames;
+            p_block->i_pts = VLC_TS_0 + i * CLOCK_FREQ / i_in;
+
+            mtime_t start = mdate();
+            p_block = p_filter->pf_audio_filter( p_filter, p_block );
+            duration += mdate() - start;
+
+            if( p_block == NULL )
+                continue;
+            assert( i_out_frames + p_block->i_nb_samples <= i_max );
+            memcpy( &p_out[i_out_frames * CHANNELS], p_block->p_buffer,
+                    p_block->i_nb_samples * CHANNELS * sizeof(float) );
+            i_out_frames += p_block->i_nb_samples;
+            block_Release( p_block );
+        }
+        DeleteResampler( p_filter );
+
+        /* Leave out the start, with the filter delay */
+        const size_t i_skip = i_out_frames / 10;
+        const double w_out = 2. * M_PI * tones[t] / i_out;
+
+        for( unsigned c = 0; c < CHANNELS; c++ )
+        {
+            double d = ToneSNR( &p_out[i_skip * CHANNELS + c],
+                                i_out_frames - i_skip, w_out );
+            if( d < d_snr )
+                d_snr = d;
+        }
+    }
+
+    const double d_seconds = (double)TONE_LENGTH
+                           * (sizeof(tones) / sizeof(tones[0])) * CHANNELS;
+    printf( "%5u->%5u Hz %-12s %8.0f us/channel-second, SNR %5.1f dB\n",
+            i_in, i_out, psz_label, duration / d_seconds, d_snr );
+    free( p_out );
+    free( p_in );
+}
+
+int main( void )
+{
+    libvlc_instance_t *vlc;
+
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *parent = vlc_object_create( vlc->p_libvlc_int,
+                                              sizeof(*parent) );
+    assert( parent != NULL );
+    vlc_object_attach( parent, vlc->p_libvlc_int );
+    var_Create( parent, "polyphase-quality", VLC_VAR_INTEGER );
+
+    for( unsigned i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++ )
+    {
+        const unsigned i_in = ratios[i].i_in, i_out = ratios[i].i_out;
+
+        bench( parent, "bandlimited_resampler", "bandlimited", i_in, i_out );
+        for( int q = 0; q <= 2; q++ )
+        {
+            static const char *const labels[] = {
+                "polyphase/0", "polyphase/1", "polyphase/2" };
+
+            var_SetInteger( parent, "polyphase-quality", q );
+            bench( parent, "polyphase_resampler", labels[q], i_in, i_out );
+        }
+    }
+
+    vlc_object_release( parent );
+    libvlc_release( vlc );
+    return 0;
+}
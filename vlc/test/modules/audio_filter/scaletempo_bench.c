@@ -0,0 +1,136 @@
+/*****************************************************************************
+ * scaletempo_bench.c: scaletempo audio filter benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_audio_filter_scaletempo [search milliseconds]
+ * Feeds ten seconds of 48 kHz noisy tones, in blocks of 1024 frames, to
+ * scaletempo at several playback rates and channel counts, and prints the
+ * CPU time per second of input. */
+
+#include <math.h>
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+#define RATE        48000
+#define BLOCK       1024
+#define BLOCKS      (10 * RATE / BLOCK)
+
+static const double rates[] = { .75, 1.25, 1.5, 2. };
+static const uint32_t layouts[] = {
+    AOUT_CHAN_CENTER,
+    AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT,
+    AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT | AOUT_CHAN_CENTER | AOUT_CHAN_LFE
+        | AOUT_CHAN_REARLEFT | AOUT_CHAN_REARRIGHT,
+};
+
+static block_t *NewBuffer( filter_t *p_filter, int i_size )
+{
+    (void) p_filter;
+    return block_Alloc( i_size );
+}
+
+static void bench( vlc_object_t *parent, uint32_t i_layout, double f_rate )
+{
+    filter_t *p_filter = vlc_object_create( parent, sizeof(*p_filter) );
+    assert( p_filter != NULL );
+    vlc_object_attach( p_filter, parent );
+
+    audio_format_t *fmt = &p_filter->fmt_in.audio;
+    fmt->i_format = VLC_CODEC_FL32;
+    fmt->i_rate = RATE;
+    fmt->i_physical_channels = fmt->i_original_channels = i_layout;
+    aout_FormatPrepare( fmt );
+    p_filter->fmt_in.i_codec = VLC_CODEC_FL32;
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->pf_audio_buffer_new = NewBuffer;
+
+    p_filter->p_module = module_need( p_filter, "audio filter", "scaletempo",
+                                      true );
+    assert( p_filter->p_module != NULL );
+
+    /* The audio output changes the input rate to play faster or slower */
+    p_filter->fmt_in.audio.i_rate = RATE * f_rate;
+
+    const unsigned i_channels = fmt->i_channels;
+    const size_t i_size = BLOCK * i_channels * sizeof(float);
+    float *p_in = malloc( BLOCKS * i_size );
+    assert( p_in != NULL );
+    for( size_t i = 0; i < (size_t)BLOCKS * BLOCK * i_channels; i++ )
+        p_in[i] = .5 * sin( i * .003 ) + .1 * (rand() / (double)RAND_MAX - .5);
+
+    mtime_t duration = 0;
+    size_t i_out = 0;
+    for( unsigned i = 0; i < BLOCKS; i++ )
+    {
+        block_t *p_block = block_Alloc( i_size );
+
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, (uint8_t *)p_in + i * i_size, i_size );
+        p_block->i_nb_samples = BLOCK;
+
+        mtime_t start = mdate();
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        duration += mdate() - start;
+
+        if( p_block != NULL )
+        {
+            i_out += p_block->i_nb_samples;
+            block_Release( p_block );
+        }
+    }
+
+    printf( "%u channel(s) rate %4.2f %8.0f us/s %8zu frames out\n",
+            i_channels, f_rate, duration * (double)RATE / (BLOCKS * BLOCK),
+            i_out );
+
+    free( p_in );
+    module_unneed( p_filter, p_filter->p_module );
+    vlc_object_release( p_filter );
+}
+
+int main( int argc, char *argv[] )
+{
+    libvlc_instance_t *vlc;
+
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *parent = vlc_object_create( vlc->p_libvlc_int,
+                                              sizeof(*parent) );
+    assert( parent != NULL );
+    vlc_object_attach( parent, vlc->p_libvlc_int );
+    if( argc > 1 )
+    {
+        var_Create( parent, "scaletempo-search", VLC_VAR_INTEGER );
+        var_SetInteger( parent, "scaletempo-search", atoi( argv[1] ) );
+    }
+
+    for( unsigned i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++ )
+        for( unsigned j = 0; j < sizeof(rates) / sizeof(rates[0]); j++ )
+            bench( parent, layouts[i], rates[j] );
+
+    vlc_object_release( parent );
+    libvlc_release( vlc );
+    return 0;
+}
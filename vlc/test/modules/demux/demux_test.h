@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * demux_test.h: common code of the demuxer time seeking tests
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef DEMUX_TEST_H
+#define DEMUX_TEST_H
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+
+/* Number of random time seeks per stream */
+#define SEEKS       100
+/* The demuxers land at most 100ms before the target */
+#define PRECISION   100000
+
+/* ES output counting the PCR, with all the ES selected. The data blocks are
+ * passed to the test with the ES index: 0 for video, 1 for the others. */
+struct es_out_sys_t
+{
+    unsigned i_pcr;
+    void   (*pf_send) (es_out_sys_t *, unsigned i_es, const block_t *);
+    void    *p_data;            /* of the test */
+};
+
+static es_out_id_t *EsOutAdd (es_out_t *out, const es_format_t *fmt)
+{
+    (void) out;
+    return (es_out_id_t *)(intptr_t)(fmt->i_cat == VIDEO_ES ? 1 : 2);
+}
+
+static int EsOutSend (es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    es_out_sys_t *sys = out->p_sys;
+
+    if (sys->pf_send != NULL)
+        sys->pf_send (sys, (intptr_t)id - 1, block);
+    block_ChainRelease (block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel (es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl (es_out_t *out, int query, va_list args)
+{
+    switch (query)
+    {
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+            out->p_sys->i_pcr++;
+            break;
+        case ES_OUT_GET_ES_STATE:
+            va_arg (args, es_out_id_t *);
+            *va_arg (args, bool *) = true;
+            break;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Control (demux_t *demux, int query, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start (args, query);
+    ret = demux->pf_control (demux, query, args);
+    va_end (args);
+    return ret;
+}
+
+/* Opens the named demuxer on the given data, with the test ES output */
+static demux_t *DemuxNew (vlc_object_t *parent, const char *psz_demux,
+                          es_out_t *out, es_out_sys_t *sys,
+                          uint8_t *p_data, size_t i_size)
+{
+    out->pf_add = EsOutAdd;
+    out->pf_send = EsOutSend;
+    out->pf_del = EsOutDel;
+    out->pf_control = EsOutControl;
+    out->p_sys = sys;
+
+    demux_t *demux = vlc_object_create (parent, sizeof (*demux));
+    assert (demux != NULL);
+    vlc_object_attach (demux, parent);
+    demux->psz_access = (char *)"";
+    demux->psz_demux = (char *)psz_demux;
+    demux->psz_location = demux->psz_file = (char *)"";
+    demux->out = out;
+    demux->s = stream_MemoryNew (demux, p_data, i_size, true);
+    assert (demux->s != NULL);
+    demux->p_module = module_need (demux, "demux", psz_demux, true);
+    assert (demux->p_module != NULL);
+    return demux;
+}
+
+static void DemuxDelete (demux_t *demux)
+{
+    module_unneed (demux, demux->p_module);
+    stream_Delete (demux->s);
+    vlc_object_release (demux);
+}
+
+/* Returns a random seek target within the length */
+static int64_t RandomTime (int64_t i_length)
+{
+    return (int64_t)(i_length * (rand () / (double)RAND_MAX));
+}
+
+/* Runs the test on each stream of a corpus, within a libvlc instance */
+static void DemuxTestRun (void (*test) (vlc_object_t *, unsigned),
+                          unsigned i_streams)
+{
+    libvlc_instance_t *vlc;
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *parent = vlc_object_create (vlc->p_libvlc_int,
+                                              sizeof (*parent));
+    assert (parent != NULL);
+    vlc_object_attach (parent, vlc->p_libvlc_int);
+
+    for (unsigned i = 0; i < i_streams; i++)
+        test (parent, i);
+
+    vlc_object_release (parent);
+    libvlc_release (vlc);
+}
+
+#endif
@@ -0,0 +1,396 @@
+/*****************************************************************************
+ * ogg.c: test for the Ogg demuxer time seeking
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "demux_test.h"
+
+/* Synthetic corpus of Vorbis and/or Theora physical streams */
+#define SECONDS     (60 * 5)
+#define FPS         25
+#define RATE        44100
+#define SAMPLES     1024        /* per Vorbis packet */
+#define PAGE_SIZE   4096
+#define VIDEO_SERIAL 0x1234
+#define AUDIO_SERIAL 0x5678
+
+static const struct
+{
+    bool     b_video;
+    bool     b_audio;
+    unsigned i_shift;           /* Theora key frame granule shift */
+} corpus[] = {
+    { false, true, 0 },
+    { true, false, 5 },
+    { true, true, 6 },
+};
+
+typedef struct
+{
+    uint8_t *p_data;
+    size_t   i_size;
+    size_t   i_max;
+    int64_t  audio_pages[SECONDS * RATE / SAMPLES + 1]; /* end granules */
+    unsigned i_audio_pages;
+} ogg_gen_t;
+
+typedef struct
+{
+    uint32_t i_serial;
+    uint32_t i_seqno;
+    uint8_t  flags;             /* of the next page */
+    int64_t  i_granule;         /* of the last packet ending on the page */
+    unsigned i_segments;
+    uint8_t  lacing[255];
+    size_t   i_body;
+    uint8_t  body[255 * 255];
+} ogg_gen_stream_t;
+
+static uint32_t crc32_ogg (const uint8_t *p, size_t len, uint32_t crc)
+{
+    while (len--)
+    {
+        crc ^= (uint32_t)*(p++) << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+static void gen_page (ogg_gen_t *gen, ogg_gen_stream_t *st, bool eos)
+{
+    const size_t len = 27 + st->i_segments + st->i_body;
+
+    if (gen->i_size + len > gen->i_max)
+    {
+        gen->i_max = gen->i_max ? 2 * gen->i_max : 1 << 20;
+        gen->p_data = realloc (gen->p_data, gen->i_max);
+        assert (gen->p_data != NULL);
+    }
+    uint8_t *p = gen->p_data + gen->i_size;
+    gen->i_size += len;
+
+    memcpy (p, "OggS", 5);
+    p[5] = st->flags | (eos ? 0x04 : 0);
+    SetQWLE (p + 6, st->i_granule);
+    SetDWLE (p + 14, st->i_serial);
+    SetDWLE (p + 18, st->i_seqno++);
+    SetDWLE (p + 22, 0);
+    p[26] = st->i_segments;
+    memcpy (p + 27, st->lacing, st->i_segments);
+    memcpy (p + 27 + st->i_segments, st->body, st->i_body);
+    SetDWLE (p + 22, crc32_ogg (p, len, 0));
+
+    if (st->i_serial == AUDIO_SERIAL && st->i_granule > 0)
+        gen->audio_pages[gen->i_audio_pages++] = st->i_granule;
+    st->flags = 0;
+    st->i_granule = -1;
+    st->i_segments = 0;
+    st->i_body = 0;
+}
+
+/* Appends a packet, which may span several pages */
+static void gen_packet (ogg_gen_t *gen, ogg_gen_stream_t *st,
+                        const uint8_t *p_packet, size_t len, int64_t granule)
+{
+    for (;;)
+    {
+        size_t seg = (len < 255) ? len : 255;
+
+        if (st->i_segments == 255 || st->i_body >= PAGE_SIZE)
+        {
+            gen_page (gen, st, false);
+            st->flags = 0x01; /* continued packet */
+        }
+        st->lacing[st->i_segments++] = seg;
+        memcpy (st->body + st->i_body, p_packet, seg);
+        st->i_body += seg;
+        p_packet += seg;
+        len -= seg;
+        if (seg < 255)
+            break;
+    }
+    st->i_granule = granule;
+    if (st->i_body >= PAGE_SIZE)
+        gen_page (gen, st, false);
+}
+
+static void gen_headers (ogg_gen_t *gen, ogg_gen_stream_t *video,
+                         ogg_gen_stream_t *audio, unsigned shift)
+{
+    uint8_t packet[64];
+
+    if (video != NULL)
+    {
+        memset (packet, 0, sizeof (packet));
+        memcpy (packet, "\x80theora\x03\x02\x01", 10);
+        SetWBE (packet + 10, 320 / 16);
+        SetWBE (packet + 12, 240 / 16);
+        SetDWBE (packet + 14, 320 << 8);
+        SetDWBE (packet + 17, 240 << 8);
+        SetDWBE (packet + 22, FPS);
+        SetDWBE (packet + 26, 1);
+        packet[40] = shift >> 3;
+        packet[41] = shift << 5;
+        video->flags = 0x02;
+        gen_packet (gen, video, packet, 42, 0);
+        gen_page (gen, video, false);
+    }
+    if (audio != NULL)
+    {
+        memset (packet, 0, sizeof (packet));
+        memcpy (packet, "\x01vorbis", 7);
+        packet[11] = 2;
+        SetDWLE (packet + 12, RATE);
+        SetDWLE (packet + 20, 128000);
+        packet[28] = 0xb8;
+        packet[29] = 1;
+        audio->flags = 0x02;
+        gen_packet (gen, audio, packet, 30, 0);
+        gen_page (gen, audio, false);
+    }
+
+    /* Comment and setup headers */
+    if (video != NULL)
+    {
+        memset (packet, 0, sizeof (packet));
+        memcpy (packet, "\x81theora", 7);
+        gen_packet (gen, video, packet, 15, 0);
+        memcpy (packet, "\x82theora", 7);
+        gen_packet (gen, video, packet, 32, 0);
+        gen_page (gen, video, false);
+    }
+    if (audio != NULL)
+    {
+        memset (packet, 0, sizeof (packet));
+        memcpy (packet, "\x03vorbis", 7);
+        packet[15] = 1;
+        gen_packet (gen, audio, packet, 16, 0);
+        memcpy (packet, "\x05vorbis", 7);
+        gen_packet (gen, audio, packet, 32, 0);
+        gen_page (gen, audio, false);
+    }
+}
+
+/* Data packets start with their index, big endian, after a type byte:
+ * key frames are up to 10 times as large as the other frames. */
+static void gen_data (ogg_gen_t *gen, ogg_gen_stream_t *st, unsigned index,
+                      size_t len, int64_t granule)
+{
+    uint8_t packet[16384];
+
+    assert (len >= 5 && len <= sizeof (packet));
+    packet[0] = 0;
+    SetDWBE (packet + 1, index);
+    for (size_t i = 5; i < len; i++)
+        packet[i] = rand ();
+    gen_packet (gen, st, packet, len, granule);
+}
+
+static void gen_stream (ogg_gen_t *gen, bool b_video, bool b_audio,
+                        unsigned shift)
+{
+    ogg_gen_stream_t video = { .i_serial = VIDEO_SERIAL, .i_granule = -1 };
+    ogg_gen_stream_t audio = { .i_serial = AUDIO_SERIAL, .i_granule = -1 };
+    const unsigned keyint = 1 << shift;
+    unsigned a = 0;
+
+    srand (1);
+    gen_headers (gen, b_video ? &video : NULL, b_audio ? &audio : NULL,
+                 shift);
+
+    for (unsigned f = 0; f < SECONDS * FPS; f++)
+    {
+        /* The audio packets starting before the end of the frame */
+        while (b_audio
+            && (uint64_t)a * SAMPLES * FPS < (uint64_t)(f + 1) * RATE)
+        {
+            gen_data (gen, &audio, a, 150 + rand () % 300,
+                      (int64_t)(a + 1) * SAMPLES);
+            a++;
+        }
+        if (b_video)
+        {
+            const unsigned k = f - f % keyint;
+
+            gen_data (gen, &video, f,
+                      (f == k) ? 6000 + rand () % 4000 : 100 + rand () % 1400,
+                      ((int64_t)k << shift) | (f - k));
+        }
+    }
+
+    if (b_video)
+        gen_page (gen, &video, true);
+    if (b_audio)
+        gen_page (gen, &audio, true);
+}
+
+/* First data packets sent after a seek */
+typedef struct
+{
+    int   i_first[2];           /* index of the first packet, or -1 */
+    int   i_first_key;          /* index of the first key frame, or -1 */
+    unsigned i_keyint;
+} ogg_first_t;
+
+static void Send (es_out_sys_t *sys, unsigned i_es, const block_t *block)
+{
+    ogg_first_t *first = sys->p_data;
+
+    /* Header packets are sent again when seeking to the start */
+    if (block->i_buffer >= 5 && block->p_buffer[0] == 0)
+    {
+        int index = GetDWBE (block->p_buffer + 1);
+
+        if (first->i_first[i_es] < 0)
+            first->i_first[i_es] = index;
+        if (i_es == 0 && first->i_first_key < 0
+         && (index % first->i_keyint) == 0)
+            first->i_first_key = index;
+    }
+}
+
+/* Demuxes until the first packet of each ES, and a key frame, are seen */
+static void DemuxFirst (demux_t *demux, ogg_first_t *first, bool b_video,
+                        bool b_audio)
+{
+    int ret;
+
+    first->i_first[0] = first->i_first[1] = first->i_first_key = -1;
+    while ((b_video && first->i_first_key < 0)
+        || (b_audio && first->i_first[1] < 0))
+    {
+        ret = demux->pf_demux (demux);
+        assert (ret > 0);
+    }
+}
+
+static void test (vlc_object_t *parent, unsigned n)
+{
+    const bool b_video = corpus[n].b_video;
+    const bool b_audio = corpus[n].b_audio;
+    const unsigned shift = corpus[n].i_shift;
+    ogg_gen_t gen = { NULL, 0, 0 };
+    ogg_first_t first = { .i_keyint = 1 << shift };
+    es_out_sys_t sys = { .pf_send = Send, .p_data = &first };
+    es_out_t out;
+    int64_t i_length, i_time, targets[SEEKS];
+    int ret;
+
+    gen_stream (&gen, b_video, b_audio, shift);
+    printf ("%s%s%s, %zu bytes\n", b_video ? "Theora" : "",
+            (b_video && b_audio) ? "+" : "", b_audio ? "Vorbis" : "",
+            gen.i_size);
+
+    if (b_video)
+        i_length = (SECONDS * FPS - 1) * INT64_C(1000000) / FPS;
+    else
+        i_length = (int64_t)((((uint64_t)SECONDS * RATE + SAMPLES - 1)
+                              / SAMPLES) * SAMPLES * INT64_C(1000000)
+                             / (double)RATE);
+
+    demux_t *demux = DemuxNew (parent, "ogg", &out, &sys,
+                               gen.p_data, gen.i_size);
+
+    /* Headers, then the first data packets */
+    DemuxFirst (demux, &first, b_video, b_audio);
+    assert (first.i_first[0] <= 0 && first.i_first[1] <= 0);
+
+    ret = Control (demux, DEMUX_GET_LENGTH, &i_time);
+    assert (ret == VLC_SUCCESS);
+    printf (" length %"PRId64" us\n", i_time);
+    assert (i_time == i_length);
+
+    /* Time seeking, then the same targets again from the index */
+    for (unsigned i = 0; i < SEEKS; i++)
+        targets[i] = RandomTime (i_length);
+
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        mtime_t duration = 0;
+
+        for (unsigned i = 0; i < SEEKS; i++)
+        {
+            const int64_t i_target = targets[i];
+            mtime_t start = mdate ();
+
+            ret = Control (demux, DEMUX_SET_TIME, i_target, true);
+            duration += mdate () - start;
+            assert (ret == VLC_SUCCESS);
+            DemuxFirst (demux, &first, b_video, b_audio);
+
+            if (b_video)
+            {
+                /* Decoding starts at most one key frame early */
+                const int f = i_target * FPS / CLOCK_FREQ;
+                const int k = f - f % first.i_keyint;
+
+                if (first.i_first[0] > first.i_first_key
+                 || first.i_first_key > k
+                 || first.i_first_key < k - (int)first.i_keyint)
+                {
+                    fprintf (stderr, "seek to frame %d started at frame %d "
+                             "key frame %d\n", f, first.i_first[0],
+                             first.i_first_key);
+                    abort ();
+                }
+            }
+            else
+            {
+                /* Decoding starts at most PRECISION early, unless no page
+                 * ends between there and the target */
+                int64_t i_page = 0;
+
+                for (unsigned p = 0; p < gen.i_audio_pages; p++)
+                {
+                    int64_t i_end = (int64_t)(gen.audio_pages[p]
+                                            * INT64_C(1000000) / (double)RATE);
+                    if (i_end > i_target)
+                        break;
+                    i_page = i_end;
+                }
+                i_time = (int64_t)(first.i_first[1] * SAMPLES
+                                   * INT64_C(1000000) / (double)RATE);
+                if (i_time > i_target
+                 || i_time < __MIN (i_target - PRECISION, i_page))
+                {
+                    fprintf (stderr, "seek to %"PRId64" started at "
+                             "%"PRId64"\n", i_target, i_time);
+                    abort ();
+                }
+            }
+        }
+        printf (" %s seeks: %"PRId64" us per seek\n",
+                pass ? "repeated" : "first", duration / SEEKS);
+    }
+
+    /* Back to the start */
+    ret = Control (demux, DEMUX_SET_TIME, INT64_C(0), true);
+    assert (ret == VLC_SUCCESS);
+    DemuxFirst (demux, &first, b_video, b_audio);
+    assert (first.i_first[0] <= 0 && first.i_first[1] <= 0);
+
+    DemuxDelete (demux);
+    free (gen.p_data);
+}
+
+int main (void)
+{
+    DemuxTestRun (test, sizeof (corpus) / sizeof (corpus[0]));
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*****************************************************************************
+ * ts.c: test for the MPEG-TS demuxer time seeking
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "demux_test.h"
+
+/* Synthetic single program streams of 25 frames per second */
+#define FRAMES      (25 * 60 * 5)
+#define FRAME_TICKS 3600    /* 90kHz */
+#define PCR_MASK    ((INT64_C(1) << 33) - 1)
+#define VIDEO_PID   0x200
+#define AUDIO_PID   0x201
+#define PMT_PID     0x100
+
+typedef struct
+{
+    uint8_t *p_data;
+    size_t   i_size;
+    size_t   i_max;
+    uint8_t  cc[8192];
+} ts_gen_t;
+
+static uint8_t *gen_packet (ts_gen_t *gen, unsigned pid)
+{
+    if (gen->i_size + 188 > gen->i_max)
+    {
+        gen->i_max = gen->i_max ? 2 * gen->i_max : 1 << 20;
+        gen->p_data = realloc (gen->p_data, gen->i_max);
+        assert (gen->p_data != NULL);
+    }
+    uint8_t *p = gen->p_data + gen->i_size;
+    gen->i_size += 188;
+
+    p[0] = 0x47;
+    p[1] = pid >> 8;
+    p[2] = pid;
+    p[3] = 0x10 | (gen->cc[pid]++ & 0xf);
+    memset (p + 4, 0xff, 184);
+    return p;
+}
+
+static uint32_t crc32_mpeg (const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (len--)
+    {
+        crc ^= (uint32_t)*(p++) << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+static void gen_section (ts_gen_t *gen, unsigned pid, uint8_t *sec,
+                         size_t len)
+{
+    uint8_t *p = gen_packet (gen, pid);
+
+    SetWBE (sec + 1, 0xb000 | (len - 3 + 4));
+    SetDWBE (sec + len, crc32_mpeg (sec, len));
+    p[1] |= 0x40;
+    p[4] = 0; /* pointer field */
+    memcpy (p + 5, sec, len + 4);
+}
+
+static void gen_psi (ts_gen_t *gen)
+{
+    uint8_t sec[32];
+
+    /* PAT */
+    memcpy (sec, "\x00\xb0\x00\x00\x01\xc1\x00\x00", 8);
+    SetWBE (sec + 8, 1);
+    SetWBE (sec + 10, 0xe000 | PMT_PID);
+    gen_section (gen, 0, sec, 12);
+
+    /* PMT: MPEG-2 video with the PCR, MPEG audio */
+    memcpy (sec, "\x02\xb0\x00\x00\x01\xc1\x00\x00", 8);
+    SetWBE (sec + 8, 0xe000 | VIDEO_PID);
+    SetWBE (sec + 10, 0xf000);
+    sec[12] = 0x02;
+    SetWBE (sec + 13, 0xe000 | VIDEO_PID);
+    SetWBE (sec + 15, 0xf000);
+    sec[17] = 0x03;
+    SetWBE (sec + 18, 0xe000 | AUDIO_PID);
+    SetWBE (sec + 20, 0xf000);
+    gen_section (gen, PMT_PID, sec, 22);
+}
+
+/* Writes one frame worth of packets, the first one with the PCR */
+static void gen_frame (ts_gen_t *gen, int64_t pcr, unsigned packets)
+{
+    for (unsigned i = 0; i < packets; i++)
+    {
+        uint8_t *p = gen_packet (gen, VIDEO_PID);
+
+        if (i == 0)
+        {
+            p[1] |= 0x40;
+            p[3] |= 0x20;
+            p[4] = 7;
+            p[5] = 0x10;
+            SetDWBE (p + 6, pcr >> 1);
+            p[10] = (pcr << 7) | 0x7e;
+            p[11] = 0;
+            /* Video PES header, without timestamps */
+            memcpy (p + 12, "\x00\x00\x01\xe0\x00\x00\x80\x00\x00", 9);
+        }
+        if ((i % 8) == 7)
+            gen_packet (gen, AUDIO_PID);
+    }
+}
+
+/* Constant bit rate, or variable with large frames every 12 frames.
+ * The PCR start at the given value and may wrap around. */
+static void gen_stream (ts_gen_t *gen, bool vbr, int64_t pcr)
+{
+    srand (1);
+    for (unsigned f = 0; f < FRAMES; f++)
+    {
+        unsigned packets = 40;
+
+        if (vbr)
+            packets = (f % 12) ? 10 + rand () % 60 : 300;
+        if ((f % 12) == 0)
+            gen_psi (gen);
+        gen_frame (gen, (pcr + f * FRAME_TICKS) & PCR_MASK, packets);
+    }
+}
+
+/* Demuxes until the next PCR, and returns the demuxer time there */
+static int64_t NextPCR (demux_t *demux, es_out_sys_t *sys)
+{
+    unsigned i_pcr = sys->i_pcr;
+    int64_t i_time;
+    int ret;
+
+    while (sys->i_pcr == i_pcr)
+    {
+        ret = demux->pf_demux (demux);
+        assert (ret > 0);
+    }
+    ret = Control (demux, DEMUX_GET_TIME, &i_time);
+    assert (ret == VLC_SUCCESS);
+    return i_time;
+}
+
+static const struct
+{
+    bool    vbr;
+    int64_t pcr;                /* first PCR */
+} corpus[] = {
+    { false, 900000 },
+    { true, 900000 },
+    /* The PCR wrap around two minutes into the stream */
+    { false, PCR_MASK - 120 * 90000 },
+    { true, PCR_MASK - 120 * 90000 },
+};
+
+static void test (vlc_object_t *parent, unsigned n)
+{
+    const bool vbr = corpus[n].vbr;
+    const int64_t pcr = corpus[n].pcr;
+    ts_gen_t gen;
+    es_out_sys_t sys = { .i_pcr = 0 };
+    es_out_t out;
+    const int64_t i_length = (FRAMES - 1) * INT64_C(40000);
+    int64_t i_time;
+    int ret;
+
+    memset (&gen, 0, sizeof (gen));
+    gen_stream (&gen, vbr, pcr);
+    printf ("%s TS, first PCR %"PRId64", %zu bytes\n", vbr ? "VBR" : "CBR",
+            pcr, gen.i_size);
+
+    demux_t *demux = DemuxNew (parent, "ts", &out, &sys,
+                               gen.p_data, gen.i_size);
+
+    /* The length is known once the PCR PID is */
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        ret = demux->pf_demux (demux);
+        assert (ret > 0);
+        ret = Control (demux, DEMUX_GET_LENGTH, &i_time);
+        assert (ret == VLC_SUCCESS);
+        if (i_time != 0)
+            break;
+    }
+    printf (" length %"PRId64" us\n", i_time);
+    assert (i_time == i_length);
+
+    /* Playback time */
+    int64_t i_prev = NextPCR (demux, &sys);
+    for (unsigned i = 0; i < 100; i++)
+    {
+        int64_t i_next = NextPCR (demux, &sys);
+        assert (i_next == i_prev + 40000);
+        i_prev = i_next;
+    }
+
+    /* Time seeking */
+    for (unsigned i = 0; i < SEEKS; i++)
+    {
+        int64_t i_target = RandomTime (i_length);
+
+        ret = Control (demux, DEMUX_SET_TIME, i_target, true);
+        assert (ret == VLC_SUCCESS);
+        i_time = NextPCR (demux, &sys);
+        if (i_time > i_target || i_time < i_target - PRECISION)
+        {
+            fprintf (stderr, "seek to %"PRId64" landed at %"PRId64"\n",
+                     i_target, i_time);
+            abort ();
+        }
+    }
+
+    /* Back to the start */
+    ret = Control (demux, DEMUX_SET_TIME, INT64_C(0), true);
+    assert (ret == VLC_SUCCESS);
+    i_time = NextPCR (demux, &sys);
+    assert (i_time == 0);
+
+    DemuxDelete (demux);
+    free (gen.p_data);
+}
+
+int main (void)
+{
+    DemuxTestRun (test, sizeof (corpus) / sizeof (corpus[0]));
+    return 0;
+}
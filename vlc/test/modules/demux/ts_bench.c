@@ -0,0 +1,325 @@
+/*****************************************************************************
+ * ts_bench.c: MPEG-TS demuxer throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_demux_ts
+ * Demuxes a synthetic multi-program transport stream from memory with
+ * several ts-bulk-packets values, and prints the throughput of each. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+
+/* Synthetic multi-program transport stream */
+#define PROGRAMS    8
+#define FRAMES      250     /* per program */
+#define VIDEO_PES   (24 * 1024)
+#define AUDIO_PES   576
+
+typedef struct
+{
+    uint8_t *p_data;
+    size_t   i_size;
+    size_t   i_max;
+    uint8_t  cc[8192];
+} ts_gen_t;
+
+static uint8_t *gen_packet (ts_gen_t *gen)
+{
+    if (gen->i_size + 188 > gen->i_max)
+    {
+        gen->i_max = gen->i_max ? 2 * gen->i_max : 1 << 20;
+        gen->p_data = realloc (gen->p_data, gen->i_max);
+        assert (gen->p_data != NULL);
+    }
+    uint8_t *p = gen->p_data + gen->i_size;
+    gen->i_size += 188;
+    return p;
+}
+
+static void gen_section (ts_gen_t *gen, unsigned pid, const uint8_t *sec,
+                         size_t len)
+{
+    uint8_t *p = gen_packet (gen);
+
+    p[0] = 0x47;
+    p[1] = 0x40 | (pid >> 8);
+    p[2] = pid;
+    p[3] = 0x10 | (gen->cc[pid]++ & 0xf);
+    p[4] = 0; /* pointer field */
+    memcpy (p + 5, sec, len);
+    memset (p + 5 + len, 0xff, 183 - len);
+}
+
+static uint32_t crc32_mpeg (const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (len--)
+    {
+        crc ^= (uint32_t)*(p++) << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+static void gen_psi (ts_gen_t *gen)
+{
+    uint8_t sec[183];
+    size_t len = 8;
+
+    /* PAT */
+    memcpy (sec, "\x00\xb0\x00\x00\x01\xc1\x00\x00", 8);
+    for (unsigned i = 0; i < PROGRAMS; i++)
+    {
+        SetWBE (sec + len, i + 1);
+        SetWBE (sec + len + 2, 0xe000 | (0x100 + i));
+        len += 4;
+    }
+    SetWBE (sec + 1, 0xb000 | (len - 3 + 4));
+    SetDWBE (sec + len, crc32_mpeg (sec, len));
+    gen_section (gen, 0, sec, len + 4);
+
+    /* PMTs: one MPEG-2 video ES with the PCR, one MPEG audio ES */
+    for (unsigned i = 0; i < PROGRAMS; i++)
+    {
+        unsigned vpid = 0x200 + 2 * i, apid = vpid + 1;
+
+        len = 0;
+        sec[len++] = 0x02;
+        len += 2;
+        SetWBE (sec + len, i + 1); len += 2;
+        sec[len++] = 0xc1;
+        sec[len++] = 0;
+        sec[len++] = 0;
+        SetWBE (sec + len, 0xe000 | vpid); len += 2;
+        SetWBE (sec + len, 0xf000); len += 2;
+        sec[len++] = 0x02;
+        SetWBE (sec + len, 0xe000 | vpid); len += 2;
+        SetWBE (sec + len, 0xf000); len += 2;
+        sec[len++] = 0x03;
+        SetWBE (sec + len, 0xe000 | apid); len += 2;
+        SetWBE (sec + len, 0xf000); len += 2;
+        SetWBE (sec + 1, 0xb000 | (len - 3 + 4));
+        SetDWBE (sec + len, crc32_mpeg (sec, len));
+        gen_section (gen, 0x100 + i, sec, len + 4);
+    }
+}
+
+static void gen_pes (ts_gen_t *gen, unsigned pid, uint8_t stream_id,
+                     size_t size, int64_t pts, bool pcr)
+{
+    uint8_t hdr[14];
+    size_t left = size;
+    bool first = true;
+
+    hdr[0] = hdr[1] = 0; hdr[2] = 1; hdr[3] = stream_id;
+    SetWBE (hdr + 4, (stream_id == 0xe0) ? 0 : size + 8);
+    hdr[6] = 0x80; hdr[7] = 0x80; hdr[8] = 5;
+    hdr[9] = 0x21 | ((pts >> 29) & 0x0e);
+    SetWBE (hdr + 10, ((pts >> 14) & 0xfffe) | 1);
+    SetWBE (hdr + 12, ((pts << 1) & 0xfffe) | 1);
+
+    while (left > 0 || first)
+    {
+        uint8_t *p = gen_packet (gen);
+        size_t avail = 184, head = 0, af = 0;
+
+        p[0] = 0x47;
+        p[1] = (first ? 0x40 : 0) | (pid >> 8);
+        p[2] = pid;
+        p[3] = 0x10 | (gen->cc[pid]++ & 0xf);
+
+        if (first && pcr)
+            af = 8;
+        if (first)
+            head = sizeof (hdr);
+        /* Stuff the last packet through the adaptation field */
+        if (left + head + af < avail)
+            af = avail - left - head;
+
+        size_t off = 4;
+        if (af > 0)
+        {
+            p[3] |= 0x20;
+            p[4] = af - 1;
+            if (af > 1)
+            {
+                p[5] = (first && pcr && af >= 8) ? 0x10 : 0;
+                memset (p + 6, 0xff, af - 2);
+                if (p[5])
+                {
+                    int64_t base = pts - 9000;
+                    SetDWBE (p + 6, base >> 1);
+                    p[10] = (base << 7) | 0x7e;
+                    p[11] = 0;
+                }
+            }
+            off += af;
+        }
+        if (head)
+        {
+            memcpy (p + off, hdr, head);
+            off += head;
+        }
+        memset (p + off, stream_id, 188 - off);
+        left -= 188 - off;
+        first = false;
+    }
+}
+
+static void gen_stream (ts_gen_t *gen)
+{
+    for (unsigned f = 0; f < FRAMES; f++)
+    {
+        int64_t pts = 90000 + f * 3600;
+
+        if ((f % 10) == 0)
+            gen_psi (gen);
+        for (unsigned i = 0; i < PROGRAMS; i++)
+        {
+            unsigned vpid = 0x200 + 2 * i;
+
+            gen_pes (gen, vpid, 0xe0, VIDEO_PES, pts, true);
+            gen_pes (gen, vpid + 1, 0xc0, AUDIO_PES, pts, false);
+            gen_pes (gen, vpid + 1, 0xc0, AUDIO_PES, pts + 2160, false);
+        }
+    }
+}
+
+/* Counting ES output */
+struct es_out_sys_t
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_pes;
+    uint64_t    i_bytes;
+};
+
+static es_out_id_t *EsOutAdd (es_out_t *out, const es_format_t *fmt)
+{
+    (void) out; (void) fmt;
+    return (es_out_id_t *)out;
+}
+
+static int EsOutSend (es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    es_out_sys_t *sys = out->p_sys;
+
+    (void) id;
+    vlc_mutex_lock (&sys->lock);
+    sys->i_pes++;
+    sys->i_bytes += block->i_buffer;
+    vlc_cond_signal (&sys->wait);
+    vlc_mutex_unlock (&sys->lock);
+    block_ChainRelease (block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel (es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl (es_out_t *out, int query, va_list args)
+{
+    (void) out; (void) query; (void) args;
+    return VLC_SUCCESS;
+}
+
+static void bench (vlc_object_t *parent, const ts_gen_t *gen, int bulk)
+{
+    es_out_sys_t sys;
+    es_out_t out = {
+        .pf_add = EsOutAdd, .pf_send = EsOutSend, .pf_del = EsOutDel,
+        .pf_control = EsOutControl, .p_sys = &sys,
+    };
+    /* The last video PES of each program is never terminated */
+    const unsigned expected = PROGRAMS * FRAMES * 3 - PROGRAMS;
+
+    vlc_mutex_init (&sys.lock);
+    vlc_cond_init (&sys.wait);
+    sys.i_pes = 0;
+    sys.i_bytes = 0;
+
+    var_SetInteger (parent, "ts-bulk-packets", bulk);
+
+    mtime_t start = mdate ();
+    stream_t *s = stream_DemuxNew ((demux_t *)parent, "ts", &out);
+    assert (s != NULL);
+
+    /* Feed the stream as an UDP access would (7 packets per datagram) */
+    for (size_t i = 0; i < gen->i_size; i += 7 * 188)
+    {
+        size_t len = gen->i_size - i;
+        if (len > 7 * 188)
+            len = 7 * 188;
+
+        block_t *block = block_Alloc (len);
+        assert (block != NULL);
+        memcpy (block->p_buffer, gen->p_data + i, len);
+        stream_DemuxSend (s, block);
+    }
+
+    vlc_mutex_lock (&sys.lock);
+    while (sys.i_pes < expected)
+        vlc_cond_wait (&sys.wait, &sys.lock);
+    vlc_mutex_unlock (&sys.lock);
+    mtime_t duration = mdate () - start;
+
+    stream_Delete (s);
+
+    printf ("ts-bulk-packets=%-4d %8.1f Mbit/s %8u PES %8.1f MB\n", bulk,
+            gen->i_size * 8. / duration, sys.i_pes, sys.i_bytes / 1e6);
+    vlc_cond_destroy (&sys.wait);
+    vlc_mutex_destroy (&sys.lock);
+}
+
+int main (void)
+{
+    static const int bulks[] = { 1, 8, 32, 64, 256 };
+    ts_gen_t gen;
+    libvlc_instance_t *vlc;
+
+    memset (&gen, 0, sizeof (gen));
+    gen_stream (&gen);
+    printf ("synthetic TS: %u programs, %zu bytes\n", PROGRAMS, gen.i_size);
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *parent = vlc_object_create (vlc->p_libvlc_int,
+                                              sizeof (demux_t));
+    assert (parent != NULL);
+    vlc_object_attach (parent, vlc->p_libvlc_int);
+    var_Create (parent, "ts-bulk-packets", VLC_VAR_INTEGER);
+
+    for (unsigned i = 0; i < sizeof (bulks) / sizeof (bulks[0]); i++)
+        bench (parent, &gen, bulks[i]);
+
+    vlc_object_release (parent);
+    libvlc_release (vlc);
+    free (gen.p_data);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*****************************************************************************
+ * freetype_bench.c: freetype text renderer benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_misc_freetype [SRT or SSA file [renders per cue]]
+ * Renders every cue of the subtitle file, by default the test sample, a
+ * number of times as if each cue was rendered again for a few frames, with
+ * the glyph and region caches disabled, with the glyph cache only, and with
+ * both caches, and prints the renders per second. Cues with tags go through
+ * the HTML renderer when available. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_subpicture.h>
+
+#define RENDERS 25
+
+typedef struct
+{
+    char   **texts;
+    unsigned count;
+} cues_t;
+
+static void cues_add (cues_t *cues, const char *text)
+{
+    if (*text == '\0')
+        return;
+    cues->texts = realloc (cues->texts, (cues->count + 1) * sizeof (char *));
+    assert (cues->texts != NULL);
+    cues->texts[cues->count] = strdup (text);
+    assert (cues->texts[cues->count] != NULL);
+    cues->count++;
+}
+
+/* Keeps the text of an SSA Dialogue line, without the override blocks */
+static void ssa_add (cues_t *cues, const char *line)
+{
+    char text[1024];
+    size_t len = 0;
+
+    for (int commas = 0; commas < 9; line++)
+    {
+        if (*line == '\0')
+            return;
+        if (*line == ',')
+            commas++;
+    }
+
+    for (bool skip = false; *line && len < sizeof (text) - 1; line++)
+    {
+        if (*line == '{')
+            skip = true;
+        else if (*line == '}')
+            skip = false;
+        else if (skip)
+            continue;
+        else if (line[0] == '\\' && (line[1] == 'N' || line[1] == 'n'))
+        {
+            text[len++] = '\n';
+            line++;
+        }
+        else
+            text[len++] = *line;
+    }
+    text[len] = '\0';
+    cues_add (cues, text);
+}
+
+static void cues_load (cues_t *cues, const char *path)
+{
+    FILE *file = fopen (path, "rt");
+    char line[1024], text[4096] = "";
+
+    if (file == NULL)
+    {
+        perror (path);
+        return;
+    }
+
+    while (fgets (line, sizeof (line), file) != NULL)
+    {
+        line[strcspn (line, "\r\n")] = '\0';
+
+        if (!strncmp (line, "Dialogue:", 9))
+            ssa_add (cues, line);
+        else if (line[0] == '\0')
+        {   /* End of an SRT cue */
+            cues_add (cues, text);
+            text[0] = '\0';
+        }
+        else if (strstr (line, "-->") == NULL
+              && strspn (line, "0123456789") != strlen (line))
+        {
+            if (text[0])
+                strncat (text, "\n", sizeof (text) - strlen (text) - 1);
+            strncat (text, line, sizeof (text) - strlen (text) - 1);
+        }
+    }
+    cues_add (cues, text);
+    fclose (file);
+}
+
+static void bench (vlc_object_t *parent, const cues_t *cues, unsigned renders,
+                   const char *label)
+{
+    filter_t *p_filter = vlc_object_create (parent, sizeof (*p_filter));
+    assert (p_filter != NULL);
+    vlc_object_attach (p_filter, parent);
+
+    video_format_Setup (&p_filter->fmt_out.video, VLC_CODEC_I420,
+                        720, 576, 1, 1);
+    p_filter->p_module = module_need (p_filter, "text renderer", "freetype",
+                                      true);
+    assert (p_filter->p_module != NULL);
+
+    video_format_t fmt;
+    memset (&fmt, 0, sizeof (fmt));
+    fmt.i_chroma = VLC_CODEC_TEXT;
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < cues->count; i++)
+        for (unsigned j = 0; j < renders; j++)
+        {
+            subpicture_region_t *p_region = subpicture_region_New (&fmt);
+            const char *text = cues->texts[i];
+            assert (p_region != NULL);
+
+            if (strchr (text, '<') != NULL && p_filter->pf_render_html)
+            {
+                if (asprintf (&p_region->psz_html, "<text>%s</text>",
+                              text) == -1)
+                    abort ();
+                p_filter->pf_render_html (p_filter, p_region, p_region);
+            }
+            else
+            {
+                p_region->psz_text = strdup (text);
+                assert (p_region->psz_text != NULL);
+                p_filter->pf_render_text (p_filter, p_region, p_region);
+            }
+            subpicture_region_Delete (p_region);
+        }
+    mtime_t duration = mdate () - start;
+
+    printf ("%-14s %u cues x %u: %9.1f renders/s, %7.3f ms per render\n",
+            label, cues->count, renders,
+            cues->count * renders * (double)CLOCK_FREQ / duration,
+            duration / (1000. * cues->count * renders));
+
+    module_unneed (p_filter, p_filter->p_module);
+    vlc_object_release (p_filter);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned renders = (argc > 2) ? strtoul (argv[2], NULL, 10) : RENDERS;
+    cues_t cues = { NULL, 0 };
+    libvlc_instance_t *vlc;
+
+    cues_load (&cues, (argc > 1) ? argv[1] : SRCDIR"/samples/subtitles.srt");
+    if (cues.count == 0 || renders == 0)
+    {
+        fprintf (stderr, "Usage: %s [SRT or SSA file [renders per cue]]\n",
+                 argv[0]);
+        return 1;
+    }
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *parent = vlc_object_create (vlc->p_libvlc_int,
+                                              sizeof (*parent));
+    assert (parent != NULL);
+    vlc_object_attach (parent, vlc->p_libvlc_int);
+    var_Create (parent, "freetype-cache", VLC_VAR_INTEGER);
+    var_Create (parent, "freetype-region-cache", VLC_VAR_INTEGER);
+
+    bench (parent, &cues, renders, "no cache");
+    var_SetInteger (parent, "freetype-cache", 1024);
+    bench (parent, &cues, renders, "glyph cache");
+    var_SetInteger (parent, "freetype-region-cache", 8);
+    bench (parent, &cues, renders, "both caches");
+
+    vlc_object_release (parent);
+    libvlc_release (vlc);
+    for (unsigned i = 0; i < cues.count; i++)
+        free (cues.texts[i]);
+    free (cues.texts);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * bits.c: cached bitstream reader test
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_bits.h>
+#include "../../../modules/packetizer/startcode_helper.h"
+
+#define BUFFER_SIZE 96
+#define ROUNDS      20000
+#define OPS         64
+
+/* bs_t based references, as the h264 packetizer used to do */
+static int ref_read_ue( bs_t *s )
+{
+    int i = 0;
+
+    while( bs_read1( s ) == 0 && s->p < s->p_end && i < 32 )
+        i++;
+    return ( 1 << i ) - 1 + bs_read( s, i );
+}
+
+static int ref_read_se( bs_t *s )
+{
+    int val = ref_read_ue( s );
+
+    return val&0x01 ? (val+1)/2 : -(val/2);
+}
+
+/* Random RBSP with many zeroes but never three zero bytes in a row, so that
+ * there are never more than 31 zero bits in a row, and the same escaped as
+ * by an encoder */
+static size_t fill( uint8_t *rbsp, uint8_t *nal, size_t *pi_nal )
+{
+    size_t i_rbsp = rand() % BUFFER_SIZE / 2, i_nal = 0, i_zeros = 0;
+
+    for( size_t i = 0; i < i_rbsp; i++ )
+    {
+        rbsp[i] = (rand() % 3) ? rand() : 0x00;
+        if( i_zeros >= 2 && rbsp[i] == 0x00 )
+            rbsp[i] = 1 + rand() % 3;
+        if( i_zeros >= 2 && rbsp[i] <= 0x03 )
+        {
+            nal[i_nal++] = 0x03;
+            i_zeros = 0;
+        }
+        nal[i_nal++] = rbsp[i];
+        i_zeros = rbsp[i] ? 0 : i_zeros + 1;
+    }
+    *pi_nal = i_nal;
+    return i_rbsp;
+}
+
+static void test_ops( const uint8_t *rbsp, size_t i_rbsp,
+                      const uint8_t *p_data, size_t i_data, bool b_nal )
+{
+    bs_t ref;
+    bs64_t s;
+
+    bs_init( &ref, rbsp, i_rbsp );
+    if( b_nal )
+        bs64_init_nal( &s, p_data, i_data );
+    else
+        bs64_init( &s, p_data, i_data );
+
+    for( unsigned i = 0; i < OPS && !bs_eof( &ref ); i++ )
+    {
+        const unsigned n = rand() % 33;
+
+        assert( bs64_pos( &s ) == bs_pos( &ref ) );
+        assert( !bs64_eof( &s ) );
+        switch( rand() % 8 )
+        {
+            case 0:
+                assert( bs64_read( &s, n ) == bs_read( &ref, n ) );
+                break;
+            case 1:
+                assert( bs64_read1( &s ) == bs_read1( &ref ) );
+                break;
+            case 2:
+                assert( bs64_show( &s, n ) == bs_show( &ref, n ) );
+                break;
+            case 3:
+                bs64_skip( &s, n * 3 );
+                bs_skip( &ref, n * 3 );
+                break;
+            case 4:
+                bs64_align( &s );
+                bs_align( &ref );
+                break;
+            case 5:
+                assert( bs64_read_se( &s ) == ref_read_se( &ref ) );
+                break;
+            default:
+                assert( (int)bs64_read_ue( &s ) == ref_read_ue( &ref ) );
+                break;
+        }
+    }
+    if( bs_eof( &ref ) )
+    {
+        assert( bs64_eof( &s ) );
+        assert( bs64_read( &s, 32 ) == 0 );
+    }
+}
+
+int main( void )
+{
+    uint8_t rbsp[BUFFER_SIZE], nal[BUFFER_SIZE], dec[BUFFER_SIZE];
+
+    test_init();
+
+    log( "Testing the cached bitstream reader\n" );
+    srand( 0 );
+    for( unsigned i = 0; i < ROUNDS; i++ )
+    {
+        size_t i_nal, i_rbsp = fill( rbsp, nal, &i_nal );
+
+        assert( startcode_RemoveEP3B( dec, sizeof(dec), nal, i_nal )
+                == i_rbsp );
+        assert( !memcmp( dec, rbsp, i_rbsp ) );
+
+        unsigned seed = rand();
+        srand( seed );
+        test_ops( rbsp, i_rbsp, rbsp, i_rbsp, false );
+        srand( seed );
+        test_ops( rbsp, i_rbsp, nal, i_nal, true );
+
+        /* NAL cut anywhere, possibly within an escape, as the slice
+         * headers are */
+        size_t i_cut = rand() % (i_nal + 1);
+        size_t i_dec = startcode_RemoveEP3B( dec, sizeof(dec), nal, i_cut );
+        test_ops( dec, i_dec, nal, i_cut, true );
+    }
+    return 0;
+}
@@ -0,0 +1,425 @@
+/*****************************************************************************
+ * h264_bench.c: H.264 parameter sets and slice headers parsing benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_packetizer_h264 [H.264 Annex B file [passes]]
+ * Parses the SPS and the slice headers of the NAL units of the file, by
+ * default of a synthetic 1080p stream, as the h264 packetizer does: with
+ * bs_t after removing the emulation prevention bytes into a copy, as it
+ * used to, then with bs64_t reading the NAL in place. Both must give the
+ * same values. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_bits.h>
+#include "../../../modules/packetizer/startcode_helper.h"
+
+#define PASSES      20
+#define SPS_PASSES  200000
+#define SLICES      2000
+#define SLICE       2000
+
+typedef struct
+{
+    const uint8_t *p;
+    size_t         i;
+} nal_t;
+
+typedef struct
+{
+    /* from the SPS and the PPS */
+    unsigned i_log2_max_frame_num;
+    unsigned i_log2_max_poc_lsb;
+    unsigned i_poc_type;
+    bool     b_delta_poc_always_zero;
+    bool     b_frame_mbs_only;
+    bool     b_poc_present;
+
+    uint64_t i_sum; /* of every value read */
+} state_t;
+
+/* As the h264 packetizer used to read Exp-Golomb codes with bs_t */
+static inline int bs_read_ue( bs_t *s )
+{
+    int i = 0;
+
+    while( bs_read1( s ) == 0 && s->p < s->p_end && i < 32 )
+        i++;
+    return ( 1 << i ) - 1 + bs_read( s, i );
+}
+
+static inline int bs_read_se( bs_t *s )
+{
+    int val = bs_read_ue( s );
+
+    return val&0x01 ? (val+1)/2 : -(val/2);
+}
+
+/* Values are hashed in reading order, so that both readers must agree */
+static inline void add( state_t *st, uint64_t i_value )
+{
+    st->i_sum = st->i_sum * 31 + i_value;
+}
+
+/* The same parsers for both readers, with the fields that PutSPS(),
+ * PutPPS() and ParseSlice() use */
+#define PARSERS( bs ) \
+static void bs##sps( state_t *st, bs##t *s ) \
+{ \
+    unsigned i_profile = bs##read( s, 8 ); \
+    add( st, i_profile ); \
+    bs##skip( s, 8 ); \
+    add( st, bs##read( s, 8 ) ); \
+    add( st, bs##read_ue( s ) ); \
+    if( i_profile >= 100 ) \
+    { \
+        if( bs##read_ue( s ) == 3 ) \
+            bs##skip( s, 1 ); \
+        add( st, bs##read_ue( s ) ); \
+        add( st, bs##read_ue( s ) ); \
+        bs##skip( s, 1 ); \
+        if( bs##read( s, 1 ) ) \
+            return; /* scaling matrices are not parsed */ \
+    } \
+    st->i_log2_max_frame_num = bs##read_ue( s ); \
+    if( st->i_log2_max_frame_num > 12 ) \
+        st->i_log2_max_frame_num = 12; \
+    st->i_poc_type = bs##read_ue( s ); \
+    if( st->i_poc_type == 0 ) \
+    { \
+        st->i_log2_max_poc_lsb = bs##read_ue( s ); \
+        if( st->i_log2_max_poc_lsb > 12 ) \
+            st->i_log2_max_poc_lsb = 12; \
+    } \
+    else if( st->i_poc_type == 1 ) \
+    { \
+        st->b_delta_poc_always_zero = bs##read( s, 1 ); \
+        add( st, bs##read_se( s ) ); \
+        add( st, bs##read_se( s ) ); \
+        for( int i = bs##read_ue( s ); i > 0; i-- ) \
+            add( st, bs##read_se( s ) ); \
+    } \
+    add( st, bs##read_ue( s ) ); \
+    add( st, bs##read( s, 1 ) ); \
+    add( st, bs##read_ue( s ) ); \
+    add( st, bs##read_ue( s ) ); \
+    st->b_frame_mbs_only = bs##read( s, 1 ); \
+    if( !st->b_frame_mbs_only ) \
+        bs##skip( s, 1 ); \
+    bs##skip( s, 1 ); \
+    if( bs##read( s, 1 ) ) \
+        for( int i = 0; i < 4; i++ ) \
+            add( st, bs##read_ue( s ) ); \
+    add( st, st->i_log2_max_frame_num ); \
+    add( st, st->i_poc_type ); \
+    add( st, st->i_log2_max_poc_lsb ); \
+} \
+\
+static void bs##pps( state_t *st, bs##t *s ) \
+{ \
+    add( st, bs##read_ue( s ) ); \
+    add( st, bs##read_ue( s ) ); \
+    bs##skip( s, 1 ); \
+    st->b_poc_present = bs##read( s, 1 ); \
+} \
+\
+static void bs##slice( state_t *st, bs##t *s, int i_nal_type ) \
+{ \
+    for( int i = 0; i < 3; i++ ) \
+        add( st, bs##read_ue( s ) ); \
+    add( st, bs##read( s, st->i_log2_max_frame_num + 4 ) ); \
+    bool b_field = false; \
+    if( !st->b_frame_mbs_only && (b_field = bs##read( s, 1 )) ) \
+        add( st, bs##read( s, 1 ) ); \
+    if( i_nal_type == 5 ) \
+        add( st, bs##read_ue( s ) ); \
+    if( st->i_poc_type == 0 ) \
+    { \
+        add( st, bs##read( s, st->i_log2_max_poc_lsb + 4 ) ); \
+        if( st->b_poc_present && !b_field ) \
+            add( st, bs##read_se( s ) ); \
+    } \
+    else if( st->i_poc_type == 1 && !st->b_delta_poc_always_zero ) \
+    { \
+        add( st, bs##read_se( s ) ); \
+        if( st->b_poc_present && !b_field ) \
+            add( st, bs##read_se( s ) ); \
+    } \
+}
+
+PARSERS( bs_ )
+PARSERS( bs64_ )
+
+/* Former path: the NAL is unescaped into a copy, see CreateDecodedNAL() */
+static void parse_copy( state_t *st, const nal_t *nal )
+{
+    const int i_type = nal->p[0] & 0x1f;
+    size_t i_src = nal->i - 1;
+    bs_t s;
+
+    if( i_type == 8 )
+    {
+        bs_init( &s, &nal->p[1], i_src );
+        bs_pps( st, &s );
+        return;
+    }
+    if( i_type != 7 )
+        i_src = __MIN( i_src, 60 );
+
+    uint8_t *p_dec = malloc( i_src );
+    assert( p_dec != NULL );
+    bs_init( &s, p_dec, startcode_RemoveEP3B( p_dec, i_src, &nal->p[1],
+                                              i_src ) );
+    if( i_type == 7 )
+        bs_sps( st, &s );
+    else
+        bs_slice( st, &s, i_type );
+    free( p_dec );
+}
+
+static void parse_nal( state_t *st, const nal_t *nal )
+{
+    const int i_type = nal->p[0] & 0x1f;
+    size_t i_src = nal->i - 1;
+    bs64_t s;
+
+    if( i_type != 7 && i_type != 8 )
+        i_src = __MIN( i_src, 60 );
+    bs64_init_nal( &s, &nal->p[1], i_src );
+    if( i_type == 7 )
+        bs64_sps( st, &s );
+    else if( i_type == 8 )
+        bs64_pps( st, &s );
+    else
+        bs64_slice( st, &s, i_type );
+}
+
+static uint64_t bench( const char *name, void (*parse)( state_t *,
+                                                        const nal_t * ),
+                       const nal_t *nals, unsigned count, unsigned passes )
+{
+    state_t st;
+    unsigned sps = 0, slices = 0;
+
+    memset( &st, 0, sizeof(st) );
+
+    /* The SPS alone, there are too few of them to be timed otherwise */
+    const nal_t *sps_nals[count];
+    unsigned sps_count = 0;
+
+    for( unsigned j = 0; j < count; j++ )
+        if( (nals[j].p[0] & 0x1f) == 7 )
+            sps_nals[sps_count++] = &nals[j];
+
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < SPS_PASSES; i++ )
+        for( unsigned j = 0; j < sps_count; j++ )
+            parse( &st, sps_nals[j] );
+    mtime_t sps_duration = mdate() - start;
+    sps = SPS_PASSES * sps_count;
+
+    start = mdate();
+    for( unsigned i = 0; i < passes; i++ )
+        for( unsigned j = 0; j < count; j++ )
+        {
+            const int i_type = nals[j].p[0] & 0x1f;
+
+            if( i_type == 1 || i_type == 5 )
+                slices++;
+            if( i_type == 1 || i_type == 5 || i_type == 7 || i_type == 8 )
+                parse( &st, &nals[j] );
+        }
+    mtime_t duration = mdate() - start;
+
+    printf( "%-6s SPS %8.1f ns, slice header %8.1f ns (%u slices)\n", name,
+            sps ? sps_duration * 1000. / sps : 0.,
+            slices ? duration * 1000. / slices : 0., slices / passes );
+    return st.i_sum;
+}
+
+/* Synthetic stream writer */
+static void write_ue( bs_t *s, unsigned v )
+{
+    unsigned i_bits = 0;
+
+    while( (v + 1) >> (i_bits + 1) )
+        i_bits++;
+    bs_write( s, i_bits, 0 );
+    bs_write( s, i_bits + 1, v + 1 );
+}
+
+static size_t put_nal( uint8_t *out, const uint8_t *rbsp, size_t i_rbsp )
+{
+    size_t i_out = 0;
+    unsigned i_zeros = 0;
+
+    memcpy( out, "\x00\x00\x00\x01", 4 );
+    i_out = 4;
+    for( size_t i = 0; i < i_rbsp; i++ )
+    {
+        if( i_zeros >= 2 && rbsp[i] <= 0x03 )
+        {
+            out[i_out++] = 0x03;
+            i_zeros = 0;
+        }
+        out[i_out++] = rbsp[i];
+        i_zeros = rbsp[i] ? 0 : i_zeros + 1;
+    }
+    return i_out;
+}
+
+/* High profile 1920x1088 SPS and PPS, then slices with random payloads */
+static uint8_t *gen_stream( size_t *pi_size )
+{
+    uint8_t *buf = malloc( SLICES * (2 * SLICE + 16) + 256 ), rbsp[SLICE];
+    size_t i_size = 0;
+    bs_t s;
+
+    assert( buf != NULL );
+
+    memset( rbsp, 0, sizeof(rbsp) );
+    bs_init( &s, rbsp, sizeof(rbsp) );
+    bs_write( &s, 8, 0x67 );
+    bs_write( &s, 8, 100 );     /* profile_idc */
+    bs_write( &s, 8, 0 );       /* constraints */
+    bs_write( &s, 8, 40 );      /* level_idc */
+    write_ue( &s, 0 );          /* seq_parameter_set_id */
+    write_ue( &s, 1 );          /* chroma_format_idc */
+    write_ue( &s, 0 );          /* bit_depth_luma_minus8 */
+    write_ue( &s, 0 );          /* bit_depth_chroma_minus8 */
+    bs_write( &s, 2, 0 );       /* transform bypass, no scaling matrix */
+    write_ue( &s, 5 );          /* log2_max_frame_num_minus4 */
+    write_ue( &s, 0 );          /* pic_order_cnt_type */
+    write_ue( &s, 6 );          /* log2_max_pic_order_cnt_lsb_minus4 */
+    write_ue( &s, 4 );          /* max_num_ref_frames */
+    bs_write( &s, 1, 0 );       /* gaps_in_frame_num_allowed */
+    write_ue( &s, 119 );        /* pic_width_in_mbs_minus1 */
+    write_ue( &s, 67 );         /* pic_height_in_map_units_minus1 */
+    bs_write( &s, 3, 0x5 );     /* frame_mbs_only, 8x8 inference, cropping */
+    write_ue( &s, 0 );
+    write_ue( &s, 0 );
+    write_ue( &s, 0 );
+    write_ue( &s, 8 );          /* crop bottom */
+    bs_write( &s, 2, 0x1 );     /* no VUI, stop bit */
+    i_size += put_nal( &buf[i_size], rbsp, bs_pos( &s ) / 8 + 1 );
+
+    memset( rbsp, 0, sizeof(rbsp) );
+    bs_init( &s, rbsp, sizeof(rbsp) );
+    bs_write( &s, 8, 0x68 );
+    write_ue( &s, 0 );          /* pic_parameter_set_id */
+    write_ue( &s, 0 );          /* seq_parameter_set_id */
+    bs_write( &s, 2, 0x2 );     /* CABAC, no bottom_field_pic_order */
+    bs_write( &s, 1, 1 );
+    i_size += put_nal( &buf[i_size], rbsp, bs_pos( &s ) / 8 + 1 );
+
+    srand( 0 );
+    for( unsigned i = 0; i < SLICES; i++ )
+    {
+        const bool b_idr = i % 25 == 0;
+
+        for( size_t j = 0; j < sizeof(rbsp); j++ )
+            rbsp[j] = (rand() % 4) ? rand() : 0x00;
+        bs_init( &s, rbsp, sizeof(rbsp) );
+        bs_write( &s, 8, b_idr ? 0x65 : 0x41 );
+        write_ue( &s, 0 );                  /* first_mb_in_slice */
+        write_ue( &s, b_idr ? 7 : 5 + i % 2 ); /* slice_type */
+        write_ue( &s, 0 );                  /* pic_parameter_set_id */
+        bs_write( &s, 9, i );               /* frame_num */
+        if( b_idr )
+            write_ue( &s, i / 25 );         /* idr_pic_id */
+        bs_write( &s, 10, 2 * i );          /* pic_order_cnt_lsb */
+        i_size += put_nal( &buf[i_size], rbsp, sizeof(rbsp) );
+    }
+    *pi_size = i_size;
+    return buf;
+}
+
+static uint8_t *load( const char *path, size_t *pi_size )
+{
+    FILE *file = fopen( path, "rb" );
+    uint8_t *buf = NULL;
+    size_t i_size = 0;
+
+    if( file == NULL )
+    {
+        perror( path );
+        return NULL;
+    }
+    for( ;; )
+    {
+        buf = realloc( buf, i_size + (1 << 20) );
+        assert( buf != NULL );
+        size_t i_read = fread( &buf[i_size], 1, 1 << 20, file );
+        if( i_read == 0 )
+            break;
+        i_size += i_read;
+    }
+    fclose( file );
+    *pi_size = i_size;
+    return buf;
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned passes = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : PASSES;
+    size_t i_size;
+    uint8_t *buf = (argc > 1) ? load( argv[1], &i_size )
+                              : gen_stream( &i_size );
+
+    if( buf == NULL || passes == 0 )
+    {
+        fprintf( stderr, "Usage: %s [H.264 Annex B file [passes]]\n",
+                 argv[0] );
+        return 1;
+    }
+
+    /* Splits the NAL units, without their start codes */
+    nal_t *nals = NULL;
+    unsigned count = 0;
+    const uint8_t *end = &buf[i_size];
+    const uint8_t *p = startcode_FindAnnexB( buf, end );
+
+    while( p != NULL )
+    {
+        const uint8_t *next = startcode_FindAnnexB( p + 3, end );
+        const uint8_t *nal_end = next ? next : end;
+
+        while( nal_end > p + 3 && nal_end[-1] == 0x00 )
+            nal_end--; /* trailing zeroes, 4 bytes start codes */
+        if( nal_end > p + 3 )
+        {
+            nals = realloc( nals, (count + 1) * sizeof(*nals) );
+            assert( nals != NULL );
+            nals[count].p = p + 3;
+            nals[count].i = nal_end - (p + 3);
+            count++;
+        }
+        p = next;
+    }
+    printf( "%u NAL units, %zu bytes\n", count, i_size );
+
+    uint64_t i_copy = bench( "bs_t", parse_copy, nals, count, passes );
+    uint64_t i_nal = bench( "bs64_t", parse_nal, nals, count, passes );
+    assert( i_copy == i_nal );
+
+    free( nals );
+    free( buf );
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*****************************************************************************
+ * startcode.c: test for the packetizers start code helpers
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include "../../../modules/packetizer/packetizer_helper.h"
+
+#define BUFFER_SIZE 512
+#define ROUNDS      500
+
+/* Byte by byte references, as the packetizers used to do */
+static const uint8_t *ref_Find( const uint8_t *p, const uint8_t *end,
+                                uint8_t code )
+{
+    for( ; p + 3 <= end; p++ )
+        if( p[0] == 0x00 && p[1] == 0x00 && p[2] == code )
+            return p;
+    return NULL;
+}
+
+static size_t ref_RemoveEP3B( uint8_t *dst, const uint8_t *src, size_t i_src )
+{
+    const uint8_t *end = &src[i_src];
+    uint8_t *start = dst;
+
+    while( src < end )
+    {
+        if( src < end - 3 && src[0] == 0x00 && src[1] == 0x00 &&
+            src[2] == 0x03 )
+        {
+            *dst++ = 0x00;
+            *dst++ = 0x00;
+
+            src += 3;
+            continue;
+        }
+        *dst++ = *src++;
+    }
+    return dst - start;
+}
+
+/* Random data, with plenty of zeroes, start codes and escapes */
+static void fill( uint8_t *p, size_t size )
+{
+    const unsigned density = 1 + rand() % 16;
+
+    for( size_t i = 0; i < size; i++ )
+        p[i] = (rand() % density) ? rand() : 0;
+    for( unsigned n = rand() % 8; n > 0; n-- )
+    {
+        size_t i = rand() % (size - 2);
+
+        p[i] = p[i + 1] = 0;
+        p[i + 2] = 1 + rand() % 3;
+    }
+}
+
+static void test_find( const uint8_t *buf )
+{
+    for( size_t start = 0; start < 32; start++ )
+        for( size_t end = start; end <= BUFFER_SIZE; end += 1 + end / 16 )
+            for( uint8_t code = 0x01; code <= 0x03; code += 2 )
+            {
+                const uint8_t *ref = ref_Find( buf + start, buf + end, code );
+
+                assert( startcode_Find( buf + start, buf + end, code ) == ref );
+                assert( startcode_FindC( buf + start, buf + end, code ) == ref );
+#ifdef CAN_COMPILE_SSE2
+                if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+                    assert( startcode_FindSSE2( buf + start, buf + end,
+                                                code ) == ref );
+#endif
+#if defined(__ARM_NEON__)
+                if( vlc_CPU() & CPU_CAPABILITY_NEON )
+                    assert( startcode_FindNEON( buf + start, buf + end,
+                                                code ) == ref );
+#endif
+            }
+}
+
+static void test_ep3b( const uint8_t *buf )
+{
+    uint8_t ref[BUFFER_SIZE], out[BUFFER_SIZE + 1];
+
+    for( size_t size = 0; size <= BUFFER_SIZE; size += 1 + size / 8 )
+    {
+        const size_t i_ref = ref_RemoveEP3B( ref, buf, size );
+
+        out[i_ref] = 0xAA;
+        assert( startcode_RemoveEP3B( out, size, buf, size ) == i_ref );
+        assert( !memcmp( out, ref, i_ref ) && out[i_ref] == 0xAA );
+
+        /* Truncated output */
+        const size_t i_max = i_ref / 2;
+        out[i_max] = 0xAA;
+        assert( startcode_RemoveEP3B( out, i_max, buf, size ) == i_max );
+        assert( !memcmp( out, ref, i_max ) && out[i_max] == 0xAA );
+    }
+}
+
+/* Compares the packetizer search with the generic one, on a chain of
+ * randomly cut blocks */
+static void test_bytestream( const uint8_t *buf )
+{
+    static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+    block_bytestream_t bs = block_BytestreamInit();
+    size_t i_pushed = 0;
+
+    while( i_pushed < BUFFER_SIZE )
+    {
+        size_t i_size = rand() % 8;
+        if( i_size > BUFFER_SIZE - i_pushed )
+            i_size = BUFFER_SIZE - i_pushed;
+
+        block_t *p_block = block_Alloc( i_size );
+
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, buf + i_pushed, i_size );
+        block_BytestreamPush( &bs, p_block );
+        i_pushed += i_size;
+    }
+    block_SkipBytes( &bs, rand() % 16 );
+
+    for( size_t offset = 0; offset <= BUFFER_SIZE; offset++ )
+    {
+        size_t i_ref = offset, i_out = offset;
+        int i_ret = block_FindStartcodeFromOffset( &bs, &i_ref, startcode, 3 );
+
+        assert( packetizer_FindAnnexB( &bs, &i_out ) == i_ret );
+        assert( i_out == i_ref );
+    }
+    block_BytestreamRelease( &bs );
+}
+
+int main( void )
+{
+    libvlc_instance_t *p_vlc;
+    uint8_t buf[BUFFER_SIZE];
+
+    test_init();
+
+    /* Initializes the CPU capabilities */
+    p_vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( p_vlc != NULL );
+
+    log( "Testing start code helpers (CPU flags 0x%x)\n", vlc_CPU() );
+    srand( 0 );
+    for( unsigned i = 0; i < ROUNDS; i++ )
+    {
+        fill( buf, sizeof(buf) );
+        test_find( buf );
+        test_ep3b( buf );
+        test_bytestream( buf );
+    }
+
+    libvlc_release( p_vlc );
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************
+ * startcode_bench.c: start code scanning and escaping benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_packetizer_startcode [megabytes]
+ * Scans a synthetic elementary stream (random slices of about 40 kB with
+ * some escapes, as a high bit rate H.264 stream) for start codes, first in
+ * a flat buffer with each available path, then through a chain of TS sized
+ * blocks as the packetizers do, and removes the emulation prevention
+ * bytes. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include "../../../modules/packetizer/packetizer_helper.h"
+
+#define MEGABYTES   64
+#define SLICE       40000
+#define BLOCK       (7 * 184)
+
+typedef const uint8_t *(*find_t)( const uint8_t *, const uint8_t *, uint8_t );
+
+static const uint8_t *FindBytes( const uint8_t *p, const uint8_t *end,
+                                 uint8_t code )
+{
+    for( ; p + 3 <= end; p++ )
+        if( p[0] == 0x00 && p[1] == 0x00 && p[2] == code )
+            return p;
+    return NULL;
+}
+
+static void gen_stream( uint8_t *p, size_t size )
+{
+    for( size_t i = 0; i < size; i++ )
+        p[i] = rand();
+
+    for( size_t i = 0; i + 4 <= size; i++ )
+    {
+        if( i % SLICE == 0 )
+        {   /* Start code of a new slice */
+            memcpy( &p[i], "\x00\x00\x01\x01", 4 );
+            i += 3;
+        }
+        else if( p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] <= 0x03 )
+        {   /* Escape as an encoder would */
+            p[i + 2] = 0x03;
+            i += 2;
+        }
+    }
+}
+
+static void bench_find( const char *name, find_t find, const uint8_t *buf,
+                        size_t size )
+{
+    unsigned count = 0;
+
+    mtime_t start = mdate();
+    for( const uint8_t *p = buf; (p = find( p, buf + size, 0x01 )) != NULL;
+         p += 3 )
+        count++;
+    mtime_t duration = mdate() - start;
+
+    printf( "find  %-5s %8.1f MB/s %6u start codes\n", name,
+            size / (double)duration, count );
+}
+
+/* Same through a block chain, as the packetizers see the stream */
+static void bench_bytestream( const char *name, bool b_annexb,
+                              const uint8_t *buf, size_t size )
+{
+    static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+    block_bytestream_t bs = block_BytestreamInit();
+    unsigned count = 0;
+
+    for( size_t i = 0; i < size; i += BLOCK )
+    {
+        block_t *p_block = block_Alloc( __MIN( BLOCK, size - i ) );
+
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, buf + i, p_block->i_buffer );
+        block_BytestreamPush( &bs, p_block );
+    }
+
+    mtime_t start = mdate();
+    for( ;; )
+    {
+        size_t offset = 3;
+        int i_ret = b_annexb ? packetizer_FindAnnexB( &bs, &offset )
+                  : block_FindStartcodeFromOffset( &bs, &offset, startcode, 3 );
+        if( i_ret )
+            break;
+        count++;
+        /* Consume the NAL as packetizer_Packetize() does */
+        block_SkipBytes( &bs, offset );
+        block_BytestreamFlush( &bs );
+    }
+    mtime_t duration = mdate() - start;
+
+    printf( "chain %-5s %8.1f MB/s %6u start codes\n", name,
+            size / (double)duration, count );
+    block_BytestreamRelease( &bs );
+}
+
+static void bench_ep3b( const uint8_t *buf, size_t size )
+{
+    uint8_t *out = malloc( SLICE );
+    size_t total = 0;
+
+    assert( out != NULL );
+
+    mtime_t start = mdate();
+    for( size_t i = 0; i < size; i += SLICE )
+        total += startcode_RemoveEP3B( out, SLICE, buf + i,
+                                       __MIN( SLICE, size - i ) );
+    mtime_t duration = mdate() - start;
+
+    printf( "ep3b        %8.1f MB/s %6.2f%% escapes\n",
+            size / (double)duration, 100. * (size - total) / size );
+    free( out );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned megabytes = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : MEGABYTES;
+    libvlc_instance_t *vlc;
+
+    if( megabytes == 0 )
+    {
+        fprintf( stderr, "Usage: %s [megabytes]\n", argv[0] );
+        return 1;
+    }
+
+    size_t size = megabytes << 20;
+    uint8_t *buf = malloc( size );
+    assert( buf != NULL );
+    gen_stream( buf, size );
+
+    /* Initializes the CPU capabilities */
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    bench_find( "bytes", FindBytes, buf, size );
+    bench_find( "C", startcode_FindC, buf, size );
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+        bench_find( "SSE2", startcode_FindSSE2, buf, size );
+#endif
+#if defined(__ARM_NEON__)
+    if( vlc_CPU() & CPU_CAPABILITY_NEON )
+        bench_find( "NEON", startcode_FindNEON, buf, size );
+#endif
+    bench_bytestream( "bytes", false, buf, size );
+    bench_bytestream( "best", true, buf, size );
+    bench_ep3b( buf, size );
+
+    libvlc_release( vlc );
+    free( buf );
+    return 0;
+}
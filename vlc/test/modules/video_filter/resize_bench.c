@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * resize_bench.c: video scalers benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_video_filter_resize [frames]
+ * Scales 1080p pictures of each chroma to 720p and 480p with the nearest
+ * neighbour scale filter and with each mode of the resize filter, and
+ * prints the frames per second. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define FRAMES 100
+
+static const vlc_fourcc_t chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_NV12, VLC_CODEC_YUYV, VLC_CODEC_RGB32,
+};
+
+static const struct
+{
+    unsigned i_width;
+    unsigned i_height;
+} sizes[] = { { 1280, 720 }, { 854, 480 } };
+
+static picture_t *NewPicture( filter_t *p_filter )
+{
+    const video_format_t *fmt = &p_filter->fmt_out.video;
+
+    return picture_New( fmt->i_chroma, fmt->i_width, fmt->i_height, 1, 1 );
+}
+
+static void DeletePicture( filter_t *p_filter, picture_t *p_pic )
+{
+    (void) p_filter;
+    picture_Release( p_pic );
+}
+
+static void bench( vlc_object_t *parent, const char *psz_name,
+                   const char *psz_label, vlc_fourcc_t i_chroma,
+                   unsigned i_width, unsigned i_height, unsigned i_frames )
+{
+    filter_t *p_filter = vlc_object_create( parent, sizeof(*p_filter) );
+    assert( p_filter != NULL );
+    vlc_object_attach( p_filter, parent );
+
+    video_format_Setup( &p_filter->fmt_in.video, i_chroma, 1920, 1080, 1, 1 );
+    p_filter->fmt_in.i_cat = VIDEO_ES;
+    p_filter->fmt_in.i_codec = i_chroma;
+    p_filter->fmt_out = p_filter->fmt_in;
+    video_format_Setup( &p_filter->fmt_out.video, i_chroma, i_width,
+                        i_height, 1, 1 );
+    p_filter->pf_video_buffer_new = NewPicture;
+    p_filter->pf_video_buffer_del = DeletePicture;
+
+    p_filter->p_module = module_need( p_filter, "video filter2", psz_name,
+                                      true );
+    assert( p_filter->p_module != NULL );
+
+    picture_t *p_src = picture_New( i_chroma, 1920, 1080, 1, 1 );
+    assert( p_src != NULL );
+    for( int i = 0; i < p_src->i_planes; i++ )
+        for( int y = 0; y < p_src->p[i].i_lines; y++ )
+            for( int x = 0; x < p_src->p[i].i_pitch; x++ )
+                p_src->p[i].p_pixels[y * p_src->p[i].i_pitch + x] =
+                    x * y + (rand() & 15);
+
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        picture_t *p_dst;
+
+        picture_Hold( p_src );
+        p_dst = p_filter->pf_video_filter( p_filter, p_src );
+        assert( p_dst != NULL );
+        picture_Release( p_dst );
+    }
+    mtime_t duration = mdate() - start;
+
+    printf( "%4.4s 1920x1080 -> %4ux%-4u %-10s %7.1f frames/s\n",
+            (const char *)&i_chroma, i_width, i_height, psz_label,
+            i_frames * (double)CLOCK_FREQ / duration );
+
+    picture_Release( p_src );
+    module_unneed( p_filter, p_filter->p_module );
+    vlc_object_release( p_filter );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned i_frames = (argc > 1) ? strtoul( argv[1], NULL, 10 ) : FRAMES;
+    libvlc_instance_t *vlc;
+
+    if( i_frames == 0 )
+    {
+        fprintf( stderr, "Usage: %s [frames]\n", argv[0] );
+        return 1;
+    }
+
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *parent = vlc_object_create( vlc->p_libvlc_int,
+                                              sizeof(*parent) );
+    assert( parent != NULL );
+    vlc_object_attach( parent, vlc->p_libvlc_int );
+    var_Create( parent, "resize-mode", VLC_VAR_INTEGER );
+
+    for( unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++ )
+        for( unsigned c = 0; c < sizeof(chromas) / sizeof(chromas[0]); c++ )
+        {
+            static const char *const labels[] = {
+                "bilinear", "bicubic", "lanczos" };
+            const unsigned i_width = sizes[s].i_width;
+            const unsigned i_height = sizes[s].i_height;
+
+            /* The nearest neighbour filter has no NV12 nor YUY2 */
+            if( chromas[c] == VLC_CODEC_I420 || chromas[c] == VLC_CODEC_RGB32 )
+                bench( parent, "scale", "nearest", chromas[c], i_width,
+                       i_height, i_frames );
+            for( int m = 0; m <= 2; m++ )
+            {
+                var_SetInteger( parent, "resize-mode", m );
+                bench( parent, "resize", labels[m], chromas[c], i_width,
+                       i_height, i_frames );
+            }
+        }
+
+    vlc_object_release( parent );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*****************************************************************************
+ * slices_bench.c: slice threaded video filters benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_modules_video_filter_slices [threads [frames]]
+ * Runs 1080p I420 pictures through video filter chains made of each ported
+ * filter, with 1 up to the given number of slice threads (one per CPU by
+ * default), and prints the frames per second. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define FRAMES 100
+
+static const struct
+{
+    const char *psz_filter;
+    vlc_fourcc_t i_chroma_out;
+} filters[] = {
+    { "deinterlace{mode=yadif}",  VLC_CODEC_I420 },
+    { "deinterlace{mode=blend}",  VLC_CODEC_I420 },
+    { "adjust{hue=30,saturation=1.5,gamma=1.2}", VLC_CODEC_I420 },
+    { NULL /* I420 to RGB */,     VLC_CODEC_RGB32 },
+};
+
+static picture_t *NewPicture( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static void DeletePicture( filter_t *p_filter, picture_t *p_pic )
+{
+    (void) p_filter;
+    picture_Release( p_pic );
+}
+
+static int AllocationInit( filter_t *p_filter, void *p_data )
+{
+    (void) p_data;
+    p_filter->pf_video_buffer_new = NewPicture;
+    p_filter->pf_video_buffer_del = DeletePicture;
+    return VLC_SUCCESS;
+}
+
+static double bench( vlc_object_t *parent, unsigned i_filter,
+                     unsigned i_frames )
+{
+    es_format_t fmt_in, fmt_out;
+
+    es_format_Init( &fmt_in, VIDEO_ES, VLC_CODEC_I420 );
+    video_format_Setup( &fmt_in.video, VLC_CODEC_I420, 1920, 1080, 1, 1 );
+    es_format_Init( &fmt_out, VIDEO_ES, filters[i_filter].i_chroma_out );
+    video_format_Setup( &fmt_out.video, filters[i_filter].i_chroma_out,
+                        1920, 1080, 1, 1 );
+    video_format_FixRgb( &fmt_out.video );
+
+    filter_chain_t *p_chain = filter_chain_New( parent, "video filter2",
+                                                false, AllocationInit, NULL,
+                                                NULL );
+    assert( p_chain != NULL );
+    filter_chain_Reset( p_chain, &fmt_in, &fmt_out );
+    if( filters[i_filter].psz_filter != NULL )
+    {
+        int i_ret = filter_chain_AppendFromString( p_chain,
+                                                   filters[i_filter].psz_filter );
+        assert( i_ret > 0 );
+    }
+    else
+    {
+        filter_t *p_filter = filter_chain_AppendFilter( p_chain, NULL, NULL,
+                                                        &fmt_in, &fmt_out );
+        assert( p_filter != NULL );
+    }
+
+    picture_t *p_src = picture_NewFromFormat( &fmt_in.video );
+    assert( p_src != NULL );
+    for( int i = 0; i < p_src->i_planes; i++ )
+        for( int y = 0; y < p_src->p[i].i_lines; y++ )
+            for( int x = 0; x < p_src->p[i].i_pitch; x++ )
+                p_src->p[i].p_pixels[y * p_src->p[i].i_pitch + x] =
+                    x * y + (rand() & 15);
+
+    mtime_t start = mdate();
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        picture_t *p_dst;
+
+        picture_Hold( p_src );
+        p_dst = filter_chain_VideoFilter( p_chain, p_src );
+        /* Yadif needs a few pictures before outputting anything */
+        if( p_dst != NULL )
+            picture_Release( p_dst );
+    }
+    mtime_t duration = mdate() - start;
+
+    picture_Release( p_src );
+    filter_chain_Delete( p_chain );
+    es_format_Clean( &fmt_in );
+    es_format_Clean( &fmt_out );
+    return i_frames * (double)CLOCK_FREQ / duration;
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned i_threads = (argc > 1) ? strtoul( argv[1], NULL, 10 )
+                                    : vlc_GetCPUCount();
+    unsigned i_frames = (argc > 2) ? strtoul( argv[2], NULL, 10 ) : FRAMES;
+    libvlc_instance_t *vlc;
+
+    if( i_threads == 0 || i_frames == 0 )
+    {
+        fprintf( stderr, "Usage: %s [threads [frames]]\n", argv[0] );
+        return 1;
+    }
+
+    vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( vlc != NULL );
+
+    vlc_object_t *parent = vlc_object_create( vlc->p_libvlc_int,
+                                              sizeof(*parent) );
+    assert( parent != NULL );
+    vlc_object_attach( parent, vlc->p_libvlc_int );
+    var_Create( parent, "filter-threads", VLC_VAR_INTEGER );
+
+    for( unsigned f = 0; f < sizeof(filters) / sizeof(filters[0]); f++ )
+    {
+        double f_single = 0.;
+
+        for( unsigned n = 1; n <= i_threads; n++ )
+        {
+            var_SetInteger( parent, "filter-threads", n );
+
+            double f_fps = bench( parent, f, i_frames );
+            if( n == 1 )
+                f_single = f_fps;
+            printf( "%-40s %2u thread(s) %7.1f frames/s (x%.2f)\n",
+                    filters[f].psz_filter ? filters[f].psz_filter
+                                          : "I420 to RV32",
+                    n, f_fps, f_fps / f_single );
+        }
+    }
+
+    vlc_object_release( parent );
+    libvlc_release( vlc );
+    return 0;
+}
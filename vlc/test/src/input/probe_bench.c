@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * probe_bench.c: demux probing latency benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_input_probe [rounds] [files or directories...]
+ * Each file is preparsed (i.e. opened and probed) as many times as requested,
+ * by default the test samples. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define ROUNDS 10
+
+typedef struct
+{
+    unsigned files;
+    mtime_t  total;     /* sum of the best times */
+} bench_result_t;
+
+static void bench_file (libvlc_instance_t *vlc, const char *path,
+                        unsigned rounds, bench_result_t *res)
+{
+    mtime_t best = INT64_MAX, sum = 0;
+
+    for (unsigned i = 0; i < rounds; i++)
+    {
+        libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+        assert (media != NULL);
+
+        mtime_t start = mdate ();
+        libvlc_media_parse (media);
+        mtime_t duration = mdate () - start;
+
+        libvlc_media_release (media);
+        if (duration < best)
+            best = duration;
+        sum += duration;
+    }
+
+    printf ("%8.3f ms best %8.3f ms mean  %s\n", best / 1000.,
+            sum / (1000. * rounds), path);
+    res->files++;
+    res->total += best;
+}
+
+static void bench_path (libvlc_instance_t *vlc, const char *path,
+                        unsigned rounds, bench_result_t *res)
+{
+    struct stat st;
+
+    if (stat (path, &st))
+    {
+        perror (path);
+        return;
+    }
+    if (!S_ISDIR (st.st_mode))
+    {
+        bench_file (vlc, path, rounds, res);
+        return;
+    }
+
+    DIR *dir = opendir (path);
+    if (dir == NULL)
+    {
+        perror (path);
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir (dir)) != NULL)
+    {
+        char *sub;
+
+        if (ent->d_name[0] == '.')
+            continue;
+        if (asprintf (&sub, "%s/%s", path, ent->d_name) == -1)
+            abort ();
+        if (!stat (sub, &st) && S_ISREG (st.st_mode))
+            bench_file (vlc, sub, rounds, res);
+        free (sub);
+    }
+    closedir (dir);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned rounds = (argc > 1) ? strtoul (argv[1], NULL, 10) : ROUNDS;
+    bench_result_t res = { 0, 0 };
+    libvlc_instance_t *vlc;
+
+    if (rounds == 0)
+    {
+        fprintf (stderr, "Usage: %s [rounds] [files or directories...]\n",
+                 argv[0]);
+        return 1;
+    }
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    if (argc > 2)
+        for (int i = 2; i < argc; i++)
+            bench_path (vlc, argv[i], rounds, &res);
+    else
+        bench_path (vlc, SRCDIR"/samples", rounds, &res);
+
+    if (res.files > 0)
+        printf ("%u files, %.3f ms per file (best of %u)\n", res.files,
+                res.total / (1000. * res.files), rounds);
+    libvlc_release (vlc);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * fifo_bench.c: block FIFO latency and throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_misc_fifo [blocks]
+ * Compares the locked FIFO with the single producer/consumer one, first
+ * bouncing a block between two threads (wake up latency), then streaming
+ * blocks from one thread to the other (throughput), with and without the
+ * pacing the decoders use. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define BLOCKS      1000000
+#define PINGS       100000
+#define BLOCK_SIZE  188
+
+typedef struct
+{
+    block_fifo_t *in, *out;
+    unsigned      count;
+    size_t        max_depth;
+} bench_t;
+
+static void *Pong (void *data)
+{
+    bench_t *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+        block_FifoPut (b->out, block_FifoGet (b->in));
+    return NULL;
+}
+
+static void *Drain (void *data)
+{
+    bench_t *b = data;
+    uint64_t bytes = 0;
+
+    for (unsigned i = 0; i < b->count; i++)
+    {
+        block_t *block = block_FifoGet (b->in);
+
+        bytes += block->i_buffer;
+        block_Release (block);
+    }
+    assert (bytes == (uint64_t)b->count * BLOCK_SIZE);
+    return NULL;
+}
+
+static void ping_pong (block_fifo_t *(*fifo_new) (void), const char *name)
+{
+    bench_t b = { fifo_new (), fifo_new (), PINGS, 0 };
+    vlc_thread_t th;
+
+    assert (b.in != NULL && b.out != NULL);
+    if (vlc_clone (&th, Pong, &b, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    block_t *block = block_Alloc (BLOCK_SIZE);
+    assert (block != NULL);
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < PINGS; i++)
+    {
+        block_FifoPut (b.in, block);
+        block = block_FifoGet (b.out);
+    }
+    mtime_t duration = mdate () - start;
+
+    vlc_join (th, NULL);
+    block_Release (block);
+    block_FifoRelease (b.out);
+    block_FifoRelease (b.in);
+
+    printf ("%-7s ping-pong   %8.3f us round trip\n", name,
+            (double)duration / PINGS);
+}
+
+static void stream (block_fifo_t *(*fifo_new) (void), const char *name,
+                    unsigned count, size_t max_depth)
+{
+    bench_t b = { fifo_new (), NULL, count, max_depth };
+    vlc_thread_t th;
+
+    assert (b.in != NULL);
+    if (vlc_clone (&th, Drain, &b, VLC_THREAD_PRIORITY_LOW))
+        abort ();
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = block_Alloc (BLOCK_SIZE);
+        assert (block != NULL);
+
+        /* Same as input_DecoderDecode() with a bounded decoder */
+        if (max_depth)
+            block_FifoPace (b.in, max_depth, SIZE_MAX);
+        block_FifoPut (b.in, block);
+    }
+    vlc_join (th, NULL);
+    mtime_t duration = mdate () - start;
+
+    assert (block_FifoCount (b.in) == 0 && block_FifoSize (b.in) == 0);
+    block_FifoRelease (b.in);
+
+    printf ("%-7s stream %-5s %8.3f Mblocks/s\n", name,
+            max_depth ? "paced" : "free", count / (double)duration);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned count = (argc > 1) ? strtoul (argv[1], NULL, 10) : BLOCKS;
+
+    if (count == 0)
+    {
+        fprintf (stderr, "Usage: %s [blocks]\n", argv[0]);
+        return 1;
+    }
+
+    ping_pong (block_FifoNew, "locked");
+    ping_pong (block_FifoNewSPSC, "SPSC");
+    stream (block_FifoNew, "locked", count, 0);
+    stream (block_FifoNewSPSC, "SPSC", count, 0);
+    stream (block_FifoNew, "locked", count, 10);
+    stream (block_FifoNewSPSC, "SPSC", count, 10);
+    return 0;
+}
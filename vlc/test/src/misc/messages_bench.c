@@ -0,0 +1,136 @@
+/*****************************************************************************
+ * messages_bench.c: log messages benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_misc_messages [messages]
+ * Times msg_Dbg() when debug messages are neither printed nor subscribed to,
+ * then with a subscriber, from one and from several threads, and prints how
+ * many messages the subscriber got and how many were dropped. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+#define MESSAGES 1000000
+#define THREADS  4
+
+struct msg_cb_data_t
+{
+    vlc_atomic_t received;
+    vlc_atomic_t dropped;
+};
+
+static void Count (msg_cb_data_t *data, msg_item_t *item, unsigned drop)
+{
+    vlc_atomic_inc (&data->received);
+    vlc_atomic_add (&data->dropped, drop);
+    (void) item;
+}
+
+typedef struct
+{
+    vlc_object_t *obj;
+    unsigned      count;
+} bench_t;
+
+static void *Emit (void *data)
+{
+    bench_t *b = data;
+
+    for (unsigned i = 0; i < b->count; i++)
+        msg_Dbg (b->obj, "message %u of %u from %p", i, b->count, data);
+    return NULL;
+}
+
+static void bench (vlc_object_t *obj, unsigned count, unsigned threads,
+                   const char *label)
+{
+    bench_t b[threads];
+    vlc_thread_t th[threads];
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < threads; i++)
+    {
+        b[i].obj = obj;
+        b[i].count = count / threads;
+        if (vlc_clone (&th[i], Emit, &b[i], VLC_THREAD_PRIORITY_LOW))
+            abort ();
+    }
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join (th[i], NULL);
+    mtime_t duration = mdate () - start;
+
+    printf ("%-12s %u thread(s): %8.1f ns per message\n", label, threads,
+            duration * 1000. / count);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned count = (argc > 1) ? strtoul (argv[1], NULL, 10) : MESSAGES;
+    libvlc_instance_t *vlc;
+
+    if (count < THREADS)
+    {
+        fprintf (stderr, "Usage: %s [messages]\n", argv[0]);
+        return 1;
+    }
+
+    /* The default verbosity does not print debug messages */
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *obj = vlc_object_create (vlc->p_libvlc_int, sizeof (*obj));
+    assert (obj != NULL);
+    vlc_object_attach (obj, vlc->p_libvlc_int);
+
+    bench (obj, count, 1, "disabled");
+    bench (obj, count, THREADS, "disabled");
+
+    msg_cb_data_t data;
+    vlc_atomic_set (&data.received, 0);
+    vlc_atomic_set (&data.dropped, 0);
+
+    msg_subscription_t *sub = msg_Subscribe (vlc->p_libvlc_int, Count, &data);
+    assert (sub != NULL);
+    bench (obj, count, 1, "subscribed");
+    bench (obj, count, THREADS, "subscribed");
+
+    /* Waits for the dispatcher to catch up. Drops are reported along with
+     * the next delivered message, hence the extra messages. */
+    unsigned total = count + (count / THREADS) * THREADS;
+    do
+    {
+        msg_Dbg (obj, "synchronization");
+        total++;
+        msleep (10000);
+    }
+    while (vlc_atomic_get (&data.received) + vlc_atomic_get (&data.dropped)
+            < total);
+    msg_Unsubscribe (sub);
+
+    printf ("subscriber got %lu messages, %lu dropped\n",
+            (unsigned long)vlc_atomic_get (&data.received),
+            (unsigned long)vlc_atomic_get (&data.dropped));
+
+    vlc_object_release (obj);
+    libvlc_release (vlc);
+    return 0;
+}
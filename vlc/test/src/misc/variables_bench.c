@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * variables_bench.c: object variables lookup benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_misc_variables [iterations]
+ * Times var_GetInteger() on an object holding as many variables as a typical
+ * input or video output, then var_InheritInteger() from objects 1, 4 and 16
+ * levels below the holder of the variable, and of a configuration option
+ * that no object holds. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+
+#define ITERATIONS 1000000
+#define VARIABLES  200
+#define DEPTH      16
+
+static void bench (const char *label, unsigned count, vlc_object_t *obj,
+                   int64_t (*get) (vlc_object_t *, const char *),
+                   const char *name, int64_t expected)
+{
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < count; i++)
+        if (get (obj, name) != expected)
+            abort ();
+    mtime_t duration = mdate () - start;
+
+    printf ("%-24s %8.1f ns per call\n", label, duration * 1000. / count);
+}
+
+static int64_t Get (vlc_object_t *obj, const char *name)
+{
+    return var_GetInteger (obj, name);
+}
+
+static int64_t Inherit (vlc_object_t *obj, const char *name)
+{
+    return var_InheritInteger (obj, name);
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned count = (argc > 1) ? strtoul (argv[1], NULL, 10) : ITERATIONS;
+    vlc_object_t *chain[DEPTH + 1];
+    libvlc_instance_t *vlc;
+    char name[32], label[32];
+
+    if (count == 0)
+    {
+        fprintf (stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    vlc = libvlc_new (test_defaults_nargs, test_defaults_args);
+    assert (vlc != NULL);
+
+    /* The top object holds the variable, the others hold unrelated ones */
+    for (unsigned i = 0; i <= DEPTH; i++)
+    {
+        vlc_object_t *parent = i ? chain[i - 1]
+                                 : VLC_OBJECT (vlc->p_libvlc_int);
+
+        chain[i] = vlc_object_create (parent, sizeof (*chain[i]));
+        assert (chain[i] != NULL);
+        vlc_object_attach (chain[i], parent);
+        for (unsigned j = 0; j < VARIABLES; j++)
+        {
+            snprintf (name, sizeof (name), "bench-%u-%u", i, j);
+            var_Create (chain[i], name, VLC_VAR_INTEGER);
+        }
+    }
+    var_Create (chain[0], "bench-value", VLC_VAR_INTEGER);
+    var_SetInteger (chain[0], "bench-value", 42);
+
+    bench ("var_GetInteger", count, chain[0], Get, "bench-value", 42);
+    for (unsigned depth = 1; depth <= DEPTH; depth *= 4)
+    {
+        snprintf (label, sizeof (label), "var_InheritInteger %2u", depth);
+        bench (label, count, chain[depth], Inherit, "bench-value", 42);
+    }
+    bench ("var_InheritInteger conf", count, chain[DEPTH], Inherit,
+           "video-title-timeout",
+           var_InheritInteger (vlc->p_libvlc_int, "video-title-timeout"));
+
+    for (unsigned i = DEPTH + 1; i-- > 0;)
+        vlc_object_release (chain[i]);
+    libvlc_release (vlc);
+    return 0;
+}
@@ -0,0 +1,302 @@
+/*****************************************************************************
+ * httpd_bench.c: HTTP server load generator
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_network_httpd [clients] [idle] [seconds] [chunks per second]
+ * Idle connections send an incomplete request and then wait. */
+
+#include "../../libvlc/test.h"
+#include <../src/control/libvlc_internal.h>
+
+#include <vlc_common.h>
+#include <vlc_httpd.h>
+
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Clients connect to one stream, which is fed at a constant bit rate */
+#define PORT        18554
+#define CLIENTS     1000
+#define IDLE        0
+#define DURATION    10          /* seconds */
+#define CHUNK       (16 * 1024)
+#define CHUNK_RATE  25          /* chunks per second, i.e. ~3 Mbit/s */
+
+typedef struct
+{
+    unsigned connected;  /* clients which got an answer */
+    unsigned sustained;  /* clients which got data during the last second */
+    unsigned corrupted;  /* clients which got bad data */
+    uint64_t bytes;      /* received bytes */
+} bench_result_t;
+
+/* Each chunk starts with a magic and a sequence number, and is filled with
+ * the low byte of the sequence number. Slow clients may skip chunks. */
+static void chunk_fill (uint8_t *p, uint32_t seq)
+{
+    memcpy (p, "VLCB", 4);
+    SetDWLE (p + 4, seq);
+    memset (p + 8, seq & 0xff, CHUNK - 8);
+}
+
+typedef struct
+{
+    mtime_t  last;      /* last reception date */
+    unsigned eoh;       /* matched bytes of the end of the HTTP header */
+    unsigned offset;    /* offset in the current chunk */
+    uint32_t seq;       /* sequence number of the current chunk */
+    uint32_t prev_seq;
+    bool     ok;
+} bench_client_t;
+
+static void client_check (bench_client_t *c, const uint8_t *p, size_t len)
+{
+    static const char eoh[] = "\r\n\r\n";
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (c->eoh < 4)
+        {   /* skip the HTTP header */
+            c->eoh = (p[i] == eoh[c->eoh]) ? (c->eoh + 1) : (p[i] == '\r');
+            continue;
+        }
+
+        if (c->offset < 4)
+        {
+            if (p[i] != "VLCB"[c->offset])
+                c->ok = false;
+            if (c->offset == 0)
+                c->seq = 0;
+        }
+        else if (c->offset < 8)
+        {
+            c->seq |= p[i] << (8 * (c->offset - 4));
+            if (c->offset == 7)
+            {
+                if (c->prev_seq != 0 && c->seq <= c->prev_seq)
+                    c->ok = false;
+                c->prev_seq = c->seq;
+            }
+        }
+        else if (p[i] != (c->seq & 0xff))
+            c->ok = false;
+
+        if (++c->offset == CHUNK)
+            c->offset = 0;
+    }
+}
+
+static int client_connect (bool idle)
+{
+    struct sockaddr_in addr;
+    int fd = socket (AF_INET, SOCK_STREAM, 0);
+
+    if (fd == -1)
+        return -1;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (PORT);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    const char *request = idle ? "GET /bench" : "GET /bench HTTP/1.0\r\n\r\n";
+    ssize_t len = strlen (request);
+
+    if (connect (fd, (struct sockaddr *)&addr, sizeof (addr))
+     || send (fd, request, len, 0) != len)
+    {
+        close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Load generator, runs in a child process so that the server CPU time can be
+ * measured on its own. */
+static void client_run (unsigned clients, unsigned idle, unsigned duration,
+                        int result_fd)
+{
+    int *idle_fd = calloc (idle, sizeof (*idle_fd));
+    struct pollfd *ufd = calloc (clients, sizeof (*ufd));
+    bench_client_t *cl = calloc (clients, sizeof (*cl));
+    bench_result_t res = { 0, 0, 0, 0 };
+    static uint8_t buf[65536];
+
+    assert (ufd != NULL && cl != NULL && (idle_fd != NULL || idle == 0));
+
+    for (unsigned i = 0; i < idle; i++)
+        idle_fd[i] = client_connect (true);
+
+    for (unsigned i = 0; i < clients; i++)
+    {
+        ufd[i].fd = client_connect (false);
+        ufd[i].events = POLLIN;
+        cl[i].ok = true;
+        if (ufd[i].fd == -1)
+            fprintf (stderr, "client %u: cannot connect: %s\n", i,
+                     strerror (errno));
+    }
+
+    mtime_t start = mdate ();
+    mtime_t end = start + duration * CLOCK_FREQ;
+
+    for (mtime_t now = start; now < end; now = mdate ())
+    {
+        int val = poll (ufd, clients, 100);
+        if (val <= 0)
+            continue;
+
+        for (unsigned i = 0; i < clients; i++)
+        {
+            if (ufd[i].revents == 0)
+                continue;
+
+            ssize_t len = recv (ufd[i].fd, buf, sizeof (buf), 0);
+            if (len <= 0)
+            {   /* disconnected by the server */
+                close (ufd[i].fd);
+                ufd[i].fd = -1;
+                continue;
+            }
+            if (cl[i].last == 0)
+                res.connected++;
+            cl[i].last = now;
+            client_check (&cl[i], buf, len);
+            res.bytes += len;
+        }
+    }
+
+    for (unsigned i = 0; i < clients; i++)
+    {
+        if (cl[i].last >= end - CLOCK_FREQ)
+            res.sustained++;
+        if (!cl[i].ok)
+            res.corrupted++;
+        if (ufd[i].fd != -1)
+            close (ufd[i].fd);
+    }
+
+    for (unsigned i = 0; i < idle; i++)
+        if (idle_fd[i] != -1)
+            close (idle_fd[i]);
+
+    write (result_fd, &res, sizeof (res));
+    free (cl);
+    free (ufd);
+    free (idle_fd);
+}
+
+static double cpu_time (long *rss)
+{
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    *rss = ru.ru_maxrss;
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+         + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+int main (int argc, char *argv[])
+{
+    unsigned clients = (argc > 1) ? strtoul (argv[1], NULL, 0) : CLIENTS;
+    unsigned idle = (argc > 2) ? strtoul (argv[2], NULL, 0) : IDLE;
+    unsigned duration = (argc > 3) ? strtoul (argv[3], NULL, 0) : DURATION;
+    unsigned chunk_rate = (argc > 4) ? strtoul (argv[4], NULL, 0) : CHUNK_RATE;
+    static uint8_t chunk[CHUNK];
+    struct rlimit lim;
+    int fds[2];
+
+    /* one descriptor per client on each side */
+    rlim_t fds_needed = 2 * (clients + idle) + 64;
+    if (getrlimit (RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < fds_needed)
+    {
+        lim.rlim_cur = __MIN (fds_needed, lim.rlim_max);
+        setrlimit (RLIMIT_NOFILE, &lim);
+    }
+    signal (SIGPIPE, SIG_IGN);
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    httpd_host_t *host = httpd_HostNew (obj, "127.0.0.1", PORT);
+    assert (host != NULL);
+    httpd_stream_t *stream = httpd_StreamNew (host, "/bench",
+                                              "application/octet-stream",
+                                              NULL, NULL, NULL);
+    assert (stream != NULL);
+
+    assert (pipe (fds) == 0);
+    pid_t pid = fork ();
+    assert (pid != -1);
+    if (pid == 0)
+    {
+        close (fds[0]);
+        client_run (clients, idle, duration, fds[1]);
+        _exit (0);
+    }
+    close (fds[1]);
+
+    /* feed the stream until the load generator is done */
+    long rss_before, rss_after;
+    double cpu = cpu_time (&rss_before);
+    mtime_t start = mdate (), deadline = start;
+    struct pollfd ufd = { .fd = fds[0], .events = POLLIN };
+
+    for (uint32_t seq = 1; poll (&ufd, 1, 0) == 0; seq++)
+    {
+        chunk_fill (chunk, seq);
+        httpd_StreamSend (stream, chunk, sizeof (chunk));
+        deadline += CLOCK_FREQ / chunk_rate;
+        mwait (deadline);
+    }
+
+    double elapsed = (mdate () - start) / (double)CLOCK_FREQ;
+    cpu = cpu_time (&rss_after) - cpu;
+
+    bench_result_t res;
+    assert (read (fds[0], &res, sizeof (res)) == sizeof (res));
+    close (fds[0]);
+    waitpid (pid, NULL, 0);
+
+    httpd_StreamDelete (stream);
+    httpd_HostDelete (host);
+    libvlc_release (vlc);
+
+    double rate = res.bytes / elapsed / 1e6;
+    printf ("%u clients requested, %u connected, %u sustained, "
+            "%u idle connections\n", clients, res.connected, res.sustained,
+            idle);
+    if (res.corrupted > 0)
+        printf ("%u clients got corrupted data!\n", res.corrupted);
+    printf ("throughput: %.1f MB/s, server CPU: %.2f s in %.2f s "
+            "(%.1f MB/s per core)\n", rate, cpu, elapsed,
+            cpu > 0. ? res.bytes / cpu / 1e6 : 0.);
+    printf ("server memory: %ld kB peak, %ld kB before streaming\n",
+            rss_after, rss_before);
+    return res.corrupted > 0;
+}
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * preparser_bench.c: preparser worker threads benchmark
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: bench_src_playlist_preparser [files or directories...]
+ * All the files, by default the test samples, are queued for preparsing at
+ * once with 1, 2, 4 and 8 preparser threads, and the wall time until they
+ * are all preparsed is printed. */
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const unsigned threads[] = { 1, 2, 4, 8 };
+
+typedef struct
+{
+    char   **paths;
+    unsigned count;
+} corpus_t;
+
+static void corpus_add (corpus_t *corpus, const char *path)
+{
+    struct stat st;
+
+    if (stat (path, &st))
+    {
+        perror (path);
+        return;
+    }
+    if (S_ISREG (st.st_mode))
+    {
+        corpus->paths = realloc (corpus->paths,
+                                 (corpus->count + 1) * sizeof (char *));
+        assert (corpus->paths != NULL);
+        corpus->paths[corpus->count] = strdup (path);
+        assert (corpus->paths[corpus->count] != NULL);
+        corpus->count++;
+        return;
+    }
+    if (!S_ISDIR (st.st_mode))
+        return;
+
+    DIR *dir = opendir (path);
+    if (dir == NULL)
+    {
+        perror (path);
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir (dir)) != NULL)
+    {
+        char *sub;
+
+        if (ent->d_name[0] == '.')
+            continue;
+        if (asprintf (&sub, "%s/%s", path, ent->d_name) == -1)
+            abort ();
+        corpus_add (corpus, sub);
+        free (sub);
+    }
+    closedir (dir);
+}
+
+static void bench (const corpus_t *corpus, unsigned n)
+{
+    const char *argv[test_defaults_nargs + 1];
+    char arg[32];
+    libvlc_instance_t *vlc;
+
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    snprintf (arg, sizeof (arg), "--preparse-threads=%u", n);
+    argv[test_defaults_nargs] = arg;
+
+    vlc = libvlc_new (test_defaults_nargs + 1, argv);
+    assert (vlc != NULL);
+
+    libvlc_media_t **medias = malloc (corpus->count * sizeof (*medias));
+    assert (medias != NULL);
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < corpus->count; i++)
+    {
+        medias[i] = libvlc_media_new_path (vlc, corpus->paths[i]);
+        assert (medias[i] != NULL);
+        libvlc_media_parse_async (medias[i]);
+    }
+    /* Waits for the last one to be preparsed */
+    for (unsigned i = 0; i < corpus->count; i++)
+        libvlc_media_parse (medias[i]);
+    mtime_t duration = mdate () - start;
+
+    printf ("%u thread(s): %u files in %8.3f s, %8.3f ms per file\n", n,
+            corpus->count, duration / (double)CLOCK_FREQ,
+            duration / (1000. * corpus->count));
+
+    for (unsigned i = 0; i < corpus->count; i++)
+        libvlc_media_release (medias[i]);
+    free (medias);
+    libvlc_release (vlc);
+}
+
+int main (int argc, char *argv[])
+{
+    corpus_t corpus = { NULL, 0 };
+
+    if (argc > 1)
+        for (int i = 1; i < argc; i++)
+            corpus_add (&corpus, argv[i]);
+    else
+        corpus_add (&corpus, SRCDIR"/samples");
+
+    if (corpus.count == 0)
+    {
+        fprintf (stderr, "Usage: %s [files or directories...]\n", argv[0]);
+        return 1;
+    }
+
+    for (unsigned i = 0; i < sizeof (threads) / sizeof (threads[0]); i++)
+        bench (&corpus, threads[i]);
+
+    for (unsigned i = 0; i < corpus.count; i++)
+        free (corpus.paths[i]);
+    free (corpus.paths);
+    return 0;
+}